@@ -1,9 +1,9 @@
 #!/bin/sh
 # ----------------------------------------------------------
 # Build script for BEEP-8 applications under /sdk/app/
-# This script builds each application by entering its directory,
-# rebuilding its libraries, helper modules, and finally the main binary.
-# Currently, it handles the "hello" app as an example.
+# This script rebuilds the libraries and helper modules once, from
+# the "hello" app, then builds every app directory, thread_stress
+# included, through sdk/app/Makefile.
 # ----------------------------------------------------------
 
 set -e  # Exit immediately if any command fails
@@ -21,5 +21,5 @@ make helper
 # Return to the root of the app directory
 cd ../
 
-# Build the main application binary
+# Build every application
 make
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <beep8.h>
+
+// Measures the V-blank latency, the CPU cycles from the kernel taking the
+// interrupt to the return of the wait in the main thread, on two paths:
+//   - event: b8SysIrqClearAndWait(), woken by the kernel from the interrupt
+//     path, as b8SysGetIrqLatency() and pico8 stat(1005) report it
+//   - relay: the SCHED_IRQ thread that b8SysSetupIrqWait() used to create,
+//     which posts a semaphore the main thread waits on
+// The relay thread never exits, so that path is measured last.
+// The result is written to the log console.
+
+#define NUM_FRAMES    (600)
+
+typedef struct {
+  u32 min;
+  u32 max;
+  u64 sum;
+  u32 num;
+} Stats;
+
+static void _add( Stats* st, u32 cycles ){
+  if( 0 == st->num || cycles < st->min ) st->min = cycles;
+  if( cycles > st->max ) st->max = cycles;
+  st->sum += cycles;
+  st->num++;
+}
+
+static void _print( const char* name, const Stats* st ){
+  printf( "%-6s frames %u, latency cycles min %u avg %u max %u\n",
+    name, (unsigned)st->num, (unsigned)st->min,
+    (unsigned)( st->num ? st->sum / st->num : 0 ), (unsigned)st->max );
+}
+
+static sem_t  _sem_relay;
+
+// The relay thread as it was in sys.c.
+static void* _relay_thread( void* arg ){
+  (void)arg;
+  while(1){
+    pthread_yield();
+    sem_post( &_sem_relay );
+  }
+  return NULL;
+}
+
+static int _start_relay( void ){
+  if( sem_init( &_sem_relay, 0, 0 ) ) return -1;
+
+  pthread_attr_t attr;
+  pthread_attr_init( &attr );
+  pthread_attr_setschedpolicy( &attr, SCHED_IRQ );
+  struct sched_param param;
+  param.sched_priority = sched_get_priority_max( SCHED_IRQ );
+  pthread_attr_setschedparam( &attr, &param );
+  pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+  pthread_attr_setstacksize( &attr, 0x800 );
+  attr.irq_no = B8_IRQ_VBLK;
+  pthread_t th;
+  return pthread_create( &th, &attr, _relay_thread, NULL );
+}
+
+int main(void) {
+  Stats event = {};
+  b8SysSetupIrqWait( B8_IRQ_VBLK );
+  for( int nn=0 ; nn<NUM_FRAMES ; ++nn ){
+    if( b8SysIrqClearAndWait( B8_IRQ_VBLK ) ) continue;
+    _add( &event, b8SysGetIrqLatency( B8_IRQ_VBLK ) );
+  }
+
+  Stats relay = {};
+  if( _start_relay() ){
+    printf( "failed to create the relay thread\n" );
+    return 1;
+  }
+  for( int nn=0 ; nn<NUM_FRAMES ; ++nn ){
+    // As b8SysIrqClearAndWait() did: drop stale events, then wait for the next.
+    while( 0 == sem_trywait( &_sem_relay ) ){}
+    if( sem_wait( &_sem_relay ) ) continue;
+    _add( &relay, B8_DWT_CYCCNT - b8OsGetIrqCycle( B8_IRQ_VBLK ) );
+  }
+
+  _print( "event", &event );
+  _print( "relay", &relay );
+  return 0;
+}
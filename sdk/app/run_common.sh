@@ -61,7 +61,19 @@ fi
 
 # BEEP-8 helper tools
 PNG2C="$TOOL_TOP/png2c/$OS/$HW/png2c"
-GENB8ROM="$TOOL_TOP/genb8rom/$OS/$HW/genb8rom"
+# genb8rom is built from its source with the host compiler, see build_genb8rom()
+HOST_CXX="${HOST_CXX:-g++}"
+GENB8ROM="$OBJDIR/genb8rom"
+# Comma separated patterns of romfs files to compress with ZPack, e.g. "*.map,*.txt"
+GENB8ROM_ZPACK="${GENB8ROM_ZPACK:-}"
+GENB8ROM_OPTS=()
+if [ -n "$GENB8ROM_ZPACK" ]; then
+  GENB8ROM_OPTS+=( -z "$GENB8ROM_ZPACK" )
+fi
+# 1 to keep file names only in the name index (genb8rom -c)
+if [ "${GENB8ROM_COMPACT:-0}" = 1 ]; then
+  GENB8ROM_OPTS+=( -c 1 )
+fi
 RELB8ROM="$TOOL_TOP/relb8rom/$OS/$HW/relb8rom"
 
 # Compilation flags
@@ -211,6 +223,13 @@ compile() {
   done
 }
 
+# Build genb8rom from tool/genb8rom, so the ROM gets the romfs format of this tree
+build_genb8rom() {
+  echo "=== building $GENB8ROM ==="
+  mkdir -p "$OBJDIR"
+  "$HOST_CXX" -O2 -Wall -std=c++17 -o "$GENB8ROM" "$TOOL_TOP/genb8rom/main.cpp"
+}
+
 # Link and generate ROM
 link_and_rom() {
   echo "=== linking → $ELF ==="
@@ -226,7 +245,8 @@ link_and_rom() {
 
   echo "=== generating B8 ROM → $ROM ==="
   mkdir -p romfs
-  (cd romfs && "$GENB8ROM" -i "*" -o "../$OBJDIR/romfs.bin")
+  build_genb8rom
+  (cd romfs && "../$GENB8ROM" -i "*" -o "../$OBJDIR/romfs.bin" ${GENB8ROM_OPTS[@]+"${GENB8ROM_OPTS[@]}"})
   "$RELB8ROM" -i "$BIN" -r "$OBJDIR/romfs.bin" -o "$ROM"
 
   if [ "${EXPORT_LIST:-0}" -eq 1 ]; then
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <beep8.h>
+
+// Creates and joins thousands of short-lived threads, and checks that the
+// stack pool and the thread slots do not grow. Each round runs:
+//   - joinable workers of several stack sizes, whose return values are checked
+//   - a detached worker, reclaimed by the kernel when it exits
+//   - a worker canceled while it is blocked in sem_wait()
+// The result is written to the log console.
+
+#define NUM_ROUNDS    (2000)
+#define NUM_WARMUP    (10)    // rounds before the baseline is taken
+#define NUM_WORKERS   (4)
+
+static const size_t _stack_sizes[ NUM_WORKERS ] = { 0x400, 0x800, 0x1000, 0x200 };
+
+static sem_t  _sem_never;     // never posted
+static sem_t  _sem_detached;  // posted by the detached worker
+
+static void* _worker( void* arg ){
+  return (void*)( (uintptr_t)arg + 1 );
+}
+
+static void* _detached_worker( void* arg ){
+  (void)arg;
+  sem_post( &_sem_detached );
+  return NULL;
+}
+
+static void* _blocked_worker( void* arg ){
+  (void)arg;
+  sem_wait( &_sem_never );
+  return NULL;
+}
+
+static int _spawn( pthread_t* th, void* (*func)(void*), void* arg, size_t stack_size, int detachstate ){
+  pthread_attr_t attr;
+  pthread_attr_init( &attr );
+  pthread_attr_setstacksize( &attr, stack_size );
+  pthread_attr_setdetachstate( &attr, detachstate );
+  return pthread_create( th, &attr, func, arg );
+}
+
+// Returns the number of errors in the round.
+static int _round( int round ){
+  int errors = 0;
+  pthread_t th[ NUM_WORKERS ];
+  for( int nn=0 ; nn<NUM_WORKERS ; ++nn ){
+    const uintptr_t arg = (uintptr_t)( round * NUM_WORKERS + nn );
+    if( _spawn( &th[ nn ], _worker, (void*)arg, _stack_sizes[ nn ], PTHREAD_CREATE_JOINABLE ) ){
+      ++errors;
+      th[ nn ] = B8_OS_INVALID_PID;
+    }
+  }
+
+  pthread_t detached;
+  if( _spawn( &detached, _detached_worker, NULL, 0x400, PTHREAD_CREATE_DETACHED ) ){
+    ++errors;
+  } else {
+    sem_wait( &_sem_detached );
+  }
+
+  pthread_t blocked;
+  if( _spawn( &blocked, _blocked_worker, NULL, 0x400, PTHREAD_CREATE_JOINABLE ) ){
+    ++errors;
+  } else {
+    void* value = NULL;
+    pthread_cancel( blocked );
+    if( pthread_join( blocked, &value ) || value != PTHREAD_CANCELED ) ++errors;
+  }
+
+  for( int nn=0 ; nn<NUM_WORKERS ; ++nn ){
+    if( th[ nn ] == B8_OS_INVALID_PID ) continue;
+    void* value = NULL;
+    const uintptr_t expected = (uintptr_t)( round * NUM_WORKERS + nn ) + 1;
+    if( pthread_join( th[ nn ], &value ) || (uintptr_t)value != expected ) ++errors;
+  }
+  return errors;
+}
+
+int main(void) {
+  sem_init( &_sem_never, 0, 0 );
+  sem_init( &_sem_detached, 0, 0 );
+
+  b8OsStackPoolInfo base;
+  int base_threads = 0;
+  int errors = 0;
+  for( int round=0 ; round<NUM_ROUNDS ; ++round ){
+    errors += _round( round );
+    if( round == NUM_WARMUP ){
+      usleep( 20000 );  // let the detached worker finish
+      b8OsGetStackPoolInfo( &base );
+      base_threads = b8OsGetThreadInfo( NULL, 0 );
+    }
+    if( round % 200 == 0 ){
+      b8OsStackPoolInfo info;
+      b8OsGetStackPoolInfo( &info );
+      printf( "round %d: threads %d, stack pool carved %u free %u of %u, errors %d\n",
+        round, b8OsGetThreadInfo( NULL, 0 ),
+        (unsigned)info.carved, (unsigned)info.free, (unsigned)info.size, errors );
+    }
+  }
+
+  usleep( 20000 );
+  b8OsStackPoolInfo info;
+  b8OsGetStackPoolInfo( &info );
+  const int threads = b8OsGetThreadInfo( NULL, 0 );
+  const int leaked = info.carved != base.carved || threads != base_threads;
+  printf( "%d threads created: threads %d (%d), stack pool carved %u (%u), errors %d\n",
+    NUM_ROUNDS * (NUM_WORKERS + 2), threads, base_threads,
+    (unsigned)info.carved, (unsigned)base.carved, errors );
+  printf( "%s\n", ( errors || leaked ) ? "FAIL" : "PASS" );
+  return 0;
+}
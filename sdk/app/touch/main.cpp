@@ -61,40 +61,39 @@ int main(int argc,char* argv[]){
       b8PpuPushFrontOT( &_ppu_cmd  , OTZ_CLEAR, pp );
     }
 
-    const auto& status = decoder.GetStatus();
-    for (const auto& [key, value] : status) {
+    for (const HifPoint& point : decoder.GetStatus()) {
       b8PpuRect* pp = b8PpuRectAllocZ( &_ppu_cmd , OTZ_RECT );
-      pp->pal = value->hdl & 15;
+      pp->pal = point.hdl & 15;
       const int RR =16;
-      pp->x = (value->ev.xp>>4)-RR;
-      pp->y = (value->ev.yp>>4)-RR;
+      pp->x = (point.ev.xp>>4)-RR;
+      pp->y = (point.ev.yp>>4)-RR;
       pp->w = (RR*2);
       pp->h = (RR*2);
 
-      switch(value->ev.type){
+      switch(point.ev.type){
         case  B8_HIF_EV_TOUCH_START:
-          fprintf( fp_bgprint, "%d t start\n" , (int)value->hdl );
+          fprintf( fp_bgprint, "%d t start\n" , (int)point.hdl );
           break;
         case  B8_HIF_EV_TOUCH_MOVE:
-          fprintf( fp_bgprint, "%d t move\n" , (int)value->hdl );
+          fprintf( fp_bgprint, "%d t move\n" , (int)point.hdl );
           break;
         case  B8_HIF_EV_TOUCH_CANCEL:
-          fprintf( fp_bgprint, "%d t cancel\n", (int)value->hdl );
+          fprintf( fp_bgprint, "%d t cancel\n", (int)point.hdl );
           break;
         case  B8_HIF_EV_TOUCH_END:
-          fprintf( fp_bgprint, "%d t end\n", (int)value->hdl );
+          fprintf( fp_bgprint, "%d t end\n", (int)point.hdl );
           break;
         case  B8_HIF_EV_MOUSE_DOWN:
-          fprintf( fp_bgprint, "%d m down %d %d\n" , (int)value->hdl , value->ev.xp>>4 , value->ev.yp>>4 );
+          fprintf( fp_bgprint, "%d m down %d %d\n" , (int)point.hdl , point.ev.xp>>4 , point.ev.yp>>4 );
           break;
         case  B8_HIF_EV_MOUSE_MOVE:
-          fprintf( fp_bgprint, "%d m move %d %d\n" , (int)value->hdl , value->ev.xp>>4 , value->ev.yp>>4 );
+          fprintf( fp_bgprint, "%d m move %d %d\n" , (int)point.hdl , point.ev.xp>>4 , point.ev.yp>>4 );
           break;
         case  B8_HIF_EV_MOUSE_HOVER_MOVE:
-          fprintf( fp_bgprint, "%d m hover %d %d\n" , (int)value->hdl , value->ev.xp>>4 , value->ev.yp>>4 );
+          fprintf( fp_bgprint, "%d m hover %d %d\n" , (int)point.hdl , point.ev.xp>>4 , point.ev.yp>>4 );
           break;
         case  B8_HIF_EV_MOUSE_UP:
-          fprintf( fp_bgprint, "%d m up %d %d\n" , (int)value->hdl , value->ev.xp>>4 , value->ev.yp>>4 );
+          fprintf( fp_bgprint, "%d m up %d %d\n" , (int)point.hdl , point.ev.xp>>4 , point.ev.yp>>4 );
           break;
       }
     }
@@ -3,9 +3,9 @@
  * @brief Module for decoding and managing HIF events in the BEEP-8 system.
  * 
  * This module provides functionality for decoding and managing human interface events (`b8HifEvent`)
- * from the Hardware Interface (HIF) system of the BEEP-8 system. The `CHifDecoder` class fetches
- * and manages events, storing them in an internal map, and allows retrieval of the current status
- * of input points such as touch and mouse events.
+ * from the Hardware Interface (HIF) system of the BEEP-8 system. The `CHifDecoder` class takes
+ * events in place with `b8HifPeekEvents()`, and tracks up to `CHifDecoder::MAX_POINTS` input
+ * points, such as touch and mouse points, in a fixed array. It never allocates memory.
  * 
  * **Note:**
  * The `hif_decoder.h` is a utility library, and the use of this module is not mandatory. If you wish
@@ -14,9 +14,22 @@
  * 
  * ### Features
  * 
- * - **HifPoint**: Structure representing a single input point (touch or mouse).
+ * - **HifPoint**: Structure representing a single input point (touch or mouse), with its gesture state.
+ * - **HifPinch**: Distance between the first two touch points, for pinch gestures.
  * - **CHifDecoder**: Class for decoding and managing HIF events.
  * 
+ * ### Gestures
+ * 
+ * Gesture state is updated as the events come, so reading it costs nothing:
+ * - **Tap**: `HifPoint::tap` is set on the last event of a point released within
+ *   `TAP_MAX_MS` without moving farther than `TAP_SLOP` from where it started.
+ * - **Long press**: `HifPoint::long_press` is set once a point has been held for
+ *   `LONG_PRESS_MS` without moving.
+ * - **Swipe**: `HifPoint::vx` and `vy` are the smoothed velocity. `HifPoint::swipe` is set
+ *   on the last event of a point released faster than `SWIPE_MIN_SPEED`.
+ * - **Pinch**: `CHifDecoder::GetPinch()` gives the distance between the first two touch
+ *   points, and the distance when the second one touched.
+ * 
  * ### Usage Example
  * 
  * Here is an example of how to use this module to fetch and process events:
@@ -27,32 +40,31 @@
     static CHifDecoder decoder;
 
     void some_func() {
-      const auto& status = decoder.GetStatus();
-      for (const auto& [key, value] : status) {
-        switch (value->ev.type) {
+      for (const HifPoint& point : decoder.GetStatus()) {
+        switch (point.ev.type) {
           case B8_HIF_EV_TOUCH_START:
-            printf(fp_bgprint, "%d t start\n", (int)value->hdl);
+            printf(fp_bgprint, "%d t start\n", (int)point.hdl);
             break;
           case B8_HIF_EV_TOUCH_MOVE:
-            printf(fp_bgprint, "%d t move\n", (int)value->hdl);
+            printf(fp_bgprint, "%d t move\n", (int)point.hdl);
             break;
           case B8_HIF_EV_TOUCH_CANCEL:
-            printf(fp_bgprint, "%d t cancel\n", (int)value->hdl);
+            printf(fp_bgprint, "%d t cancel\n", (int)point.hdl);
             break;
           case B8_HIF_EV_TOUCH_END:
-            printf(fp_bgprint, "%d t end\n", (int)value->hdl);
+            printf(fp_bgprint, "%d t end%s\n", (int)point.hdl, point.tap ? " tap" : "");
             break;
           case B8_HIF_EV_MOUSE_DOWN:
-            printf(fp_bgprint, "%d m down %d %d\n", (int)value->hdl, value->ev.xp >> 4, value->ev.yp >> 4);
+            printf(fp_bgprint, "%d m down %d %d\n", (int)point.hdl, point.ev.xp >> 4, point.ev.yp >> 4);
             break;
           case B8_HIF_EV_MOUSE_MOVE:
-            printf(fp_bgprint, "%d m move %d %d\n", (int)value->hdl, value->ev.xp >> 4, value->ev.yp >> 4);
+            printf(fp_bgprint, "%d m move %d %d\n", (int)point.hdl, point.ev.xp >> 4, point.ev.yp >> 4);
             break;
           case B8_HIF_EV_MOUSE_HOVER_MOVE:
-            printf(fp_bgprint, "%d m hover %d %d\n", (int)value->hdl, value->ev.xp >> 4, value->ev.yp >> 4);
+            printf(fp_bgprint, "%d m hover %d %d\n", (int)point.hdl, point.ev.xp >> 4, point.ev.yp >> 4);
             break;
           case B8_HIF_EV_MOUSE_UP:
-            printf(fp_bgprint, "%d m up %d %d\n", (int)value->hdl, value->ev.xp >> 4, value->ev.yp >> 4);
+            printf(fp_bgprint, "%d m up %d %d\n", (int)point.hdl, point.ev.xp >> 4, point.ev.yp >> 4);
             break;
         }
       }
@@ -65,7 +77,7 @@
 
 #pragma once
 
-#include <map>
+#include <span>
 #include <b8/hif.h>
 
 /**
@@ -73,12 +85,12 @@
  * 
  * The `HifPoint` structure represents an active input point from the HIF system,
  * such as a touch or mouse event. It contains information about the event type,
- * a unique handle, and the event data itself.
+ * a unique handle, the latest event data and the gesture state of the point.
  * 
  * @note
  * - The `ev.xp` and `ev.yp` members of the `b8HifEvent` structure are 16-bit signed fixed-point numbers
  *   with 4 fractional bits. To obtain the integer part of the coordinates, shift right by 4 bits
- *   (i.e., `ev.xp >> 4` and `ev.yp >> 4`).
+ *   (i.e., `ev.xp >> 4` and `ev.yp >> 4`). `start_xp`, `start_yp`, `vx` and `vy` use the same unit.
  */
 struct HifPoint {
   /**
@@ -92,7 +104,22 @@ struct HifPoint {
 
   u32 hdl = 0;            /**< Unique handle for the input point */
   PointType ptype = None; /**< Type of the input point (Mouse or Touch) */
-  b8HifEvent ev;          /**< Event data associated with the input point */
+  b8HifEvent ev = {};     /**< Latest event of the input point */
+
+  s16 start_xp = 0;       /**< X position where the point started */
+  s16 start_yp = 0;       /**< Y position where the point started */
+  u32 start_cyc = 0;      /**< CPU cycle counter when the point started */
+  u32 vel_cyc = 0;        /**< CPU cycle counter of the last velocity update */
+  s16 vel_xp = 0;         /**< Position at the last velocity update */
+  s16 vel_yp = 0;
+  s32 vx = 0;             /**< Smoothed X velocity, per second */
+  s32 vy = 0;             /**< Smoothed Y velocity, per second */
+  bool moved = false;     /**< Went farther than `CHifDecoder::TAP_SLOP` from the start */
+  bool long_press = false;/**< Held for `CHifDecoder::LONG_PRESS_MS` without moving */
+  bool tap = false;       /**< Released as a tap; set on the last event only */
+  bool swipe = false;     /**< Released as a swipe; set on the last event only */
+
+  HifPoint() = default;
 
   /**
    * @brief Constructs a `HifPoint` with the given event.
@@ -103,32 +130,60 @@ struct HifPoint {
     : ev(ev_) {}
 };
 
-class ImplCHifDecoder;
+/**
+ * @brief Distance between the first two touch points.
+ * 
+ * Distances are in 1/16 pixels, like `b8HifEvent::xp`. Compare `dist` with `dist_start`
+ * for the scale of a pinch.
+ */
+struct HifPinch {
+  bool active = false;  /**< Two or more touch points are down */
+  u32 dist = 0;         /**< Current distance */
+  u32 dist_start = 0;   /**< Distance when the second of the two points touched */
+  u32 hdl0 = 0;         /**< Handles of the two points */
+  u32 hdl1 = 0;
+};
 
 /**
  * @brief Class for decoding and managing HIF events.
  * 
  * The `CHifDecoder` class fetches and manages human interface events from the
- * Hardware Interface (HIF) system. It maintains an internal map of active input
- * points (`HifPoint` instances), identified by their event identifiers.
+ * Hardware Interface (HIF) system. Active input points (`HifPoint` instances)
+ * are kept in a fixed array, in the order they started, and are found by their
+ * event identifiers through a table, so no event costs a memory allocation.
  */
 class CHifDecoder {
-  ImplCHifDecoder* impl = nullptr;
+public:
+  static constexpr size_t MAX_POINTS      = 10;       /**< Input points tracked at once; more are ignored */
+  static constexpr s32    TAP_SLOP        = 8 << 4;   /**< Movement that is not a tap, in 1/16 pixels */
+  static constexpr u32    TAP_MAX_MS      = 250;      /**< Longest press that is a tap */
+  static constexpr u32    LONG_PRESS_MS   = 500;      /**< Shortest press that is a long press */
+  static constexpr s32    SWIPE_MIN_SPEED = 200 << 4; /**< Slowest release that is a swipe, in 1/16 pixels per second */
+
+private:
+  HifPoint  _points[ MAX_POINTS ];
+  size_t    _num = 0;
+  u8        _slot_of_id[ 256 ];   // index in _points + 1, or 0
+  u32       _hdl = 1;
+  HifPinch  _pinch;
+
+  HifPoint* Find( u8 identifier_ );
+  HifPoint* Add( const b8HifEvent& ev_ );
+  void      Remove( size_t index_ );
+  void      OnEvent( const b8HifEvent& ev_ , u32 cyc_ );
+  void      UpdateGestures( u32 cyc_ );
+  void      UpdatePinch();
 
 public:
   /**
-   * @brief Constructs a `CHifDecoder` object.
-   * 
-   * Initializes the internal implementation of the decoder.
+   * @brief Constructs a `CHifDecoder` object with no input points.
    */
   CHifDecoder();
 
   /**
-   * @brief Destructs the `CHifDecoder` object.
-   * 
-   * Cleans up the internal implementation of the decoder.
+   * @brief Forgets every input point, as if the decoder was constructed again.
    */
-  ~CHifDecoder();
+  void Reset();
 
   /**
    * @brief Retrieves the current mouse or touch panel status.
@@ -161,26 +216,34 @@ public:
    * @brief Retrieves the current status of active input points.
    * 
    * This function processes new HIF events and updates the internal state.
-   * It returns a constant reference to a map containing pointers to
-   * `HifPoint` instances, keyed by their event identifiers (`u8`).
-   * The map represents the current active input points, such as ongoing
-   * touch or mouse interactions.
+   * It returns the active input points, such as ongoing touch or mouse
+   * interactions, in the order they started. A point whose last event is
+   * TOUCH_END, TOUCH_CANCEL or MOUSE_UP is returned once more, then removed
+   * by the next call.
    * 
    * **Usage Example:**
    * ```cpp
-   * const auto& status = decoder.GetStatus();
-   * for (const auto& [id, point] : status) {
-   *     // Use point->ev.xp and point->ev.yp (shifted right by 4 bits for integer part)
-   *     int x = point->ev.xp >> 4;
-   *     int y = point->ev.yp >> 4;
+   * for (const HifPoint& point : decoder.GetStatus()) {
+   *     // Use point.ev.xp and point.ev.yp (shifted right by 4 bits for integer part)
+   *     int x = point.ev.xp >> 4;
+   *     int y = point.ev.yp >> 4;
    *     // Handle different event types
-   *     switch (point->ev.type) {
+   *     switch (point.ev.type) {
    *         // ...
    *     }
    * }
    * ```
    * 
-   * @return A constant reference to a map of active input points.
+   * @return The active input points, valid until the next call.
+   */
+  std::span<const HifPoint> GetStatus();
+
+  /**
+   * @brief Retrieves the pinch state, as of the last `GetStatus()` call.
+   * 
+   * @return The distance between the first two touch points.
    */
-  const std::map<u8, HifPoint*>& GetStatus();
+  const HifPinch& GetPinch() const {
+    return  _pinch;
+  }
 };
@@ -157,6 +157,8 @@ public:
  * @brief Class for Huffman decoding.
  * 
  * This class provides methods to decode data that was encoded using Huffman coding.
+ * The code table is expanded into 8-bit lookup tables, so most symbols are
+ * decoded with one or two table lookups instead of one tree step per bit.
  */
 class CHuffmanDecoder {
   std::shared_ptr< Pipe::CPipe > _pipe_in  = std::make_shared< Pipe::CNullPipe >();
@@ -175,9 +177,10 @@ private:
   /**
    * @brief Helper method to decode flat (non-Huffman encoded) data.
    * 
+   * @param byte_size_ The size of the data following the header.
    * @return The result of the decoding process.
    */
-  CHuffmanDecoder::DecodeResult  _DoDecodeFlat();
+  CHuffmanDecoder::DecodeResult  _DoDecodeFlat( u32 byte_size_ );
 
 public:
   /**
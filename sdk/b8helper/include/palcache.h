@@ -0,0 +1,120 @@
+/**
+ * @file palcache.h
+ * @brief Shadow palette state that removes redundant SETPAL and FLUSH commands.
+ *
+ * Every palette change used to cost a SETPAL and a palette FLUSH, and flushes
+ * are expensive for the PPU (see b8PpuSetpalAllocZPB in ppu.h). CPalCache sits
+ * between the drawing code and the command buffer and keeps, for each OT depth,
+ * the palette entries written at that depth during the current frame.
+ *
+ * ### How it works
+ *
+ * Commands pushed to the back of one OT depth run one after another, so the
+ * palette seen at the tail of a depth is known once this frame wrote it there.
+ *
+ * - **Redundant changes** that write the value an entry already holds at that
+ *   depth are dropped.
+ * - **Consecutive changes** to the same palsel at the same depth, with no draw
+ *   in between, are merged into one SETPAL through its `wmask`.
+ * - **FLUSH** is emitted once, right before the next draw at that depth, or at
+ *   the tail of the depth by End() if nothing was drawn there after the change.
+ *
+ * Draw commands that read the palette must call Depend() before they are
+ * pushed. SETPAL commands that bypass the cache at a depth make its shadow
+ * state stale, so all palette changes of a depth should go through the cache.
+ * Depths from MAX_DEPTH up are not cached; changes there are emitted as before.
+ *
+ * ### Usage Example
+ *
+ * @code
+ * static palcache::CPalCache _palcache;
+ *
+ * _palcache.Begin( &_ppu_cmd );     // after b8PpuClearOT()
+ * _palcache.Set( otz, palsel, 1<<c0, pidx );
+ * _palcache.Depend( otz );
+ * b8PpuRect* pp = b8PpuRectAllocZPB( &_ppu_cmd, otz );
+ * ...
+ * _palcache.End();                  // before b8PpuHaltAlloc()
+ * @endcode
+ */
+#pragma once
+#include <b8/ppu.h>
+
+namespace palcache {
+
+  constexpr u32 MAX_DEPTH   = 16;   ///< Number of cached OT depths
+  constexpr u32 NUM_PALSEL  = 16;   ///< Number of palettes
+  constexpr u32 NUM_PIDX    = 16;   ///< Entries in one palette
+
+  /**
+   * @struct Stats
+   * @brief Commands of one frame. Without the cache, every Set() costs one SETPAL and one FLUSH.
+   */
+  struct Stats {
+    u32 set_calls = 0;       ///< Number of Set() calls
+    u32 setpal_emitted = 0;  ///< SETPAL commands written to the command buffer
+    u32 flush_emitted = 0;   ///< Palette FLUSH commands written to the command buffer
+
+    u32 SetpalAvoided() const { return set_calls - setpal_emitted; }
+    u32 FlushAvoided()  const { return set_calls > flush_emitted ? set_calls - flush_emitted : 0; }
+  };
+
+  /**
+   * @class CPalCache
+   * @brief Per OT depth shadow of the palette for one command buffer.
+   */
+  class CPalCache {
+    struct Depth {
+      b8PpuSetpal* _pending[ NUM_PALSEL ];  ///< SETPAL still open for merging, per palsel
+      u64   _value[ NUM_PALSEL ];           ///< Known entries, 4 bits each
+      u16   _known[ NUM_PALSEL ];           ///< Entries written at this depth this frame
+      bool  _flush;                         ///< A FLUSH is owed before the next draw
+    };
+
+    b8PpuCmd* _cmd = nullptr;
+    Depth     _depth[ MAX_DEPTH ] = {};
+    Stats     _cur;
+    Stats     _last;
+
+    void  _Flush( u32 otz_ );
+  public:
+    /**
+     * @brief Starts a frame. The shadow state is cleared.
+     *
+     * @param cmd_ Command buffer of the frame, with its OT already cleared.
+     */
+    void  Begin( b8PpuCmd* cmd_ );
+
+    /**
+     * @brief Changes palette entries at an OT depth.
+     *
+     * @param otz_    OT depth of the change.
+     * @param palsel_ Palette to change, 0-15.
+     * @param wmask_  Entries to change. Bit n selects pidx_[n].
+     * @param pidx_   16 color indices. Only the entries selected by wmask_ are read.
+     */
+    void  Set( u32 otz_, u8 palsel_, u16 wmask_, const u8* pidx_ );
+
+    /**
+     * @brief Declares that the next command at otz_ reads the palette.
+     *
+     * Emits the FLUSH owed by earlier changes at otz_, if any.
+     *
+     * @param otz_ OT depth of the draw command that follows.
+     */
+    void  Depend( u32 otz_ ){
+      if( otz_ < MAX_DEPTH && _depth[ otz_ ]._flush ) _Flush( otz_ );
+    }
+
+    /**
+     * @brief Ends a frame. Emits the FLUSH commands still owed.
+     */
+    void  End();
+
+    /**
+     * @brief Gets the counters of the last frame finished by End().
+     */
+    const Stats& GetStats() const { return _last; }
+  };
+
+} // namespace palcache
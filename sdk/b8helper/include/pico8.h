@@ -113,7 +113,8 @@ namespace pico8 {
     NOT_DURING_DRAWING, ///< Attempt to perform drawing outside of a valid drawing context.
     INVALID_PARAM,      ///< An invalid parameter was passed to a function.
     NOT_INITIALIZED,
-    EMPTY_SPAN
+    EMPTY_SPAN,
+    SOUND_NOT_STARTED   ///< The sequencer thread of `sfx()` and `music()` could not be started.
   };
   void  seterr( Error error );
 
@@ -919,6 +920,49 @@ namespace pico8 {
    */
   void dprintenable(bool enable);
 
+  /**
+   * @brief Enables or disables double-buffered PPU command lists.
+   *
+   * When enabled, the next frame is recorded into a second command buffer while the
+   * PPU is still consuming the previous one, instead of waiting for the V-blank first.
+   * Frames are still submitted once per V-blank, so input latency does not change.
+   *
+   * By default, double buffering is disabled. The change takes effect at the start of
+   * the next frame.
+   *
+   * @param enable Set to `true` to overlap frame building with PPU execution.
+   *
+   * @note Data referenced by the previous frame, such as BG maps updated with `mset()`,
+   *       may be modified while the PPU is still reading it.
+   */
+  void dbufenable(bool enable);
+
+  /**
+   * @brief Enables or disables the cycle profiler of the main loop.
+   *
+   * The main loop is measured in the zones "update", "draw", "bgprint" and
+   * "vsync". Code can add its own zones with `B8_PROF_SCOPE()` from prof.h.
+   * The overlay shows, per zone, the calls and the last/avg/max cycles per
+   * frame in percent of the last frame. Below them, it shows each thread's
+   * share of the frame and how many times it was switched in during the frame.
+   *
+   * By default, the profiler is disabled.
+   *
+   * @param enable  Set to `true` to record zones.
+   * @param overlay Set to `true` to also print the statistics on screen.
+   */
+  void profenable(bool enable, bool overlay = true);
+
+  /**
+   * @brief Writes the zones of the last frame to stdout, which goes out over SCI.
+   *
+   * The dump is binary. tool/b8prof converts a capture of it into folded
+   * stacks for flame graph tools.
+   *
+   * @return Number of bytes written, or -1 on error.
+   */
+  int profdump();
+
   /**
    * @brief Prints formatted text at a specified position and palette on the background layer.
    *
@@ -1285,6 +1329,39 @@ namespace pico8 {
    *               sub-pixel precision.
    * - `stat(34)`: Returns 1 if the left mouse button is pressed. Use 
    *               `mousestatus()` for full mouse button status in BEEP-8.
+   * - `stat(24)`: The music frame being played, or -1.
+   * 
+   * BEEP-8 specific indices, for rendering diagnostics:
+   * - `stat(1000)`: Words used in the PPU command buffer so far this frame.
+   * - `stat(1001)`: SETPAL commands emitted by `pal()`/`setpal()` in the last frame.
+   * - `stat(1002)`: SETPAL commands avoided in the last frame, dropped as redundant
+   *                 or merged into an earlier SETPAL.
+   * - `stat(1003)`: Palette FLUSH commands emitted in the last frame.
+   * - `stat(1004)`: Palette FLUSH commands avoided in the last frame.
+   * - `stat(1005)`: CPU cycles from the last vblank interrupt to the main loop
+   *                 waking up from its wait for it.
+   * - `stat(1006)`: CPU cycles from the touch or mouse events of the last frame
+   *                 being received to the main loop taking them.
+   * 
+   * When b8lib is built with `B8_PPU_STATS=1`, the PPU command statistics of
+   * the last frame are available too. Otherwise, these return 0:
+   * - `stat(1010)`-`stat(1018)`: Commands allocated, per kind: RECT, SPRITE,
+   *                 POLY, LINE, BG, SETPAL, FLUSH, LOADIMG and other commands.
+   * - `stat(1020)`: Words spent on JMP commands linking the OT.
+   * - `stat(1021)`: Words used in the command buffer.
+   * - `stat(1022)`: Highest `stat(1021)` of any frame so far.
+   * - `stat(1023)`: Number of frames executed.
+   * - `stat(1100+z)`: Words linked to OT depth z.
+   * 
+   * Sequencer diagnostics (see `sequencer.h`):
+   * - `stat(1200)`: Sequencer ticks run.
+   * - `stat(1201)`: CPU cycles of the last sequencer tick.
+   * - `stat(1202)`: Most CPU cycles of any sequencer tick.
+   * - `stat(1203)`: Times a track ran out of its per-tick operation budget.
+   * - `stat(1204)`: Voices taken from another sfx or from the music.
+   * - `stat(1205)`: Voices in use.
+   * - `stat(1206)`: APU register commands recorded.
+   * - `stat(1207)`: APU register commands dropped as redundant.
    * 
    * @param index The index of the system information to retrieve. Use 32, 33, or 34 
    *              only for legacy PICO-8 compatibility. BEEP-8 provides clearer 
@@ -1753,6 +1830,41 @@ namespace pico8 {
    */
   Color sget(u8 x, u8 y , u8 bank = 0 );
 
+  /**
+   * @brief Sets the sound bank that `sfx()` and `music()` play from.
+   *
+   * BEEP-8 specific. The bank is in the format described in `sequencer.h`, and is
+   * not copied. A bank compressed with ZPack is expanded by `CSequencer::UnpackBank()`.
+   * Setting a bank stops the sfx and the music.
+   *
+   * @param bank The sound bank.
+   * @return false if the bank is invalid.
+   */
+  bool sfxbank(std::span<const u8> bank);
+
+  /**
+   * @brief Plays or stops a sound effect.
+   *
+   * The sound is played by the sequencer thread, which is started by the first
+   * call to `sfxbank()`, `sfx()` or `music()`. If it cannot be started, the call
+   * sets the SOUND_NOT_STARTED error and does nothing; the next call tries again.
+   *
+   * @param n The sfx number in the bank, or -1 to stop.
+   * @param channel The channel (voice) to play on, 0 to 7, or -1 to let the sequencer choose
+   *                one. With n = -1, the channel to stop, or -1 for all channels.
+   */
+  void sfx(int n, int channel = -1);
+
+  /**
+   * @brief Plays or stops the music.
+   *
+   * @param n The music frame to start from, or -1 to stop.
+   * @param fade_len Not supported; ignored.
+   * @param channel_mask Channels that `sfx()` without a channel leaves to the music,
+   *                     bit n for channel n.
+   */
+  void music(int n = 0, int fade_len = 0, int channel_mask = 0);
+
   class ImplPico8;
 
   /**
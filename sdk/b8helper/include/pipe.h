@@ -9,8 +9,17 @@
  * ### Features
  * 
  * - **CNullPipe**: A null pipe class that does nothing.
+ * - **CMemReaderPipe**: A read-only pipe over a buffer it does not own, such as data in ROM.
  * - **CMemBufferPipe**: A memory buffer pipe class that holds data in a buffer.
  * - **Move**: A function to move data from one pipe to another.
+ *
+ * ### Block transfers
+ *
+ * Push() and Pop() cost one virtual call per byte. Read() and Write() move a
+ * whole span at once, and memory pipes implement them with memcpy. Peek()
+ * returns the bytes that can be read without copying, and Skip() consumes
+ * them. Peek() returns an empty span for pipes that are not backed by memory,
+ * so callers fall back to Read() or Pop().
  * 
  * ### Usage Example
  * 
@@ -61,6 +70,8 @@
 
 #pragma once
 #include <cstddef>
+#include <cstring>
+#include <span>
 #include <vector>
 #include <memory>
 #include <b8/type.h>
@@ -85,13 +96,8 @@ public:
    * @return true if all data was pushed successfully, false otherwise.
    */
   bool Push(const std::string& str_) {
-    bool failed = false;
-    for( auto it : str_ ){
-      if( ! Push( it ) ){
-        failed = true;
-      }
-    }
-    return failed ? false : true;
+    const std::span<const u8> src( reinterpret_cast<const u8*>( str_.data() ), str_.size() );
+    return Write( src ) == str_.size();
   }
 
   /**
@@ -106,6 +112,24 @@ public:
     return result;
   }
 
+private:
+  // Overrides must advance _pushed_in_bytes themselves.
+  virtual size_t vOnWrite( std::span<const u8> src_ ){
+    size_t nn = 0;
+    while( nn < src_.size() && Push( src_[ nn ] ) ) ++nn;
+    return nn;
+  }
+public:
+  /**
+   * @brief Writes a block of data into the pipe.
+   * 
+   * @param src_ The bytes to write.
+   * @return The number of bytes written. Less than src_.size() if the pipe is full.
+   */
+  size_t Write( std::span<const u8> src_ ){
+    return vOnWrite( src_ );
+  }
+
 protected:
   size_t _poped_in_bytes = 0;
 private:
@@ -123,6 +147,15 @@ public:
     _poped_in_bytes = offset_;
   }
 
+  /**
+   * @brief Gets the position of the next Pop operation.
+   * 
+   * @return The number of bytes popped so far, as set by SeekPop.
+   */
+  size_t TellPop() const {
+    return _poped_in_bytes;
+  }
+
   /**
    * @brief Pops a byte of data from the pipe.
    * 
@@ -135,6 +168,48 @@ public:
     return result;
   }
 
+private:
+  // Overrides must advance _poped_in_bytes themselves.
+  virtual size_t vOnRead( std::span<u8> dst_ ){
+    size_t nn = 0;
+    while( nn < dst_.size() && Pop( dst_[ nn ] ) ) ++nn;
+    return nn;
+  }
+
+  virtual std::span<const u8> vOnPeek() const {
+    return {};
+  }
+public:
+  /**
+   * @brief Reads a block of data from the pipe.
+   * 
+   * @param dst_ The buffer to fill.
+   * @return The number of bytes read. Less than dst_.size() at the end of the data.
+   */
+  size_t Read( std::span<u8> dst_ ){
+    return vOnRead( dst_ );
+  }
+
+  /**
+   * @brief Gets the bytes that can be popped next, without consuming them.
+   * 
+   * The span stays valid until the pipe is written to or destroyed.
+   * 
+   * @return The readable bytes in place, or an empty span if the pipe is not backed by memory.
+   */
+  std::span<const u8> Peek() const {
+    return vOnPeek();
+  }
+
+  /**
+   * @brief Consumes bytes returned by Peek().
+   * 
+   * @param bytesize_ The number of bytes to consume. Must not exceed Peek().size().
+   */
+  void Skip( size_t bytesize_ ){
+    _poped_in_bytes += bytesize_;
+  }
+
 public:
   virtual ~CPipe() {}
 };
@@ -150,6 +225,9 @@ public:
 
 /**
  * @brief A memory reader pipe class that reads data from a memory buffer.
+ *
+ * The pipe does not own or copy the buffer, so it can read data in ROM,
+ * such as a romfs file, in place. The buffer must outlive the pipe.
  */
 class CMemReaderPipe : public CPipe {
   const u8* _addr;
@@ -163,6 +241,19 @@ class CMemReaderPipe : public CPipe {
     return false;
   }
 
+  std::span<const u8> vOnPeek() const override {
+    if (_poped_in_bytes >= _bytesize) return {};
+    return { _addr + _poped_in_bytes, _bytesize - _poped_in_bytes };
+  }
+
+  size_t vOnRead( std::span<u8> dst_ ) override {
+    const std::span<const u8> src = vOnPeek();
+    const size_t nn = src.size() < dst_.size() ? src.size() : dst_.size();
+    memcpy( dst_.data(), src.data(), nn );
+    _poped_in_bytes += nn;
+    return nn;
+  }
+
 public:
   /**
    * @brief Gets the size of the memory buffer.
@@ -182,6 +273,59 @@ public:
   CMemReaderPipe(const u8* addr_, size_t bytesize_)
     : _addr(addr_),
       _bytesize(bytesize_) {}
+
+  /**
+   * @brief Constructs a memory reader pipe.
+   * 
+   * @param src_ The memory buffer.
+   */
+  explicit CMemReaderPipe(std::span<const u8> src_)
+    : _addr(src_.data()),
+      _bytesize(src_.size()) {}
+};
+
+/**
+ * @brief A memory writer pipe class that writes data into a fixed memory buffer.
+ */
+class CMemWriterPipe : public CPipe {
+  u8* _addr;
+  size_t _bytesize;
+
+  bool vOnPush(u8 x_) override {
+    if (_pushed_in_bytes < _bytesize) {
+      *(_addr + _pushed_in_bytes) = x_;
+      return true;
+    }
+    return false;
+  }
+
+  size_t vOnWrite( std::span<const u8> src_ ) override {
+    const size_t rest = _bytesize - _pushed_in_bytes;
+    const size_t nn = src_.size() < rest ? src_.size() : rest;
+    memcpy( _addr + _pushed_in_bytes, src_.data(), nn );
+    _pushed_in_bytes += nn;
+    return nn;
+  }
+
+public:
+  /**
+   * @brief Gets the number of bytes written so far.
+   * 
+   * @return The number of bytes written.
+   */
+  size_t Size() const {
+    return _pushed_in_bytes;
+  }
+
+  /**
+   * @brief Constructs a memory writer pipe.
+   * 
+   * @param addr_ The address of the memory buffer.
+   * @param bytesize_ The size of the memory buffer.
+   */
+  CMemWriterPipe(u8* addr_, size_t bytesize_)
+    : _addr(addr_),
+      _bytesize(bytesize_) {}
 };
 
 /**
@@ -217,6 +361,25 @@ private:
     }
     return false;
   }
+
+  size_t vOnWrite( std::span<const u8> src_ ) override {
+    _buff.insert( _buff.end(), src_.begin(), src_.end() );
+    _pushed_in_bytes += src_.size();
+    return src_.size();
+  }
+
+  std::span<const u8> vOnPeek() const override {
+    if (_poped_in_bytes >= _buff.size()) return {};
+    return { _buff.data() + _poped_in_bytes, _buff.size() - _poped_in_bytes };
+  }
+
+  size_t vOnRead( std::span<u8> dst_ ) override {
+    const std::span<const u8> src = vOnPeek();
+    const size_t nn = src.size() < dst_.size() ? src.size() : dst_.size();
+    memcpy( dst_.data(), src.data(), nn );
+    _poped_in_bytes += nn;
+    return nn;
+  }
 };
 
 /**
@@ -239,6 +402,18 @@ private:
       return false;
     }
   }
+
+  size_t vOnWrite( std::span<const u8> src_ ) override {
+    const size_t nn = fwrite( src_.data(), 1, src_.size(), _fp );
+    _pushed_in_bytes += nn;
+    return nn;
+  }
+
+  size_t vOnRead( std::span<u8> dst_ ) override {
+    const size_t nn = fread( dst_.data(), 1, dst_.size(), _fp );
+    _poped_in_bytes += nn;
+    return nn;
+  }
 public:
   /**
    * @brief Constructs a file pipe.
@@ -250,10 +425,23 @@ public:
   }
 };
 
+/**
+ * @brief Copies a number of bytes from one pipe to another.
+ * 
+ * Data is copied in blocks, directly from Peek() when the input pipe is backed by memory.
+ * 
+ * @param pipe_in_ The input pipe from which data is read.
+ * @param pipe_out_ The output pipe to which data is written.
+ * @param bytesize_ The maximum number of bytes to copy.
+ * @return The number of bytes copied. Less than bytesize_ if the input ends or the output is full.
+ */
+extern size_t Copy( CPipe& pipe_in_, CPipe& pipe_out_, size_t bytesize_ );
+
 /**
  * @brief Moves data from one pipe to another.
  * 
  * This function moves data from the input pipe to the output pipe until the input pipe is empty.
+ * Data is moved in blocks, see Copy().
  * 
  * @param pipe_in_ The input pipe from which data is read.
  * @param pipe_out_ The output pipe to which data is written.
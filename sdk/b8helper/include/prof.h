@@ -0,0 +1,71 @@
+/**
+ * @file prof.h
+ * @brief C++ helpers for the b8lib scoped profiler (b8/prof.h).
+ *
+ * - **prof::CScope**: Opens a zone for the lifetime of the object.
+ * - **B8_PROF_SCOPE**: Declares a CScope for a zone name, registering the zone once.
+ * - **prof::Overlay**: Prints the zone statistics through a sprprint stream.
+ * - **prof::ThreadOverlay**: Prints the share of each thread through a sprprint stream.
+ *
+ * @code
+ * void update_enemies(){
+ *   B8_PROF_SCOPE( "enemies" );
+ *   ...
+ * }
+ * @endcode
+ */
+#pragma once
+#include <cstdio>
+#include <b8/prof.h>
+#include <b8/os.h>
+
+namespace prof {
+
+  /**
+   * @class CScope
+   * @brief Opens a profiling zone on construction and closes it on destruction.
+   */
+  class CScope {
+  public:
+    explicit CScope( int zone_ ){ b8ProfBegin( zone_ ); }
+    ~CScope(){ b8ProfEnd(); }
+    CScope( const CScope& ) = delete;
+    CScope& operator=( const CScope& ) = delete;
+  };
+
+  /**
+   * @brief Prints one line per zone: calls, and last/avg/max cycles per frame
+   *        in percent of the last frame.
+   *
+   * @param fp_ sprprint stream, as returned by sprprint::Open().
+   * @param x_  Left of the overlay in pixels.
+   * @param y_  Top of the overlay in pixels.
+   * @return The y just below the overlay.
+   */
+  int   Overlay( FILE* fp_, int x_, int y_ );
+
+  /**
+   * @brief Prints one line per thread: its share of the cycles, and the times it was
+   *        switched in, since the previous call.
+   *
+   * Call it once per frame to see how a frame splits between the main loop,
+   * the idle thread and the irq threads.
+   *
+   * @param fp_ sprprint stream, as returned by sprprint::Open().
+   * @param x_  Left of the overlay in pixels.
+   * @param y_  Top of the overlay in pixels.
+   * @return The y just below the overlay.
+   */
+  int   ThreadOverlay( FILE* fp_, int x_, int y_ );
+
+} // namespace prof
+
+#define B8_PROF_CONCAT_( a_, b_ ) a_##b_
+#define B8_PROF_CONCAT( a_, b_ )  B8_PROF_CONCAT_( a_, b_ )
+
+/**
+ * @brief Profiles the rest of the enclosing scope as the zone name_.
+ */
+#define B8_PROF_SCOPE( name_ ) \
+  static const int B8_PROF_CONCAT( _prof_zone_, __LINE__ ) = b8ProfZone( name_ ); \
+  prof::CScope B8_PROF_CONCAT( _prof_scope_, __LINE__ )( B8_PROF_CONCAT( _prof_zone_, __LINE__ ) )
@@ -0,0 +1,284 @@
+/**
+ * @file sequencer.h
+ * @brief Tracker-style music and sound-effect sequencer on the APU.
+ *
+ * `CSequencer` plays sound effects (sfx) and music from a bank of compact
+ * patterns. It runs on its own thread, woken by a TMR channel TICK_HZ times a
+ * second, and records the channel commands of each tick through `CSound`.
+ *
+ * ### Voices
+ *
+ * The APU has NUM_VOICES channels, called voices here. Music plays up to
+ * MUSIC_TRACKS tracks, and up to MAX_SFX sound effects play at once; each takes
+ * a voice when it plays a note. A free voice is taken first. Otherwise an sfx takes
+ * the voice of the lowest priority, and of those the one whose note is the
+ * oldest: music gives its voices to sfx, and a new sfx cuts an old one. Music
+ * never takes a voice from an sfx; the track keeps its place silently, and plays
+ * again once a voice is free. Voices reserved by PlayMusic() are left to the music.
+ *
+ * ### Timing
+ *
+ * Patterns are timed in ticks of 1/TICK_HZ second, but the commands reach the
+ * APU at most 60 times a second. CSound submits a list only once the previous one
+ * is known to be consumed, and the APU fence can only tell that at the next
+ * V-blank. The commands of a tick whose list cannot be submitted yet go with
+ * those of the next tick. So what is heard changes at V-blank, 1/60 second
+ * apart: two notes a tick apart may sound together. TICK_HZ sets the tempo
+ * resolution of the patterns, not how often the sound changes.
+ *
+ * ### Cost
+ *
+ * A track runs at most MAX_OPS_PER_TICK pattern operations per tick, and plays at
+ * most one note, so a tick records a bounded number of commands. Stats() gives the
+ * CPU cycles of the last and of the slowest tick.
+ *
+ * ### Bank format
+ *
+ * All multi-byte values are little endian.
+ *
+ * | offset   | size  | contents                                                    |
+ * |----------|-------|-------------------------------------------------------------|
+ * | 0        | 2     | magic "SQ"                                                  |
+ * | 2        | 1     | S, the number of sfx                                        |
+ * | 3        | 1     | M, the number of music frames                               |
+ * | 4        | 2*S   | offset of each sfx pattern from the start of the bank       |
+ * | 4+2S     | 5*M   | music frames: flags (FRAME_*), then the sfx of tracks 0-3, 0xff for none |
+ *
+ * A frame ends once each of its tracks has ended or looped once; then the next
+ * frame plays.
+ *
+ * A pattern starts with its speed, in ticks per row, followed by operations.
+ * Pitches are semitones; 0 is C at 65.4 Hz and 33 is A at 440 Hz, as in PICO-8.
+ *
+ * | op          | operation                                                      |
+ * |-------------|----------------------------------------------------------------|
+ * | 0x00 - 0x3f | rest for op+1 rows                                             |
+ * | 0x40 - 0x7f | play the last pitch plus op&0x3f as a signed 6-bit delta, for one row |
+ * | 0x80 - 0x87 | select instrument op&7                                         |
+ * | 0x88 - 0x8f | set the volume to op&7, 7 being the loudest                    |
+ * | 0x90 p      | play pitch p, for one row                                      |
+ * | 0x91 s      | set the speed to s ticks per row                               |
+ * | 0x92        | silence the voice                                              |
+ * | 0xfe        | loop to the first operation                                    |
+ * | 0xff        | end                                                            |
+ *
+ * Most notes are a single byte. Banks compress well with ZPack (genb8rom -z),
+ * and UnpackBank() expands them to RAM.
+ *
+ * ### Usage Example
+ *
+ * @code
+ * #include <sequencer.h>
+ *
+ * static CSequencer seq;
+ *
+ * seq.Start( 2 );            // TMR channel 2
+ * seq.SetBank( bank );
+ * seq.PlayMusic( 0 );
+ * ...
+ * seq.PlaySfx( 3 );
+ * @endcode
+ *
+ * On a host build of b8lib with B8_APU_MOCK=1, Render() runs the ticks on the
+ * calling thread, and b8ApuMockGetCapture() returns the commands they recorded.
+ * The trace depends only on the bank and the requests, so it can be compared
+ * with a known good one, as sdk/test/test_sequencer.cpp does.
+ */
+
+#pragma once
+#include <span>
+#include <vector>
+#include <b8/type.h>
+#include <sound.h>
+#include <spsc_ring.h>
+
+/**
+ * @brief Sequencer statistics.
+ */
+struct SequencerStats {
+  u32 ticks       = 0;  ///< Ticks run.
+  u32 cycles_last = 0;  ///< CPU cycles of the last tick.
+  u32 cycles_max  = 0;  ///< Most CPU cycles of any tick.
+  u32 budget_hits = 0;  ///< Times a track stopped at MAX_OPS_PER_TICK before the end of its row.
+  u32 steals      = 0;  ///< Voices taken from another sfx or from the music.
+  u32 voices      = 0;  ///< Voices in use after the last tick.
+};
+
+/**
+ * @brief Plays sfx and music from a bank of patterns on its own thread.
+ *
+ * The Play and Stop functions and SetBank() only queue a request, which the
+ * sequencer takes at its next tick. Call them from one thread.
+ */
+class CSequencer {
+public:
+  static constexpr u32 TICK_HZ          = 120;  ///< Pattern ticks per second; the APU is updated at 60 Hz, see Timing.
+  static constexpr u32 NUM_VOICES       = B8_APU_MAX_CH;
+  static constexpr u32 MUSIC_TRACKS     = 4;
+  static constexpr u32 MAX_SFX          = 8;    ///< Sfx playing at once.
+  static constexpr u32 MAX_OPS_PER_TICK = 8;
+  static constexpr u32 MAX_REQUESTS     = 16;   ///< Requests queued between two ticks.
+
+  static constexpr u8 FRAME_LOOP_START  = 0x01; ///< Frame flag: a later FRAME_LOOP_BACK returns here.
+  static constexpr u8 FRAME_LOOP_BACK   = 0x02; ///< Frame flag: after this frame, return to the last FRAME_LOOP_START.
+  static constexpr u8 FRAME_STOP        = 0x04; ///< Frame flag: the music stops after this frame.
+
+  /**
+   * @brief Priority of a track. A higher one may take the voice of a lower one.
+   */
+  enum Priority : u8 {
+    PRIO_NONE  = 0,
+    PRIO_MUSIC = 1,
+    PRIO_SFX   = 2,
+  };
+
+private:
+  struct Track {
+    const u8* start   = nullptr;  // first operation
+    const u8* pc      = nullptr;
+    u32       born    = 0;        // tick it was started
+    u16       wait    = 0;        // ticks left in the current row
+    u8        speed   = 1;
+    u8        pitch   = 33;
+    u8        inst    = 0;
+    u8        vol     = 5;
+    s8        voice   = -1;
+    u8        prio    = PRIO_NONE;
+    bool      active  = false;
+    bool      looped  = false;
+  };
+
+  struct Request {
+    u8          kind;
+    u8          mask;
+    s8          voice;
+    s16         n;
+    const u8*   data;
+    u32         size;
+  };
+
+  CSound        _sound;
+  std::span<const u8>  _bank;
+  Track         _tracks[ MUSIC_TRACKS + MAX_SFX ];
+  s8            _owner[ NUM_VOICES ];       // track of each voice, or -1
+  u32           _age[ NUM_VOICES ];         // tick of the last note of each voice
+  s16           _frame = -1;                // music frame, or -1
+  s16           _loop_frame = 0;
+  u8            _reserved = 0;              // voices kept for the music
+  u32           _tmr_ch = 0;
+  bool          _running = false;
+  SequencerStats  _stats;
+  CSpscRing< Request , MAX_REQUESTS >  _requests;
+
+public:
+  CSequencer();
+
+  /**
+   * @brief Starts the sequencer thread, woken by a TMR channel.
+   *
+   * @param tmr_ch_ The TMR channel, which the sequencer has to itself.
+   * @return 0 on success; an error code on failure.
+   */
+  int   Start( u32 tmr_ch_ );
+
+  /**
+   * @brief Sets the bank the patterns are played from. Stops the sfx and the music.
+   *
+   * The bank is not copied, and must stay valid while it is in use.
+   *
+   * @param bank_ The bank.
+   * @return false if the header of the bank is invalid; the bank is then not used.
+   */
+  bool  SetBank( std::span<const u8> bank_ );
+
+  /**
+   * @brief Plays an sfx.
+   *
+   * @param n_ The sfx number in the bank.
+   * @param voice_ The voice to play it on, taken from whoever has it; -1 to choose one.
+   */
+  void  PlaySfx( int n_ , int voice_ = -1 );
+
+  /**
+   * @brief Stops sfx.
+   *
+   * @param voice_ The voice whose sfx is stopped; -1 for all sfx.
+   */
+  void  StopSfx( int voice_ = -1 );
+
+  /**
+   * @brief Plays the music from a frame.
+   *
+   * @param frame_ The first music frame.
+   * @param reserved_mask_ Voices that sfx without an explicit voice leave to the music, bit n for voice n.
+   */
+  void  PlayMusic( int frame_ , u8 reserved_mask_ = 0 );
+
+  /**
+   * @brief Stops the music.
+   */
+  void  StopMusic();
+
+  /**
+   * @brief Runs ticks on the calling thread, submitting the commands of each.
+   *
+   * For host builds and tests; do not call it once Start() has been called.
+   *
+   * @param ticks_ The number of ticks to run.
+   */
+  void  Render( u32 ticks_ );
+
+  /**
+   * @brief Gets the music frame being played.
+   *
+   * @return The frame, or -1 if no music is playing.
+   */
+  int   MusicFrame() const {
+    return  _frame;
+  }
+
+  /**
+   * @brief Gets the statistics.
+   *
+   * @return The statistics; they are updated by the sequencer thread at each tick.
+   */
+  const SequencerStats& Stats() const {
+    return  _stats;
+  }
+
+  /**
+   * @brief Gets the APU command recorder, for its shadow register statistics.
+   *
+   * @return The recorder.
+   */
+  const CSound& Sound() const {
+    return  _sound;
+  }
+
+  /**
+   * @brief Expands a bank compressed with ZPack.
+   *
+   * @param src_ The compressed bank.
+   * @param srcsize_ Size of the compressed bank in bytes.
+   * @param out_ Receives the bank.
+   * @param maxsize_ Largest expanded size accepted, in bytes.
+   * @return true on success.
+   */
+  static  bool  UnpackBank( const u8* src_ , size_t srcsize_ , std::vector<u8>& out_ , size_t maxsize_ = 0x4000 );
+
+private:
+  static  void* ThreadMain( void* arg_ );
+  void  Tick();
+  void  TakeRequests();
+  void  StartTrack( u32 track_ , u32 sfx_ , u8 prio_ );
+  void  StartSfx( u32 sfx_ , int voice_ );
+  void  StopTrack( u32 track_ , bool silence_ );
+  bool  StepTrack( u32 track_ );
+  void  PlayNote( u32 track_ );
+  int   AllocVoice( u32 track_ );
+  void  TakeVoice( u32 track_ , u32 voice_ );
+  void  StartFrame( int frame_ );
+  void  UpdateMusic();
+  const u8* FrameAt( int frame_ ) const;
+  void  Push( const Request& req_ );
+};
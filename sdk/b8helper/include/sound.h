@@ -1,2 +1,148 @@
+/**
+ * @file sound.h
+ * @brief Per-frame APU command recording for the BEEP-8 system.
+ *
+ * `CSound` records the channel register writes of one frame into a pair of APU
+ * command buffers (see `b8ApuCmdPair` in `<b8/apu.h>`) and starts them with one
+ * write to `B8_APU_EXEC` per frame. A shadow copy of the channel registers drops
+ * writes of a value the channel already has, so setting the same voice every
+ * frame costs no APU commands.
+ *
+ * ### Usage Example
+ *
+ * @code
+ * #include <sound.h>
+ *
+ * static CSound sound;
+ *
+ * SoundEnvelope env;
+ * env.attack_ms  = 10;
+ * env.release_ms = 200;
+ * sound.SetEnvelope( 0 , env );
+ * sound.SetWave( 0 , B8_APU_WAVE_SQUARE );
+ * sound.SetFreq( 0 , B8_APU_HZ( 440 ) );
+ * sound.NoteOn( 0 );
+ *
+ * while( true ){
+ *   ...
+ *   sound.Submit();         // once a frame
+ *   b8PpuVsyncWait();
+ * }
+ * @endcode
+ */
+
 #pragma once
+#include <b8/apu.h>
+
+/**
+ * @brief Envelope of a channel: attack, decay, sustain, then release.
+ *
+ * Times are in milliseconds; SetEnvelope() converts them to the APU's samples
+ * at B8_APU_SAMPLE_RATE, up to B8_APU_TIME_MAX.
+ */
+struct SoundEnvelope {
+  u32 attack_ms   = 0;              ///< Time to rise to attack_amp.
+  u32 attack_amp  = B8_APU_AMP_MAX; ///< Peak amplitude, 0 to B8_APU_AMP_MAX.
+  u32 decay_ms    = 0;              ///< Time to fall to sustain_amp.
+  u32 sustain_ms  = 0;              ///< Time held at sustain_amp.
+  u32 sustain_amp = B8_APU_AMP_MAX; ///< Sustain amplitude, 0 to B8_APU_AMP_MAX.
+  u32 release_ms  = 0;              ///< Time to fall to silence.
+};
+
+/**
+ * @brief Records APU commands for one frame at a time, and submits them once per frame.
+ */
+class CSound {
+public:
+  static constexpr size_t BUFF_WORDS = 512;  ///< Words of each command buffer.
+
+private:
+  u32           _buff[ 2 ][ BUFF_WORDS ];
+  b8ApuCmdPair  _pair;
+  b8ApuShadow   _shadow;
+  b8ApuCmd      _cmd;
+
+public:
+  CSound();
+
+  /**
+   * @brief Sets the wave type of a channel.
+   *
+   * @param ch_ Channel, 0 to B8_APU_MAX_CH-1.
+   * @param wavtype_ One of B8_APU_WAVE_*.
+   * @return true if a command was recorded, false if the channel already had it or the buffer is full.
+   */
+  bool  SetWave( u32 ch_ , u32 wavtype_ );
+
+  /**
+   * @brief Sets the frequency of a channel.
+   *
+   * @param ch_ Channel, 0 to B8_APU_MAX_CH-1.
+   * @param freq_ Frequency in Hz, 14.6 fixed point (see B8_APU_HZ), up to B8_APU_FREQ_MAX.
+   * @return true if a command was recorded, false otherwise.
+   */
+  bool  SetFreq( u32 ch_ , u32 freq_ );
+
+  /**
+   * @brief Sets the volume of a channel.
+   *
+   * @param ch_ Channel, 0 to B8_APU_MAX_CH-1.
+   * @param vol_ Volume, 0 to B8_APU_AMP_MAX.
+   * @return true if a command was recorded, false otherwise.
+   */
+  bool  SetVolume( u32 ch_ , u32 vol_ );
+
+  /**
+   * @brief Sets the envelope of a channel; only the parts that changed are recorded.
+   *
+   * @param ch_ Channel, 0 to B8_APU_MAX_CH-1.
+   * @param env_ The envelope.
+   * @return The number of commands recorded.
+   */
+  int   SetEnvelope( u32 ch_ , const SoundEnvelope& env_ );
+
+  /**
+   * @brief Starts the envelope of a channel. Always recorded.
+   *
+   * @param ch_ Channel, 0 to B8_APU_MAX_CH-1.
+   * @return false if the buffer is full.
+   */
+  bool  NoteOn( u32 ch_ );
+
+  /**
+   * @brief Terminates the commands of this frame, starts them, and begins the next frame.
+   *
+   * Does nothing if no command was recorded. Blocks until the list submitted the
+   * frame before has been consumed, so call it once per frame.
+   */
+  void  Submit();
+
+  /**
+   * @brief Same as Submit(), but never blocks.
+   *
+   * If the list submitted before is still being consumed, the commands stay in
+   * the back buffer and are submitted, with those recorded meanwhile, by a later call.
+   *
+   * @return true if the commands were submitted or there were none, false if they are still pending.
+   */
+  bool  TrySubmit();
+
+  /**
+   * @brief Forgets the shadow registers, so that every register is written again.
+   *
+   * Call it if the APU has been reset behind CSound's back.
+   */
+  void  Invalidate();
+
+  /**
+   * @brief Gets the shadow registers, with the counts of written and dropped commands.
+   *
+   * @return The shadow state.
+   */
+  const b8ApuShadow&  Shadow() const {
+    return  _shadow;
+  }
 
+private:
+  bool  HasRoom() const;
+};
@@ -1,4 +1,5 @@
 #include <b8/ppu.h>
+#include <palcache.h>
 #pragma once
 /**
  * @namespace sprprint
@@ -82,9 +83,12 @@ namespace sprprint {
    * @brief Holds the command context for sprite printing operations.
    * 
    * This structure contains a pointer to a command list used by the BEEP-8 PPU.
+   * If _palcache is set, color changes go through it instead of emitting
+   * a SETPAL and a FLUSH each time.
    */
   struct Context {
     b8PpuCmd* _cmd = nullptr;  ///< Pointer to PPU command list.
+    palcache::CPalCache* _palcache = nullptr;  ///< Palette cache of _cmd, or nullptr.
   };
 
   /**
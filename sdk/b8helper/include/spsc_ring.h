@@ -0,0 +1,140 @@
+/**
+ * @file spsc_ring.h
+ * @brief Lock-free ring buffer for one producer thread and one consumer thread.
+ *
+ * `CSpscRing` passes elements from one thread to another without a semaphore or
+ * any other system call. The producer writes only the head index and the consumer
+ * only the tail index, so neither has to wait for the other.
+ *
+ * BEEP-8 has one CPU, and threads are switched only on entry to the kernel, so a
+ * compiler barrier is enough to make a slot visible before the index that
+ * publishes it. An interrupt handler may be the producer too.
+ *
+ * ### Features
+ *
+ * - **Push()**: Adds an element; fails, counting an overflow, when the ring is full.
+ * - **Peek()**: The oldest elements in place, as a span, without copying them.
+ * - **Commit()**: Removes elements returned by Peek().
+ * - **Overflows()**: How many elements were lost to a full ring.
+ *
+ * The elements of Peek() are contiguous; when they wrap around the end of the
+ * ring, the rest comes with the next Peek() after the Commit().
+ *
+ * ### Usage Example
+ *
+ * @code
+ * #include <spsc_ring.h>
+ *
+ * static CSpscRing< Note, 64 > ring;
+ *
+ * // producer thread
+ * ring.Push( note );
+ *
+ * // consumer thread
+ * std::span<const Note> notes;
+ * while( !(notes = ring.Peek()).empty() ){
+ *   for( const Note& note : notes ) Play( note );
+ *   ring.Commit( notes.size() );
+ * }
+ * @endcode
+ *
+ * @note b8HifPeekEvents() and b8HifCommitEvents() in `<b8/hif.h>` are the same
+ *       ring for touch and mouse events, written in C for b8lib.
+ */
+
+#pragma once
+#include <cstddef>
+#include <span>
+#include <b8/type.h>
+
+/**
+ * @brief Lock-free single-producer, single-consumer ring buffer.
+ *
+ * @tparam T The element type, copied by Push().
+ * @tparam N The capacity, a power of two.
+ */
+template< typename T , size_t N >
+class CSpscRing {
+  static_assert( N > 0 && (N & (N-1)) == 0 , "N must be a power of two" );
+
+  T             _buff[ N ];
+  volatile u32  _head = 0;      // written by the producer only
+  volatile u32  _tail = 0;      // written by the consumer only
+  volatile u32  _overflows = 0; // written by the producer only
+
+  static  void  Barrier(){
+    __asm__ volatile( "" ::: "memory" );
+  }
+
+public:
+  /**
+   * @brief Adds an element. Call from the producer only.
+   *
+   * @param x_ The element to add.
+   * @return true if it was added, false if the ring was full and it was dropped.
+   */
+  bool  Push( const T& x_ ){
+    const u32 head = _head;
+    if( head - _tail == N ){
+      _overflows = _overflows + 1;
+      return  false;
+    }
+    _buff[ head & (N-1) ] = x_;
+    Barrier();
+    _head = head + 1;
+    return  true;
+  }
+
+  /**
+   * @brief Gets the oldest elements in place. Call from the consumer only.
+   *
+   * The elements stay in the ring, and valid, until Commit() removes them.
+   *
+   * @return The oldest contiguous elements; empty if there are none.
+   */
+  std::span<const T>  Peek() const {
+    const u32 tail = _tail;
+    const u32 num  = _head - tail;
+    Barrier();
+    const u32 idx = tail & (N-1);
+    const u32 contiguous = N - idx;
+    return  { &_buff[ idx ] , num < contiguous ? num : contiguous };
+  }
+
+  /**
+   * @brief Removes elements returned by Peek(). Call from the consumer only.
+   *
+   * @param num_ The number of elements to remove, at most the size of the last Peek().
+   */
+  void  Commit( size_t num_ ){
+    Barrier();
+    _tail = _tail + num_;
+  }
+
+  /**
+   * @brief Gets the number of elements in the ring.
+   *
+   * @return The number of elements; from the other thread, it may change at once.
+   */
+  size_t  Size() const {
+    return  _head - _tail;
+  }
+
+  /**
+   * @brief Gets the capacity of the ring.
+   *
+   * @return N.
+   */
+  static  constexpr size_t  Capacity(){
+    return  N;
+  }
+
+  /**
+   * @brief Gets the number of elements dropped by Push() because the ring was full.
+   *
+   * @return The number of dropped elements so far.
+   */
+  u32   Overflows() const {
+    return  _overflows;
+  }
+};
@@ -149,4 +149,24 @@ public:
   CZPackDecoder::DecodeResult Decode();
 };
 
+/**
+ * @brief Decodes a ZPack stream from memory into a fixed buffer.
+ *
+ * @param src_ The ZPack stream.
+ * @param srcsize_ Size of the stream in bytes.
+ * @param dst_ Destination buffer.
+ * @param dstsize_ Size of the destination buffer in bytes.
+ * @return Number of bytes decoded, or -1 if the stream is invalid or does not fit.
+ */
+extern  int Decode( const u8* src_, size_t srcsize_, u8* dst_, size_t dstsize_ );
+
+/**
+ * @brief Lets the romfs driver open files packed with genb8rom -z.
+ *
+ * Call this once before opening compressed files under B8_ROMFS_MOUNT.
+ * It is kept out of b8lib so that apps without compressed assets do not
+ * link the ZPack codecs.
+ */
+extern  void  InstallRomfsDecoder();
+
 } // namespace ZPack
@@ -1,99 +1,205 @@
-#include <map>
+#include <string.h>
 #include <b8/hif.h>
 #include <b8/sys.h>
-#include <b8/assert.h>
+#include <b8/dwt.h>
 #include <hif_decoder.h>
-#include <trace.h>
 
-using namespace std;
-
-class ImplCHifDecoder{
-  friend  class CHifDecoder;
-  map< u8 , b8HifEvent > _map_hifev;  // TODO: remove
+static  u32   _isqrt( u64 x ){
+  u64 res = 0;
+  u64 bit = 1ULL << 62;
+  while( bit > x ) bit >>= 2;
+  while( bit ){
+    if( x >= res + bit ){
+      x  -= res + bit;
+      res = (res >> 1) + bit;
+    } else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+  return  (u32)res;
+}
 
-  u32 _hdl = 1;
-  map< u8 , HifPoint* > _map_hifp; 
+static  u32   _cyc_to_ms( u32 cyc ){
+  const u32 cyc_per_ms = b8SysGetCpuClock() / 1000;
+  return  cyc_per_ms ? cyc / cyc_per_ms : 0;
+}
 
-  void  ClearIdentifierZero(){
-    for(
-      map< u8 , b8HifEvent >::iterator it = _map_hifev.begin() ;
-      it != _map_hifev.end() ;
-    ){
-      if( it->second.identifier == 0 ){
-        //trace( it->second.identifier );
-        it = _map_hifev.erase( it );
-      } else {
-        ++it;
-      }
-    }
+// The point is released, and is removed by the next GetStatus().
+static  bool  _is_last( b8HifEventType type ){
+  switch( type ){
+    case  B8_HIF_EV_TOUCH_CANCEL:
+    case  B8_HIF_EV_TOUCH_END:
+    case  B8_HIF_EV_MOUSE_UP:
+      return  true;
+    default:
+      return  false;
   }
-};
+}
+
+static  void  _start_press( HifPoint& hp , u32 cyc ){
+  hp.start_xp = hp.vel_xp = hp.ev.xp;
+  hp.start_yp = hp.vel_yp = hp.ev.yp;
+  hp.start_cyc = hp.vel_cyc = cyc;
+  hp.vx = hp.vy = 0;
+  hp.moved = hp.long_press = hp.tap = hp.swipe = false;
+}
+
+// Velocity is sampled once a frame or so: events of one frame come in a burst.
+static  void  _update_velocity( HifPoint& hp , u32 cyc , bool force ){
+  const u32 clk  = b8SysGetCpuClock();
+  const u32 dcyc = cyc - hp.vel_cyc;
+  if( 0 == dcyc ) return;
+  if( !force && dcyc < (clk >> 7) ) return;
+
+  const s32 vx = (s32)( (s64)(hp.ev.xp - hp.vel_xp) * clk / dcyc );
+  const s32 vy = (s32)( (s64)(hp.ev.yp - hp.vel_yp) * clk / dcyc );
+  hp.vx = (hp.vx + vx) / 2;
+  hp.vy = (hp.vy + vy) / 2;
+  hp.vel_xp  = hp.ev.xp;
+  hp.vel_yp  = hp.ev.yp;
+  hp.vel_cyc = cyc;
+}
 
 CHifDecoder::CHifDecoder(){
-  impl = new ImplCHifDecoder;
+  Reset();
 }
 
-CHifDecoder::~CHifDecoder(){
-  delete impl;
+void  CHifDecoder::Reset(){
+  _num = 0;
+  memset( _slot_of_id , 0 , sizeof(_slot_of_id) );
+  _hdl = 1;
+  _pinch = HifPinch();
 }
 
 const b8HifMouseStatus* CHifDecoder::GetMouseStatus(){
   return  b8HifGetMouseStatus();
 }
 
-const map< u8 , HifPoint* >& CHifDecoder::GetStatus(){
-  for (auto it = impl->_map_hifp.begin() ; it != impl->_map_hifp.end() ; ){
-    switch( it->second->ev.type ){
-      case B8_HIF_EV_TOUCH_CANCEL:
-      case B8_HIF_EV_TOUCH_END:
-      case B8_HIF_EV_MOUSE_UP:{
-        delete it->second;
-        it = impl->_map_hifp.erase(it);
-      }break;
-
-      default: ++it; break;
-    }
+HifPoint* CHifDecoder::Find( u8 identifier_ ){
+  const u8 slot = _slot_of_id[ identifier_ ];
+  return  slot ? &_points[ slot - 1 ] : nullptr;
+}
+
+HifPoint* CHifDecoder::Add( const b8HifEvent& ev_ ){
+  if( _num == MAX_POINTS )  return  nullptr;
+  HifPoint& hp = _points[ _num++ ];
+  hp = HifPoint( ev_ );
+  hp.hdl = _hdl++;
+  _slot_of_id[ ev_.identifier ] = (u8)_num;
+  return  &hp;
+}
+
+// Keeps the points in the order they started, for the pinch.
+void  CHifDecoder::Remove( size_t index_ ){
+  _slot_of_id[ _points[ index_ ].ev.identifier ] = 0;
+  for( size_t nn=index_+1 ; nn < _num ; ++nn ){
+    _points[ nn-1 ] = _points[ nn ];
+    _slot_of_id[ _points[ nn-1 ].ev.identifier ] = (u8)nn;
+  }
+  --_num;
+}
+
+void  CHifDecoder::OnEvent( const b8HifEvent& ev_ , u32 cyc_ ){
+  HifPoint* hp = Find( ev_.identifier );
+  switch( ev_.type ){
+    case  B8_HIF_EV_TOUCH_START:
+    case  B8_HIF_EV_MOUSE_DOWN:
+      if( nullptr == hp ){
+        hp = Add( ev_ );
+        if( nullptr == hp ) return;
+      }
+      hp->ev = ev_;
+      hp->ptype = ev_.type == B8_HIF_EV_TOUCH_START ? HifPoint::PointType::Touch : HifPoint::PointType::Mouse;
+      _start_press( *hp , cyc_ );
+      return;
+
+    case  B8_HIF_EV_MOUSE_HOVER_MOVE:
+      if( nullptr == hp ){
+        hp = Add( ev_ );
+        if( nullptr == hp ) return;
+        _start_press( *hp , cyc_ );
+      }
+      break;
+
+    default:
+      if( nullptr == hp ) return;
+      break;
+  }
+
+  hp->ev = ev_;
+  const s32 dx = hp->ev.xp - hp->start_xp;
+  const s32 dy = hp->ev.yp - hp->start_yp;
+  if( dx > TAP_SLOP || dx < -TAP_SLOP || dy > TAP_SLOP || dy < -TAP_SLOP ){
+    hp->moved = true;
   }
 
-  b8HifEvents result;
-  b8HifGetEvents( &result );
-  if( result.num == 0 ) return  impl->_map_hifp;
-
-  b8HifEvent* ev = &result.events[0];
-  for( size_t ii=0 ; ii < result.num ; ++ii,++ev ){
-    switch( ev->type ){
-      case  B8_HIF_EV_TOUCH_START:
-      case  B8_HIF_EV_MOUSE_DOWN:
-      case  B8_HIF_EV_MOUSE_HOVER_MOVE:
-      {
-        auto it = impl->_map_hifp.find( ev->identifier );
-        if (it == impl->_map_hifp.end()) {  // TODO: 
-          HifPoint* hp = new HifPoint( *ev );
-          hp->hdl = impl->_hdl++;
-          hp->ptype =
-            ev->type == B8_HIF_EV_TOUCH_START ?  HifPoint::PointType::Touch :
-            ev->type == B8_HIF_EV_MOUSE_DOWN  ?  HifPoint::PointType::Mouse : HifPoint::PointType::None ;
-          impl->_map_hifp[ ev->identifier ] = hp;
-        }
-      }break;
-      default: break;
+  if( ev_.type == B8_HIF_EV_TOUCH_END || ev_.type == B8_HIF_EV_MOUSE_UP ){
+    _update_velocity( *hp , cyc_ , true );
+    const u32 held_ms = _cyc_to_ms( cyc_ - hp->start_cyc );
+    hp->tap = !hp->moved && held_ms <= TAP_MAX_MS;
+    const s64 speed2 = (s64)hp->vx * hp->vx + (s64)hp->vy * hp->vy;
+    hp->swipe = speed2 >= (s64)SWIPE_MIN_SPEED * SWIPE_MIN_SPEED;
+  }
+}
+
+void  CHifDecoder::UpdateGestures( u32 cyc_ ){
+  for( size_t nn=0 ; nn < _num ; ++nn ){
+    HifPoint& hp = _points[ nn ];
+    if( _is_last( hp.ev.type ) )  continue;
+    _update_velocity( hp , cyc_ , false );
+
+    if(
+      hp.ptype != HifPoint::PointType::None &&
+      !hp.moved && !hp.long_press &&
+      _cyc_to_ms( cyc_ - hp.start_cyc ) >= LONG_PRESS_MS
+    ){
+      hp.long_press = true;
     }
+  }
+}
+
+void  CHifDecoder::UpdatePinch(){
+  const HifPoint* pair[2] = { nullptr , nullptr };
+  size_t found = 0;
+  for( size_t nn=0 ; nn < _num && found < 2 ; ++nn ){
+    const HifPoint& hp = _points[ nn ];
+    if( hp.ptype != HifPoint::PointType::Touch || _is_last( hp.ev.type ) ) continue;
+    pair[ found++ ] = &hp;
+  }
+  if( found < 2 ){
+    _pinch.active = false;
+    return;
+  }
 
-    switch( ev->type ){
-      case  B8_HIF_EV_TOUCH_MOVE:
-      case  B8_HIF_EV_TOUCH_CANCEL:
-      case  B8_HIF_EV_TOUCH_END:
-      case  B8_HIF_EV_MOUSE_MOVE:
-      case  B8_HIF_EV_MOUSE_UP:
-      case  B8_HIF_EV_MOUSE_HOVER_MOVE:
-      {
-        auto it = impl->_map_hifp.find( ev->identifier );
-        if (it != impl->_map_hifp.end()) {
-          impl->_map_hifp[ ev->identifier ]->ev = *ev;
-        }
-      }break;
-      default: break;
+  const s64 dx = pair[1]->ev.xp - pair[0]->ev.xp;
+  const s64 dy = pair[1]->ev.yp - pair[0]->ev.yp;
+  _pinch.dist = _isqrt( (u64)(dx*dx + dy*dy) );
+  if( !_pinch.active || _pinch.hdl0 != pair[0]->hdl || _pinch.hdl1 != pair[1]->hdl ){
+    _pinch.dist_start = _pinch.dist;
+    _pinch.hdl0 = pair[0]->hdl;
+    _pinch.hdl1 = pair[1]->hdl;
+  }
+  _pinch.active = true;
+}
+
+std::span<const HifPoint> CHifDecoder::GetStatus(){
+  for( size_t nn=_num ; nn-- > 0 ; ){
+    if( _is_last( _points[ nn ].ev.type ) ) Remove( nn );
+  }
+
+  // Take the events in place; the ring may hand them over in two parts.
+  const u32 cyc = B8_DWT_CYCCNT;
+  const b8HifEvent* events;
+  size_t num;
+  while( 0 != (num = b8HifPeekEvents( &events )) ){
+    for( size_t ii=0 ; ii < num ; ++ii ){
+      OnEvent( events[ ii ] , cyc );
     }
+    b8HifCommitEvents( num );
   }
-  return  impl->_map_hifp;
+
+  UpdateGestures( cyc );
+  UpdatePinch();
+  return  { _points , _num };
 }
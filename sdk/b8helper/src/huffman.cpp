@@ -38,6 +38,7 @@ using namespace Pipe;
 
 #define MAX_SIZE_POW2       (20)
 #define SIG_GENERAL_HUFFMAN (0x77)
+#define BLOCK_BYTES         (256)
 
 class SerialBytes{
   std::shared_ptr< Pipe::CPipe > _pipe_in  = std::make_shared< Pipe::CNullPipe >();
@@ -162,6 +163,8 @@ struct KeyEqual {
 // huffman encoder
 // ------------------------------------------------------------------------------
 struct  Branch;
+// Upper bound of sizeof( Branch ), checked where Branch is defined: 28 on the target, 40 on 64-bit hosts.
+constexpr size_t  BRANCH_BYTES = 8 + sizeof( HuffmanCode ) + 3 * sizeof( void* );
 struct  WorkEnc{
   static WorkEnc* instance;
   static WorkEnc& GetSingleInstance() {
@@ -171,7 +174,7 @@ struct  WorkEnc{
 
   u32     _freq_ap[ 0x100 ];
   size_t  _up_pool_of_branches = 0;
-  u8      _pool_of_branches[ 32 * 512 ];  // 32 = sizeof( Branch )
+  alignas( void* ) u8  _pool_of_branches[ BRANCH_BYTES * 512 ];
   unordered_map< HuffmanCode,u8,KeyHash,KeyEqual >   _h2c;  // huffman2code
   HuffmanCode _c2h[ 0x100 ];  // code2huffman
 
@@ -255,6 +258,7 @@ public:
   Branch()
     : _work( &WorkEnc::GetSingleInstance() ){}
 };
+static_assert( sizeof( Branch ) <= BRANCH_BYTES , "BRANCH_BYTES is too small" );
 
 static  bool compare_branch(Branch* lhs, Branch* rhs) {
   return lhs->_freq_ap < rhs->_freq_ap ? true : false;
@@ -279,15 +283,17 @@ void  WorkEnc::Export( std::shared_ptr< Pipe::CPipe > pipe_in_,  SerialBytes& sb
   WATCH(_byte_size_of_orgin);
 #endif
   sb.PushBitsN(MAX_SIZE_POW2 ,_byte_size_of_orgin );
-  u8 reg8 = 0x00;
+  u8 block[ BLOCK_BYTES ];
   int cnt_pop = 0;
-  while( pipe_in_->Pop( reg8 )){
+  for( size_t nn_block ; (nn_block = pipe_in_->Read( block )) > 0 ; ){
+    for( size_t ii=0 ; ii<nn_block ; ++ii ){
 #ifdef VERBOSE
- WATCH(reg8);
+ WATCH(block[ii]);
 #endif
-    ++cnt_pop;
-    const HuffmanCode& hc = _c2h[ reg8 ];
-    sb.PushBitsN(hc._len,hc._code);
+      ++cnt_pop;
+      const HuffmanCode& hc = _c2h[ block[ii] ];
+      sb.PushBitsN(hc._len,hc._code);
+    }
   }
 #ifdef VERBOSE
  WATCH(cnt_pop);
@@ -348,10 +354,7 @@ void  CHuffmanEncoder::SetOut( std::shared_ptr< Pipe::CPipe > pipe_out_ ){
 }
 
 void  CHuffmanEncoder::_Output( std::shared_ptr< Pipe::CPipe > pipe_mem_huf_packed_ ){
-  u8 reg8;
-  while( pipe_mem_huf_packed_->Pop( reg8 ) ){
-    _pipe_out->Push( reg8 );
-  }
+  Pipe::Move( pipe_mem_huf_packed_, _pipe_out );
 }
 
 void  CHuffmanEncoder::Encode(){
@@ -373,11 +376,13 @@ void  CHuffmanEncoder::Encode(){
   WorkEnc* work = new WorkEnc;
 
   // Build frequency of appearance table -> work->_freq_ap[0x100]
-  u8 reg8 = 0x00;
+  u8 block[ BLOCK_BYTES ];
   size_t org_bytesize = 0;
-  while( _pipe_in->Pop( reg8 )){
-    work->_freq_ap[ reg8 ]++;
-    ++org_bytesize;
+  for( size_t nn_block ; (nn_block = _pipe_in->Read( block )) > 0 ; ){
+    for( size_t ii=0 ; ii<nn_block ; ++ii ){
+      work->_freq_ap[ block[ii] ]++;
+    }
+    org_bytesize += nn_block;
   }
   if( 0 == org_bytesize ){
     sb.Flush();
@@ -476,12 +481,9 @@ void  CHuffmanEncoder::Encode(){
     // export _reserved
     sb_flat.PushBitsN(3,0);
 
+    // the header is 32 bits, so the data is byte aligned
     _pipe_in->SeekPop(0);
-    u8 cc;
-    while( _pipe_in->Pop( cc ) ){
-      sb_flat.PushBitsU8( cc );
-    }
-    sb_flat.Flush();
+    Pipe::Copy( *_pipe_in, *_pipe_out, org_bytesize );
   }
   delete work;
 #ifdef VERBOSE
@@ -494,45 +496,211 @@ void  CHuffmanEncoder::Encode(){
 // ------------------------------------------------------------------------------
 #define IDX_NIL     (0xffff)
 #define N_MAX       (512)
+
+// Lookup tables: the primary table is indexed by the next LUT_BITS bits of the
+// stream. Codes longer than that continue in a secondary table of up to
+// LUT2_BITS bits hung off the tree node reached; codes longer than both fall
+// back to walking the tree one bit at a time.
+#define LUT_BITS    (8)
+#define LUT2_BITS   (8)
+
+// A subtree LUT2_BITS deep holds at least LUT2_BITS+1 of the 256 leaves, so the
+// secondary tables of a full code tree fit in this many entries. Others, from
+// malformed streams, walk the tree where the tables run out.
+#define LUT2_MAX    ( ( 256 / (LUT2_BITS+1) + 1 ) << LUT2_BITS )
+
+enum LutKind : u8 {
+  LUT_LEAF,     // _value = decoded byte, _len = bits consumed
+  LUT_LINK,     // _value = top of the secondary table, _len = its bits
+  LUT_NODE,     // _value = tree node after _len bits, walk the tree from there
+  LUT_INVALID,  // no code has this prefix
+};
+
+struct LutEntry {
+  u16 _value;
+  u8  _len;
+  u8  _kind;
+};
+
 struct WorkDec {
   u16  _gen_idx_branch = 0;
   u16  _left    [ N_MAX ];
   u16  _right   [ N_MAX ];
   u8   _dec_data[ N_MAX ];
+  LutEntry  _lut[ 1<<LUT_BITS ];
+  LutEntry* _lut2 = nullptr;    // secondary tables, sized by LinkTables()
+
+  ~WorkDec(){ delete[] _lut2; }
 
   u16 NewBranch(){
+    if( _gen_idx_branch >= N_MAX ) return IDX_NIL;
     const u16 idx = _gen_idx_branch++;
     _left    [ idx ] =
     _right   [ idx ] = IDX_NIL;
     _dec_data[ idx ] = 0;
     return idx;
   }
+
+  bool  IsLeaf( u16 idx ) const {
+    return  _left[ idx ] == IDX_NIL && _right[ idx ] == IDX_NIL;
+  }
+
+  u8  Depth( u16 idx ) const {
+    if( IsLeaf( idx ) ) return 0;
+    u8 dl = _left [ idx ] == IDX_NIL ? 0 : Depth( _left [ idx ] );
+    u8 dr = _right[ idx ] == IDX_NIL ? 0 : Depth( _right[ idx ] );
+    return  1 + (dl > dr ? dl : dr);
+  }
+
+  // Fills (1<<bits_) entries, each decoding the next bits_ bits from node idx_.
+  void  FillTable( LutEntry* lut_, u16 idx_, u8 bits_ ){
+    for( u32 vv=0 ; vv < (1u<<bits_) ; ++vv ){
+      LutEntry& ent = lut_[ vv ];
+      u16 idx = idx_;
+      u8  len = 0;
+      while( !IsLeaf( idx ) && len < bits_ ){
+        idx = ( (vv >> (bits_-1-len)) & 1 ) ? _right[ idx ] : _left[ idx ];
+        ++len;
+        if( idx == IDX_NIL )  break;
+      }
+      if( idx == IDX_NIL ){
+        ent = { 0, 0, LUT_INVALID };
+      } else if( IsLeaf( idx ) ){
+        ent = { _dec_data[ idx ], len, LUT_LEAF };
+      } else {
+        ent = { idx, len, LUT_NODE };
+      }
+    }
+  }
+
+  // Gives the prefixes longer than the primary table a secondary table.
+  // The tables are counted first so only what the code lengths need is
+  // allocated; most streams need a few hundred entries or none.
+  void  LinkTables(){
+    u8  bits2[ 1<<LUT_BITS ];
+    u32 total = 0;
+    for( u32 vv=0 ; vv < (1u<<LUT_BITS) ; ++vv ){
+      bits2[ vv ] = 0;
+      if( _lut[ vv ]._kind != LUT_NODE ) continue;
+      u8 bits = Depth( _lut[ vv ]._value );
+      if( bits > LUT2_BITS ) bits = LUT2_BITS;
+      if( total + (1u<<bits) > LUT2_MAX ) continue;
+      bits2[ vv ] = bits;
+      total += 1u<<bits;
+    }
+    if( !total )  return;
+
+    _lut2 = new LutEntry[ total ];
+    u16 top = 0;
+    for( u32 vv=0 ; vv < (1u<<LUT_BITS) ; ++vv ){
+      if( !bits2[ vv ] )  continue;
+      FillTable( &_lut2[ top ], _lut[ vv ]._value, bits2[ vv ] );
+      _lut[ vv ] = { top, bits2[ vv ], LUT_LINK };
+      top += 1u<<bits2[ vv ];
+    }
+  }
 };
 
-CHuffmanDecoder::DecodeResult  CHuffmanDecoder::_DoDecodeFlat(){
-  _pipe_in->SeekPop(0);
-  SerialBytes sb;
-  sb.SetIn( _pipe_in );
+// Bit reader for the code stream. When the input can be peeked, it keeps up
+// to 32 bits ahead of the decoder so a symbol is looked up without popping
+// bit by bit, and the pipe is only advanced by Unread(). Otherwise bytes are
+// popped one at a time as the codes need them, so nothing past the end of
+// the stream is taken from the pipe.
+class BitStream {
+  std::shared_ptr< Pipe::CPipe > _pipe_in;
+  std::span<const u8> _ahead;
+  size_t  _taken = 0;
+  bool  _peek = true;
+  u32   _acc  = 0;
+  u8    _nacc = 0;
+
+  void  Repeek(){
+    _pipe_in->Skip( _taken );
+    _taken = 0;
+    _ahead = _pipe_in->Peek();
+    _peek  = !_ahead.empty();
+  }
+public:
+  BitStream( std::shared_ptr< Pipe::CPipe > pipe_in_, u8 reg_pop_, u8 left_bits_ )
+    : _pipe_in( pipe_in_ ),
+      _acc( left_bits_ ? (reg_pop_ >> (8-left_bits_)) : 0 ),
+      _nacc( left_bits_ ) {}
+
+  u8    Bits() const { return _nacc; }
+
+  // Reads ahead from the peeked span. A new span is only peeked once no
+  // whole byte is left unconsumed, since skipping the old one commits it.
+  void  Refill(){
+    while( _nacc <= 24 ){
+      if( _taken == _ahead.size() ){
+        if( !_peek || _nacc >= 8 )  return;
+        Repeek();
+        if( !_peek )  return;
+      }
+      _acc = (_acc << 8) | _ahead[ _taken++ ];
+      _nacc += 8;
+    }
+  }
 
-  // _signature
-  const u8 _signature = sb.PopBitsU8();
-  if( _signature != SIG_GENERAL_HUFFMAN ){
-    return CHuffmanDecoder::DECODE_ERR_INVALID_SIGNATURE;
+  // Takes one more byte. Only called when the current code needs it.
+  bool  Pull(){
+    if( _taken == _ahead.size() && _peek )  Repeek();
+    u8 reg8;
+    if( _taken < _ahead.size() ){
+      reg8 = _ahead[ _taken++ ];
+    } else if( !_pipe_in->Pop( reg8 ) ){
+      return false;
+    }
+    _acc = (_acc << 8) | reg8;
+    _nacc += 8;
+    return true;
   }
 
-  bool _flat = sb.PopBits();   // _flat
-  if( !_flat ){
-    return CHuffmanDecoder::DECODE_INVALID_DATA;
+  bool  Need( u8 bits_ ){
+    while( _nacc < bits_ ){
+      if( !Pull() ) return false;
+    }
+    return true;
   }
 
-  const u32 _byte_size_of_orgin = sb.PopBitsN( MAX_SIZE_POW2 );
+  // Past the end of the stream, zeros are returned.
+  u32   Peek( u8 bits_ ) const {
+    const u32 mask = (1u<<bits_)-1;
+    if( _nacc >= bits_ )  return (_acc >> (_nacc-bits_)) & mask;
+    return  (_acc << (bits_-_nacc)) & mask;
+  }
+
+  // Looks the next code up in lut_, pulling bytes until the entry found is
+  // backed by real bits rather than the zeros Peek() pads with.
+  LutEntry  Lookup( const LutEntry* lut_, u8 bits_ ){
+    for(;;){
+      const LutEntry ent = lut_[ Peek( bits_ ) ];
+      const u8 need = ent._kind == LUT_LEAF ? ent._len : bits_;
+      if( _nacc >= need || !Pull() )  return ent;
+    }
+  }
 
-  // _reserved
-  sb.PopBitsN( 3 );
+  bool  Consume( u8 bits_ ){
+    if( bits_ > _nacc ) return false;
+    _nacc -= bits_;
+    return true;
+  }
+
+  // Returns the whole bytes read ahead but not decoded to the peeked span.
+  // Popped bytes are never ahead of the decoder, so there is nothing to
+  // give back for them.
+  void  Unread(){
+    _pipe_in->Skip( _taken - (_nacc >> 3) );
+    _ahead = {};
+    _taken = 0;
+    _nacc &= 7;
+  }
+};
 
-  for( size_t ii=0 ; ii<_byte_size_of_orgin ; ++ii ){
-    const u8 reg8 = sb.PopBitsU8();
-    _pipe_out->Push( reg8 );
+CHuffmanDecoder::DecodeResult  CHuffmanDecoder::_DoDecodeFlat( u32 byte_size_ ){
+  // the header is 32 bits, so the data is byte aligned
+  if( Pipe::Copy( *_pipe_in, *_pipe_out, byte_size_ ) != byte_size_ ){
+    return  CHuffmanDecoder::DECODE_INVALID_DATA;
   }
   return  CHuffmanDecoder::DECODE_OK;
 }
@@ -548,7 +716,11 @@ CHuffmanDecoder::DecodeResult  CHuffmanDecoder::Decode(){
 
   const u8 _flat = sb.PopBits();
   if( _flat ){
-    return  _DoDecodeFlat();
+    // the rest of the header is read here rather than rewinding the pipe,
+    // which only memory pipes can do
+    const u32 _byte_size_of_orgin = sb.PopBitsN( MAX_SIZE_POW2 );
+    sb.PopBitsN( 3 );   // _reserved
+    return  _DoDecodeFlat( _byte_size_of_orgin );
   }
 
   WorkDec* work       = new WorkDec;
@@ -567,8 +739,12 @@ CHuffmanDecoder::DecodeResult  CHuffmanDecoder::Decode(){
     for( int nc=_num_of_bits_huffman_code-1 ; nc >= 0 ; --nc ){
       u16* idx = (0==((_huffman_code>>nc)&1)) ? &left[ idx_cur ] : &right[ idx_cur ];
       if( IDX_NIL == *idx ){
-        idx_cur = work->NewBranch();
-        *idx = idx_cur;
+        const u16 idx_new = work->NewBranch();
+        if( IDX_NIL == idx_new ){
+          delete work;
+          return CHuffmanDecoder::DECODE_INVALID_DATA;
+        }
+        *idx = idx_cur = idx_new;
       } else {
         idx_cur = *idx;
       }
@@ -589,21 +765,60 @@ CHuffmanDecoder::DecodeResult  CHuffmanDecoder::Decode(){
 #ifdef VERBOSE
   WATCH( _byte_size_of_orgin );
 #endif
-  u32 size_of_decoded = 0;
-  idx_cur = idx_root;
-  while( size_of_decoded < _byte_size_of_orgin ){
-    if( work->_left[ idx_cur ] == IDX_NIL && work->_right[ idx_cur ] == IDX_NIL ){
-      if( _pipe_out ){
-        _pipe_out->Push( work->_dec_data[ idx_cur ] );
+  work->FillTable( work->_lut, idx_root, LUT_BITS );
+  work->LinkTables();
+
+  BitStream bs( _pipe_in, sb._reg_pop, (8 - (sb._cnt_recv_bits & 7)) & 7 );
+  u8    block[ BLOCK_BYTES ];
+  size_t  nn_block = 0;
+  CHuffmanDecoder::DecodeResult result = CHuffmanDecoder::DECODE_OK;
+  for( u32 size_of_decoded = 0 ; size_of_decoded < _byte_size_of_orgin ; ++size_of_decoded ){
+    bs.Refill();
+    LutEntry ent = bs.Lookup( work->_lut, LUT_BITS );
+    if( ent._kind == LUT_LINK ){
+      if( !bs.Consume( LUT_BITS ) ){
+        result = CHuffmanDecoder::DECODE_INVALID_DATA;
+        break;
       }
-      ++size_of_decoded;
-      idx_cur = idx_root;
-    } else {
-      idx_cur = (0 == sb.PopBits()) ? work->_left[ idx_cur ] : work->_right[ idx_cur ];
+      ent = bs.Lookup( &work->_lut2[ ent._value ], ent._len );
     }
+
+    if( ent._kind == LUT_NODE ){
+      // longer than both tables
+      u16 idx = ent._value;
+      if( !bs.Consume( ent._len ) ){
+        result = CHuffmanDecoder::DECODE_INVALID_DATA;
+        break;
+      }
+      while( idx != IDX_NIL && !work->IsLeaf( idx ) ){
+        if( !bs.Need( 1 ) ) break;
+        const bool bit = bs.Peek( 1 );
+        bs.Consume( 1 );
+        idx = bit ? right[ idx ] : left[ idx ];
+      }
+      if( idx == IDX_NIL || !work->IsLeaf( idx ) ){
+        result = CHuffmanDecoder::DECODE_INVALID_DATA;
+        break;
+      }
+      ent = { dec_data[ idx ], 0, LUT_LEAF };
+    }
+
+    if( ent._kind != LUT_LEAF || !bs.Consume( ent._len ) ){
+      result = CHuffmanDecoder::DECODE_INVALID_DATA;
+      break;
+    }
+    block[ nn_block++ ] = (u8)ent._value;
+    if( nn_block == BLOCK_BYTES ){
+      if( _pipe_out ) _pipe_out->Write( block );
+      nn_block = 0;
+    }
+  }
+  if( _pipe_out && nn_block ){
+    _pipe_out->Write( std::span<const u8>( block, nn_block ) );
   }
+  bs.Unread();
   delete work;
-  return  CHuffmanDecoder::DECODE_OK;
+  return  result;
 }
 
 void  CHuffmanDecoder::SetIn ( std::shared_ptr< Pipe::CPipe > pipe_in_  ){
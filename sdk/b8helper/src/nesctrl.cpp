@@ -138,16 +138,15 @@ static  void  ChkCollide( const TouchPos& tp , const CfgNesCtrl& cfg, u8* result
 void  CNesCtrl::Step(){
   u8 results[ N_BTN ];
   memset(&results[0],0x00,sizeof(results));
-  const auto& status = impl->decoder.GetStatus();
-  for (const auto& [key, value] : status) {
-    switch(value->ev.type){
+  for (const HifPoint& point : impl->decoder.GetStatus()) {
+    switch(point.ev.type){
       case  B8_HIF_EV_MOUSE_DOWN:
       case  B8_HIF_EV_MOUSE_MOVE:
       case  B8_HIF_EV_TOUCH_START:
       case  B8_HIF_EV_TOUCH_MOVE:{
         TouchPos tp;
-        tp._tx = value->ev.xp;
-        tp._ty = value->ev.yp;
+        tp._tx = point.ev.xp;
+        tp._ty = point.ev.yp;
         ChkCollide( tp , _cfg, results );
       }break;
       default:break;
@@ -198,13 +197,12 @@ void  CNesCtrl::Draw( b8PpuCmd* pcmd , u32 otz ){
   }
 
   if( _cfg.debug_visual ){
-    const auto& status = impl->decoder.GetStatus();
-    for (const auto& [key, value] : status) {
+    for (const HifPoint& point : impl->decoder.GetStatus()) {
       b8PpuRect* pp = b8PpuRectAllocZ( pcmd , 1 );
-      pp->pal = value->hdl & 15;
+      pp->pal = point.hdl & 15;
       const int RR =16;
-      pp->x = (value->ev.xp>>4)-RR;
-      pp->y = (value->ev.yp>>4)-RR;
+      pp->x = (point.ev.xp>>4)-RR;
+      pp->y = (point.ev.yp>>4)-RR;
       pp->w = (RR*2);
       pp->h = (RR*2);
     }
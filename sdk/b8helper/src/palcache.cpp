@@ -0,0 +1,96 @@
+#include <palcache.h>
+#include <string.h>
+
+namespace palcache {
+
+static  void  _SetPidx( b8PpuSetpal* pp, u32 nn, u8 cc ){
+  switch( nn ){
+    case  0: pp->pidx0 = cc; break;
+    case  1: pp->pidx1 = cc; break;
+    case  2: pp->pidx2 = cc; break;
+    case  3: pp->pidx3 = cc; break;
+    case  4: pp->pidx4 = cc; break;
+    case  5: pp->pidx5 = cc; break;
+    case  6: pp->pidx6 = cc; break;
+    case  7: pp->pidx7 = cc; break;
+    case  8: pp->pidx8 = cc; break;
+    case  9: pp->pidx9 = cc; break;
+    case 10: pp->pidx10= cc; break;
+    case 11: pp->pidx11= cc; break;
+    case 12: pp->pidx12= cc; break;
+    case 13: pp->pidx13= cc; break;
+    case 14: pp->pidx14= cc; break;
+    case 15: pp->pidx15= cc; break;
+    default:  break;
+  }
+}
+
+void  CPalCache::Begin( b8PpuCmd* cmd_ ){
+  _cmd = cmd_;
+  memset( _depth, 0, sizeof(_depth) );
+  _cur = Stats();
+}
+
+void  CPalCache::_Flush( u32 otz_ ){
+  Depth& dp = _depth[ otz_ ];
+  b8PpuFlush* pf = b8PpuFlushAllocZPB( _cmd, otz_ );
+  pf->pal = 1;
+  ++_cur.flush_emitted;
+
+  dp._flush = false;
+  memset( dp._pending, 0, sizeof(dp._pending) );
+}
+
+void  CPalCache::Set( u32 otz_, u8 palsel_, u16 wmask_, const u8* pidx_ ){
+  ++_cur.set_calls;
+  palsel_ &= NUM_PALSEL-1;
+
+  if( otz_ >= MAX_DEPTH ){
+    b8PpuSetpal* pp = b8PpuSetpalAllocZPB( _cmd, otz_, 1 );
+    pp->palsel = palsel_;
+    pp->wmask  = wmask_;
+    for( u32 nn=0 ; nn<NUM_PIDX ; ++nn ){
+      if( wmask_ & (1<<nn) ) _SetPidx( pp, nn, pidx_[ nn ] & 15 );
+    }
+    ++_cur.setpal_emitted;
+    ++_cur.flush_emitted;
+    return;
+  }
+
+  // Drop the entries that already hold the requested value at this depth.
+  Depth& dp = _depth[ otz_ ];
+  u64& value = dp._value[ palsel_ ];
+  u16& known = dp._known[ palsel_ ];
+  u16 changed = 0;
+  for( u32 nn=0 ; nn<NUM_PIDX ; ++nn ){
+    if( 0 == (wmask_ & (1<<nn)) ) continue;
+    const u64 cc = pidx_[ nn ] & 15;
+    if( (known & (1<<nn)) && ((value >> (nn*4)) & 15) == cc ) continue;
+    changed |= 1<<nn;
+    value = (value & ~(u64(15) << (nn*4))) | (cc << (nn*4));
+  }
+  if( 0 == changed )  return;
+  known |= changed;
+
+  b8PpuSetpal*& pp = dp._pending[ palsel_ ];
+  if( nullptr == pp ){
+    pp = b8PpuSetpalAllocZPB( _cmd, otz_, 0 );
+    pp->palsel = palsel_;
+    pp->wmask  = 0;
+    ++_cur.setpal_emitted;
+  }
+  pp->wmask = pp->wmask | changed;
+  for( u32 nn=0 ; nn<NUM_PIDX ; ++nn ){
+    if( changed & (1<<nn) ) _SetPidx( pp, nn, pidx_[ nn ] & 15 );
+  }
+  dp._flush = true;
+}
+
+void  CPalCache::End(){
+  for( u32 otz=0 ; otz<MAX_DEPTH ; ++otz ){
+    if( _depth[ otz ]._flush ) _Flush( otz );
+  }
+  _last = _cur;
+}
+
+} // namespace palcache
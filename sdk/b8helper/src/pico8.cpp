@@ -14,6 +14,9 @@
 #include <bit>
 #include <map>
 #include <bgprint.h>
+#include <palcache.h>
+#include <prof.h>
+#include <sequencer.h>
 
 using namespace std;
 using namespace pico8;
@@ -164,7 +167,7 @@ enum Status {
 
 #define MAX_OTZ     (16)
 #define OTZ_BG_TEXT (1)
-static  u32  _ot        [ MAX_OTZ ];
+static  u32  _ot        [ 2 ][ MAX_OTZ ];
 static  u32  _ot_prev   [ MAX_OTZ ];
 static  u32* _jmp_prev  [ MAX_OTZ ];
 
@@ -178,8 +181,12 @@ static  void  clear_jmp_prev( b8PpuCmd* ppu_cmd ){
 #define PLAYER_MAX  (2)
 #define PPU_CMD_BUFF_WORDS (16*1024)
 static  u32       _cnt_update;
-static  u32       _ppu_cmd_buff[ PPU_CMD_BUFF_WORDS ];
+static  u32       _ppu_cmd_buff[ 2 ][ PPU_CMD_BUFF_WORDS ];
 static  b8PpuCmd  _ppu_cmd;
+static  b8PpuCmdPair  _ppu_cmd_pair;
+static  palcache::CPalCache  _palcache;
+static  bool      _dbuf_enabled = false;
+static  bool      _dbuf_request = false;
 static  s32       _reso_w     = 0;
 static  s32       _reso_h     = 0;
 static  Color     _color        = BLACK;
@@ -199,9 +206,11 @@ static  FILE*     _fp_bgprint_debug = 0;
 static  BgConfig  _bg_config[ BG_MAX ];
 static  ButtonStatus  _button_status[ PLAYER_MAX ];
 static  MouseStatus   _mouse_status;
-static  shared_ptr< CHifDecoder > _hif_decoder;
+static  CHifDecoder _hif_decoder;
+static  CSequencer  _sequencer;
 static  bool  _init_dprint;
 static  bool  _dprint_enabled;
+static  bool  _prof_overlay;
 
 #define SPRITE_PATTERN_BANK_NUM (16)
 static  u8        _sprite_flags[ SPRITE_PATTERN_BANK_NUM ][256];
@@ -249,7 +258,7 @@ static  void  _reset(){
   for( size_t nn=0 ; nn < numof( _button_status ) ; ++nn ){
     _button_status[ nn ] = ButtonStatus();
   }
-  _hif_decoder = make_shared< CHifDecoder >(); 
+  _hif_decoder.Reset();
   _mouse_status = MouseStatus();
   _init_dprint = false;
 
@@ -257,6 +266,7 @@ static  void  _reset(){
     sprprint::Reset();
     sprprint::Context ctx;
     ctx._cmd = &_ppu_cmd;
+    ctx._palcache = &_palcache;
     _fp_sprprint = sprprint::Open( sprprint::CH1, ctx );
     _ASSERT(_fp_sprprint,"sprprint::Open");
   }
@@ -299,7 +309,7 @@ static  void  hif_update(){
   }
 
   _mouse_status.ClearStatus();
-  const b8HifMouseStatus* ms = _hif_decoder->GetMouseStatus();
+  const b8HifMouseStatus* ms = _hif_decoder.GetMouseStatus();
   if( ms->is_dragging ){
     _mouse_status.btn_status |= LEFT;
     bs.frm_pressed[ BUTTON_MOUSE_LEFT ]++;
@@ -309,17 +319,16 @@ static  void  hif_update(){
     bs.frm_released[ BUTTON_MOUSE_LEFT ]++;
   }
 
-  const auto& status = _hif_decoder->GetStatus();
-  for (const auto& [key, value] : status) {
-    switch(value->ev.type){
+  for (const HifPoint& point : _hif_decoder.GetStatus()) {
+    switch(point.ev.type){
       case  B8_HIF_EV_TOUCH_START:
       case  B8_HIF_EV_TOUCH_MOVE:
       case  B8_HIF_EV_MOUSE_MOVE:
       case  B8_HIF_EV_MOUSE_HOVER_MOVE:
       case  B8_HIF_EV_MOUSE_DOWN:
       case  B8_HIF_EV_MOUSE_UP:
-        _mouse_status.x = value->ev.xp;
-        _mouse_status.y = value->ev.yp;
+        _mouse_status.x = point.ev.xp;
+        _mouse_status.y = point.ev.yp;
         break;
 
       case  B8_HIF_EV_TOUCH_CANCEL:
@@ -338,18 +347,51 @@ void  Pico8::run(){
 
   _status = RUNNING;
 
+  const int zone_update  = b8ProfZone( "update" );
+  const int zone_draw    = b8ProfZone( "draw" );
+  const int zone_bgprint = b8ProfZone( "bgprint" );
+  const int zone_vsync   = b8ProfZone( "vsync" );
+
   while(1){
     hif_update();
+    b8ProfBegin( zone_update );
     _update();
+    b8ProfEnd();
     ++_cnt_update;
     if( has_error() ) break;
 
-    b8PpuCmdSetBuff( &_ppu_cmd , _ppu_cmd_buff , sizeof( _ppu_cmd_buff ) );
-    b8PpuClearOT( &_ppu_cmd , &_ot[0], &_ot_prev[0], MAX_OTZ );
+    if( _dbuf_request != _dbuf_enabled ){
+      if( _dbuf_enabled ){
+        b8PpuCmdPairSync( &_ppu_cmd_pair );
+      } else {
+        b8PpuCmdPairInit( &_ppu_cmd_pair , _ppu_cmd_buff[0] , _ppu_cmd_buff[1] , sizeof( _ppu_cmd_buff[0] ) );
+      }
+      _dbuf_enabled = _dbuf_request;
+    }
+
+    u32* ot;
+    if( _dbuf_enabled ){
+      // The OT words are part of the list, so each buffer of the pair has its own OT.
+      ot = &_ot[ _ppu_cmd_pair.back ][0];
+      b8PpuCmdPairBegin( &_ppu_cmd_pair , &_ppu_cmd );
+    } else {
+      ot = &_ot[0][0];
+      b8PpuCmdSetBuff( &_ppu_cmd , _ppu_cmd_buff[0] , sizeof( _ppu_cmd_buff[0] ) );
+    }
+    b8PpuClearOT( &_ppu_cmd , ot, &_ot_prev[0], MAX_OTZ );
     clear_jmp_prev( &_ppu_cmd );
+    _palcache.Begin( &_ppu_cmd );
     _during_draw = true;
+    b8ProfBegin( zone_draw );
     _draw();
+    b8ProfEnd();
+    if( _prof_overlay ){
+      prof::ThreadOverlay( _fp_sprprint, 0, prof::Overlay( _fp_sprprint, 0, 0 ) );
+    }
+
+    b8ProfBegin( zone_bgprint );
 
+    _palcache.Depend( OTZ_BG_TEXT );
     {
       bgprint::ExportPpuCmd epc;
       epc._cmd = &_ppu_cmd;
@@ -364,14 +406,24 @@ void  Pico8::run(){
       bgprint::Export(_fp_bgprint_debug, epc);
     }
 
+    b8ProfEnd();
+
     test_esc( _fp_sprprint );
 
     _during_draw = false;
     if( has_error() ) break;
     fflush(_fp_sprprint);
+    _palcache.End();
     b8PpuHaltAlloc( &_ppu_cmd );
-    b8PpuExec( &_ppu_cmd );
-    b8PpuVsyncWait();
+    b8ProfBegin( zone_vsync );
+    if( _dbuf_enabled ){
+      b8PpuCmdPairSubmit( &_ppu_cmd_pair , &_ppu_cmd );
+    } else {
+      b8PpuExec( &_ppu_cmd );
+      b8PpuVsyncWait();
+    }
+    b8ProfEnd();
+    b8ProfFrame();
   }
 
   _status = ERROR; 
@@ -389,7 +441,10 @@ void lsp(u8 bank,const uint8_t* srcimg){
   _ASSERT( bank < MAX_SPR_BANK , "invalid bank" );
   _ASSERT( sprite_sheets[ bank ] == 0 , "sprite_sheets is already used" );
 
-  b8PpuCmdSetBuff( &_ppu_cmd , _ppu_cmd_buff , sizeof( _ppu_cmd_buff ) );
+  if( _dbuf_enabled ){
+    b8PpuCmdPairSync( &_ppu_cmd_pair );
+  }
+  b8PpuCmdSetBuff( &_ppu_cmd , _ppu_cmd_buff[0] , sizeof( _ppu_cmd_buff[0] ) );
 
   {
     b8PpuLoadimg* pp = b8PpuLoadimgAlloc( &_ppu_cmd );
@@ -432,6 +487,7 @@ void  cls( Color color ){
   }
 
   {
+    _palcache.Depend( OTZ_CLEAR );
     b8PpuRect* pp = b8PpuRectAllocZPB( &_ppu_cmd , OTZ_CLEAR );
     pp->pal = (color == CURRENT) ? _color : color;
     pp->x = 0;
@@ -463,6 +519,7 @@ void rectfill(fx8 x0, fx8 y0, fx8 x1, fx8 y1, Color color) {
   const Rect rc(x0, y0, x1 - x0, y1 - y0);
   if (false == _is_colliding(rc, _clip_cur)) return;
 
+  _palcache.Depend( _otz );
   b8PpuRect* pp = b8PpuRectAllocZPB(&_ppu_cmd, _otz);
   pp->pal = (color == CURRENT) ? _color : color;
   pp->x = x0;
@@ -495,6 +552,7 @@ void  line(const Line& ln, Color color ){
 
   if( false == _is_colliding( lln, _clip_cur ) ) return;
 
+  _palcache.Depend( _otz );
   b8PpuLine* pp = b8PpuLineAllocZPB( &_ppu_cmd , _otz );
   pp->pal = (color == CURRENT) ? _color : color;
   pp->width = 2;
@@ -514,6 +572,7 @@ void  poly(const Poly& pol , Color color ){
 
   if( false == _is_colliding( lpol , _clip_cur ) ) return;
 
+  _palcache.Depend( _otz );
   b8PpuPoly* pp = b8PpuPolyAllocZPB( &_ppu_cmd, _otz);
   pp->pal = (color == CURRENT) ? _color : color;
   pp->x0 = lpol.pos0.x;
@@ -537,6 +596,7 @@ void  spr(int n, fx8 x, fx8 y, u8 w, u8 h, bool flip_x, bool flip_y,u8 selpal){
   const Rect rc(x - _camera_cur.x, y - _camera_cur.y, w<<3,h<<3);
   if( false == _is_colliding(rc, _clip_cur ) )  return;
 
+  _palcache.Depend( _otz );
   b8PpuSprite* pp = b8PpuSpriteAllocZPB( &_ppu_cmd , _otz );
   pp->pal = selpal;
   pp->x = rc.x;
@@ -559,6 +619,7 @@ void sprb(u8 bank , int n, fx8 x , fx8 y , u8 w , u8 h , bool flip_x , bool flip
   const Rect rc(x - _camera_cur.x, y - _camera_cur.y, w<<3,h<<3);
   if( false == _is_colliding(rc, _clip_cur ) )  return;
 
+  _palcache.Depend( _otz );
   b8PpuSprite* pp = b8PpuSpriteAllocZPB( &_ppu_cmd , _otz );
   pp->pal = selpal;
   pp->x = rc.x;
@@ -581,55 +642,16 @@ void sprb(u8 bank , int n, fx8 x , fx8 y , u8 w , u8 h , bool flip_x , bool flip
 void setpal(int palsel, const std::array<unsigned char, 16>& pidx ){
   MUST( _during_draw , NOT_DURING_DRAWING );
 
-  b8PpuSetpal* pp = b8PpuSetpalAllocZPB( &_ppu_cmd, _otz, 1 );
-  pp->palsel = palsel;
-
-  pp->pidx0 = pidx[0];
-  pp->pidx1 = pidx[1];
-  pp->pidx2 = pidx[2];
-  pp->pidx3 = pidx[3];
-  pp->pidx4 = pidx[4];
-  pp->pidx5 = pidx[5];
-  pp->pidx6 = pidx[6];
-  pp->pidx7 = pidx[7];
-
-  pp->pidx8 = pidx[8];
-  pp->pidx9 = pidx[9];
-  pp->pidx10= pidx[10];
-  pp->pidx11= pidx[11];
-  pp->pidx12= pidx[12];
-  pp->pidx13= pidx[13];
-  pp->pidx14= pidx[14];
-  pp->pidx15= pidx[15];
+  _palcache.Set( _otz, palsel, 0xffff, pidx.data() );
 }
 
 void pal( Color c0 , Color c1 , u8 palsel ){
   MUST( _during_draw , NOT_DURING_DRAWING );
   MUST( c0 < 16 && c1 < 16 && palsel < 16, INVALID_PARAM ); 
 
-  b8PpuSetpal* pp = b8PpuSetpalAllocZPB( &_ppu_cmd, _otz, 1 );
-  pp->palsel = palsel;
-  pp->wmask = 1<<c0;
-
-  switch( c0 ){
-    case  0: pp->pidx0 = c1; break;
-    case  1: pp->pidx1 = c1; break;
-    case  2: pp->pidx2 = c1; break;
-    case  3: pp->pidx3 = c1; break;
-    case  4: pp->pidx4 = c1; break;
-    case  5: pp->pidx5 = c1; break;
-    case  6: pp->pidx6 = c1; break;
-    case  7: pp->pidx7 = c1; break;
-    case  8: pp->pidx8 = c1; break;
-    case  9: pp->pidx9 = c1; break;
-    case 10: pp->pidx10= c1; break;
-    case 11: pp->pidx11= c1; break;
-    case 12: pp->pidx12= c1; break;
-    case 13: pp->pidx13= c1; break;
-    case 14: pp->pidx14= c1; break;
-    case 15: pp->pidx15= c1; break;
-    default:  break;
-  }
+  u8 pidx[ palcache::NUM_PIDX ];
+  pidx[ c0 ] = c1;
+  _palcache.Set( _otz, palsel, 1<<c0, pidx );
 }
 
 Color color(Color color ){
@@ -897,6 +919,20 @@ void  dprintenable(bool enable){
   _dprint_enabled = enable;
 }
 
+void  dbufenable(bool enable){
+  _dbuf_request = enable;
+}
+
+void  profenable(bool enable, bool overlay){
+  b8ProfEnable( enable ? 1 : 0 );
+  _prof_overlay = enable && overlay;
+}
+
+int   profdump(){
+  fflush( stdout );
+  return  b8ProfDump( fileno( stdout ) );
+}
+
 void dprint(std::string_view format, ...){
   if( !_init_dprint ){
     bgprint::Context ctx;
@@ -981,6 +1017,7 @@ void  map(s16 upix,s16 vpix, BgIndex index ){
   const BgConfig& cfg = _bg_config[ index ];
   MUST( cfg.ready , NOT_INITIALIZED );
 
+  _palcache.Depend( _otz );
   b8PpuBg* pp = b8PpuBgAllocZPB( &_ppu_cmd, _otz );
   pp->cpuaddr = cfg.tiles->data();
   pp->upix = upix;
@@ -1100,10 +1137,42 @@ s32 stat( int index ){
     case  32: return mousex();
     case  33: return mousey();
     case  34: return mousestatus();
+    case  24: return _sequencer.MusicFrame();
 
     case 1000:{
       return  _ppu_cmd.sp - _ppu_cmd.buff;
     }break;
+
+    case 1001: return _palcache.GetStats().setpal_emitted;
+    case 1002: return _palcache.GetStats().SetpalAvoided();
+    case 1003: return _palcache.GetStats().flush_emitted;
+    case 1004: return _palcache.GetStats().FlushAvoided();
+    case 1005: return (s32)b8SysGetIrqLatency( B8_IRQ_VBLK );
+    case 1006: return (s32)b8HifGetLatency();
+
+    case 1200: return _sequencer.Stats().ticks;
+    case 1201: return _sequencer.Stats().cycles_last;
+    case 1202: return _sequencer.Stats().cycles_max;
+    case 1203: return _sequencer.Stats().budget_hits;
+    case 1204: return _sequencer.Stats().steals;
+    case 1205: return _sequencer.Stats().voices;
+    case 1206: return _sequencer.Sound().Shadow().written;
+    case 1207: return _sequencer.Sound().Shadow().dropped;
+  }
+
+  if( index >= 1010 && index < 1200 ){
+    b8PpuStats ps;
+    if( b8PpuGetStats( &ps ) < 0 )  return 0;
+    if( index < 1010 + B8_PPU_STAT_NUM ) return ps.prims[ index - 1010 ];
+    if( index >= 1100 ){
+      return  index < 1100 + B8_PPU_STATS_MAX_OTZ ? ps.ot_words[ index - 1100 ] : 0;
+    }
+    switch( index ){
+      case 1020: return ps.jmp_words;
+      case 1021: return ps.used_words;
+      case 1022: return ps.peak_words;
+      case 1023: return ps.frames;
+    }
   }
   return 0;
 }
@@ -1232,6 +1301,43 @@ Color sget(u8 x, u8 y , u8 bank ){
   const u8 dot = *( pix + ((y<<6)+(x>>1)) );
   return x&1 ? static_cast< Color >( dot&0xf ) : static_cast< Color >( dot>>4 );
 }
+
+// TMR channel the sequencer thread ticks on.
+#define SEQUENCER_TMR_CH  (2)
+
+// A failed start is retried by the next call.
+static  bool  sequencer_start(){
+  static  bool  _started = false;
+  if( _started )  return true;
+  if( _sequencer.Start( SEQUENCER_TMR_CH ) != 0 ) return false;
+  _started = true;
+  return  true;
+}
+
+bool sfxbank(std::span<const u8> bank){
+  MUST_RETURN( sequencer_start() , SOUND_NOT_STARTED , false );
+  return  _sequencer.SetBank( bank );
+}
+
+void sfx(int n, int channel){
+  MUST( channel < (int)CSequencer::NUM_VOICES , INVALID_PARAM );
+  MUST( sequencer_start() , SOUND_NOT_STARTED );
+  if( n < 0 ){
+    _sequencer.StopSfx( channel );
+  } else {
+    _sequencer.PlaySfx( n , channel );
+  }
+}
+
+void music(int n, int fade_len, int channel_mask){
+  (void)fade_len;
+  MUST( sequencer_start() , SOUND_NOT_STARTED );
+  if( n < 0 ){
+    _sequencer.StopMusic();
+  } else {
+    _sequencer.PlayMusic( n , (u8)channel_mask );
+  }
+}
 struct LargeStruct {
   int data[256];
   int x=100;
@@ -1,5 +1,6 @@
 #include <pipe.h>
 #include <trace.h>
+#include <cstdint>
 
 namespace Pipe {
 
@@ -15,14 +16,35 @@ void  CMemBufferPipe::Dump(){
   }
 }
 
+size_t  Copy( CPipe& pipe_in_, CPipe& pipe_out_, size_t bytesize_ ){
+  size_t copied = 0;
+  while( copied < bytesize_ ){
+    std::span<const u8> src = pipe_in_.Peek();
+    if( src.empty() ) break;
+    if( src.size() > bytesize_ - copied ) src = src.first( bytesize_ - copied );
+    const size_t written = pipe_out_.Write( src );
+    pipe_in_.Skip( written );
+    copied += written;
+    if( written < src.size() )  return copied;
+  }
+
+  u8 block[ 256 ];
+  while( copied < bytesize_ ){
+    const size_t rest = bytesize_ - copied;
+    const size_t nn = pipe_in_.Read( std::span<u8>( block, rest < sizeof(block) ? rest : sizeof(block) ) );
+    if( nn == 0 ) break;
+    const size_t written = pipe_out_.Write( std::span<const u8>( block, nn ) );
+    copied += written;
+    if( written < nn )  break;
+  }
+  return  copied;
+}
+
 void  Move(
   std::shared_ptr< Pipe::CPipe > pipe_in_,
   std::shared_ptr< Pipe::CPipe > pipe_out_
 ){
-  u8 reg8;
-  while( pipe_in_->Pop( reg8 ) ){
-    pipe_out_->Push( reg8 );
-  }
+  Copy( *pipe_in_, *pipe_out_, SIZE_MAX );
 }
 
 } // namespace Pipe
\ No newline at end of file
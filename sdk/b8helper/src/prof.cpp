@@ -0,0 +1,82 @@
+#include <prof.h>
+#include <string.h>
+
+namespace prof {
+
+static  u32 _percent( u32 cycles_, u32 frame_ ){
+  return  frame_ ? (u32)( (u64)cycles_ * 100 / frame_ ) : 0;
+}
+
+int   Overlay( FILE* fp_, int x_, int y_ ){
+  if( nullptr == fp_ )  return y_;
+
+  u32 frame = 0;
+  b8ProfGetEvents( nullptr, &frame );
+
+  fprintf( fp_, "\e[%d;%dH", y_, x_ );
+  fprintf( fp_, "frame %lu cyc", (unsigned long)frame );
+  for( int nn=0 ; nn<b8ProfGetNumZones() ; ++nn ){
+    b8ProfZoneStats st;
+    if( b8ProfGetZoneStats( nn, &st ) < 0 ) continue;
+    y_ += 8;
+    fprintf( fp_, "\e[%d;%dH", y_, x_ );
+    fprintf( fp_, "%-8.8s%3lu %3lu%% %3lu%% %3lu%%",
+      st.name,
+      (unsigned long)st.calls,
+      (unsigned long)_percent( st.last, frame ),
+      (unsigned long)_percent( st.avg,  frame ),
+      (unsigned long)_percent( st.max,  frame )
+    );
+  }
+  return  y_ + 8;
+}
+
+int   ThreadOverlay( FILE* fp_, int x_, int y_ ){
+  static  b8OsThreadInfo  _prev[ 32 ];
+  static  int             _num_prev;
+
+  b8OsThreadInfo  cur[ 32 ];
+  int num = b8OsGetThreadInfo( cur, 32 );
+  if( num < 0 ) return y_;
+  if( num > 32 )  num = 32;
+
+  // Cycles and switches of each thread since the previous call. Threads created since then count from 0.
+  u64 delta[ 32 ];
+  u32 switches[ 32 ];
+  u64 total = 0;
+  for( int nn=0 ; nn<num ; ++nn ){
+    delta[ nn ]    = cur[ nn ].cpu_cycles;
+    switches[ nn ] = cur[ nn ].switches;
+    for( int mm=0 ; mm<_num_prev ; ++mm ){
+      if( _prev[ mm ].pid == cur[ nn ].pid ){
+        delta[ nn ]    -= _prev[ mm ].cpu_cycles;
+        switches[ nn ] -= _prev[ mm ].switches;
+        break;
+      }
+    }
+    total += delta[ nn ];
+  }
+
+  for( int nn=0 ; fp_ && nn<num ; ++nn ){
+    if( cur[ nn ].state == B8_OS_THREAD_EXITED ) continue;
+    fprintf( fp_, "\e[%d;%dH", y_, x_ );
+    if( cur[ nn ].idle ){
+      fprintf( fp_, "idle    " );
+    } else if( cur[ nn ].irq != B8_OS_NOT_USING_IRQ ){
+      fprintf( fp_, "irq%-5u", (unsigned)cur[ nn ].irq );
+    } else {
+      fprintf( fp_, "th%-6lu", (unsigned long)( cur[ nn ].pid & 0xffff ) );
+    }
+    fprintf( fp_, "%3lu%% %4lu",
+      (unsigned long)( total ? delta[ nn ] * 100 / total : 0 ),
+      (unsigned long)switches[ nn ]
+    );
+    y_ += 8;
+  }
+
+  memcpy( _prev, cur, sizeof(cur[0]) * num );
+  _num_prev = num;
+  return  y_;
+}
+
+} // namespace prof
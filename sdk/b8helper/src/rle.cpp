@@ -20,6 +20,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 #include <vector>
+#include <cstring>
 #include <rle.h>
 #include <trace.h>
 #include "stdio.h"
@@ -56,9 +57,7 @@ CRleEncoder::EncodeResult CRleEncoder::Encode(){
     if( equal ){
       if( uniq.size() >= 2 ){
         _pipe_out->Push( -s8( uniq.size()-1 ) );
-        for( size_t ii=0 ; ii < uniq.size()-1 ; ++ii ){
-          _pipe_out->Push( uniq[ii] );
-        }
+        _pipe_out->Write( std::span<const u8>( uniq.data(), uniq.size()-1 ) );
       }
       uniq.clear();
     } else {
@@ -70,9 +69,7 @@ CRleEncoder::EncodeResult CRleEncoder::Encode(){
 
       if( uniq.size() >= 0x7f ){
         _pipe_out->Push( -s8( uniq.size() ) );
-        for( size_t ii=0 ; ii < uniq.size() ; ++ii ){
-          _pipe_out->Push( uniq[ii] );
-        }
+        _pipe_out->Write( uniq );
         reset = true;;
       }
     }
@@ -89,9 +86,7 @@ CRleEncoder::EncodeResult CRleEncoder::Encode(){
 
   if( uniq.size() >= 2 ){
     _pipe_out->Push( -s8( uniq.size() ) );
-    for( const auto& it : uniq ){
-      _pipe_out->Push( it );
-    }
+    _pipe_out->Write( uniq );
   } else if( rl._rep >= 1 ){
     _pipe_out->Push( rl._rep  );
     _pipe_out->Push( rl._data );
@@ -125,20 +120,27 @@ union	ForceCast8 {
   s8 _ds8;
 };
 
+// Runs and literals are written as blocks. Literals are copied straight from
+// the input when it can be peeked, e.g. a stream in ROM.
 CRleDecoder::DecodeResult  CRleDecoder::Decode(){
   ForceCast8 fc8;
   u8 reg8;
+  u8 block[ 0x80 ];
   while( _pipe_in->Pop( reg8 ) ){
     fc8._du8 = reg8;
     if( fc8._ds8 > 0){
       _pipe_in->Pop( reg8 );
-      for( s8 ii=0 ; ii<fc8._ds8 ; ++ii ){
-        _pipe_out->Push( reg8 );
-      }
+      memset( block, reg8, fc8._ds8 );
+      _pipe_out->Write( std::span<const u8>( block, fc8._ds8 ) );
     } else if( fc8._ds8 < 0){
-      for( s8 ii=0 ; ii< -fc8._ds8 ; ++ii ){
-        _pipe_in->Pop( reg8 );
-        _pipe_out->Push( reg8 );
+      const size_t len = -fc8._ds8;
+      const std::span<const u8> src = _pipe_in->Peek();
+      if( src.size() >= len ){
+        _pipe_out->Write( src.first( len ) );
+        _pipe_in->Skip( len );
+      } else {
+        const size_t nn = _pipe_in->Read( std::span<u8>( block, len ) );
+        _pipe_out->Write( std::span<const u8>( block, nn ) );
       }
     } else if (fc8._du8 == END_OF_MARK ){
       return  CRleDecoder::DECODE_OK;
@@ -0,0 +1,495 @@
+#include <string.h>
+#include <iterator>
+#include <beep8.h>
+#include <b8/dwt.h>
+#include <sequencer.h>
+#include <zpack.h>
+
+// The host trace must not depend on timing.
+#if B8_APU_MOCK
+#define CYCCNT()  (0u)
+#else
+#define CYCCNT()  (B8_DWT_CYCCNT)
+#endif
+
+enum {
+  REQ_BANK,
+  REQ_SFX,
+  REQ_STOP_SFX,
+  REQ_MUSIC,
+  REQ_STOP_MUSIC,
+};
+
+enum {
+  OP_NOTE     = 0x40,
+  OP_INST     = 0x80,
+  OP_VOL      = 0x88,
+  OP_NOTE_ABS = 0x90,
+  OP_SPEED    = 0x91,
+  OP_OFF      = 0x92,
+  OP_LOOP     = 0xfe,
+  OP_END      = 0xff,
+};
+
+static  constexpr size_t  BANK_HEADER = 4;
+static  constexpr size_t  FRAME_BYTES = 1 + CSequencer::MUSIC_TRACKS;
+static  constexpr u8      MAX_PITCH   = 95;
+static  constexpr u8      MAX_VOL     = 7;
+
+// The highest octave, from C at 8372 Hz, in Hz, 14.6 fixed point as SETFREQ takes it.
+// Lower octaves are shifted down from it, which keeps their fractional bits.
+static  const u32 _freq_octave7[ 12 ] = {
+  535809, 567670, 601425, 637188, 675077, 715219,
+  757749, 802807, 850544, 901120, 954703, 1011473,
+};
+
+struct Instrument {
+  u8  wave;
+  u16 attack_ms;
+  u16 decay_ms;
+  u16 sustain_amp;
+  u16 release_ms;
+};
+
+// The eight PICO-8 instruments, as near as the APU waves get.
+static  const Instrument  _instruments[ 8 ] = {
+  { B8_APU_WAVE_TRIANGLE , 2 ,  0 , 0xffff , 20 }, // triangle
+  { B8_APU_WAVE_SAWTOOTH , 2 , 40 , 0xc8c8 , 20 }, // tilted saw
+  { B8_APU_WAVE_SAWTOOTH , 2 ,  0 , 0xffff , 20 }, // saw
+  { B8_APU_WAVE_SQUARE   , 2 ,  0 , 0xffff , 20 }, // square
+  { B8_APU_WAVE_SQUARE   , 2 , 60 , 0xa0a0 , 20 }, // pulse
+  { B8_APU_WAVE_TRIANGLE , 5 , 30 , 0xc8c8 , 40 }, // organ
+  { B8_APU_WAVE_NOISE    , 1 ,  0 , 0xffff , 10 }, // noise
+  { B8_APU_WAVE_SIN      ,10 , 50 , 0xb4b4 , 60 }, // phaser
+};
+
+static  u32   _freq_of( u32 pitch ){
+  return  _freq_octave7[ pitch % 12 ] >> ( 7 - pitch / 12 );
+}
+
+static  u32   _rd16( const u8* p ){
+  return  p[0] | ( p[1] << 8 );
+}
+
+static  u32   _num_sfx( std::span<const u8> bank ){
+  return  bank.empty() ? 0 : bank[ 2 ];
+}
+
+static  u32   _num_frames( std::span<const u8> bank ){
+  return  bank.empty() ? 0 : bank[ 3 ];
+}
+
+static  u8    _clamp_pitch( int pitch ){
+  return  pitch < 0 ? 0 : pitch > MAX_PITCH ? MAX_PITCH : (u8)pitch;
+}
+
+CSequencer::CSequencer(){
+  memset( _owner , -1 , sizeof(_owner) );
+  memset( _age , 0 , sizeof(_age) );
+}
+
+int   CSequencer::Start( u32 tmr_ch_ ){
+  if( _running )  return  0;
+
+  const int ret = b8TmrSetup( tmr_ch_ , ( b8SysGetCpuClock() / TICK_HZ ) >> 8 );
+  if( ret < 0 ) return  ret;
+  _tmr_ch = tmr_ch_;
+
+  pthread_t pid;
+  pthread_attr_t attr;
+  pthread_attr_init( &attr );
+  pthread_attr_setstacksize( &attr , 0x1000 );
+  struct sched_param param;
+  param.sched_priority = B8_OS_PRIORITY_DEFAULT + 1;
+  pthread_attr_setschedparam( &attr , &param );
+  pthread_attr_setdetachstate( &attr , PTHREAD_CREATE_DETACHED );
+  const int err = pthread_create( &pid , &attr , ThreadMain , this );
+  if( err ) return  err;
+
+  _running = true;
+  return  0;
+}
+
+void* CSequencer::ThreadMain( void* arg_ ){
+  CSequencer* seq = (CSequencer*)arg_;
+  while( true ){
+    b8TmrWait( seq->_tmr_ch );
+    seq->Tick();
+    // The fence of the last list is signaled at V-blank, so every other tick
+    // finds it pending and its commands go with the next tick.
+    seq->_sound.TrySubmit();
+  }
+  return  nullptr;
+}
+
+bool  CSequencer::SetBank( std::span<const u8> bank_ ){
+  if( bank_.size() < BANK_HEADER || bank_[0] != 'S' || bank_[1] != 'Q' ) return false;
+
+  const size_t patterns = BANK_HEADER + 2 * _num_sfx( bank_ ) + FRAME_BYTES * _num_frames( bank_ );
+  if( bank_.size() < patterns ) return false;
+  for( u32 nn=0 ; nn < _num_sfx( bank_ ) ; ++nn ){
+    const u32 offset = _rd16( &bank_[ BANK_HEADER + 2*nn ] );
+    if( offset < patterns || offset >= bank_.size() ) return false;
+  }
+
+  Request req = { REQ_BANK , 0 , -1 , 0 , bank_.data() , (u32)bank_.size() };
+  Push( req );
+  return  true;
+}
+
+void  CSequencer::PlaySfx( int n_ , int voice_ ){
+  Request req = { REQ_SFX , 0 , (s8)voice_ , (s16)n_ , nullptr , 0 };
+  Push( req );
+}
+
+void  CSequencer::StopSfx( int voice_ ){
+  Request req = { REQ_STOP_SFX , 0 , (s8)voice_ , 0 , nullptr , 0 };
+  Push( req );
+}
+
+void  CSequencer::PlayMusic( int frame_ , u8 reserved_mask_ ){
+  Request req = { REQ_MUSIC , reserved_mask_ , -1 , (s16)frame_ , nullptr , 0 };
+  Push( req );
+}
+
+void  CSequencer::StopMusic(){
+  Request req = { REQ_STOP_MUSIC , 0 , -1 , 0 , nullptr , 0 };
+  Push( req );
+}
+
+// A full queue drops the request; see the overflow count of the ring.
+void  CSequencer::Push( const Request& req_ ){
+  _requests.Push( req_ );
+}
+
+void  CSequencer::Render( u32 ticks_ ){
+  _ASSERT( !_running , "sequencer thread is running" );
+  while( ticks_-- > 0 ){
+    Tick();
+    _sound.Submit();
+  }
+}
+
+bool  CSequencer::UnpackBank( const u8* src_ , size_t srcsize_ , std::vector<u8>& out_ , size_t maxsize_ ){
+  out_.resize( maxsize_ );
+  const int size = ZPack::Decode( src_ , srcsize_ , out_.data() , out_.size() );
+  if( size < 0 ){
+    out_.clear();
+    return  false;
+  }
+  out_.resize( size );
+  return  true;
+}
+
+void  CSequencer::Tick(){
+  const u32 cyc0 = CYCCNT();
+
+  TakeRequests();
+
+  // The sfx first, so that music notes of this tick do not take voices the sfx want.
+  for( u32 tt=MUSIC_TRACKS ; tt < std::size(_tracks) ; ++tt ){
+    if( _tracks[ tt ].active && !StepTrack( tt ) ) StopTrack( tt , false );
+  }
+  for( u32 tt=0 ; tt < MUSIC_TRACKS ; ++tt ){
+    if( _tracks[ tt ].active && !StepTrack( tt ) ) StopTrack( tt , false );
+  }
+  UpdateMusic();
+
+  u32 voices = 0;
+  for( s8 owner : _owner ){
+    voices += owner >= 0;
+  }
+  _stats.voices = voices;
+  ++_stats.ticks;
+
+  const u32 cyc = CYCCNT() - cyc0;
+  _stats.cycles_last = cyc;
+  if( cyc > _stats.cycles_max ) _stats.cycles_max = cyc;
+}
+
+void  CSequencer::TakeRequests(){
+  std::span<const Request> reqs;
+  while( !(reqs = _requests.Peek()).empty() ){
+    for( const Request& req : reqs ){
+      switch( req.kind ){
+        case  REQ_BANK:
+          for( u32 tt=0 ; tt < std::size(_tracks) ; ++tt ){
+            StopTrack( tt , true );
+          }
+          _frame = -1;
+          _reserved = 0;
+          _bank = { req.data , req.size };
+          break;
+
+        case  REQ_SFX:
+          if( req.n >= 0 && (u32)req.n < _num_sfx( _bank ) ) StartSfx( req.n , req.voice );
+          break;
+
+        case  REQ_STOP_SFX:
+          for( u32 tt=MUSIC_TRACKS ; tt < std::size(_tracks) ; ++tt ){
+            const Track& tr = _tracks[ tt ];
+            if( tr.active && ( req.voice < 0 || tr.voice == req.voice ) ) StopTrack( tt , true );
+          }
+          break;
+
+        case  REQ_MUSIC:
+          _reserved = req.mask;
+          _loop_frame = req.n;
+          StartFrame( req.n );
+          break;
+
+        case  REQ_STOP_MUSIC:
+          for( u32 tt=0 ; tt < MUSIC_TRACKS ; ++tt ){
+            StopTrack( tt , true );
+          }
+          _frame = -1;
+          _reserved = 0;
+          break;
+      }
+    }
+    _requests.Commit( reqs.size() );
+  }
+}
+
+void  CSequencer::StartTrack( u32 track_ , u32 sfx_ , u8 prio_ ){
+  Track& tr = _tracks[ track_ ];
+  const u8* pp = _bank.data() + _rd16( &_bank[ BANK_HEADER + 2*sfx_ ] );
+  tr.speed  = pp[0] ? pp[0] : 1;
+  tr.start  = tr.pc = pp + 1;
+  tr.born   = _stats.ticks;
+  tr.wait   = 0;
+  tr.pitch  = 33;
+  tr.inst   = 0;
+  tr.vol    = 5;
+  tr.prio   = prio_;
+  tr.active = true;
+  tr.looped = false;
+  // A music track keeps its voice from one frame to the next.
+}
+
+void  CSequencer::StartSfx( u32 sfx_ , int voice_ ){
+  // A free track, or else the oldest one.
+  u32 track = MUSIC_TRACKS;
+  for( u32 tt=MUSIC_TRACKS ; tt < std::size(_tracks) ; ++tt ){
+    if( !_tracks[ tt ].active ){
+      track = tt;
+      break;
+    }
+    if( (s32)( _tracks[ tt ].born - _tracks[ track ].born ) < 0 ) track = tt;
+  }
+  if( _tracks[ track ].active ) StopTrack( track , false );
+
+  StartTrack( track , sfx_ , PRIO_SFX );
+  if( voice_ >= 0 && (u32)voice_ < NUM_VOICES ){
+    if( _owner[ voice_ ] >= 0 ) ++_stats.steals;
+    TakeVoice( track , voice_ );
+  }
+}
+
+void  CSequencer::StopTrack( u32 track_ , bool silence_ ){
+  Track& tr = _tracks[ track_ ];
+  if( tr.voice >= 0 ){
+    if( silence_ ) _sound.SetVolume( tr.voice , 0 );
+    _owner[ tr.voice ] = -1;
+    tr.voice = -1;
+  }
+  tr.active = false;
+  tr.prio = PRIO_NONE;
+}
+
+// Returns false once the track has ended.
+bool  CSequencer::StepTrack( u32 track_ ){
+  Track& tr = _tracks[ track_ ];
+  if( tr.wait && --tr.wait )  return  true;
+
+  const u8* end = _bank.data() + _bank.size();
+  for( u32 ops=0 ; ops < MAX_OPS_PER_TICK ; ++ops ){
+    if( tr.pc >= end )  return  false;
+    const u8 op = *tr.pc++;
+
+    if( op < OP_NOTE ){
+      tr.wait = ( op + 1 ) * tr.speed;
+      return  true;
+    }
+    if( op < OP_INST ){
+      const int delta = (int)( (op & 0x3f) ^ 0x20 ) - 0x20;
+      tr.pitch = _clamp_pitch( tr.pitch + delta );
+      PlayNote( track_ );
+      tr.wait = tr.speed;
+      return  true;
+    }
+    if( op < OP_VOL ){
+      tr.inst = op & 7;
+      continue;
+    }
+    if( op < OP_NOTE_ABS ){
+      tr.vol = op & 7;
+      continue;
+    }
+
+    switch( op ){
+      case  OP_NOTE_ABS:
+        if( tr.pc >= end )  return  false;
+        tr.pitch = _clamp_pitch( *tr.pc++ );
+        PlayNote( track_ );
+        tr.wait = tr.speed;
+        return  true;
+
+      case  OP_SPEED:
+        if( tr.pc >= end )  return  false;
+        tr.speed = *tr.pc++;
+        if( 0 == tr.speed ) tr.speed = 1;
+        break;
+
+      case  OP_OFF:
+        if( tr.voice >= 0 ) _sound.SetVolume( tr.voice , 0 );
+        break;
+
+      case  OP_LOOP:
+        tr.pc = tr.start;
+        tr.looped = true;
+        break;
+
+      case  OP_END:
+        return  false;
+
+      default:
+        break;
+    }
+  }
+
+  // Out of budget: the rest of the row's operations wait for the next tick.
+  ++_stats.budget_hits;
+  return  true;
+}
+
+void  CSequencer::PlayNote( u32 track_ ){
+  Track& tr = _tracks[ track_ ];
+  if( 0 == tr.vol ) return;
+  if( tr.voice < 0 && AllocVoice( track_ ) < 0 )  return;
+
+  const u32 ch = tr.voice;
+  const Instrument& inst = _instruments[ tr.inst ];
+  const u32 row_ms = tr.speed * 1000 / TICK_HZ;
+  const u32 ad_ms  = inst.attack_ms + inst.decay_ms;
+
+  SoundEnvelope env;
+  env.attack_ms   = inst.attack_ms;
+  env.decay_ms    = inst.decay_ms;
+  env.sustain_amp = inst.sustain_amp;
+  env.sustain_ms  = row_ms > ad_ms ? row_ms - ad_ms : 0;
+  env.release_ms  = inst.release_ms;
+
+  // Mostly the same values as the last note: the shadow registers drop those.
+  _sound.SetWave( ch , inst.wave );
+  _sound.SetEnvelope( ch , env );
+  _sound.SetFreq( ch , _freq_of( tr.pitch ) );
+  _sound.SetVolume( ch , tr.vol * B8_APU_AMP_MAX / MAX_VOL );
+  _sound.NoteOn( ch );
+  _age[ ch ] = _stats.ticks;
+}
+
+int   CSequencer::AllocVoice( u32 track_ ){
+  const Track& tr = _tracks[ track_ ];
+  const bool music = track_ < MUSIC_TRACKS;
+
+  // A free voice. The music tries its reserved voices first; sfx leave them.
+  int found = -1;
+  for( u32 vv=0 ; vv < NUM_VOICES ; ++vv ){
+    if( _owner[ vv ] >= 0 ) continue;
+    const bool reserved = _reserved & (1u << vv);
+    if( !music && reserved )  continue;
+    if( !music || reserved ){
+      found = vv;
+      break;
+    }
+    if( found < 0 ) found = vv;
+  }
+
+  // Or the oldest note of the lowest priority, no higher than ours.
+  if( found < 0 && !music ){
+    u8  found_prio = 0xff;
+    u32 found_age  = 0;
+    for( u32 vv=0 ; vv < NUM_VOICES ; ++vv ){
+      if( _owner[ vv ] < 0 || (_reserved & (1u << vv)) ) continue;
+      const u8 prio = _tracks[ _owner[ vv ] ].prio;
+      if( prio > tr.prio )  continue;
+      if( prio < found_prio || ( prio == found_prio && (s32)( _age[ vv ] - found_age ) < 0 ) ){
+        found = vv;
+        found_prio = prio;
+        found_age  = _age[ vv ];
+      }
+    }
+    if( found >= 0 )  ++_stats.steals;
+  }
+
+  if( found >= 0 )  TakeVoice( track_ , found );
+  return  found;
+}
+
+void  CSequencer::TakeVoice( u32 track_ , u32 voice_ ){
+  const s8 prev = _owner[ voice_ ];
+  if( prev >= 0 && (u32)prev != track_ ){
+    Track& other = _tracks[ prev ];
+    other.voice = -1;
+    // A cut sfx ends; a music track keeps its place without a voice.
+    if( (u32)prev >= MUSIC_TRACKS ){
+      other.active = false;
+      other.prio = PRIO_NONE;
+    }
+  }
+
+  Track& tr = _tracks[ track_ ];
+  if( tr.voice >= 0 && (u32)tr.voice != voice_ )  _owner[ tr.voice ] = -1;
+  _owner[ voice_ ] = (s8)track_;
+  tr.voice = (s8)voice_;
+}
+
+const u8* CSequencer::FrameAt( int frame_ ) const {
+  return  _bank.data() + BANK_HEADER + 2 * _num_sfx( _bank ) + FRAME_BYTES * frame_;
+}
+
+void  CSequencer::StartFrame( int frame_ ){
+  if( frame_ < 0 || (u32)frame_ >= _num_frames( _bank ) ){
+    for( u32 tt=0 ; tt < MUSIC_TRACKS ; ++tt ){
+      StopTrack( tt , false );
+    }
+    _frame = -1;
+    _reserved = 0;
+    return;
+  }
+
+  const u8* ff = FrameAt( frame_ );
+  _frame = frame_;
+  if( ff[0] & FRAME_LOOP_START )  _loop_frame = frame_;
+  for( u32 tt=0 ; tt < MUSIC_TRACKS ; ++tt ){
+    const u32 sfx = ff[ 1 + tt ];
+    if( sfx < _num_sfx( _bank ) ){
+      StartTrack( tt , sfx , PRIO_MUSIC );
+    } else {
+      StopTrack( tt , false );
+    }
+  }
+}
+
+void  CSequencer::UpdateMusic(){
+  if( _frame < 0 )  return;
+  for( u32 tt=0 ; tt < MUSIC_TRACKS ; ++tt ){
+    const Track& tr = _tracks[ tt ];
+    if( tr.active && !tr.looped ) return;
+  }
+
+  const u8 flags = FrameAt( _frame )[0];
+  int next = _frame + 1;
+  if( flags & FRAME_LOOP_BACK ){
+    next = _loop_frame;
+  } else if( flags & FRAME_STOP ){
+    next = -1;
+  }
+  StartFrame( next );
+
+  // The next frame starts on this tick, with no gap.
+  for( u32 tt=0 ; tt < MUSIC_TRACKS ; ++tt ){
+    if( _tracks[ tt ].active && !StepTrack( tt ) ) StopTrack( tt , false );
+  }
+}
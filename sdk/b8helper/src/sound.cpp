@@ -0,0 +1,82 @@
+#include <beep8.h>
+#include <sound.h>
+
+// Room for the largest command and the HALT after it, in words.
+static  constexpr u32 MIN_ROOM_WORDS = ( sizeof(b8ApuTime) + sizeof(b8ApuHalt) ) / sizeof(u32);
+
+CSound::CSound(){
+  b8ApuCmdPairInit( &_pair , _buff[0] , _buff[1] , sizeof(_buff[0]) );
+  b8ApuShadowReset( &_shadow );
+  _cmd.shadow = &_shadow;
+  b8ApuCmdPairBegin( &_pair , &_cmd );
+}
+
+// A command that does not fit is dropped, and the shadow is left as it was.
+bool  CSound::HasRoom() const {
+  return  (u32)( _cmd.tail - _cmd.sp ) >= MIN_ROOM_WORDS;
+}
+
+bool  CSound::SetWave( u32 ch_ , u32 wavtype_ ){
+  return  HasRoom() && b8ApuSetWavtype( &_cmd , ch_ , wavtype_ );
+}
+
+bool  CSound::SetFreq( u32 ch_ , u32 freq_ ){
+  return  HasRoom() && b8ApuSetFreq( &_cmd , ch_ , freq_ );
+}
+
+bool  CSound::SetVolume( u32 ch_ , u32 vol_ ){
+  return  HasRoom() && b8ApuSetTrackvol( &_cmd , ch_ , vol_ );
+}
+
+// Envelope times are given in milliseconds, and clamped to what the APU takes.
+static  u32   _samples_of( u32 ms_ ){
+  return  ms_ < B8_APU_TIME_MAX / B8_APU_SAMPLE_RATE * 1000 ? B8_APU_MS_TO_SAMPLES( ms_ ) : B8_APU_TIME_MAX;
+}
+
+int   CSound::SetEnvelope( u32 ch_ , const SoundEnvelope& env_ ){
+  const struct {
+    u32 reg;
+    u32 value;
+  } regs[] = {
+    { B8_APU_REG_ATTACKTIME  , _samples_of( env_.attack_ms )  },
+    { B8_APU_REG_ATTACKAMP   , env_.attack_amp                },
+    { B8_APU_REG_DECAYTIME   , _samples_of( env_.decay_ms )   },
+    { B8_APU_REG_SUSTAINTIME , _samples_of( env_.sustain_ms ) },
+    { B8_APU_REG_SUSTAINAMP  , env_.sustain_amp               },
+    { B8_APU_REG_RELEASETIME , _samples_of( env_.release_ms ) },
+  };
+
+  int num = 0;
+  for( const auto& rr : regs ){
+    if( !HasRoom() ) break;
+    num += b8ApuSetReg( &_cmd , ch_ , rr.reg , rr.value );
+  }
+  return  num;
+}
+
+bool  CSound::NoteOn( u32 ch_ ){
+  if( !HasRoom() ) return false;
+  b8ApuAttack* pp = b8ApuAttackAlloc( &_cmd );
+  pp->ch = ch_;
+  return  true;
+}
+
+void  CSound::Submit(){
+  if( _cmd.sp == _cmd.buff ) return;
+
+  b8ApuHaltAlloc( &_cmd );
+  b8ApuCmdPairSubmit( &_pair , &_cmd );
+  b8ApuCmdPairBegin( &_pair , &_cmd );
+}
+
+bool  CSound::TrySubmit(){
+  if( _cmd.sp == _cmd.buff ) return true;
+  if( !b8ApuFenceDone( _pair.fence[ _pair.back ^ 1 ] ) ) return false;
+
+  Submit();
+  return  true;
+}
+
+void  CSound::Invalidate(){
+  b8ApuShadowReset( &_shadow );
+}
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <b8/romfs.h>
 #include <trace.h>
 #include <zpack.h>
 #include <rle.h>
@@ -26,9 +27,9 @@ void  CZPackEncoder::SetOut( std::shared_ptr< Pipe::CPipe > pipe_out_ ){
 
 void  CZPackEncoder::Encode(){
   size_t size_of_org = 0;
-  u8 reg8;
-  while( _pipe_in->Pop( reg8 )){
-    ++size_of_org;
+  u8 block[ 256 ];
+  for( size_t nn ; (nn = _pipe_in->Read( block )) > 0 ; ){
+    size_of_org += nn;
   }
   _pipe_in->SeekPop(0);
 
@@ -168,14 +169,32 @@ WATCH("FlatWithSize");
         orgsize |= u32(xx)<<(ii*8);
       }
 
-      for( u32 nn=0 ; nn<orgsize ; ++nn ){
-        u8 xx;
-        if( ! _pipe_in ->Pop (xx))  return CZPackDecoder::DECODE_INVALID_DATA;
-        if( ! _pipe_out->Push(xx))  return CZPackDecoder::DECODE_INVALID_DATA;
+      if( Pipe::Copy( *_pipe_in, *_pipe_out, orgsize ) != orgsize ){
+        return CZPackDecoder::DECODE_INVALID_DATA;
       }
 
       return  CZPackDecoder::DECODE_OK;
     }break;
   }
   return  CZPackDecoder::DECODE_OK;
-}
\ No newline at end of file
+}
+
+// ---
+
+int ZPack::Decode( const u8* src_, size_t srcsize_, u8* dst_, size_t dstsize_ ){
+  auto pipe_in  = make_shared< CMemReaderPipe >( src_, srcsize_ );
+  auto pipe_out = make_shared< CMemWriterPipe >( dst_, dstsize_ );
+  CZPackDecoder decoder;
+  decoder.SetIn ( pipe_in  );
+  decoder.SetOut( pipe_out );
+  if( decoder.Decode() != CZPackDecoder::DECODE_OK ) return -1;
+  return  (int)pipe_out->Size();
+}
+
+static  int _RomfsDecode( const void* src, size_t srcsize, void* dst, size_t dstsize ){
+  return  ZPack::Decode( (const u8*)src, srcsize, (u8*)dst, dstsize );
+}
+
+void  ZPack::InstallRomfsDecoder(){
+  b8RomfsSetDecoder( _RomfsDecode );
+}
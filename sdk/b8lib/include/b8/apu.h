@@ -1,9 +1,67 @@
-// ppu / Audio Processing Unit
+/**
+ * @file apu.h
+ * @brief Audio Processing Unit (APU) definitions for the BEEP-8 system.
+ *
+ * The APU is driven the same way as the PPU: the CPU records a list of command
+ * words in RAM, terminated by a HALT command, and starts it by writing its address
+ * to `B8_APU_EXEC`. Each command is addressed to one channel and sets one of its
+ * registers (envelope, frequency, wave type, volume), or starts its envelope (ATTACK).
+ *
+ * This file provides:
+ * - `b8ApuCmd`, a command buffer with a typed allocator per command (`b8ApuSetfreqAlloc`, ...).
+ * - `b8ApuShadow`, a per-channel copy of the registers, with which the `b8ApuSet*`
+ *   functions drop writes of a value the channel already has.
+ * - `b8ApuCmdPair`, a ping-pong pair of buffers submitted once per frame.
+ *
+ * Command layout, from the APU command tables of the BEEP-8 data sheet
+ * (docs/beep8_data_sheet.numbers): every command is one 32-bit word.
+ *
+ * | bits  | field                                                          |
+ * |-------|----------------------------------------------------------------|
+ * | 31:24 | command code (B8_APU_CMD_*)                                    |
+ * | 23    | reserved                                                       |
+ * | 22:20 | TRACK, the channel                                             |
+ * | 19:0  | SAMPLES @44100Hz (ATTACKTIME, DECAYTIME, SUSTAINTIME, RELEASETIME) |
+ * | 19:6  | FREQUENCY IntegerPart, in Hz (SETFREQ)                         |
+ * | 5:0   | FREQUENCY FractionalPart, in 1/64 Hz (SETFREQ)                 |
+ * | 15:0  | AMPLITUDE (ATTACKAMP, SUSTAINAMP), VOLUME (TRACKVOL); 0xffff is 1.0 |
+ * | 2:0   | TYPE, the wave (SETWAVTYPE): B8_APU_WAVE_*                     |
+ *
+ * Bits not listed for a command are reserved and written as 0. `B8_APU_EXEC` takes
+ * B8_APU_EXEC_START in bits 31:24 and the address of the list in bits 23:0. The
+ * data sheet's APU_EXEC register page gives its address as FFFF8000h, like
+ * PPU_EXEC; the memory map places the APU page at FFFF9000h, which is used here.
+ *
+ * For more detailed information, please refer to the BEEP-8 data sheet.
+ */
 #pragma once
+
+// apu / Audio Processing Unit
+#ifdef  __cplusplus
+extern  "C" {
+#endif
+
 #include <b8/type.h>
+#include <b8/register.h>
+
+/**
+ * @brief Builds b8lib against a RAM copy of the APU registers, for host-side tests.
+ *
+ * With -DB8_APU_MOCK=1, `B8_APU_EXEC` is a variable and every list started by
+ * `b8ApuExec` is copied to a capture buffer, which `b8ApuMockGetCapture` returns.
+ * Fences are signaled at once. Off by default; sdk/test builds with it.
+ */
+#ifndef B8_APU_MOCK
+#define B8_APU_MOCK  (0)
+#endif
 
 #define B8_APU_ADDR    (0xffff9000)
+#if B8_APU_MOCK
+extern  volatile u32  b8ApuMockRegs[ 4 ];
+#define B8_APU_EXEC    (b8ApuMockRegs[ 0 ])
+#else
 #define B8_APU_EXEC    _B8_REG(B8_APU_ADDR + 0x00)
+#endif
 
 #define B8_APU_CMD_NOP         (0x00)
 #define B8_APU_CMD_HALT        (0xff)
@@ -24,4 +82,434 @@
 #define B8_APU_WAVE_SAWTOOTH (3)
 #define B8_APU_WAVE_NOISE    (7)
 
-#define B8_APU_EXEC_START  (0x1)
+#define B8_APU_EXEC_START      (0x1)
+#define B8_APU_EXEC_ADDR_MASK  (0xffffff)  ///< STARTADDR, bits 23:0 of B8_APU_EXEC.
+
+#define B8_APU_MAX_CH      (8)        ///< Number of channels; TRACK is 3 bits.
+#define B8_APU_AMP_MAX     (0xffff)   ///< Full scale of amplitudes and volumes, 1.0.
+#define B8_APU_SAMPLE_RATE (44100)    ///< Unit of the envelope times, in samples per second.
+#define B8_APU_TIME_MAX    (0xfffff)  ///< Longest envelope time, in samples.
+#define B8_APU_FREQ_SHIFT  (6)        ///< Fractional bits of a SETFREQ frequency.
+#define B8_APU_FREQ_MAX    (0xfffff)  ///< Highest frequency, 16383 + 63/64 Hz, 14.6 fixed point.
+
+/**
+ * @brief Converts milliseconds to an envelope time in samples.
+ */
+#define B8_APU_MS_TO_SAMPLES(ms_)  ( (u32)(ms_) * B8_APU_SAMPLE_RATE / 1000 )
+
+/**
+ * @brief Converts a whole frequency in Hz to the 14.6 fixed point of SETFREQ.
+ */
+#define B8_APU_HZ(hz_)  ( (u32)(hz_) << B8_APU_FREQ_SHIFT )
+
+/**
+ * @brief Channel registers tracked by b8ApuShadow, one per register command.
+ */
+enum {
+  B8_APU_REG_ATTACKTIME,
+  B8_APU_REG_ATTACKAMP,
+  B8_APU_REG_DECAYTIME,
+  B8_APU_REG_SUSTAINTIME,
+  B8_APU_REG_SUSTAINAMP,
+  B8_APU_REG_RELEASETIME,
+  B8_APU_REG_SETFREQ,
+  B8_APU_REG_SETWAVTYPE,
+  B8_APU_REG_TRACKVOL,
+  B8_APU_REG_NUM
+};
+
+#ifndef PACKED_ALIGNED4
+#define PACKED_ALIGNED4 __attribute__((__packed__,aligned(4)))
+#endif
+
+/**
+ * @brief Copy of the channel registers, as written by the submitted lists.
+ *
+ * A register is unknown until it is first written; writes of the value it
+ * already has are dropped by the `b8ApuSet*` functions.
+ */
+typedef struct _b8ApuShadow {
+  u32   val[ B8_APU_MAX_CH ][ B8_APU_REG_NUM ];  /**< Last value written to each register. */
+  u32   known[ B8_APU_MAX_CH ];  /**< Bit B8_APU_REG_* is set once the register has been written. */
+  u32   written;                 /**< Register commands recorded so far. */
+  u32   dropped;                 /**< Register commands dropped as redundant so far. */
+} b8ApuShadow;
+
+/**
+ * @brief Forgets the contents of every register, so that the next writes are all recorded.
+ *
+ * Call it after the APU has been reset, or when a list was recorded but not submitted.
+ *
+ * @param shadow_ Pointer to the shadow state.
+ */
+extern  void  b8ApuShadowReset( b8ApuShadow* shadow_ );
+
+/**
+ * @brief Structure representing an APU command buffer for the BEEP-8 system.
+ */
+typedef struct _b8ApuCmd {
+  u32*          buff;     /**< Pointer to the buffer storing the APU commands. */
+  u32           bytesize; /**< Size of the buffer in bytes. */
+  u32*          sp;       /**< Stack pointer, the position of the next command. */
+  u32*          tail;     /**< Pointer to the end of the buffer. */
+  b8ApuShadow*  shadow;   /**< Shadow state used by the `b8ApuSet*` functions, or NULL to record every write. */
+} b8ApuCmd;
+
+/**
+ * @brief Sets the buffer for APU commands.
+ *
+ * `shadow` is left as it is, so the same shadow state follows the command
+ * structure from one buffer to the next.
+ *
+ * Example usage:
+ * @code
+ * static u32 _apu_cmd_buff[ 256 ];
+ * b8ApuCmdSetBuff( &_apu_cmd , _apu_cmd_buff , sizeof(_apu_cmd_buff) );
+ * @endcode
+ *
+ * @param cmd_ Pointer to the `b8ApuCmd` structure to be initialized.
+ * @param buff_ Pointer to the buffer where APU commands will be stored.
+ * @param bytesize_ Size of the buffer in bytes.
+ */
+extern  void  b8ApuCmdSetBuff( b8ApuCmd* cmd_ , u32* buff_ , u32 bytesize_ );
+
+/**
+ * @brief Pushes a command word onto the APU command buffer.
+ *
+ * @param cmd_ Pointer to the `b8ApuCmd` structure representing the APU command buffer.
+ * @param word_ The command word to be pushed onto the buffer.
+ */
+extern  void  b8ApuCmdPush( b8ApuCmd* cmd_ , u32 word_ );
+
+/**
+ * @brief No-operation command.
+ */
+typedef struct PACKED_ALIGNED4 _b8ApuNop {
+  unsigned  na0   : 24; /**< Reserved, not used. */
+  unsigned  code  :  8; /**< B8_APU_CMD_NOP */
+} b8ApuNop;
+
+/**
+ * @brief Terminates the command list.
+ */
+typedef struct PACKED_ALIGNED4 _b8ApuHalt {
+  unsigned  na0   : 24; /**< Reserved, not used. */
+  unsigned  code  :  8; /**< B8_APU_CMD_HALT */
+} b8ApuHalt;
+
+/**
+ * @brief Starts the envelope of a channel: attack, decay, sustain, then release.
+ */
+typedef struct PACKED_ALIGNED4 _b8ApuAttack {
+  unsigned  na0   : 20; /**< Reserved, not used. */
+  unsigned  ch    :  3; /**< TRACK, 0 to B8_APU_MAX_CH-1. */
+  unsigned  na1   :  1; /**< Reserved, not used. */
+  unsigned  code  :  8; /**< B8_APU_CMD_ATTACK */
+} b8ApuAttack;
+
+/**
+ * @brief Sets a time of the envelope of a channel.
+ *
+ * Used by ATTACKTIME, DECAYTIME, SUSTAINTIME and RELEASETIME.
+ */
+typedef struct PACKED_ALIGNED4 _b8ApuTime {
+  unsigned  time  : 20; /**< SAMPLES @44100Hz, 0 to B8_APU_TIME_MAX. */
+  unsigned  ch    :  3; /**< TRACK, 0 to B8_APU_MAX_CH-1. */
+  unsigned  na0   :  1; /**< Reserved, not used. */
+  unsigned  code  :  8; /**< Command code. */
+} b8ApuTime;
+
+/**
+ * @brief Sets an amplitude of the envelope of a channel.
+ *
+ * Used by ATTACKAMP and SUSTAINAMP.
+ */
+typedef struct PACKED_ALIGNED4 _b8ApuAmp {
+  unsigned  amp   : 16; /**< AMPLITUDE, 0 to B8_APU_AMP_MAX. */
+  unsigned  na0   :  4; /**< Reserved, not used. */
+  unsigned  ch    :  3; /**< TRACK, 0 to B8_APU_MAX_CH-1. */
+  unsigned  na1   :  1; /**< Reserved, not used. */
+  unsigned  code  :  8; /**< Command code. */
+} b8ApuAmp;
+
+/**
+ * @brief Sets the frequency of a channel.
+ */
+typedef struct PACKED_ALIGNED4 _b8ApuSetfreq {
+  unsigned  freq  : 20; /**< Frequency in Hz, 14.6 fixed point (IntegerPart 14 bits, FractionalPart 6 bits). */
+  unsigned  ch    :  3; /**< TRACK, 0 to B8_APU_MAX_CH-1. */
+  unsigned  na0   :  1; /**< Reserved, not used. */
+  unsigned  code  :  8; /**< B8_APU_CMD_SETFREQ */
+} b8ApuSetfreq;
+
+/**
+ * @brief Sets the wave type of a channel.
+ */
+typedef struct PACKED_ALIGNED4 _b8ApuSetwavtype {
+  unsigned  wavtype :  3; /**< TYPE, one of B8_APU_WAVE_*. */
+  unsigned  na0     : 17; /**< Reserved, not used. */
+  unsigned  ch      :  3; /**< TRACK, 0 to B8_APU_MAX_CH-1. */
+  unsigned  na1     :  1; /**< Reserved, not used. */
+  unsigned  code    :  8; /**< B8_APU_CMD_SETWAVTYPE */
+} b8ApuSetwavtype;
+
+/**
+ * @brief Sets the volume of a channel.
+ */
+typedef struct PACKED_ALIGNED4 _b8ApuTrackvol {
+  unsigned  vol   : 16; /**< VOLUME, 0 (0.0) to B8_APU_AMP_MAX (1.0). */
+  unsigned  na0   :  4; /**< Reserved, not used. */
+  unsigned  ch    :  3; /**< TRACK, 0 to B8_APU_MAX_CH-1. */
+  unsigned  na1   :  1; /**< Reserved, not used. */
+  unsigned  code  :  8; /**< B8_APU_CMD_TRACKVOL */
+} b8ApuTrackvol;
+
+/**
+ * @brief Allocates a NOP command in the APU command buffer.
+ *
+ * @param cmd_ Pointer to the `b8ApuCmd` structure representing the APU command buffer.
+ * @return Pointer to the newly allocated `b8ApuNop` structure.
+ */
+extern  b8ApuNop*         b8ApuNopAlloc( b8ApuCmd* cmd_ );
+
+/**
+ * @brief Allocates a HALT command, which terminates the list, in the APU command buffer.
+ *
+ * @param cmd_ Pointer to the `b8ApuCmd` structure representing the APU command buffer.
+ * @return Pointer to the newly allocated `b8ApuHalt` structure.
+ */
+extern  b8ApuHalt*        b8ApuHaltAlloc( b8ApuCmd* cmd_ );
+
+/**
+ * @brief Allocates an ATTACK command in the APU command buffer.
+ *
+ * ATTACK is an event, not a register, so it is never dropped by the shadow state.
+ *
+ * @param cmd_ Pointer to the `b8ApuCmd` structure representing the APU command buffer.
+ * @return Pointer to the newly allocated `b8ApuAttack` structure; set its `ch`.
+ */
+extern  b8ApuAttack*      b8ApuAttackAlloc( b8ApuCmd* cmd_ );
+
+/**
+ * @brief Allocates an ATTACKTIME command in the APU command buffer.
+ *
+ * The `*Alloc` functions of register commands record the command unconditionally
+ * and do not update the shadow state; prefer the `b8ApuSet*` functions.
+ *
+ * @param cmd_ Pointer to the `b8ApuCmd` structure representing the APU command buffer.
+ * @return Pointer to the newly allocated `b8ApuTime` structure; set its `ch` and `time`.
+ */
+extern  b8ApuTime*        b8ApuAttacktimeAlloc( b8ApuCmd* cmd_ );
+
+/** @brief Allocates an ATTACKAMP command. See `b8ApuAttacktimeAlloc`. */
+extern  b8ApuAmp*         b8ApuAttackampAlloc( b8ApuCmd* cmd_ );
+
+/** @brief Allocates a DECAYTIME command. See `b8ApuAttacktimeAlloc`. */
+extern  b8ApuTime*        b8ApuDecaytimeAlloc( b8ApuCmd* cmd_ );
+
+/** @brief Allocates a SUSTAINTIME command. See `b8ApuAttacktimeAlloc`. */
+extern  b8ApuTime*        b8ApuSustaintimeAlloc( b8ApuCmd* cmd_ );
+
+/** @brief Allocates a SUSTAINAMP command. See `b8ApuAttacktimeAlloc`. */
+extern  b8ApuAmp*         b8ApuSustainampAlloc( b8ApuCmd* cmd_ );
+
+/** @brief Allocates a RELEASETIME command. See `b8ApuAttacktimeAlloc`. */
+extern  b8ApuTime*        b8ApuReleasetimeAlloc( b8ApuCmd* cmd_ );
+
+/** @brief Allocates a SETFREQ command. See `b8ApuAttacktimeAlloc`. */
+extern  b8ApuSetfreq*     b8ApuSetfreqAlloc( b8ApuCmd* cmd_ );
+
+/** @brief Allocates a SETWAVTYPE command. See `b8ApuAttacktimeAlloc`. */
+extern  b8ApuSetwavtype*  b8ApuSetwavtypeAlloc( b8ApuCmd* cmd_ );
+
+/** @brief Allocates a TRACKVOL command. See `b8ApuAttacktimeAlloc`. */
+extern  b8ApuTrackvol*    b8ApuTrackvolAlloc( b8ApuCmd* cmd_ );
+
+/**
+ * @brief Records a register write, unless the channel already has the value.
+ *
+ * Without a shadow state in `cmd_`, the write is always recorded.
+ *
+ * @param cmd_ Pointer to the `b8ApuCmd` structure representing the APU command buffer.
+ * @param ch_ Channel, 0 to B8_APU_MAX_CH-1.
+ * @param reg_ One of B8_APU_REG_*.
+ * @param value_ The value of the register, which must fit its field.
+ * @return 1 if the command was recorded, 0 if it was dropped.
+ */
+extern  int   b8ApuSetReg( b8ApuCmd* cmd_ , u32 ch_ , u32 reg_ , u32 value_ );
+
+/** @brief Sets the attack time of a channel in samples @44100Hz. See `b8ApuSetReg`. */
+extern  int   b8ApuSetAttacktime( b8ApuCmd* cmd_ , u32 ch_ , u32 time_ );
+
+/** @brief Sets the attack amplitude of a channel. See `b8ApuSetReg`. */
+extern  int   b8ApuSetAttackamp( b8ApuCmd* cmd_ , u32 ch_ , u32 amp_ );
+
+/** @brief Sets the decay time of a channel in samples @44100Hz. See `b8ApuSetReg`. */
+extern  int   b8ApuSetDecaytime( b8ApuCmd* cmd_ , u32 ch_ , u32 time_ );
+
+/** @brief Sets the sustain time of a channel in samples @44100Hz. See `b8ApuSetReg`. */
+extern  int   b8ApuSetSustaintime( b8ApuCmd* cmd_ , u32 ch_ , u32 time_ );
+
+/** @brief Sets the sustain amplitude of a channel. See `b8ApuSetReg`. */
+extern  int   b8ApuSetSustainamp( b8ApuCmd* cmd_ , u32 ch_ , u32 amp_ );
+
+/** @brief Sets the release time of a channel in samples @44100Hz. See `b8ApuSetReg`. */
+extern  int   b8ApuSetReleasetime( b8ApuCmd* cmd_ , u32 ch_ , u32 time_ );
+
+/** @brief Sets the frequency of a channel in Hz, 14.6 fixed point (see B8_APU_HZ). See `b8ApuSetReg`. */
+extern  int   b8ApuSetFreq( b8ApuCmd* cmd_ , u32 ch_ , u32 freq_ );
+
+/** @brief Sets the wave type (B8_APU_WAVE_*) of a channel. See `b8ApuSetReg`. */
+extern  int   b8ApuSetWavtype( b8ApuCmd* cmd_ , u32 ch_ , u32 wavtype_ );
+
+/** @brief Sets the volume of a channel. See `b8ApuSetReg`. */
+extern  int   b8ApuSetTrackvol( b8ApuCmd* cmd_ , u32 ch_ , u32 vol_ );
+
+/**
+ * @brief Starts executing the APU command list.
+ *
+ * The list must be terminated with `b8ApuHaltAlloc`.
+ *
+ * @param cmd_ A pointer to the APU command structure containing the commands to be executed.
+ */
+extern  void  b8ApuExec( b8ApuCmd* cmd_ );
+
+/**
+ * @brief Completion fence of a submitted APU command list.
+ *
+ * The data sheet gives the APU no completion interrupt and no status register
+ * (`B8_APU_EXEC` is write-only), so completion cannot be observed. The driver
+ * assumes the rule of `b8PpuFence`: a list is consumed before the next V-blank.
+ * A fence records the V-blank count right after submission, and is signaled
+ * once another V-blank has been serviced.
+ */
+typedef u32 b8ApuFence;
+
+/**
+ * @brief Starts executing an APU command list and returns its completion fence.
+ *
+ * @param cmd_ A pointer to the APU command structure containing the commands to be executed.
+ * @return The fence of the submitted list.
+ */
+extern  b8ApuFence  b8ApuExecFence( b8ApuCmd* cmd_ );
+
+/**
+ * @brief Checks whether the APU has finished the list guarded by a fence.
+ *
+ * @param fence_ A fence returned by `b8ApuExecFence`.
+ * @return Non-zero if the list has been consumed, 0 otherwise.
+ */
+extern  int   b8ApuFenceDone( b8ApuFence fence_ );
+
+/**
+ * @brief Blocks the current thread until the list guarded by a fence has been consumed.
+ *
+ * Halts with an assertion if waiting for the V-blank interrupt fails, rather than
+ * spinning forever on a fence that cannot be signaled.
+ *
+ * @param fence_ A fence returned by `b8ApuExecFence`.
+ */
+extern  void  b8ApuFenceWait( b8ApuFence fence_ );
+
+/**
+ * @brief Ping-pong pair of APU command buffers.
+ *
+ * The commands of one frame are recorded into the back buffer while the APU may
+ * still be reading the other, and are started together by one write to
+ * `B8_APU_EXEC`. `b8ApuCmdPairSubmit` keeps the pace at one list per V-blank.
+ *
+ * Example usage:
+ * @code
+ * static u32 _buff[2][ 256 ];
+ * static b8ApuCmdPair _pair;
+ * static b8ApuShadow _shadow;
+ * static b8ApuCmd _apu_cmd;
+ *
+ * b8ApuCmdPairInit( &_pair , _buff[0] , _buff[1] , sizeof(_buff[0]) );
+ * b8ApuShadowReset( &_shadow );
+ * _apu_cmd.shadow = &_shadow;
+ * while(1){
+ *   b8ApuCmdPairBegin( &_pair , &_apu_cmd );
+ *   b8ApuSetFreq( &_apu_cmd , 0 , B8_APU_HZ( 440 ) );
+ *   ...
+ *   b8ApuHaltAlloc( &_apu_cmd );
+ *   b8ApuCmdPairSubmit( &_pair , &_apu_cmd );
+ * }
+ * @endcode
+ */
+typedef struct _b8ApuCmdPair {
+  u32*        buff[2];  /**< The two command buffers. */
+  u32         bytesize; /**< Size of each buffer in bytes. */
+  u32         back;     /**< Index of the buffer recorded next. */
+  b8ApuFence  fence[2]; /**< Completion fence of the last submission of each buffer. */
+} b8ApuCmdPair;
+
+/**
+ * @brief Initializes a ping-pong pair of APU command buffers.
+ *
+ * @param pair_ Pointer to the pair to be initialized.
+ * @param buff0_ First command buffer.
+ * @param buff1_ Second command buffer.
+ * @param bytesize_ Size of each buffer in bytes.
+ */
+extern  void  b8ApuCmdPairInit( b8ApuCmdPair* pair_ , u32* buff0_ , u32* buff1_ , u32 bytesize_ );
+
+/**
+ * @brief Prepares the back buffer of a pair for recording.
+ *
+ * Waits until the APU has consumed the previous contents of the back buffer,
+ * then sets it as the buffer of `cmd_` (see `b8ApuCmdSetBuff`).
+ *
+ * @param pair_ Pointer to the pair.
+ * @param cmd_ Command structure that receives the back buffer.
+ */
+extern  void  b8ApuCmdPairBegin( b8ApuCmdPair* pair_ , b8ApuCmd* cmd_ );
+
+/**
+ * @brief Submits the recorded back buffer and swaps the pair.
+ *
+ * Waits until the previously submitted list has been consumed, then executes
+ * `cmd_` and records its fence. The caller terminates the list with `b8ApuHaltAlloc`.
+ *
+ * @param pair_ Pointer to the pair.
+ * @param cmd_ Command structure prepared by `b8ApuCmdPairBegin`.
+ */
+extern  void  b8ApuCmdPairSubmit( b8ApuCmdPair* pair_ , b8ApuCmd* cmd_ );
+
+/**
+ * @brief Waits until neither buffer of the pair is in use by the APU.
+ *
+ * @param pair_ Pointer to the pair.
+ */
+extern  void  b8ApuCmdPairSync( b8ApuCmdPair* pair_ );
+
+#if B8_APU_MOCK
+#define B8_APU_MOCK_CAPTURE_WORDS  (4096)
+
+/**
+ * @brief Gets the command words of every list started since the last `b8ApuMockClear`.
+ *
+ * The lists are concatenated in the order they were executed, each up to its HALT.
+ * Words beyond B8_APU_MOCK_CAPTURE_WORDS are lost.
+ *
+ * @param words_ Receives the first captured word.
+ * @return The number of captured words.
+ */
+extern  u32   b8ApuMockGetCapture( const u32** words_ );
+
+/**
+ * @brief Gets the number of lists started since the last `b8ApuMockClear`.
+ *
+ * @return The number of calls to `b8ApuExec`.
+ */
+extern  u32   b8ApuMockGetExecCount( void );
+
+/**
+ * @brief Empties the capture buffer and clears the mock registers.
+ */
+extern  void  b8ApuMockClear( void );
+#endif
+
+#ifdef  __cplusplus
+}
+#endif
@@ -135,6 +135,12 @@ typedef struct _b8HifEvent {
 
 #define B8_HIF_MAX_TOUCH_EVENTS (32)
 
+/**
+ * @brief Number of touch and mouse events buffered until they are taken, a power of two.
+ * When the buffer is full, new events are dropped and counted, see `b8HifGetDroppedEvents`.
+ */
+#define B8_HIF_EVENT_RING (128)
+
 /**
  * @brief Structure representing a collection of HIF events.
  *
@@ -152,20 +158,73 @@ typedef struct _b8HifEvents {
 /**
  * @brief Retrieve the current HIF events.
  *
- * This function retrieves the current HIF events and stores them in the provided result structure.
- * It safely copies the events from the internal buffer to the user-provided buffer.
+ * This function copies up to `B8_HIF_MAX_TOUCH_EVENTS` buffered events, oldest first,
+ * into the provided result structure and removes them from the buffer. Events left
+ * over are returned by the next call. To take the events without copying them, see
+ * `b8HifPeekEvents`.
  *
  * @param result A pointer to a `b8HifEvents` structure where the events will be stored.
- * @return 0 on success; a negative error code on failure.
- *
- * @retval 0       Success.
- * @retval -EINVAL Invalid argument (e.g., `result` is NULL).
- * @retval Other   Error codes as returned by semaphore functions.
+ * @return 0 on success; -1 if `result` is NULL (errno is set to EINVAL).
  *
- * @note The function is thread-safe and ensures that the events are copied atomically.
+ * @note Only one thread may take events, with this function or `b8HifPeekEvents`.
+ *       No lock or system call is involved.
  */
 extern int b8HifGetEvents(b8HifEvents* result);
 
+/**
+ * @brief Look at the buffered HIF events in place.
+ *
+ * This function points `*events` at the oldest buffered events, which stay in the
+ * buffer until `b8HifCommitEvents` removes them. The buffer is a ring, so the events
+ * may come in two parts; call again after the commit for the rest.
+ *
+ * Usage:
+ * ```c
+ * const b8HifEvent* events;
+ * size_t num;
+ * while ((num = b8HifPeekEvents(&events)) != 0) {
+ *     for (size_t i = 0; i < num; ++i) {
+ *         // Handle events[i]
+ *     }
+ *     b8HifCommitEvents(num);
+ * }
+ * ```
+ *
+ * @param events Where to store the address of the first event.
+ * @return The number of events at `*events`; 0 if there are none.
+ *
+ * @note Only one thread may take events. It must not write to the events.
+ */
+extern size_t b8HifPeekEvents(const b8HifEvent** events);
+
+/**
+ * @brief Remove events returned by `b8HifPeekEvents` from the buffer.
+ *
+ * @param num The number of events to remove, at most the count returned by the last
+ *            `b8HifPeekEvents` call.
+ */
+extern void b8HifCommitEvents(size_t num);
+
+/**
+ * @brief Get the number of events dropped because the buffer was full.
+ *
+ * The counter only grows; compare it between frames to see if events are taken too late.
+ *
+ * @return The number of dropped events since startup.
+ */
+extern u32 b8HifGetDroppedEvents(void);
+
+/**
+ * @brief Get the input latency of the last events retrieved.
+ *
+ * Touch and mouse events are taken from the SCI at every V-blank. This returns the
+ * CPU cycles from the oldest event of the last `b8HifCommitEvents` or `b8HifGetEvents`
+ * call that removed any, being taken, to that call. Divide by `b8SysGetCpuClock()` for seconds.
+ *
+ * @return Latency in CPU cycles; 0 if no event has been retrieved yet.
+ */
+extern u32 b8HifGetLatency(void);
+
 /**
  * @brief Structure representing the current mouse or touch panel status.
  *
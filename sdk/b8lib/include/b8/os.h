@@ -35,16 +35,31 @@ typedef u64 b8OsCpuCycles;
 #define B8_OS_SCHED_IRQ                 4  // Irq handler scheduling policy
 #define B8_OS_SCHED_OTHER               5  // Not supported
 
+// thread priorities (a larger value is more urgent)
+#define B8_OS_PRIORITY_MIN              0
+#define B8_OS_PRIORITY_MAX              31
+#define B8_OS_PRIORITY_DEFAULT          16
+
 #define B8_OS_NOT_USING_IRQ (0xffff)
 
 #define B8_OS_SEM_WAIT       (0)
 #define B8_OS_SEM_TRYWAIT    (1)
 #define B8_OS_SEM_TIMEDWAIT  (2)
 
+#define B8_OS_IRQ_WAIT_CLEAR   (1<<0)  // discard the events that came before the wait
+#define B8_OS_IRQ_WAIT_OBSERVE (1<<1)  // wait for the next event, and leave the events kept for the other waiters
+
+#define B8_OS_FUTEX_TIMED    (1<<0)  // B8_OS_SYSCALL_FUTEX_WAIT: give up at a CLOCK_REALTIME deadline
+#define B8_OS_FUTEX_CANCEL   (1<<1)  // B8_OS_SYSCALL_FUTEX_WAIT: the wait is a cancellation point
+#define B8_OS_FUTEX_INC      (1<<0)  // B8_OS_SYSCALL_FUTEX_WAKE: increment the word before waking
+
+#define B8_OS_THREAD_CREATE_DETACHED  (1<<16)      // B8_OS_SYSCALL_THREAD_CREATE: reclaim the thread when it exits
+#define B8_OS_THREAD_CANCELED         (0xffffffff) // exit value of a canceled thread
+
 #define B8_OS_CLOCKID_REALTIME              (0x10)
 #define B8_OS_CLOCKID_MONOTONIC             (0x11)
-#define B8_OS_CLOCKID_PROCESS_CPUTIME_ID    (0x12)  // Not supported
-#define B8_OS_CLOCKID_THREAD_CPUTIME_ID     (0x13)  // Not supported
+#define B8_OS_CLOCKID_PROCESS_CPUTIME_ID    (0x12)  // Cycles of all threads but the idle thread
+#define B8_OS_CLOCKID_THREAD_CPUTIME_ID     (0x13)  // Cycles of the calling thread
 
 // Maximum value the semaphore can have.
 #define SEM_VALUE_MAX (32767)
@@ -74,7 +89,7 @@ typedef enum {
       [2] = size_t  StackSize
       [3] = void*   StartRoutine
       [4] = void*   Arg
-      [5] = u32     SchedulingPolicy B8_OS_SCHED_*
+      [5] = u32     SchedulingPolicy B8_OS_SCHED_* | (Priority << 8) | B8_OS_THREAD_CREATE_DETACHED
       [6] = u32     IrqNo
 
     out:
@@ -85,6 +100,10 @@ typedef enum {
   /*
     in:
       [0] = B8_OS_SYSCALL_EXIT
+      [1] = u32     Exit value, handed to B8_OS_SYSCALL_THREAD_JOIN
+
+    The stack goes back to the pool at once. The thread is reclaimed when
+    it is joined, or at once if it is detached.
   */
   B8_OS_SYSCALL_EXIT,
 
@@ -158,6 +177,137 @@ typedef enum {
   */
   B8_OS_SYSCALL_CLOCK_SETTIME,
 
+  /*
+    in:
+      [0] = B8_OS_SYSCALL_THREAD_SETSCHEDPARAM
+      [1] = b8OsPid pid
+      [2] = u32     SchedulingPolicy B8_OS_SCHED_*
+      [3] = u32     Priority B8_OS_PRIORITY_MIN .. B8_OS_PRIORITY_MAX
+  */
+  B8_OS_SYSCALL_THREAD_SETSCHEDPARAM,
+
+  /*
+    in:
+      [0] = B8_OS_SYSCALL_THREAD_GETSCHEDPARAM
+      [1] = b8OsPid pid
+
+    out:
+      b8OsBridgeUsr2Svc::ret_policy
+      b8OsBridgeUsr2Svc::ret_priority
+  */
+  B8_OS_SYSCALL_THREAD_GETSCHEDPARAM,
+
+  /*
+    in:
+      [0] = B8_OS_SYSCALL_THREAD_GETINFO
+      [1] = b8OsThreadInfo* Info
+      [2] = u32             Number of entries in Info
+
+    out:
+      b8OsBridgeUsr2Svc::ret_count : number of threads
+  */
+  B8_OS_SYSCALL_THREAD_GETINFO,
+
+  /*
+    in:
+      [0] = B8_OS_SYSCALL_IRQ_ATTACH
+      [1] = u32 IrqNo
+  */
+  B8_OS_SYSCALL_IRQ_ATTACH,
+
+  /*
+    in:
+      [0] = B8_OS_SYSCALL_IRQ_WAIT
+      [1] = u32 IrqNo, attached by B8_OS_SYSCALL_IRQ_ATTACH
+      [2] = u32 B8_OS_IRQ_WAIT_*
+
+    out:
+      b8OsBridgeUsr2Svc::ret_count : events pending before the call, after
+                                     B8_OS_IRQ_WAIT_CLEAR; 0 if the call blocked
+
+    Returns at once if an event is pending, and consumes it. Otherwise
+    blocks until the irq comes; every thread waiting for it is woken.
+  */
+  B8_OS_SYSCALL_IRQ_WAIT,
+
+  /*
+    in:
+      [0] = B8_OS_SYSCALL_FUTEX_WAIT
+      [1] = volatile u32* Word, 4-byte aligned
+      [2] = u32 Expected value of Word
+      [3] = u32 B8_OS_FUTEX_TIMED or 0
+      [4] = sec  of the deadline, if B8_OS_FUTEX_TIMED
+      [5] = nsec of the deadline, if B8_OS_FUTEX_TIMED
+
+    Blocks until B8_OS_SYSCALL_FUTEX_WAKE on Word, if Word still holds the
+    expected value. Otherwise fails at once with EAGAIN. The check and the
+    block are one step, as the kernel is not preempted.
+    With B8_OS_FUTEX_CANCEL, a canceled thread fails with ECANCELED instead
+    of sleeping, or is woken with it, and must exit by itself.
+  */
+  B8_OS_SYSCALL_FUTEX_WAIT,
+
+  /*
+    in:
+      [0] = B8_OS_SYSCALL_FUTEX_WAKE
+      [1] = volatile u32* Word
+      [2] = u32 Maximum number of threads to wake
+      [3] = u32 B8_OS_FUTEX_INC or 0
+
+    out:
+      b8OsBridgeUsr2Svc::ret_count : number of threads woken
+
+    Threads of higher priority are woken first, and in the order they
+    began to wait among the same priority.
+  */
+  B8_OS_SYSCALL_FUTEX_WAKE,
+
+  /*
+    in:
+      [0] = B8_OS_SYSCALL_THREAD_JOIN
+      [1] = b8OsPid pid
+
+    out:
+      b8OsBridgeUsr2Svc::ret_value : exit value of the thread
+
+    Blocks until the thread exits, then reclaims it.
+  */
+  B8_OS_SYSCALL_THREAD_JOIN,
+
+  /*
+    in:
+      [0] = B8_OS_SYSCALL_THREAD_DETACH
+      [1] = b8OsPid pid
+  */
+  B8_OS_SYSCALL_THREAD_DETACH,
+
+  /*
+    in:
+      [0] = B8_OS_SYSCALL_THREAD_CANCEL
+      [1] = b8OsPid pid
+
+    A thread blocked at a cancellation point exits at once with
+    B8_OS_THREAD_CANCELED. Otherwise it exits at its next one.
+  */
+  B8_OS_SYSCALL_THREAD_CANCEL,
+
+  /*
+    in:
+      [0] = B8_OS_SYSCALL_THREAD_TESTCANCEL
+
+    A cancellation point, and nothing else.
+  */
+  B8_OS_SYSCALL_THREAD_TESTCANCEL,
+
+  /*
+    in:
+      [0] = B8_OS_SYSCALL_SEM_DESTROY
+      [1] = b8OsSid SemaphoreID
+
+    Fails with EBUSY while a thread waits for the semaphore.
+  */
+  B8_OS_SYSCALL_SEM_DESTROY,
+
   /* --- */
   B8_OS_SYSCALL_MAX,
 } b8OsSysCallNum;
@@ -201,12 +351,55 @@ typedef struct _b8OsBridgeUsr2Svc{
   b8OsPid   ret_pid;
   b8OsSid   ret_sid;
   int       ret_semcount;
+  u32       ret_policy;
+  s32       ret_priority;
   u64       tv_sec;
   u32       tv_nsec;
   s32       errcode;
+  u32       ret_count;
+  u32       ret_value;
 } b8OsBridgeUsr2Svc;
 extern  b8OsBridgeUsr2Svc* b8OsGetBridge(void);
 
+// states of b8OsThreadInfo
+#define B8_OS_THREAD_RUNNING          (0)  // the calling thread
+#define B8_OS_THREAD_READY            (1)
+#define B8_OS_THREAD_WAIT_SEMAPHORE   (2)
+#define B8_OS_THREAD_WAIT_TIMER       (3)
+#define B8_OS_THREAD_WAIT_IRQ         (4)
+#define B8_OS_THREAD_EXITED           (5)
+#define B8_OS_THREAD_WAIT_FUTEX       (6)  // a pthread mutex or condition variable
+#define B8_OS_THREAD_WAIT_JOIN        (7)
+
+/**
+ * @brief Snapshot of one thread, filled by b8OsGetThreadInfo().
+ *
+ * The cycles since the last kernel entry are charged to the thread that
+ * was running, so the time the kernel spends on a switch is charged to
+ * the thread switched to.
+ */
+typedef struct _b8OsThreadInfo{
+  b8OsPid       pid;
+  u8            state;      // B8_OS_THREAD_*
+  u8            policy;     // B8_OS_SCHED_*
+  u8            priority;   // B8_OS_PRIORITY_MIN .. B8_OS_PRIORITY_MAX
+  u8            idle;       // 1 for the idle thread
+  u16           irq;        // B8_OS_NOT_USING_IRQ unless the thread waits for an irq
+  size_t        stack_size;
+  b8OsCpuCycles cpu_cycles; // cycles used so far
+  u32           switches;   // times switched in
+  u32           syscalls;   // system calls made
+} b8OsThreadInfo;
+
+/**
+ * @brief Takes a snapshot of all threads, the idle thread and exited threads included.
+ *
+ * @param info Receives up to num entries. May be NULL if num is 0.
+ * @param num  Number of entries in info.
+ * @return Number of threads, which may be larger than num; negative on error.
+ */
+extern  int  b8OsGetThreadInfo( b8OsThreadInfo* info, size_t num );
+
 typedef struct _sem_t sem_t;
 
 extern b8OsBridgeUsr2Svc* b8OsSysCall( b8OsSysCallNum syscall,u32 arg0,u32 arg1,u32 arg2,u32 arg3,u32 arg4,u32 arg5);
@@ -220,8 +413,6 @@ typedef struct _b8OsConfig{
   // 1000Hz: 1ms =  1*1000us =  1000
   u32           UsecPerTick;
 
-  sem_t*        sem_heap;
-
   // driver
   int   (*ArchDriverGetTimerIrq)(u16* irq);
   int   (*ArchDriverOnStartTimer)(u32 hz);
@@ -234,6 +425,61 @@ typedef struct _b8OsConfig{
 extern  int  b8OsReset( b8OsConfig* cfg_ );
 extern  int  b8OsIsRunning(void);
 
+/**
+ * @brief Clock state published by the kernel each time it returns to user mode.
+ *
+ * The kernel is entered on every system call and every interrupt, the
+ * 100 Hz timer included, so user code can read the clocks without a system
+ * call: it adds the cycles counted by B8_DWT_CYCCNT since `cyccnt`.
+ * `seq` changes whenever the kernel updates the page; a reader copies the
+ * fields and retries if `seq` changed meanwhile. clock_gettime() does this.
+ *
+ * The page belongs to the kernel. User code must only read it.
+ */
+typedef struct _b8OsTimePage{
+  u32       seq;            // incremented before and after each update
+  u32       cyccnt;         // B8_DWT_CYCCNT at the last kernel entry
+  u64       sec;            // CLOCK_MONOTONIC at cyccnt: seconds
+  u32       cyc_in_sec;     // CLOCK_MONOTONIC at cyccnt: cycles past sec, less than cpu_hz
+  u32       cpu_hz;         // cycles per second; 0 until the kernel runs
+  u64       ns_mult;        // (1000000000 << 32) / cpu_hz, converts cycles to nsec
+  u64       realtime_sec;   // CLOCK_REALTIME - CLOCK_MONOTONIC: seconds
+  u32       realtime_nsec;  // CLOCK_REALTIME - CLOCK_MONOTONIC: nsec past realtime_sec
+  u64       thread_cycles;  // CLOCK_THREAD_CPUTIME_ID of the running thread at cyccnt
+  u64       process_cycles; // CLOCK_PROCESS_CPUTIME_ID at cyccnt
+  u32       idle;           // 1 while the idle thread runs
+  b8OsPid   pid;            // the running thread, read by pthread_self()
+} b8OsTimePage;
+extern  const volatile b8OsTimePage* b8OsGetTimePage(void);
+
+/**
+ * @brief Usage of the pool the kernel carves thread stacks from.
+ *
+ * Stacks are carved in multiples of B8_OS_STACK_GRANULE bytes. The stack of
+ * an exited thread goes on a free list, where it is merged with the free
+ * stacks next to it, and is reused by any thread whose stack fits in it.
+ * Free stacks at the end of the carved part are given back to the rest of the
+ * pool. Stacks given with pthread_attr_setstack() are not taken from the pool.
+ */
+#define B8_OS_STACK_GRANULE     (0x200)
+typedef struct _b8OsStackPoolInfo{
+  size_t    size;       // bytes of the pool
+  size_t    carved;     // bytes carved from the pool
+  size_t    free;       // bytes of the carved part on the free list
+} b8OsStackPoolInfo;
+extern  void b8OsGetStackPoolInfo( b8OsStackPoolInfo* info );
+
+// Number of events of an irq taken by the kernel for B8_OS_SYSCALL_IRQ_WAIT.
+extern  u32 b8OsGetIrqCount( u32 irq );
+
+// CYCCNT when the kernel took the last event of an irq.
+extern  u32 b8OsGetIrqCycle( u32 irq );
+
+// Called from the timer interrupt, in IRQ mode, with the interrupted pc
+// and the pid of the interrupted thread. It must not make system calls.
+typedef void (*b8OsTickHook)( u32 pc, b8OsPid pid );
+extern  void b8OsSetTickHook( b8OsTickHook hook );
+
 #ifdef  __cplusplus
 }
 #endif
\ No newline at end of file
@@ -1087,6 +1087,97 @@ extern void b8PpuPushFrontOT(b8PpuCmd* cmd_, u32 otz_, void* prim_);
  */
 extern void b8PpuPushBackOT(b8PpuCmd* cmd_, u32 otz_, void* prim_);
 
+/**
+ * @brief Structure representing a retained PPU command segment.
+ *
+ * A segment is a run of primitives recorded once into a persistent buffer and
+ * terminated by a `B8_PPU_CMD_JMP` back-link. Instead of rebuilding static
+ * primitives (HUDs, borders, background art) every frame, the segment is
+ * spliced into an OT slot with `b8PpuSegmentLinkFront` or `b8PpuSegmentLinkBack`,
+ * which costs a couple of word writes regardless of the number of primitives.
+ *
+ * Primitives are recorded with the plain `b8Ppu*Alloc` functions on `seg.cmd`.
+ * The `Z`/`ZPB` variants must not be used while recording, since a segment has no OT.
+ */
+typedef struct _b8PpuSegment {
+  b8PpuCmd  cmd;    /**< Recorder for the segment body. `cmd.buff` must stay valid while the segment is in use. */
+  u32*      head;   /**< First command word of the segment. */
+  b8PpuJmp* tail;   /**< Terminating JMP, re-targeted every time the segment is linked. */
+  u32       linked; /**< OT build the segment was last linked into; it is not relinked while that list is in flight. */
+} b8PpuSegment;
+
+/**
+ * @brief Starts recording a retained segment into a persistent buffer.
+ *
+ * Example usage:
+ * @code
+ * static u32 _hud_buff[ 256 ];
+ * static b8PpuSegment _hud;
+ *
+ * b8PpuSegmentBegin( &_hud , _hud_buff , sizeof(_hud_buff) );
+ * b8PpuRect* rc = b8PpuRectAlloc( &_hud.cmd );
+ * ...
+ * b8PpuSegmentEnd( &_hud );
+ *
+ * // every frame, after b8PpuClearOT()
+ * b8PpuSegmentLinkBack( &_ppu_cmd , 3 , &_hud );
+ * @endcode
+ *
+ * With a `b8PpuCmdPair`, the list of the other buffer may still be in flight, so
+ * each buffer links its own copy of the segment (see `b8PpuCmdPair`).
+ *
+ * @param seg_ Pointer to the segment to be initialized.
+ * @param buff_ Persistent buffer receiving the segment commands. It must not be
+ *              reused for anything else while the segment is linked into an OT.
+ * @param bytesize_ Size of the buffer in bytes.
+ */
+extern void b8PpuSegmentBegin(b8PpuSegment* seg_, u32* buff_, u32 bytesize_);
+
+/**
+ * @brief Finishes recording a retained segment.
+ *
+ * Appends the terminating JMP command. After this call the segment can be linked
+ * into an OT any number of frames, until it is recorded again with `b8PpuSegmentBegin`.
+ *
+ * @param seg_ Pointer to the segment being recorded.
+ */
+extern void b8PpuSegmentEnd(b8PpuSegment* seg_);
+
+/**
+ * @brief Links a retained segment at the front of the specified OT entry.
+ *
+ * Equivalent to calling `b8PpuPushFrontOT` for every primitive of the segment in
+ * reverse order, but only two words are written and no space is taken from `cmd_`.
+ *
+ * **Note:** The terminating JMP of a segment is shared, so a segment can be linked
+ * at most once per OT build (i.e. once between two `b8PpuClearOT` calls).
+ * A second link halts with an assertion, since it would make the list loop.
+ * Linking also re-targets the JMP for the list started last with it, so the
+ * segment cannot be linked again until that list has retired (its fence is
+ * done, e.g. after `b8PpuVsyncWait`); an earlier link halts with an assertion.
+ * The same restriction as `b8PpuPushFrontOT` applies to mixing front and back
+ * insertion on the same Z-value.
+ *
+ * @param cmd_ A pointer to the PPU command structure holding the OT.
+ * @param otz_ The Z-value at which the segment is inserted.
+ * @param seg_ A pointer to the finished segment.
+ */
+extern void b8PpuSegmentLinkFront(b8PpuCmd* cmd_, u32 otz_, b8PpuSegment* seg_);
+
+/**
+ * @brief Links a retained segment at the back of the specified OT entry.
+ *
+ * Equivalent to calling `b8PpuPushBackOT` for every primitive of the segment in
+ * order, but only two words are written and no space is taken from `cmd_`.
+ *
+ * **Note:** A segment can be linked at most once per OT build, see `b8PpuSegmentLinkFront`.
+ *
+ * @param cmd_ A pointer to the PPU command structure holding the OT.
+ * @param otz_ The Z-value at which the segment is appended.
+ * @param seg_ A pointer to the finished segment.
+ */
+extern void b8PpuSegmentLinkBack(b8PpuCmd* cmd_, u32 otz_, b8PpuSegment* seg_);
+
 /**
  * @brief Executes the PPU commands stored in the buffer.
  *
@@ -1116,6 +1207,130 @@ extern  void  b8PpuEnableVblankInterrupt( void );
  */
 extern  void  b8PpuVsyncWait( void );
 
+/**
+ * @brief Completion fence of a submitted PPU command list.
+ *
+ * The PPU consumes a list started with `b8PpuExec` before the following V-blank
+ * interrupt is raised. A fence records the V-blank count right after submission,
+ * and is signaled once another V-blank has been serviced.
+ */
+typedef u32 b8PpuFence;
+
+/**
+ * @brief Starts executing a PPU command list and returns its completion fence.
+ *
+ * Same as `b8PpuExec`, but the returned fence can be polled with `b8PpuFenceDone`
+ * to learn when the buffer of `cmd_` may be overwritten.
+ *
+ * @param cmd_ A pointer to the PPU command structure containing the commands to be executed.
+ * @return The fence of the submitted list.
+ */
+extern  b8PpuFence  b8PpuExecFence( b8PpuCmd* cmd_ );
+
+/**
+ * @brief Checks whether the PPU has finished the list guarded by a fence.
+ *
+ * @param fence_ A fence returned by `b8PpuExecFence`.
+ * @return Non-zero if the list has been consumed, 0 otherwise.
+ */
+extern  int   b8PpuFenceDone( b8PpuFence fence_ );
+
+/**
+ * @brief Blocks the current thread until the list guarded by a fence has been consumed.
+ *
+ * Returns immediately if the fence is already signaled. Halts with an assertion
+ * if the V-blank wait fails, e.g. when `b8PpuReset` has not been called, instead
+ * of spinning.
+ *
+ * @param fence_ A fence returned by `b8PpuExecFence`.
+ */
+extern  void  b8PpuFenceWait( b8PpuFence fence_ );
+
+/**
+ * @brief Ping-pong pair of PPU command buffers.
+ *
+ * Lets the CPU record frame N+1 into one buffer while the PPU is still consuming
+ * frame N from the other. `b8PpuCmdPairSubmit` keeps the pace at one list per
+ * V-blank, so input latency is the same as the serial
+ * build/`b8PpuExec`/`b8PpuVsyncWait` loop.
+ *
+ * Example usage:
+ * @code
+ * static u32 _buff[2][ 8*1024 ];
+ * static u32 _ot[2][ MAX_OTZ ];
+ * static u32 _ot_prev[ MAX_OTZ ];
+ * static b8PpuCmdPair _pair;
+ * static b8PpuCmd _ppu_cmd;
+ *
+ * b8PpuCmdPairInit( &_pair , _buff[0] , _buff[1] , sizeof(_buff[0]) );
+ * while(1){
+ *   b8PpuCmdPairBegin( &_pair , &_ppu_cmd );
+ *   b8PpuClearOT( &_ppu_cmd , _ot[ _pair.back ] , _ot_prev , MAX_OTZ );
+ *   ... // record primitives
+ *   b8PpuHaltAlloc( &_ppu_cmd );
+ *   b8PpuCmdPairSubmit( &_pair , &_ppu_cmd );
+ * }
+ * @endcode
+ *
+ * **Note:** The OT words are part of the command stream, so each buffer needs its own OT.
+ * Any memory referenced by a submitted list (BG maps, images) is still read by the PPU
+ * while the next frame is recorded.
+ *
+ * **Note:** A retained segment (`b8PpuSegment`) must not be linked into both buffers.
+ * Linking it re-targets its tail JMP, which the list still in flight may not have
+ * reached yet, so it halts with an assertion until that list has retired. Record
+ * one segment per buffer and link `seg[ pair.back ]`.
+ */
+typedef struct _b8PpuCmdPair {
+  u32*        buff[2];  /**< The two command buffers. */
+  u32         bytesize; /**< Size of each buffer in bytes. */
+  u32         back;     /**< Index of the buffer recorded next. */
+  b8PpuFence  fence[2]; /**< Completion fence of the last submission of each buffer. */
+} b8PpuCmdPair;
+
+/**
+ * @brief Initializes a ping-pong pair of PPU command buffers.
+ *
+ * @param pair_ Pointer to the pair to be initialized.
+ * @param buff0_ First command buffer.
+ * @param buff1_ Second command buffer.
+ * @param bytesize_ Size of each buffer in bytes.
+ */
+extern  void  b8PpuCmdPairInit( b8PpuCmdPair* pair_ , u32* buff0_ , u32* buff1_ , u32 bytesize_ );
+
+/**
+ * @brief Prepares the back buffer of a pair for recording.
+ *
+ * Waits until the PPU has consumed the previous contents of the back buffer,
+ * then sets it as the buffer of `cmd_` (see `b8PpuCmdSetBuff`).
+ *
+ * @param pair_ Pointer to the pair.
+ * @param cmd_ Command structure that receives the back buffer.
+ */
+extern  void  b8PpuCmdPairBegin( b8PpuCmdPair* pair_ , b8PpuCmd* cmd_ );
+
+/**
+ * @brief Submits the recorded back buffer and swaps the pair.
+ *
+ * Waits until the previously submitted list has been consumed, so that at most one
+ * list is started per V-blank, then executes `cmd_` and records its fence.
+ * The caller is responsible for terminating the list with `b8PpuHaltAlloc`.
+ *
+ * @param pair_ Pointer to the pair.
+ * @param cmd_ Command structure prepared by `b8PpuCmdPairBegin`.
+ */
+extern  void  b8PpuCmdPairSubmit( b8PpuCmdPair* pair_ , b8PpuCmd* cmd_ );
+
+/**
+ * @brief Waits until neither buffer of the pair is in use by the PPU.
+ *
+ * Call this before issuing a list from another buffer that must not overlap
+ * with the pair, or before releasing the buffers.
+ *
+ * @param pair_ Pointer to the pair.
+ */
+extern  void  b8PpuCmdPairSync( b8PpuCmdPair* pair_ );
+
 /**
  * @brief Gets the current screen resolution.
  *
@@ -1126,6 +1341,55 @@ extern  void  b8PpuVsyncWait( void );
  */
 extern  void  b8PpuGetResolution( u32* ww, u32* hh );
 
+/**
+ * @brief Enables the per-frame command statistics of b8PpuGetStats().
+ *
+ * Statistics cost a few instructions per command, so they are off by default
+ * and the counting code is compiled out. Rebuild b8lib with -DB8_PPU_STATS=1
+ * (see makefile.inc) to enable them.
+ */
+#ifndef B8_PPU_STATS
+#define B8_PPU_STATS          (0)
+#endif
+
+#define B8_PPU_STATS_MAX_OTZ  (32)  ///< OT depths counted separately. Deeper ones count in the last.
+
+/**
+ * @brief Primitive kinds counted by b8PpuStats.
+ */
+enum {
+  B8_PPU_STAT_RECT,     ///< RECT
+  B8_PPU_STAT_SPRITE,   ///< SPRITE
+  B8_PPU_STAT_POLY,     ///< POLY
+  B8_PPU_STAT_LINE,     ///< LINE
+  B8_PPU_STAT_BG,       ///< BG
+  B8_PPU_STAT_SETPAL,   ///< SETPAL
+  B8_PPU_STAT_FLUSH,    ///< FLUSH
+  B8_PPU_STAT_LOADIMG,  ///< LOADIMG
+  B8_PPU_STAT_OTHER,    ///< SCISSOR, VIEWOFFSET, NOP, HALT and ENABLE
+  B8_PPU_STAT_NUM
+};
+
+/**
+ * @brief PPU command statistics of one frame, from one b8PpuExec() to the next.
+ */
+typedef struct {
+  u32 prims[ B8_PPU_STAT_NUM ];           /**< Number of commands allocated, per B8_PPU_STAT_* kind. */
+  u32 jmp_words;                          /**< Words spent on JMP commands linking the OT and segments. */
+  u32 ot_words[ B8_PPU_STATS_MAX_OTZ ];   /**< Words linked to each OT depth, JMP words included. */
+  u32 used_words;                         /**< Words used in the command buffer when it was executed. */
+  u32 peak_words;                         /**< Highest used_words of any frame so far. */
+  u32 frames;                             /**< Number of frames executed so far. */
+} b8PpuStats;
+
+/**
+ * @brief Gets the command statistics of the last executed frame.
+ *
+ * @param stats_ Receives the statistics.
+ * @return 0 on success, or -1 if b8lib was built without B8_PPU_STATS.
+ */
+extern  int   b8PpuGetStats( b8PpuStats* stats_ );
+
 /**
  * @brief Resets the PPU system.
  *
@@ -0,0 +1,213 @@
+/**
+ * @file prof.h
+ * @brief Scoped profiler built on the DWT cycle counter.
+ *
+ * Code is measured in named zones. Zones nest, and every zone that ends is
+ * recorded as an event in a ring buffer for the current frame. b8ProfFrame()
+ * closes the frame: the events are kept as the last frame, and each zone's
+ * cycles in the frame are folded into its min/avg/max statistics.
+ *
+ * @code
+ * static int zone_ai;
+ * zone_ai = b8ProfZone( "ai" );
+ * b8ProfEnable( 1 );
+ * ...
+ * b8ProfBegin( zone_ai );
+ * update_enemies();
+ * b8ProfEnd();
+ * ...
+ * b8ProfFrame();   // once per frame
+ * @endcode
+ *
+ * b8helper's prof.h provides a scope guard, and pico8 profiles its own main loop.
+ *
+ * The last frame can be dumped in a compact binary form with b8ProfDump().
+ * Dumped to stdout, it goes out over SCI, and tool/b8prof turns a capture
+ * into the folded stack text used by flame graph tools. The dump layout,
+ * little endian:
+ * @code
+ *   "B8PF"  u16 version (1)  u16 number of zones  u32 CPU clock [Hz]
+ *           u32 frame cycles  u16 number of events  u16 dropped events
+ *   zones   { u8 name length, name } x number of zones
+ *   events  b8ProfEvent x number of events, in the order they ended
+ * @endcode
+ *
+ * @note The profiler is meant for one thread, usually the main loop.
+ * @note Cycles are wall-clock cycles. Time spent in other threads, or in
+ *       the kernel, while a zone is open is included in the zone.
+ *
+ * ### Sampling
+ *
+ * b8ProfSampleEnable() needs no zones at all. On every tick of the kernel
+ * timer (100 Hz), the pc and the thread of the interrupted code are counted
+ * in a histogram, so whole programs can be profiled, newlib and b8lib
+ * included. b8ProfSampleDump() writes the histogram, and tool/b8prof
+ * symbolizes it against the .elf or .map file of the program.
+ * @code
+ *   "B8PS"  u16 version (1)  u16 reserved  u32 CPU clock [Hz]
+ *           u32 samples  u32 lost samples  u16 number of entries  u16 reserved
+ *   entries b8ProfSample x number of entries
+ * @endcode
+ */
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <b8/type.h>
+#include <stddef.h>
+
+#define B8_PROF_MAX_ZONES   (32)    ///< Maximum number of zones
+#define B8_PROF_MAX_DEPTH   (8)     ///< Maximum nesting of zones
+#define B8_PROF_MAX_EVENTS  (128)   ///< Events kept per frame. Older ones are dropped.
+
+/**
+ * @brief One ended zone.
+ */
+typedef struct {
+  u8  zone;     ///< Zone id
+  u8  depth;    ///< Nesting depth, 0 for outermost
+  u16 reserved;
+  u32 begin;    ///< Cycles from the start of the frame to the begin of the zone
+  u32 cycles;   ///< Cycles from begin to end, nested zones included
+} b8ProfEvent;
+
+/**
+ * @brief Statistics of a zone over the frames closed so far.
+ *
+ * min/avg/max are the cycles spent in the zone per frame, over the
+ * frames in which the zone was entered.
+ */
+typedef struct {
+  const char* name;   ///< Name given to b8ProfZone()
+  u32 frames;         ///< Frames in which the zone was entered
+  u32 calls;          ///< Times the zone was entered in the last frame
+  u32 last;           ///< Cycles in the last frame
+  u32 min;            ///< Minimum cycles per frame
+  u32 max;            ///< Maximum cycles per frame
+  u32 avg;            ///< Average cycles per frame
+} b8ProfZoneStats;
+
+/**
+ * @brief Returns the id of a zone, registering it on first use.
+ *
+ * @param name Zone name. It must stay valid, a string literal is typical.
+ * @return Zone id, or -1 if B8_PROF_MAX_ZONES zones already exist.
+ */
+extern  int   b8ProfZone( const char* name );
+
+/**
+ * @brief Enables or disables recording. It is disabled at start up.
+ *
+ * While disabled, b8ProfBegin() and b8ProfEnd() return at once.
+ *
+ * @param enable 1 to enable, 0 to disable.
+ */
+extern  void  b8ProfEnable( int enable );
+
+/**
+ * @brief Returns 1 if recording is enabled.
+ */
+extern  int   b8ProfIsEnabled( void );
+
+/**
+ * @brief Opens a zone.
+ *
+ * Zones nested deeper than B8_PROF_MAX_DEPTH are not recorded, but must still be closed.
+ *
+ * @param zone Zone id from b8ProfZone(). Negative ids are ignored.
+ */
+extern  void  b8ProfBegin( int zone );
+
+/**
+ * @brief Closes the innermost open zone.
+ */
+extern  void  b8ProfEnd( void );
+
+/**
+ * @brief Closes a frame and starts the next one.
+ *
+ * Zones still open are carried over to the next frame.
+ */
+extern  void  b8ProfFrame( void );
+
+/**
+ * @brief Gets the statistics of a zone.
+ *
+ * @param zone  Zone id.
+ * @param stats Receives the statistics.
+ * @return 0 on success, or -1 if zone is invalid.
+ */
+extern  int   b8ProfGetZoneStats( int zone, b8ProfZoneStats* stats );
+
+/**
+ * @brief Returns the number of zones registered.
+ */
+extern  int   b8ProfGetNumZones( void );
+
+/**
+ * @brief Gets the events of the last closed frame.
+ *
+ * @param events  Receives a pointer to the events, valid until the next b8ProfFrame().
+ * @param cycles  If not NULL, receives the length of the frame in cycles.
+ * @return Number of events.
+ */
+extern  size_t  b8ProfGetEvents( const b8ProfEvent** events, u32* cycles );
+
+#define B8_PROF_MAX_SAMPLE_PCS  (1024)  ///< Distinct pc and thread pairs of the sampling histogram
+
+/**
+ * @brief One entry of the sampling histogram.
+ */
+typedef struct {
+  u32 pc;       ///< Address of the interrupted instruction
+  u16 pid;      ///< Interrupted thread, the low 16 bits of its pid (its thread slot)
+  u16 reserved;
+  u32 count;    ///< Number of samples
+} b8ProfSample;
+
+/**
+ * @brief Writes the last closed frame to a file descriptor in the dump format.
+ *
+ * @param fd File descriptor, e.g. 1 (stdout) to send it over SCI.
+ * @return Number of bytes written, or -1 on error.
+ */
+extern  int   b8ProfDump( int fd );
+
+/**
+ * @brief Starts or stops sampling. Samples taken so far are kept.
+ *
+ * @param enable 1 to start, 0 to stop.
+ */
+extern  void  b8ProfSampleEnable( int enable );
+
+/**
+ * @brief Discards all samples.
+ */
+extern  void  b8ProfSampleClear( void );
+
+/**
+ * @brief Gets the sampling histogram.
+ *
+ * Unused entries have count 0. The entries are updated by the timer
+ * interrupt; stop sampling first to read a consistent histogram.
+ *
+ * @param samples Receives a pointer to B8_PROF_MAX_SAMPLE_PCS entries.
+ * @param total   If not NULL, receives the number of samples taken.
+ * @param lost    If not NULL, receives the samples not counted because the histogram was full.
+ * @return Number of entries in use.
+ */
+extern  size_t  b8ProfGetSamples( const b8ProfSample** samples, u32* total, u32* lost );
+
+/**
+ * @brief Writes the sampling histogram to a file descriptor in the dump format.
+ *
+ * Sampling is paused while the histogram is written.
+ *
+ * @param fd File descriptor, e.g. 1 (stdout) to send it over SCI.
+ * @return Number of bytes written, or -1 on error.
+ */
+extern  int   b8ProfSampleDump( int fd );
+
+#ifdef __cplusplus
+}
+#endif
@@ -19,22 +19,32 @@
  *   - pthread_attr_getstack
  *   - pthread_attr_getdetachstate
  *   - pthread_attr_setdetachstate
- *
- * - The following functions are not supported in this OS environment and always return -ERRNOSYS:
+ *   - pthread_attr_setschedpolicy
+ *   - pthread_attr_getschedpolicy
+ *   - pthread_attr_setschedparam
+ *   - pthread_attr_getschedparam
  *   - pthread_getschedparam
  *   - pthread_setschedparam
- *   - pthread_detach
+ *   - pthread_mutex_init, pthread_mutex_destroy, pthread_mutex_lock, pthread_mutex_trylock,
+ *     pthread_mutex_timedlock, pthread_mutex_unlock
+ *   - pthread_mutexattr_init, pthread_mutexattr_destroy, pthread_mutexattr_settype, pthread_mutexattr_gettype
+ *   - pthread_cond_init, pthread_cond_destroy, pthread_cond_wait, pthread_cond_timedwait,
+ *     pthread_cond_signal, pthread_cond_broadcast
+ *   - pthread_condattr_init, pthread_condattr_destroy
+ *   - pthread_exit
  *   - pthread_join
+ *   - pthread_detach
  *   - pthread_cancel
- *   - pthread_setcanceltype
  *   - pthread_testcancel
+ *   - pthread_setcanceltype (PTHREAD_CANCEL_DEFERRED only)
  *
- * - The following functions can be called and will set attributes, but the actual scheduling
- *   policy or affinity settings are ignored in this BEEP-8 environment, making them effectively unsupported:
- *   - pthread_attr_setschedpolicy
- *   - pthread_attr_getschedpolicy
- *   - pthread_attr_setschedparam
- *   - pthread_attr_getschedparam
+ * Stacks of threads are taken from a pool in the kernel, and go back to it
+ * when the thread exits (see b8OsGetStackPoolInfo() in os.h). A thread that
+ * exits is kept until it is joined, unless it is detached, so every joinable
+ * thread must be joined for its slot to be reused.
+ *
+ * - The following functions can be called and will set attributes, but the actual
+ *   inheritance or affinity settings are ignored in this BEEP-8 environment, making them effectively unsupported:
  *   - pthread_attr_setinheritsched
  *   - pthread_attr_getinheritsched
  *   - pthread_attr_setaffinity_np
@@ -46,6 +56,7 @@
 extern  "C" {
 #endif
 
+#include <time.h>
 #include <b8/os.h>
 #include <b8/type.h>
 #include <b8/sched.h>
@@ -53,6 +64,18 @@ extern  "C" {
 #undef  pthread_attr_t
 #define pthread_attr_t b8_pthread_attr_t
 
+#undef  pthread_mutex_t
+#define pthread_mutex_t b8_pthread_mutex_t
+
+#undef  pthread_mutexattr_t
+#define pthread_mutexattr_t b8_pthread_mutexattr_t
+
+#undef  pthread_cond_t
+#define pthread_cond_t b8_pthread_cond_t
+
+#undef  pthread_condattr_t
+#define pthread_condattr_t b8_pthread_condattr_t
+
 typedef b8OsPid pthread_t;
 
 typedef void *pthread_addr_t;
@@ -65,7 +88,7 @@ typedef struct _b8_pthread_attr_t {
   size_t  stacksize;    // Size of the stack allocated for the pthread
   u8      policy;
   u8      detachstate;  // Initialize to the detach state
-  s16     priority;     // The actual scheduling policy is ignored and thus effectively unsupported.
+  s16     priority;     // sched_get_priority_min() .. sched_get_priority_max(), larger is more urgent
   u16     irq_no;
 } b8_pthread_attr_t;
 
@@ -77,8 +100,68 @@ typedef struct _b8_pthread_attr_t {
 #undef  PTHREAD_CREATE_DETACHED
 #define PTHREAD_CREATE_DETACHED       1
 
+#undef  PTHREAD_CANCELED
+#define PTHREAD_CANCELED              ((void*)B8_OS_THREAD_CANCELED)  // Exit value of a canceled thread
+
+#undef  PTHREAD_CANCEL_DEFERRED
+#define PTHREAD_CANCEL_DEFERRED       0
+
+#undef  PTHREAD_CANCEL_ASYNCHRONOUS
+#define PTHREAD_CANCEL_ASYNCHRONOUS   1
+
 #define pthread_equal(t1,t2) ((t1) == (t2))
 
+/*
+  Mutexes and condition variables are futexes: a word in user memory that is
+  changed with SWP, the atomic swap of ARMv4. A mutex that is not contended is
+  locked and unlocked without a system call. The kernel is entered only to
+  sleep on a word that is held, or to wake a thread sleeping on it.
+
+  The mutex word is 0 while unlocked, 1 while locked, and 2 while locked with
+  threads that may be sleeping on it.
+*/
+typedef struct _b8_pthread_mutex_t {
+  volatile u32  lock;   // 0, 1 or 2
+  b8OsPid       owner;  // B8_OS_INVALID_PID while unlocked
+  u16           count;  // times locked by owner, above 1 only for PTHREAD_MUTEX_RECURSIVE
+  u8            type;   // PTHREAD_MUTEX_*
+  u8            reserved;
+} b8_pthread_mutex_t;
+
+typedef struct _b8_pthread_mutexattr_t {
+  u8  type;
+} b8_pthread_mutexattr_t;
+
+typedef struct _b8_pthread_cond_t {
+  volatile u32  seq;      // changed by every signal and broadcast
+  u32           waiters;  // threads in pthread_cond_wait(), counted under the mutex
+} b8_pthread_cond_t;
+
+typedef struct _b8_pthread_condattr_t {
+  u8  reserved;
+} b8_pthread_condattr_t;
+
+#undef  PTHREAD_MUTEX_NORMAL
+#define PTHREAD_MUTEX_NORMAL          0   // Locking it again deadlocks.
+
+#undef  PTHREAD_MUTEX_RECURSIVE
+#define PTHREAD_MUTEX_RECURSIVE       1   // The owner may lock it again, and must unlock it as often.
+
+#undef  PTHREAD_MUTEX_ERRORCHECK
+#define PTHREAD_MUTEX_ERRORCHECK      2   // Locking it again fails with EDEADLK.
+
+#undef  PTHREAD_MUTEX_DEFAULT
+#define PTHREAD_MUTEX_DEFAULT         PTHREAD_MUTEX_NORMAL
+
+#undef  PTHREAD_MUTEX_INITIALIZER
+#define PTHREAD_MUTEX_INITIALIZER     { 0, B8_OS_INVALID_PID, 0, PTHREAD_MUTEX_NORMAL, 0 }
+
+#undef  PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP
+#define PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP  { 0, B8_OS_INVALID_PID, 0, PTHREAD_MUTEX_RECURSIVE, 0 }
+
+#undef  PTHREAD_COND_INITIALIZER
+#define PTHREAD_COND_INITIALIZER      { 0, 0 }
+
 /**
  * @brief Creates a new thread.
  *
@@ -113,7 +196,7 @@ extern int pthread_yield(void);
  * @brief Returns the thread identifier of the calling thread.
  *
  * This function is part of the POSIX standard and is used to obtain the thread identifier of the calling thread.
- * This function works correctly in this OS environment.
+ * This function works correctly in this OS environment, and makes no system call.
  *
  * @return The thread identifier of the calling thread.
  */
@@ -219,13 +302,13 @@ extern int pthread_attr_setdetachstate(pthread_attr_t *attr, int detachstate);
  * @brief Sets the scheduling parameters in the thread attributes object.
  *
  * This function is part of the POSIX standard and allows setting the scheduling parameters
- * in the thread attributes object. However, in this specific OS environment, while the function
- * can be called and the parameters can be set, the actual scheduling policy is ignored, making
- * it effectively unsupported.
+ * in the thread attributes object. `sched_priority` must be in the range returned by
+ * `sched_get_priority_min()` and `sched_get_priority_max()`; it is checked by `pthread_create()`.
+ * The default priority is B8_OS_PRIORITY_DEFAULT.
  *
  * @param attr A pointer to the thread attributes object.
  * @param param A pointer to a struct sched_param containing the scheduling parameters.
- * @return 0 indicating success, but note that the scheduling policy is ignored.
+ * @return 0 on success, or EINVAL if an argument is NULL.
  */
 extern int pthread_attr_setschedparam(pthread_attr_t *attr, const struct sched_param *param);
 
@@ -233,63 +316,60 @@ extern int pthread_attr_setschedparam(pthread_attr_t *attr, const struct sched_p
  * @brief Retrieves the scheduling parameters from the thread attributes object.
  *
  * This function is part of the POSIX standard and allows retrieving the scheduling parameters
- * from the thread attributes object. However, in this specific OS environment, while the function
- * can be called and the parameters can be retrieved, the actual scheduling policy is ignored, making
- * it effectively unsupported.
+ * from the thread attributes object.
  *
  * @param attr A pointer to the thread attributes object.
  * @param param A pointer to a struct sched_param where the scheduling parameters will be stored.
- * @return 0 indicating success, but note that the retrieved scheduling policy is ignored.
+ * @return 0 on success, or EINVAL if an argument is NULL.
  */
 extern int pthread_attr_getschedparam(const pthread_attr_t *attr, struct sched_param *param);
 
 /**
  * @brief Retrieves the scheduling policy and parameters of the specified thread.
  *
- * This function is part of the POSIX standard. However, in this specific environment,
- * it is not supported and will always return -ERRNOSYS.
+ * This function is part of the POSIX standard and works correctly in this OS environment.
  *
  * @param thread The thread whose scheduling parameters are to be retrieved.
  * @param policy A pointer to an integer where the policy will be stored.
  * @param param A pointer to a struct sched_param where the scheduling parameters will be stored.
- * @return -ERRNOSYS as this function is not supported in this environment.
+ * @return 0 on success, EINVAL if an argument is NULL, or ESRCH if the thread does not exist.
  */
 extern int pthread_getschedparam(pthread_t thread, int* policy, struct sched_param* param);
 
 /**
  * @brief Sets the scheduling policy and parameters of the specified thread.
  *
- * This function is part of the POSIX standard. However, in this specific environment,
- * it is not supported and will always return -ERRNOSYS.
+ * This function is part of the POSIX standard and works correctly in this OS environment.
+ * The change takes effect immediately: if a ready thread now has a higher priority than
+ * the caller, the caller is preempted before this function returns.
  *
  * @param thread The thread whose scheduling parameters are to be set.
- * @param policy The new scheduling policy.
+ * @param policy The new scheduling policy (SCHED_FIFO, SCHED_RR, or SCHED_IRQ for IRQ threads).
  * @param param A pointer to a struct sched_param containing the new scheduling parameters.
- * @return -ERRNOSYS as this function is not supported in this environment.
+ * @return 0 on success, EINVAL for an invalid policy or priority, or ESRCH if the thread does not exist.
  */
 extern int pthread_setschedparam(pthread_t thread, int policy, const struct sched_param* param);
 
 /**
  * @brief Sets the scheduling policy attribute in the thread attributes object.
  *
- * This function is part of the POSIX standard. In this specific environment, while the function can be called and 
- * the policy can be set, the actual scheduling policy is ignored and thus effectively unsupported.
+ * This function is part of the POSIX standard. SCHED_RR threads share the CPU with threads of
+ * the same priority every timer tick, while SCHED_FIFO threads run until they block or yield.
  *
  * @param attr A pointer to the thread attributes object.
  * @param policy The new scheduling policy.
- * @return 0 indicating success, but note that the policy is ignored.
+ * @return 0 on success, or EINVAL if attr is NULL.
  */
 extern int pthread_attr_setschedpolicy(pthread_attr_t *attr, int policy);
 
 /**
  * @brief Retrieves the scheduling policy from the thread attributes object.
  *
- * This function is part of the POSIX standard. In this specific environment, while the function can be called and 
- * the policy can be retrieved, the actual scheduling policy is ignored and thus effectively unsupported.
+ * This function is part of the POSIX standard and works correctly in this OS environment.
  *
  * @param attr A pointer to the thread attributes object.
  * @param policy A pointer to an integer where the policy will be stored.
- * @return 0 indicating success, but note that the retrieved policy is ignored in practice.
+ * @return 0 on success, or EINVAL if an argument is NULL.
  */
 extern int pthread_attr_getschedpolicy(const pthread_attr_t *attr, int *policy);
 
@@ -297,11 +377,11 @@ extern int pthread_attr_getschedpolicy(const pthread_attr_t *attr, int *policy);
  * @brief Terminates the calling thread.
  *
  * This function is part of the POSIX standard and allows for the termination of the calling thread.
- * However, in this specific OS environment, thread termination is not supported. While the function
- * can be called, it will only put the thread into an indefinite wait state, and the thread will not
- * be released or cleaned up.
+ * Returning from the start routine does the same with its return value. The stack of the thread goes
+ * back to the pool at once. The thread is reclaimed when it is joined, or at once if it is detached.
+ * Mutexes held by the thread stay locked.
  *
- * @param value The exit status of the thread.
+ * @param value The exit status of the thread, handed to pthread_join().
  */
 extern  void pthread_exit(pthread_addr_t value);
 
@@ -309,11 +389,11 @@ extern  void pthread_exit(pthread_addr_t value);
  * @brief Detaches the specified thread.
  *
  * This function is part of the POSIX standard and is used to detach a thread, allowing its resources
- * to be automatically reclaimed upon termination. However, in this OS environment, this function is not supported
- * and always returns -ERRNOSYS.
+ * to be automatically reclaimed upon termination. A thread that has already exited is reclaimed at once.
+ * A thread may also be created detached with pthread_attr_setdetachstate().
  *
  * @param thread The thread to be detached.
- * @return -ERRNOSYS indicating that this function is not supported.
+ * @return 0 on success, ESRCH if the thread does not exist, or EINVAL if it is already detached or being joined.
  */
 extern int pthread_detach(pthread_t thread);
 
@@ -321,22 +401,28 @@ extern int pthread_detach(pthread_t thread);
  * @brief Waits for the specified thread to terminate.
  *
  * This function is part of the POSIX standard and is used to wait for a thread to terminate and optionally
- * retrieve its exit status. However, in this OS environment, this function is not supported and always returns -ERRNOSYS.
+ * retrieve its exit status. The thread is reclaimed when this function returns. This function is a
+ * cancellation point.
  *
  * @param thread The thread to wait for.
- * @param value A pointer to a location where the exit status of the thread will be stored.
- * @return -ERRNOSYS indicating that this function is not supported.
+ * @param value If not NULL, receives the exit status of the thread, or PTHREAD_CANCELED if it was canceled.
+ * @return 0 on success, ESRCH if the thread does not exist, EDEADLK if it is the calling thread,
+ *         or EINVAL if it is detached or another thread is joining it.
  */
 extern int pthread_join(pthread_t thread, pthread_addr_t *value);
 
 /**
  * @brief Cancels the specified thread.
  *
- * This function is part of the POSIX standard and is used to request the cancellation of a thread. However, in this OS environment,
- * this function is not supported and always returns -ERRNOSYS.
+ * This function is part of the POSIX standard and is used to request the cancellation of a thread.
+ * Cancellation is deferred: the thread exits with PTHREAD_CANCELED at a cancellation point, at once if it
+ * is blocked in one. The cancellation points are pthread_join(), pthread_cond_wait(),
+ * pthread_cond_timedwait(), pthread_testcancel(), sem_wait(), sem_timedwait(), sleep(), usleep(),
+ * and b8SysIrqWait(). Cleanup handlers are not supported; a thread canceled in pthread_cond_wait()
+ * exits without the mutex.
  *
  * @param thread The thread to be canceled.
- * @return -ERRNOSYS indicating that this function is not supported.
+ * @return 0 on success, or ESRCH if the thread does not exist.
  */
 extern int pthread_cancel(pthread_t thread);
 
@@ -344,23 +430,193 @@ extern int pthread_cancel(pthread_t thread);
  * @brief Sets the cancelability type of the calling thread.
  *
  * This function is part of the POSIX standard and is used to set the cancelability type (deferred or asynchronous) of the calling thread.
- * However, in this OS environment, this function is not supported and always returns -ERRNOSYS.
+ * Only PTHREAD_CANCEL_DEFERRED is supported.
  *
  * @param type The new cancelability type.
- * @param oldtype A pointer to an integer where the previous cancelability type will be stored.
- * @return -ERRNOSYS indicating that this function is not supported.
+ * @param oldtype If not NULL, receives PTHREAD_CANCEL_DEFERRED.
+ * @return 0 on success, or EINVAL if type is not PTHREAD_CANCEL_DEFERRED.
  */
 extern int pthread_setcanceltype(int type, int *oldtype);
 
 /**
  * @brief Creates a cancellation point in the calling thread.
  *
- * This function is part of the POSIX standard and is used to create a cancellation point in the calling thread,
- * allowing it to be canceled if a cancellation request is pending. However, in this OS environment, this function is not supported
- * and does not perform any action.
+ * This function is part of the POSIX standard and is used to create a cancellation point in the calling thread.
+ * If the thread has been canceled, it exits with PTHREAD_CANCELED.
  */
 extern void pthread_testcancel(void);
 
+/**
+ * @brief Initializes a mutex attributes object. The type is PTHREAD_MUTEX_DEFAULT.
+ *
+ * @param attr A pointer to the mutex attributes object.
+ * @return 0 on success, or EINVAL if attr is NULL.
+ */
+extern int pthread_mutexattr_init(pthread_mutexattr_t* attr);
+
+/**
+ * @brief Destroys a mutex attributes object.
+ *
+ * @param attr A pointer to the mutex attributes object.
+ * @return 0 on success, or EINVAL if attr is NULL.
+ */
+extern int pthread_mutexattr_destroy(pthread_mutexattr_t* attr);
+
+/**
+ * @brief Sets the mutex type in a mutex attributes object.
+ *
+ * @param attr A pointer to the mutex attributes object.
+ * @param type PTHREAD_MUTEX_NORMAL, PTHREAD_MUTEX_RECURSIVE, PTHREAD_MUTEX_ERRORCHECK or PTHREAD_MUTEX_DEFAULT.
+ * @return 0 on success, or EINVAL for an invalid argument.
+ */
+extern int pthread_mutexattr_settype(pthread_mutexattr_t* attr, int type);
+
+/**
+ * @brief Gets the mutex type from a mutex attributes object.
+ *
+ * @param attr A pointer to the mutex attributes object.
+ * @param type A pointer to an integer where the type will be stored.
+ * @return 0 on success, or EINVAL if an argument is NULL.
+ */
+extern int pthread_mutexattr_gettype(const pthread_mutexattr_t* attr, int* type);
+
+/**
+ * @brief Initializes a mutex.
+ *
+ * A mutex may also be initialized statically with PTHREAD_MUTEX_INITIALIZER, or with
+ * PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP for a recursive one. No kernel object is allocated.
+ *
+ * @param mutex A pointer to the mutex.
+ * @param attr A pointer to the mutex attributes object. If NULL, default attributes are used.
+ * @return 0 on success, or EINVAL if mutex is NULL.
+ */
+extern int pthread_mutex_init(pthread_mutex_t* mutex, const pthread_mutexattr_t* attr);
+
+/**
+ * @brief Destroys a mutex.
+ *
+ * @param mutex A pointer to the mutex.
+ * @return 0 on success, EINVAL if mutex is NULL, or EBUSY if it is locked.
+ */
+extern int pthread_mutex_destroy(pthread_mutex_t* mutex);
+
+/**
+ * @brief Locks a mutex, blocking while another thread holds it.
+ *
+ * A mutex that is not held is taken without a system call.
+ *
+ * @param mutex A pointer to the mutex.
+ * @return 0 on success, EINVAL if mutex is NULL, EDEADLK if the caller holds a PTHREAD_MUTEX_ERRORCHECK mutex,
+ *         or EAGAIN if a PTHREAD_MUTEX_RECURSIVE mutex is locked too many times.
+ */
+extern int pthread_mutex_lock(pthread_mutex_t* mutex);
+
+/**
+ * @brief Locks a mutex if no other thread holds it.
+ *
+ * @param mutex A pointer to the mutex.
+ * @return 0 on success, EBUSY if the mutex is held, or an error code of pthread_mutex_lock().
+ */
+extern int pthread_mutex_trylock(pthread_mutex_t* mutex);
+
+/**
+ * @brief Locks a mutex, blocking no later than a deadline.
+ *
+ * @param mutex A pointer to the mutex.
+ * @param abstime Deadline on CLOCK_REALTIME.
+ * @return 0 on success, ETIMEDOUT if the deadline passed, or an error code of pthread_mutex_lock().
+ */
+extern int pthread_mutex_timedlock(pthread_mutex_t* mutex, const struct timespec* abstime);
+
+/**
+ * @brief Unlocks a mutex held by the caller.
+ *
+ * A system call is made only if another thread may be sleeping on the mutex;
+ * the most urgent of them is woken.
+ *
+ * @param mutex A pointer to the mutex.
+ * @return 0 on success, EINVAL if mutex is NULL, or EPERM if the caller does not hold it.
+ */
+extern int pthread_mutex_unlock(pthread_mutex_t* mutex);
+
+/**
+ * @brief Initializes a condition variable attributes object.
+ *
+ * @param attr A pointer to the condition variable attributes object.
+ * @return 0 on success, or EINVAL if attr is NULL.
+ */
+extern int pthread_condattr_init(pthread_condattr_t* attr);
+
+/**
+ * @brief Destroys a condition variable attributes object.
+ *
+ * @param attr A pointer to the condition variable attributes object.
+ * @return 0 on success, or EINVAL if attr is NULL.
+ */
+extern int pthread_condattr_destroy(pthread_condattr_t* attr);
+
+/**
+ * @brief Initializes a condition variable.
+ *
+ * A condition variable may also be initialized statically with PTHREAD_COND_INITIALIZER.
+ *
+ * @param cond A pointer to the condition variable.
+ * @param attr Ignored. Timeouts are on CLOCK_REALTIME.
+ * @return 0 on success, or EINVAL if cond is NULL.
+ */
+extern int pthread_cond_init(pthread_cond_t* cond, const pthread_condattr_t* attr);
+
+/**
+ * @brief Destroys a condition variable.
+ *
+ * @param cond A pointer to the condition variable.
+ * @return 0 on success, EINVAL if cond is NULL, or EBUSY if a thread waits on it.
+ */
+extern int pthread_cond_destroy(pthread_cond_t* cond);
+
+/**
+ * @brief Unlocks a mutex and waits on a condition variable, then locks the mutex again.
+ *
+ * All threads waiting on one condition variable must use the same mutex.
+ * A PTHREAD_MUTEX_RECURSIVE mutex is released fully while waiting, and locked
+ * again as many times as before.
+ *
+ * @param cond A pointer to the condition variable.
+ * @param mutex A pointer to the mutex held by the caller.
+ * @return 0 on success, EINVAL if an argument is NULL, or EPERM if the caller does not hold the mutex.
+ */
+extern int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex);
+
+/**
+ * @brief Same as pthread_cond_wait(), but gives up waiting at a deadline.
+ *
+ * The mutex is held again on return, on timeout as well.
+ *
+ * @param cond A pointer to the condition variable.
+ * @param mutex A pointer to the mutex held by the caller.
+ * @param abstime Deadline on CLOCK_REALTIME.
+ * @return 0 on success, ETIMEDOUT if the deadline passed, or an error code of pthread_cond_wait().
+ */
+extern int pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* abstime);
+
+/**
+ * @brief Wakes the most urgent thread waiting on a condition variable.
+ *
+ * Returns without a system call if no thread waits.
+ *
+ * @param cond A pointer to the condition variable.
+ * @return 0 on success, or EINVAL if cond is NULL.
+ */
+extern int pthread_cond_signal(pthread_cond_t* cond);
+
+/**
+ * @brief Wakes all threads waiting on a condition variable.
+ *
+ * @param cond A pointer to the condition variable.
+ * @return 0 on success, or EINVAL if cond is NULL.
+ */
+extern int pthread_cond_broadcast(pthread_cond_t* cond);
+
 /*
 Note: The following functions are not supported and are not defined in this environment.
 - pthread_attr_setinheritsched
@@ -0,0 +1,142 @@
+/**
+ * @file romfs.h
+ * @brief Read-only file system over the BP8R image appended to the ROM.
+ *
+ * tool/genb8rom packs the files of an application's romfs directory into a
+ * "BP8R" image, and tool/relb8rom appends that image to the .b8 ROM and
+ * patches its offset into the ROM header at address 32. Because the ROM is
+ * mapped at address 0, the image can be read in place without copying.
+ *
+ * The files are reachable in two ways:
+ * - Through the standard C library, under the mount point B8_ROMFS_MOUNT:
+ *   @code
+ *   FILE* fp = fopen( "/rom/title.png", "rb" );
+ *   @endcode
+ *   open/read/lseek/fstat are supported. Writing is not.
+ * - Directly by name, with no file descriptor and no copy:
+ *   @code
+ *   size_t size;
+ *   const u8* png = (const u8*)b8RomfsFind( "title.png", &size );
+ *   @endcode
+ *
+ * An open descriptor can also be mapped with ioctl(fd, B8_ROMFS_IOCTL_MAP, &map),
+ * which describes the bytes read() returns. Other ioctl requests fail with ENOTTY.
+ *
+ * Files packed with genb8rom -z are stored as ZPack streams; an app selects
+ * them with GENB8ROM_ZPACK in its Makefile (see sdk/app/makefile.app).
+ * open() decodes them into a heap buffer, which is freed by close(). This
+ * needs a decoder installed with b8RomfsSetDecoder(). b8helper provides one,
+ * see ZPack::InstallRomfsDecoder() in zpack.h. b8RomfsFind() always returns
+ * the stored bytes. Use b8RomfsLookup() to check whether they are compressed.
+ *
+ * @note Data pointers point into ROM. They are valid for the lifetime of the
+ * application and must not be written to. The exception is B8_ROMFS_IOCTL_MAP
+ * on a compressed file: it maps the decoded heap buffer, with method
+ * B8_ROMFS_METHOD_STORED, and the pointer is valid only until close().
+ */
+
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <b8/type.h>
+#include <stddef.h>
+
+#define B8_ROMFS_MOUNT            "/rom/"   ///< Mount point of the romfs in the file system
+#define B8_ROMFS_MAX_OPEN_FILES   (16)      ///< Maximum number of romfs files opened at once
+
+#define B8_ROMFS_IOCTL_MAP        (0x524f0001)  ///< ioctl: fill a b8RomfsMap for an open file, valid until close()
+
+#define B8_ROMFS_METHOD_STORED    (0)       ///< Stored as-is. Other values are 1 + ZPack::CompressionMethod
+
+/**
+ * @brief Builds romfs.c for host-side tests.
+ *
+ * With -DB8_ROMFS_HOST=1, b8RomfsReset() is replaced by b8RomfsHostMount(),
+ * which mounts an image held in host memory. Off by default; sdk/test builds with it.
+ */
+#ifndef B8_ROMFS_HOST
+#define B8_ROMFS_HOST             (0)
+#endif
+
+/**
+ * @brief Location of a file's contents.
+ */
+typedef struct {
+  const void* ptr;      ///< First byte of the file
+  size_t      size;     ///< Size of the file in bytes, as stored
+  size_t      orgsize;  ///< Size of the file in bytes, after decoding
+  u8          method;   ///< B8_ROMFS_METHOD_STORED, or the ZPack method used by genb8rom
+} b8RomfsMap;
+
+/**
+ * @brief Decodes one compressed romfs file.
+ *
+ * @param src     Stored ZPack stream in ROM.
+ * @param srcsize Size of the stream in bytes.
+ * @param dst     Destination buffer.
+ * @param dstsize Size of the destination buffer, equal to the original file size.
+ * @return Number of bytes decoded, or a negative value on failure.
+ */
+typedef int (*b8RomfsDecoder)( const void* src, size_t srcsize, void* dst, size_t dstsize );
+
+/**
+ * @brief Locates the romfs image and registers the B8_ROMFS_MOUNT driver.
+ *
+ * If relb8rom did not append an image, no driver is registered and every
+ * lookup fails with ENOENT.
+ *
+ * @warning This function is called from crt0.c. Do not call it directly.
+ *
+ * @return 0 on success, or -1 if the image header is broken.
+ */
+extern  int b8RomfsReset(void);
+
+#if B8_ROMFS_HOST
+/**
+ * @brief Mounts a BP8R image in host memory and registers the B8_ROMFS_MOUNT driver.
+ *
+ * @param image The image, as written by genb8rom. It must stay valid while mounted.
+ * @param size  Size of the image in bytes.
+ * @return 0 on success, or -1 if the image header is broken.
+ */
+extern  int b8RomfsHostMount( const void* image, size_t size );
+#endif
+
+/**
+ * @brief Returns the number of files in the romfs image.
+ *
+ * @return Number of files. 0 if there is no image.
+ */
+extern  size_t  b8RomfsGetNumFiles(void);
+
+/**
+ * @brief Looks up a file by name and returns its contents in place.
+ *
+ * @param name File name as stored by genb8rom, without the mount point.
+ * @param size If not NULL, receives the size of the file in bytes.
+ * @return Pointer to the file in ROM, or NULL with errno set to ENOENT.
+ */
+extern  const void* b8RomfsFind( const char* name, size_t* size );
+
+/**
+ * @brief Looks up a file by name and reports how it is stored.
+ *
+ * For a compressed file, map->ptr and map->size describe the ZPack stream in ROM.
+ *
+ * @param name File name as stored by genb8rom, without the mount point.
+ * @param map  Receives the location, sizes and method of the file.
+ * @return 0 on success, or -1 with errno set to ENOENT or EINVAL.
+ */
+extern  int b8RomfsLookup( const char* name, b8RomfsMap* map );
+
+/**
+ * @brief Installs the decoder used by open() for compressed files.
+ *
+ * @param decoder Decoder function, or NULL to remove it.
+ */
+extern  void  b8RomfsSetDecoder( b8RomfsDecoder decoder );
+
+#ifdef __cplusplus
+}
+#endif
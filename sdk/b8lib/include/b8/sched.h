@@ -13,8 +13,17 @@
  * - `SCHED_IRQ`: IRQ handler scheduling policy
  * - `SCHED_OTHER`: Not supported
  * 
- * This file also provides a function prototype for retrieving the maximum priority 
- * value for a given scheduling policy.
+ * This file also provides function prototypes for retrieving the maximum and minimum
+ * priority values for a given scheduling policy.
+ *
+ * Threads are scheduled by fixed priority: the ready thread with the largest
+ * `sched_priority` always runs. Threads of equal priority are time-sliced every
+ * timer tick under `SCHED_RR`, and run until they block or yield under `SCHED_FIFO`.
+ * `pthread_yield()` only gives the CPU to ready threads of the same priority, so
+ * a thread that loops on it, waiting for a lower priority thread to do
+ * something, starves that thread forever; block on a semaphore or sleep instead.
+ * A thread that changes its own scheduling parameters goes to the back of its
+ * new priority, and yields to the threads of that priority.
  * 
  * Typically, users do not need to use this header directly. It is intended for internal 
  * use within the BEEP-8 system to handle scheduling-related operations.
@@ -48,6 +57,7 @@ struct b8_sched_param{
 };
 
 extern  int sched_get_priority_max(int policy);
+extern  int sched_get_priority_min(int policy);
 
 #ifdef  __cplusplus
 }
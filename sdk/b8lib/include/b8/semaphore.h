@@ -13,6 +13,7 @@
  * - `sem_trywait`: Try to wait on an unnamed semaphore without blocking
  * - `sem_post`: Post (signal) an unnamed semaphore
  * - `sem_getvalue`: Get the current value of an unnamed semaphore
+ * - `sem_destroy`: Destroy an unnamed semaphore
  * 
  * Note that named semaphores are not supported in this implementation. Functions 
  * related to named semaphores, such as `sem_open`, `sem_close`, and `sem_unlink`, 
@@ -113,10 +114,22 @@ extern int sem_post(sem_t* sem);
  */
 extern int sem_getvalue(sem_t* sem, int* sval);
 
+/**
+ * @brief Destroy an unnamed semaphore.
+ * 
+ * This function returns the semaphore pointed to by `sem` to the system, so that a
+ * later `sem_init` can use it again. The system has a fixed number of semaphores;
+ * destroy the ones no longer used. A semaphore that a thread waits on cannot be
+ * destroyed.
+ * 
+ * @param sem A pointer to the semaphore to destroy.
+ * @return 0 on success; -1 on error, including while a thread waits on the semaphore.
+ */
+extern int sem_destroy(sem_t* sem);
+
 
 // The following API functions are not supported and cannot be used in the BEEP-8 system.
 #define SEM_FAILED	((sem_t *) 0)
-extern int    sem_destroy(sem_t* sem);
 extern sem_t* sem_open (const char* name, int __oflag, ...);
 extern int    sem_close (sem_t* sem);
 extern int    sem_unlink(const char *name);
@@ -16,6 +16,8 @@
  * - `b8SysGetCpuClock`: Get the CPU clock speed
  * - `b8SysSetupIrqWait`: Set up an IRQ wait handler
  * - `b8SysIrqWait`: Wait for an IRQ
+ * - `b8SysGetIrqCount`: Get the number of serviced IRQ events
+ * - `b8SysGetIrqLatency`: Get the cycles from an IRQ to the return of its wait
  * 
  * These functions are intended for use under special conditions, such as in the bootloader,
  * operating system, or for handling exceptional halts. They should not be used in regular 
@@ -91,6 +93,8 @@ extern u32 b8SysGetCpuClock(void);
  * @brief Set up an IRQ wait handler.
  * 
  * This function sets up an IRQ wait handler for the specified IRQ.
+ * The kernel then keeps the events of the IRQ, and wakes the threads
+ * waiting for it directly from the interrupt path.
  * 
  * @param irq The IRQ number to set up.
  * @return 0 on success; an error code on failure.
@@ -113,7 +117,7 @@ extern int b8SysIrqWait(u32 irq);
 /**
  * @brief Clear pending IRQ events and wait for the next occurrence.
  *
- * This function drains any pending sem_post backlog for the specified IRQ,
+ * This function discards any pending events of the specified IRQ,
  * then waits for the next IRQ event. Use this API when you want to ensure
  * that only the next interrupt will cause the wait to return.
  *
@@ -123,6 +127,26 @@ extern int b8SysIrqWait(u32 irq);
  */
 extern int b8SysIrqClearAndWait(u32 irq);
 
+/**
+ * @brief Get the number of serviced IRQ events.
+ * The counter of the specified IRQ is incremented each time the kernel takes
+ * its event for the waiters set up by `b8SysSetupIrqWait`. It wraps around at 2^32,
+ * so compare values for equality only.
+ * @param irq The IRQ number to query.
+ * @return The event count; 0 if the IRQ is invalid or has not been set up.
+ */
+extern u32 b8SysGetIrqCount(u32 irq);
+
+/**
+ * @brief Get the latency of the last wait for an IRQ.
+ * The cycles from the kernel taking an event of the IRQ to the return of the
+ * `b8SysIrqWait` or `b8SysIrqClearAndWait` it woke. A wait that returns at
+ * once for a pending event, or fails, leaves the value as it was.
+ * @param irq The IRQ number to query.
+ * @return Latency in CPU cycles; 0 if the IRQ is invalid or was never waited for.
+ */
+extern u32 b8SysGetIrqLatency(u32 irq);
+
 /**
  * @brief Assert macro for system checks.
  * 
@@ -60,6 +60,9 @@ extern int clock_getres(clockid_t clk_id, struct timespec *res);
  * 
  * This function retrieves the current time of the specified clock, identified by `clk_id`.
  * The current time is stored in the `tp` structure.
+ *
+ * Once the OS runs, the time is read from the kernel's time page (see b8OsTimePage)
+ * and B8_DWT_CYCCNT, without a system call.
  * 
  * @param clk_id The identifier of the clock.
  * @param tp A pointer to a `timespec` structure where the current time will be stored.
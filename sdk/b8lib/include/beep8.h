@@ -25,6 +25,8 @@
  * - <b8/pthread.h>: BEEP-8 pthread functions
  * - <b8/syscall.h>: BEEP-8 system call interface
  * - <b8/misc.h>: Miscellaneous BEEP-8 functions
+ * - <b8/romfs.h>: BEEP-8 read-only file system
+ * - <b8/prof.h>: BEEP-8 scoped profiler
  *
  * @note Ensure that this header is included at the beginning of your source files to access
  * all the functionalities of the BEEP-8 SDK.
@@ -47,4 +49,6 @@
 #include <b8/semaphore.h>
 #include <b8/pthread.h>
 #include <b8/syscall.h>
-#include <b8/misc.h>
\ No newline at end of file
+#include <b8/misc.h>
+#include <b8/romfs.h>
+#include <b8/prof.h>
\ No newline at end of file
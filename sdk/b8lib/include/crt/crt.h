@@ -30,6 +30,7 @@ typedef struct
   void*   d_priv;     ///< Driver-specific private data
   uint8_t used;       ///< Flag indicating if the file is in use
   int     mode;       ///< Access mode for the file
+  const char* name;   ///< Path below the mount point. Valid only during open()
 } File;
 
 /**
@@ -49,6 +50,16 @@ typedef struct
 } file_operations;
 
 #define N_MAX_PATH  (32)
+
+/**
+ * @brief IOCTL command issued by fstat().
+ *
+ * The argument is a zero-filled struct stat. A driver that supports fstat()
+ * fills it in, setting st_mode. If st_mode is still zero afterwards, fstat()
+ * fails with EBADF.
+ */
+#define FS_IOCTL_FSTAT  (0x46530001)
+
 /**
  * @brief Represents a file system driver.
  * 
@@ -67,6 +78,10 @@ typedef struct {
  * 
  * This function registers a new file system driver with the specified path,
  * file operations, access mode, and private data.
+ *
+ * A path that ends with '/' registers a mount point. open() then accepts any
+ * path that starts with it. Each open gets its own file descriptor, and
+ * File::name points at the rest of the path while the driver's open() runs.
  * 
  * @param path The path managed by the driver.
  * @param fops The file operations supported by the driver.
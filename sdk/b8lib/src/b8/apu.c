@@ -0,0 +1,247 @@
+#include <beep8.h>
+#include <string.h>
+
+#define CHKOVL() _ASSERT( cmd_->sp <= cmd_->tail , "apu cmd overflow" )
+
+#if B8_APU_MOCK
+volatile u32  b8ApuMockRegs[ 4 ];
+static  u32   _capture[ B8_APU_MOCK_CAPTURE_WORDS ];
+static  u32   _capture_num;
+static  u32   _exec_count;
+#endif
+
+// The command that sets each B8_APU_REG_* register, and the bits of its value.
+static  const struct {
+  u8  code;
+  u32 mask;
+} _regs[ B8_APU_REG_NUM ] = {
+  { B8_APU_CMD_ATTACKTIME  , B8_APU_TIME_MAX },
+  { B8_APU_CMD_ATTACKAMP   , B8_APU_AMP_MAX  },
+  { B8_APU_CMD_DECAYTIME   , B8_APU_TIME_MAX },
+  { B8_APU_CMD_SUSTAINTIME , B8_APU_TIME_MAX },
+  { B8_APU_CMD_SUSTAINAMP  , B8_APU_AMP_MAX  },
+  { B8_APU_CMD_RELEASETIME , B8_APU_TIME_MAX },
+  { B8_APU_CMD_SETFREQ     , B8_APU_FREQ_MAX },
+  { B8_APU_CMD_SETWAVTYPE  , 0x7             },
+  { B8_APU_CMD_TRACKVOL    , B8_APU_AMP_MAX  },
+};
+
+void  b8ApuShadowReset( b8ApuShadow* shadow_ ){
+  memset( shadow_ , 0 , sizeof(*shadow_) );
+}
+
+void  b8ApuCmdSetBuff( b8ApuCmd* cmd_ , u32* buff_ , u32 bytesize_ ){
+  cmd_->sp = cmd_->buff = buff_;
+  cmd_->bytesize = bytesize_;
+  cmd_->tail = cmd_->sp + bytesize_ / sizeof(u32);
+}
+
+void  b8ApuCmdPush( b8ApuCmd* cmd_ , u32 word_ ){
+  _ASSERT( cmd_->sp < cmd_->tail , "apu cmd overflow" );
+  *( cmd_->sp++ ) = word_;
+}
+
+// Every command is one word; the reserved bits and the fields start at 0.
+static  u32*  _alloc( b8ApuCmd* cmd_ , u32 code_ ){
+  u32* pp = cmd_->sp++;
+  CHKOVL();
+  *pp = code_ << 24;
+  return pp;
+}
+
+b8ApuNop* b8ApuNopAlloc( b8ApuCmd* cmd_ ){
+  return (b8ApuNop*)_alloc( cmd_ , B8_APU_CMD_NOP );
+}
+
+b8ApuHalt* b8ApuHaltAlloc( b8ApuCmd* cmd_ ){
+  return (b8ApuHalt*)_alloc( cmd_ , B8_APU_CMD_HALT );
+}
+
+b8ApuAttack* b8ApuAttackAlloc( b8ApuCmd* cmd_ ){
+  return (b8ApuAttack*)_alloc( cmd_ , B8_APU_CMD_ATTACK );
+}
+
+b8ApuTime* b8ApuAttacktimeAlloc( b8ApuCmd* cmd_ ){
+  return (b8ApuTime*)_alloc( cmd_ , B8_APU_CMD_ATTACKTIME );
+}
+
+b8ApuAmp* b8ApuAttackampAlloc( b8ApuCmd* cmd_ ){
+  return (b8ApuAmp*)_alloc( cmd_ , B8_APU_CMD_ATTACKAMP );
+}
+
+b8ApuTime* b8ApuDecaytimeAlloc( b8ApuCmd* cmd_ ){
+  return (b8ApuTime*)_alloc( cmd_ , B8_APU_CMD_DECAYTIME );
+}
+
+b8ApuTime* b8ApuSustaintimeAlloc( b8ApuCmd* cmd_ ){
+  return (b8ApuTime*)_alloc( cmd_ , B8_APU_CMD_SUSTAINTIME );
+}
+
+b8ApuAmp* b8ApuSustainampAlloc( b8ApuCmd* cmd_ ){
+  return (b8ApuAmp*)_alloc( cmd_ , B8_APU_CMD_SUSTAINAMP );
+}
+
+b8ApuTime* b8ApuReleasetimeAlloc( b8ApuCmd* cmd_ ){
+  return (b8ApuTime*)_alloc( cmd_ , B8_APU_CMD_RELEASETIME );
+}
+
+b8ApuSetfreq* b8ApuSetfreqAlloc( b8ApuCmd* cmd_ ){
+  return (b8ApuSetfreq*)_alloc( cmd_ , B8_APU_CMD_SETFREQ );
+}
+
+b8ApuSetwavtype* b8ApuSetwavtypeAlloc( b8ApuCmd* cmd_ ){
+  return (b8ApuSetwavtype*)_alloc( cmd_ , B8_APU_CMD_SETWAVTYPE );
+}
+
+b8ApuTrackvol* b8ApuTrackvolAlloc( b8ApuCmd* cmd_ ){
+  return (b8ApuTrackvol*)_alloc( cmd_ , B8_APU_CMD_TRACKVOL );
+}
+
+int   b8ApuSetReg( b8ApuCmd* cmd_ , u32 ch_ , u32 reg_ , u32 value_ ){
+  _ASSERT( ch_ < B8_APU_MAX_CH && reg_ < B8_APU_REG_NUM , "apu bad register" );
+  _ASSERT( ( value_ & ~_regs[ reg_ ].mask ) == 0 , "apu value out of range" );
+
+  b8ApuShadow* shadow = cmd_->shadow;
+  if( shadow ){
+    const u32 bit = 1u << reg_;
+    if( (shadow->known[ ch_ ] & bit) && shadow->val[ ch_ ][ reg_ ] == value_ ){
+      ++shadow->dropped;
+      return 0;
+    }
+    shadow->known[ ch_ ] |= bit;
+    shadow->val[ ch_ ][ reg_ ] = value_;
+    ++shadow->written;
+  }
+
+  // Every register command has TRACK in bits 22:20 and its value from bit 0.
+  *_alloc( cmd_ , _regs[ reg_ ].code ) |= ( ch_ << 20 ) | value_;
+  return 1;
+}
+
+int   b8ApuSetAttacktime( b8ApuCmd* cmd_ , u32 ch_ , u32 time_ ){
+  return b8ApuSetReg( cmd_ , ch_ , B8_APU_REG_ATTACKTIME , time_ );
+}
+
+int   b8ApuSetAttackamp( b8ApuCmd* cmd_ , u32 ch_ , u32 amp_ ){
+  return b8ApuSetReg( cmd_ , ch_ , B8_APU_REG_ATTACKAMP , amp_ );
+}
+
+int   b8ApuSetDecaytime( b8ApuCmd* cmd_ , u32 ch_ , u32 time_ ){
+  return b8ApuSetReg( cmd_ , ch_ , B8_APU_REG_DECAYTIME , time_ );
+}
+
+int   b8ApuSetSustaintime( b8ApuCmd* cmd_ , u32 ch_ , u32 time_ ){
+  return b8ApuSetReg( cmd_ , ch_ , B8_APU_REG_SUSTAINTIME , time_ );
+}
+
+int   b8ApuSetSustainamp( b8ApuCmd* cmd_ , u32 ch_ , u32 amp_ ){
+  return b8ApuSetReg( cmd_ , ch_ , B8_APU_REG_SUSTAINAMP , amp_ );
+}
+
+int   b8ApuSetReleasetime( b8ApuCmd* cmd_ , u32 ch_ , u32 time_ ){
+  return b8ApuSetReg( cmd_ , ch_ , B8_APU_REG_RELEASETIME , time_ );
+}
+
+int   b8ApuSetFreq( b8ApuCmd* cmd_ , u32 ch_ , u32 freq_ ){
+  return b8ApuSetReg( cmd_ , ch_ , B8_APU_REG_SETFREQ , freq_ );
+}
+
+int   b8ApuSetWavtype( b8ApuCmd* cmd_ , u32 ch_ , u32 wavtype_ ){
+  return b8ApuSetReg( cmd_ , ch_ , B8_APU_REG_SETWAVTYPE , wavtype_ );
+}
+
+int   b8ApuSetTrackvol( b8ApuCmd* cmd_ , u32 ch_ , u32 vol_ ){
+  return b8ApuSetReg( cmd_ , ch_ , B8_APU_REG_TRACKVOL , vol_ );
+}
+
+void  b8ApuExec( b8ApuCmd* cmd_ ){
+  CHKOVL();
+#if B8_APU_MOCK
+  const u32 num = (u32)( cmd_->sp - cmd_->buff );
+  const u32 room = B8_APU_MOCK_CAPTURE_WORDS - _capture_num;
+  memcpy( &_capture[ _capture_num ] , cmd_->buff , sizeof(u32) * ( num < room ? num : room ) );
+  _capture_num += num < room ? num : room;
+  ++_exec_count;
+#endif
+  __asm("nop");
+  B8_APU_EXEC = (B8_APU_EXEC_START<<24) | ( (u32) cmd_->buff & B8_APU_EXEC_ADDR_MASK );
+  __asm("nop");
+}
+
+#if B8_APU_MOCK
+b8ApuFence  b8ApuExecFence( b8ApuCmd* cmd_ ){
+  b8ApuExec( cmd_ );
+  return  0;
+}
+
+int   b8ApuFenceDone( b8ApuFence fence_ ){
+  (void)fence_;
+  return  1;
+}
+
+u32   b8ApuMockGetCapture( const u32** words_ ){
+  *words_ = _capture;
+  return  _capture_num;
+}
+
+u32   b8ApuMockGetExecCount( void ){
+  return  _exec_count;
+}
+
+void  b8ApuMockClear( void ){
+  _capture_num = 0;
+  _exec_count = 0;
+  for( size_t nn=0 ; nn < sizeof(b8ApuMockRegs)/sizeof(b8ApuMockRegs[0]) ; ++nn ){
+    b8ApuMockRegs[ nn ] = 0;
+  }
+}
+#else
+b8ApuFence  b8ApuExecFence( b8ApuCmd* cmd_ ){
+  b8ApuExec( cmd_ );
+  // Sampled after the kick: a V-blank serviced in between only makes the fence conservative.
+  return  b8SysGetIrqCount( B8_IRQ_VBLK );
+}
+
+int   b8ApuFenceDone( b8ApuFence fence_ ){
+  return  b8SysGetIrqCount( B8_IRQ_VBLK ) != fence_;
+}
+#endif
+
+void  b8ApuFenceWait( b8ApuFence fence_ ){
+  while( !b8ApuFenceDone( fence_ ) ){
+    const int res = b8SysIrqClearAndWait( B8_IRQ_VBLK );
+    _ASSERT( res >= 0 , "apu fence: V-blank wait failed" );
+  }
+}
+
+void  b8ApuCmdPairInit( b8ApuCmdPair* pair_ , u32* buff0_ , u32* buff1_ , u32 bytesize_ ){
+  pair_->buff[0] = buff0_;
+  pair_->buff[1] = buff1_;
+  pair_->bytesize = bytesize_;
+  pair_->back = 0;
+
+  // Neither buffer is in flight yet, so start with already signaled fences.
+#if B8_APU_MOCK
+  pair_->fence[0] = pair_->fence[1] = 0;
+#else
+  pair_->fence[0] = pair_->fence[1] = b8SysGetIrqCount( B8_IRQ_VBLK ) - 1;
+#endif
+}
+
+void  b8ApuCmdPairBegin( b8ApuCmdPair* pair_ , b8ApuCmd* cmd_ ){
+  b8ApuFenceWait( pair_->fence[ pair_->back ] );
+  b8ApuCmdSetBuff( cmd_ , pair_->buff[ pair_->back ] , pair_->bytesize );
+}
+
+void  b8ApuCmdPairSubmit( b8ApuCmdPair* pair_ , b8ApuCmd* cmd_ ){
+  _ASSERT( cmd_->buff == pair_->buff[ pair_->back ] , "not the back buffer" );
+
+  b8ApuFenceWait( pair_->fence[ pair_->back ^ 1 ] );
+  pair_->fence[ pair_->back ] = b8ApuExecFence( cmd_ );
+  pair_->back ^= 1;
+}
+
+void  b8ApuCmdPairSync( b8ApuCmdPair* pair_ ){
+  b8ApuFenceWait( pair_->fence[0] );
+  b8ApuFenceWait( pair_->fence[1] );
+}
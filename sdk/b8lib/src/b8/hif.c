@@ -1,25 +1,56 @@
 #include <beep8.h>
 #include <string.h>
-#include <unistd.h>
 #include <errno.h>
 
 #define B8_HIF_SCI_CH (15)
-static  sem_t             _sem_touch;
-static  b8HifEvents       _touch_events;
+#define B8_HIF_EV_BYTES (6)   // type, identifier, x lo, x hi, y lo, y hi
+#define B8_HIF_EVENT_RING_MASK  (B8_HIF_EVENT_RING-1)
+
+#if B8_HIF_EVENT_RING & B8_HIF_EVENT_RING_MASK
+#error B8_HIF_EVENT_RING must be a power of two.
+#endif
+
+/*
+  Events go from the receive thread to one consumer through a ring. Each side
+  writes only its own index, so neither takes a lock or makes a syscall.
+  There is one CPU and threads switch only on kernel entry, so a compiler
+  barrier is enough to order the slots and the indices.
+*/
+static  b8HifEvent        _ev_ring[ B8_HIF_EVENT_RING ];
+static  u32               _ev_stamp[ B8_HIF_EVENT_RING ];  // CYCCNT when each event was taken
+static  volatile u32      _ev_head;       // written by the receive thread only
+static  volatile u32      _ev_tail;       // written by the consumer only
+static  volatile u32      _ev_dropped;    // events lost to a full ring
+static  u32               _touch_latency;
 static  b8HifMouseStatus  _mouse_status;
 static  u16               _latest_identifier = 0xffff;
+static  u8                _rx[ B8_HIF_EV_BYTES ];   // an event split across passes
+static  u8                _rx_len;
+
+#define _b8HifBarrier() __asm__ volatile( "" ::: "memory" )
+
+size_t  b8HifPeekEvents(const b8HifEvent** events){
+  const u32 tail = _ev_tail;
+  const u32 num = _ev_head - tail;
+  _b8HifBarrier();
+  const u32 idx = tail & B8_HIF_EVENT_RING_MASK;
+  const u32 contiguous = B8_HIF_EVENT_RING - idx;
+  if( events ){
+    *events = &_ev_ring[ idx ];
+  }
+  return  num < contiguous ? num : contiguous;
+}
 
-static  u8  _b8HifRecvSci(void){
-  while( 0 == B8_FIFO_SCI_RX_LEN( B8_HIF_SCI_CH ) ) usleep(7000);
-  return  (u8)B8_FIFO_SCI_RX( B8_HIF_SCI_CH );
+void  b8HifCommitEvents(size_t num){
+  if( 0 == num ) return;
+  const u32 tail = _ev_tail;
+  _touch_latency = B8_DWT_CYCCNT - _ev_stamp[ tail & B8_HIF_EVENT_RING_MASK ];
+  _b8HifBarrier();
+  _ev_tail = tail + num;
 }
 
-static  void  _b8HifEventPushBack( b8HifEvent* ev ){
-  if( sem_wait(&_sem_touch) < 0 ) return;
-  if (_touch_events.num < B8_HIF_MAX_TOUCH_EVENTS) {
-    _touch_events.events[_touch_events.num++] = *ev;
-  }
-  sem_post(&_sem_touch);
+u32 b8HifGetDroppedEvents(void){
+  return  _ev_dropped;
 }
 
 int b8HifGetEvents(b8HifEvents* result) {
@@ -29,99 +60,120 @@ int b8HifGetEvents(b8HifEvents* result) {
   }
   result->num = 0;
 
-  int ret = sem_wait(&_sem_touch);
-  if (ret < 0) return ret;
-
-  result->num = _touch_events.num;
-  if( result->num > 0 ){
-    memcpy(result->events, _touch_events.events, result->num * sizeof(b8HifEvent));
+  // The ring may wrap, so take it in up to two spans.
+  const b8HifEvent* events;
+  size_t num;
+  while(
+    result->num < B8_HIF_MAX_TOUCH_EVENTS &&
+    0 != (num = b8HifPeekEvents( &events ))
+  ){
+    if( num > B8_HIF_MAX_TOUCH_EVENTS - result->num ){
+      num = B8_HIF_MAX_TOUCH_EVENTS - result->num;
+    }
+    memcpy(&result->events[ result->num ], events, num * sizeof(b8HifEvent));
+    result->num += num;
+    b8HifCommitEvents( num );
   }
+  return 0;
+}
 
-  _touch_events.num = 0;
+u32 b8HifGetLatency(void){
+  return  _touch_latency;
+}
 
-  ret = sem_post(&_sem_touch);
-  if( ret < 0 ) return ret;
+static  int   _b8HifIsEventType( u8 type ){
+  return  type >= B8_HIF_EV_TOUCH_START && type <= B8_HIF_EV_MOUSE_HOVER_MOVE;
+}
 
-  return 0;
+static  void  _b8HifDecode( const u8* rx , b8HifEvent* ev ){
+  const b8HifEventType type = (b8HifEventType)rx[0];
+  ev->type = type;
+  ev->identifier = rx[1];
+  if( type == B8_HIF_EV_TOUCH_START ){
+    _latest_identifier = ev->identifier;
+  }
+  ev->xp = (rx[3]<<8) | rx[2];
+  ev->yp = (rx[5]<<8) | rx[4];
+
+  switch( type ){
+    case  B8_HIF_EV_MOUSE_DOWN:
+    case  B8_HIF_EV_MOUSE_MOVE:
+    case  B8_HIF_EV_MOUSE_UP:
+      _mouse_status.mouse_x = ev->xp;
+      _mouse_status.mouse_y = ev->yp;
+      break;
+
+    case  B8_HIF_EV_TOUCH_START:
+    case  B8_HIF_EV_TOUCH_MOVE:
+    case  B8_HIF_EV_TOUCH_END:{
+      if( _latest_identifier == ev->identifier ){
+        _mouse_status.mouse_x = ev->xp;
+        _mouse_status.mouse_y = ev->yp;
+        _mouse_status.is_dragging = (type == B8_HIF_EV_TOUCH_END) ? 0:1;
+      }
+    }break;
+
+    case  B8_HIF_EV_MOUSE_HOVER_MOVE:
+      _mouse_status.mouse_x = ev->xp;
+      _mouse_status.mouse_y = ev->yp;
+      break;
+
+    default:  break;
+  }
+
+  if( type == B8_HIF_EV_MOUSE_DOWN ){
+    _mouse_status.is_dragging = 1;
+  } else if ( type == B8_HIF_EV_MOUSE_UP ){
+    _mouse_status.is_dragging = 0;
+  }
 }
 
+// Takes every byte in the FIFO, decoding each event into its ring slot in place.
+static  void  _b8HifDrainSci(void){
+  u32 len;
+  while( 0 != (len = B8_FIFO_SCI_RX_LEN( B8_HIF_SCI_CH )) ){
+    while( len-- ){
+      const u8 byte = (u8)B8_FIFO_SCI_RX( B8_HIF_SCI_CH );
+      if( 0 == _rx_len && !_b8HifIsEventType( byte ) ) continue;
+
+      _rx[ _rx_len++ ] = byte;
+      if( _rx_len < B8_HIF_EV_BYTES ) continue;
+      _rx_len = 0;
+
+      const u32 head = _ev_head;
+      if( head - _ev_tail == B8_HIF_EVENT_RING ){
+        // Full: the event is lost, but the mouse status still follows it.
+        b8HifEvent ev;
+        _b8HifDecode( _rx , &ev );
+        ++_ev_dropped;
+        continue;
+      }
+      const u32 idx = head & B8_HIF_EVENT_RING_MASK;
+      _b8HifDecode( _rx , &_ev_ring[ idx ] );
+      _ev_stamp[ idx ] = B8_DWT_CYCCNT;
+      _b8HifBarrier();
+      _ev_head = head + 1;
+    }
+  }
+}
+
+/*
+  The SCI has no receive interrupt, so the FIFO is drained at every V-blank.
+  This thread runs above the default priority: it is done before a main loop
+  woken by the same V-blank reads the events.
+*/
 static  void* _b8HifRecvThread(void* arg ){
   (void)arg;
 
-  sem_wait( &_sem_touch );
-  memset( &_touch_events, 0x00 , sizeof( b8HifEvents ) );
-  _touch_events.num = 0;
-  sem_post( &_sem_touch );
-
   B8_HIF_TOUCH_CONNECT = B8_HIF_SCI_CH;
   B8_HIF_TOUCH_CTRL = 1;
 
+  b8SysSetupIrqWait( B8_IRQ_VBLK );
   while(1){
-    const b8HifEventType type = (b8HifEventType)_b8HifRecvSci();
-
-    switch( type ){
-      case  B8_HIF_EV_TOUCH_START:
-      case  B8_HIF_EV_TOUCH_MOVE:
-      case  B8_HIF_EV_TOUCH_CANCEL:
-      case  B8_HIF_EV_TOUCH_END:
-
-      case  B8_HIF_EV_MOUSE_DOWN:
-      case  B8_HIF_EV_MOUSE_MOVE:
-      case  B8_HIF_EV_MOUSE_UP:
-      case  B8_HIF_EV_MOUSE_HOVER_MOVE:
-      {
-        b8HifEvent ev;
-        ev.type = type;
-        ev.identifier = _b8HifRecvSci();
-        if( type == B8_HIF_EV_TOUCH_START ){
-          _latest_identifier = ev.identifier;
-        }
-
-        const u16 xlo = _b8HifRecvSci();
-        const u16 xhi = _b8HifRecvSci();
-        ev.xp = (xhi<<8) | xlo;
-
-        const u16 ylo = _b8HifRecvSci();
-        const u16 yhi = _b8HifRecvSci();
-        ev.yp = (yhi<<8) | ylo;
-
-        switch( type ){
-          case  B8_HIF_EV_MOUSE_DOWN:
-          case  B8_HIF_EV_MOUSE_MOVE:
-          case  B8_HIF_EV_MOUSE_UP:
-            _mouse_status.mouse_x = ev.xp;
-            _mouse_status.mouse_y = ev.yp;
-            break;
-
-          case  B8_HIF_EV_TOUCH_START:
-          case  B8_HIF_EV_TOUCH_MOVE:
-          case  B8_HIF_EV_TOUCH_END:{
-            if( _latest_identifier == ev.identifier ){
-              _mouse_status.mouse_x = ev.xp;
-              _mouse_status.mouse_y = ev.yp;
-              _mouse_status.is_dragging = (type == B8_HIF_EV_TOUCH_END) ? 0:1;
-            }
-          }break;
-
-          case  B8_HIF_EV_MOUSE_HOVER_MOVE:
-            _mouse_status.mouse_x = ev.xp;
-            _mouse_status.mouse_y = ev.yp;
-            break;
-
-          default:  break;
-        }
-
-        if( type == B8_HIF_EV_MOUSE_DOWN ){
-          _mouse_status.is_dragging = 1;
-        } else if ( type == B8_HIF_EV_MOUSE_UP ){
-          _mouse_status.is_dragging = 0;
-        }
-
-        _b8HifEventPushBack( &ev );
-      }break;
-
-      default:break;
-    }
+    _b8HifDrainSci();
+    // Not b8SysIrqWait(), which would overwrite the V-blank latency of the main loop,
+    // and would take the V-blank events kept for it.
+    b8OsSysCall( B8_OS_SYSCALL_IRQ_WAIT, B8_IRQ_VBLK, B8_OS_IRQ_WAIT_OBSERVE, 0,0,0,0 );
   }
   return NULL;
 }
@@ -144,13 +196,16 @@ int  b8HifReset(void){
     _mouse_status.mouse_x = _mouse_status.mouse_y = 0;
     _mouse_status.is_dragging = 0;
 
-    int ret = sem_init(&_sem_touch,0,1);
-    if( ret < 0 ) return ret;
+    _ev_head = _ev_tail = 0;
+    _ev_dropped = 0;
 
     pthread_t pid;
     pthread_attr_t attr;
     pthread_attr_init(&attr);
     pthread_attr_setstacksize(&attr, 0x1000);
+    struct sched_param param;
+    param.sched_priority = B8_OS_PRIORITY_DEFAULT + 1;
+    pthread_attr_setschedparam(&attr, &param);
     return  pthread_create(
       &pid,
       &attr,
@@ -0,0 +1,297 @@
+#include <b8/pthread.h>
+#include <b8/os.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/errno.h>
+
+#define FUTEX_WAKE_ALL  (0xffffffff)
+
+// SWP is the only atomic read-modify-write of ARMv4.
+static  inline  u32 _swap( volatile u32* word , u32 value ){
+  u32 old;
+  __asm__ volatile( "swp %0, %2, [%1]" : "=&r"(old) : "r"(word), "r"(value) : "memory" );
+  return  old;
+}
+
+static  int   _futex_wait( volatile u32* word , u32 value , const struct timespec* abstime , u32 flags ){
+  b8OsBridgeUsr2Svc* bridge = b8OsSysCall(
+    B8_OS_SYSCALL_FUTEX_WAIT,
+    (u32)(uintptr_t)word,
+    value,
+    flags | ( abstime ? B8_OS_FUTEX_TIMED : 0 ),
+    abstime ? (u32)abstime->tv_sec  : 0,
+    abstime ? (u32)abstime->tv_nsec : 0,
+    0
+  );
+  return  - bridge->errcode;
+}
+
+static  void  _futex_wake( volatile u32* word , u32 num , u32 flags ){
+  b8OsSysCall( B8_OS_SYSCALL_FUTEX_WAKE, (u32)(uintptr_t)word, num, flags, 0,0,0 );
+}
+
+/*
+  Only a swap is available, so the word may be set to 1 for a moment while it
+  is 2. The thread that does it either takes the lock in the loop below,
+  setting 2 again, or sleeps; the unlock that follows wakes the next sleeper.
+*/
+static  int   _lock_word( volatile u32* lock , const struct timespec* abstime ){
+  if( 0 == _swap( lock , 1 ) )  return  0;
+
+  while( 0 != _swap( lock , 2 ) ){
+    const int ret = _futex_wait( lock , 2 , abstime , 0 );
+    if( ret && ret != EAGAIN )  return  ret;
+  }
+  return  0;
+}
+
+static  void  _unlock_word( volatile u32* lock ){
+  if( 2 == _swap( lock , 0 ) ){
+    _futex_wake( lock , 1 , 0 );
+  }
+}
+
+static  int   _owns( const pthread_mutex_t* mutex , pthread_t self ){
+  return  mutex->lock && mutex->owner == self;
+}
+
+static  int   _mutex_lock( pthread_mutex_t* mutex , const struct timespec* abstime ){
+  if( !mutex ){
+    return  EINVAL;
+  }
+
+  const pthread_t self = pthread_self();
+  if( _owns( mutex , self ) ){
+    if( mutex->type == PTHREAD_MUTEX_ERRORCHECK ) return  EDEADLK;
+    if( mutex->type == PTHREAD_MUTEX_RECURSIVE ){
+      if( mutex->count == 0xffff )  return  EAGAIN;
+      ++mutex->count;
+      return  0;
+    }
+  }
+
+  const int ret = _lock_word( &mutex->lock , abstime );
+  if( ret ){
+    return  ret;
+  }
+  mutex->owner = self;
+  mutex->count = 1;
+  return  0;
+}
+
+int pthread_mutexattr_init(pthread_mutexattr_t* attr){
+  if( !attr ){
+    return  EINVAL;
+  }
+  attr->type = PTHREAD_MUTEX_DEFAULT;
+  return  0;
+}
+
+int pthread_mutexattr_destroy(pthread_mutexattr_t* attr){
+  if( !attr ){
+    return  EINVAL;
+  }
+  memset( attr, 0, sizeof(pthread_mutexattr_t) );
+  return  0;
+}
+
+int pthread_mutexattr_settype(pthread_mutexattr_t* attr, int type){
+  if( !attr ){
+    return  EINVAL;
+  }
+  switch( type ){
+    case  PTHREAD_MUTEX_NORMAL:
+    case  PTHREAD_MUTEX_RECURSIVE:
+    case  PTHREAD_MUTEX_ERRORCHECK:
+      break;
+    default:
+      return  EINVAL;
+  }
+  attr->type = (u8)type;
+  return  0;
+}
+
+int pthread_mutexattr_gettype(const pthread_mutexattr_t* attr, int* type){
+  if( !attr || !type ){
+    return  EINVAL;
+  }
+  *type = attr->type;
+  return  0;
+}
+
+int pthread_mutex_init(pthread_mutex_t* mutex, const pthread_mutexattr_t* attr){
+  if( !mutex ){
+    return  EINVAL;
+  }
+  memset( mutex, 0, sizeof(pthread_mutex_t) );
+  mutex->owner = B8_OS_INVALID_PID;
+  mutex->type  = attr ? attr->type : PTHREAD_MUTEX_DEFAULT;
+  return  0;
+}
+
+int pthread_mutex_destroy(pthread_mutex_t* mutex){
+  if( !mutex ){
+    return  EINVAL;
+  }
+  if( mutex->lock ){
+    return  EBUSY;
+  }
+  return  0;
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex){
+  return  _mutex_lock( mutex , NULL );
+}
+
+int pthread_mutex_timedlock(pthread_mutex_t* mutex, const struct timespec* abstime){
+  if( !abstime ){
+    return  EINVAL;
+  }
+  return  _mutex_lock( mutex , abstime );
+}
+
+int pthread_mutex_trylock(pthread_mutex_t* mutex){
+  if( !mutex ){
+    return  EINVAL;
+  }
+
+  const pthread_t self = pthread_self();
+  if( _owns( mutex , self ) ){
+    if( mutex->type != PTHREAD_MUTEX_RECURSIVE )  return  EBUSY;
+    if( mutex->count == 0xffff )  return  EAGAIN;
+    ++mutex->count;
+    return  0;
+  }
+
+  // Writing 1 over 2 would hide the sleepers from the owner; put 2 back.
+  u32 old = _swap( &mutex->lock , 1 );
+  if( 2 == old ){
+    old = _swap( &mutex->lock , 2 );
+  }
+  if( old ){
+    return  EBUSY;
+  }
+  mutex->owner = self;
+  mutex->count = 1;
+  return  0;
+}
+
+int pthread_mutex_unlock(pthread_mutex_t* mutex){
+  if( !mutex ){
+    return  EINVAL;
+  }
+  if( !_owns( mutex , pthread_self() ) ){
+    return  EPERM;
+  }
+
+  if( --mutex->count ){
+    return  0;
+  }
+  mutex->owner = B8_OS_INVALID_PID;
+  _unlock_word( &mutex->lock );
+  return  0;
+}
+
+int pthread_condattr_init(pthread_condattr_t* attr){
+  if( !attr ){
+    return  EINVAL;
+  }
+  memset( attr, 0, sizeof(pthread_condattr_t) );
+  return  0;
+}
+
+int pthread_condattr_destroy(pthread_condattr_t* attr){
+  if( !attr ){
+    return  EINVAL;
+  }
+  return  0;
+}
+
+int pthread_cond_init(pthread_cond_t* cond, const pthread_condattr_t* attr){
+  (void)attr;
+  if( !cond ){
+    return  EINVAL;
+  }
+  memset( cond, 0, sizeof(pthread_cond_t) );
+  return  0;
+}
+
+int pthread_cond_destroy(pthread_cond_t* cond){
+  if( !cond ){
+    return  EINVAL;
+  }
+  if( cond->waiters ){
+    return  EBUSY;
+  }
+  return  0;
+}
+
+static  int   _cond_wait( pthread_cond_t* cond , pthread_mutex_t* mutex , const struct timespec* abstime ){
+  if( !cond || !mutex ){
+    return  EINVAL;
+  }
+  const pthread_t self = pthread_self();
+  if( !_owns( mutex , self ) ){
+    return  EPERM;
+  }
+
+  // seq is read under the mutex, so a signal sent after the mutex is released
+  // changes it, and the kernel refuses to sleep on the old value.
+  ++cond->waiters;
+  const u32 seq = cond->seq;
+  const u16 count = mutex->count;
+  mutex->owner = B8_OS_INVALID_PID;
+  mutex->count = 0;
+  _unlock_word( &mutex->lock );
+
+  int ret = _futex_wait( &cond->seq , seq , abstime , B8_OS_FUTEX_CANCEL );
+  if( ret == EAGAIN ){
+    ret = 0;
+  }
+
+  // A broadcast wakes every waiter at once, and all but one sleep on the mutex.
+  while( 0 != _swap( &mutex->lock , 2 ) ){
+    _futex_wait( &mutex->lock , 2 , NULL , 0 );
+  }
+  --cond->waiters;
+  if( ret == ECANCELED ){
+    // No cleanup handlers would unlock the mutex for a canceled thread.
+    _unlock_word( &mutex->lock );
+    pthread_exit( PTHREAD_CANCELED );
+  }
+  mutex->owner = self;
+  mutex->count = count;
+  return  ret;
+}
+
+int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex){
+  return  _cond_wait( cond , mutex , NULL );
+}
+
+int pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* abstime){
+  if( !abstime ){
+    return  EINVAL;
+  }
+  return  _cond_wait( cond , mutex , abstime );
+}
+
+// The kernel increments seq, so signals sent without the mutex are not lost to each other.
+int pthread_cond_signal(pthread_cond_t* cond){
+  if( !cond ){
+    return  EINVAL;
+  }
+  if( cond->waiters ){
+    _futex_wake( &cond->seq , 1 , B8_OS_FUTEX_INC );
+  }
+  return  0;
+}
+
+int pthread_cond_broadcast(pthread_cond_t* cond){
+  if( !cond ){
+    return  EINVAL;
+  }
+  if( cond->waiters ){
+    _futex_wake( &cond->seq , FUTEX_WAKE_ALL , B8_OS_FUTEX_INC );
+  }
+  return  0;
+}
@@ -3,15 +3,17 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/errno.h>
+#include "stack.h"
 
 #define CONFIG_N_MAX_THREAD_POW2      (5)
-#define CONFIG_BYTESIZE_OF_HEAP       (8*1024)
 #define CONFIG_N_MAX_SEMAPHORE_POW2   (6)
 #define CONFIG_BYTESIZE_OF_STACK_IDLE_THREAD  (0x100)
 #define CONFIG_BYTESIZE_OF_STACK_MAIN_THREAD  (0x2000)
 
 #define N_MAX_THREAD    (1<<CONFIG_N_MAX_THREAD_POW2)
+#define N_PRIORITY      (B8_OS_PRIORITY_MAX+1)
 #define N_MAX_SEMAPHORE (1<<CONFIG_N_MAX_SEMAPHORE_POW2)
+#define N_FUTEX_QUEUE   (16)    // futex waiters hashed by address
 
 #define B8_OS_BRIDGE_USR2SVC_SIGNATURE  (0xbeafface)
 
@@ -28,6 +30,7 @@
 #define REG_MAX (17)
 
 typedef u64 b8OsUsec;         // usec
+#define B8_OS_USEC_INFINITE   (0xffffffffffffffffULL)
 
 extern  void  _b8OsSvc2Usr(void);
 extern  void  _b8OsIrq2Usr(void);
@@ -117,9 +120,8 @@ static  void* _b8OsCastU32(u32 uptr ){
   return cast.data._p32;
 }
 
-typedef struct _Node        Node;
-typedef struct _List        List;
 typedef struct _Tcb         Tcb;
+typedef struct _WaitQueue   WaitQueue;
 typedef struct _Semaphore   Semaphore;
 typedef struct _ReqSchedule ReqSchedule;
 
@@ -131,11 +133,22 @@ typedef enum {
 typedef enum {
   TWF_NOTHING,
   TWF_SEMAPHORE,
-  TWF_YIELD,
   TWF_TIMER,
-  TWF_IRQ
+  TWF_IRQ,        // irq thread, woken by its irq
+  TWF_IRQ_EVENT,  // waiting in B8_OS_SYSCALL_IRQ_WAIT for irq_wait
+  TWF_FUTEX,      // waiting in B8_OS_SYSCALL_FUTEX_WAIT for futex
+  TWF_JOIN        // waiting in B8_OS_SYSCALL_THREAD_JOIN for join_pid
 } TcbWaitingFor;
 
+/*
+  Wait queue: blocked threads in FIFO order, linked through Tcb::wq_next and
+  wq_prev, so that a thread leaves its queue in O(1) however it was woken.
+*/
+struct _WaitQueue {
+  Tcb*  head;
+  Tcb*  tail;
+};
+
 struct _Tcb {
   u32       reg[ REG_MAX ];
   b8OsPid   pid;
@@ -143,18 +156,45 @@ struct _Tcb {
   void*     arg;
   void*     stack_addr;
   size_t    stack_size;
+  void*     stack_base;   // block taken from the stack pool, NULL if the user gave the stack
+  size_t    stack_block;  // bytes of stack_base
+  u8        detached;     // reclaimed at exit
+  u8        exited;       // a zombie until joined
+  u8        cancel_pending;
+  u8        futex_cancel; // the TWF_FUTEX wait is a cancellation point
+  b8OsPid   joiner;       // thread waiting to join this one
+  b8OsPid   join_pid;     // thread joined while TWF_JOIN
+  u32       exit_value;
   b8OsSid   sid_wait;
   TcbStatus status;
   TcbWaitingFor waiting_for;
   u8        mode_when_saved;  // MODE_SVC or MODE_IRQ
   u8        scheduling_policy;
   u16       irq;
+  u16       irq_wait;   // irq waited for while TWF_IRQ_EVENT
+  u32       futex;      // address of the word waited for while TWF_FUTEX
   b8OsUsec  wake_up_time;
+  u8        priority;   // B8_OS_PRIORITY_MIN .. B8_OS_PRIORITY_MAX
+  u8        ready;      // linked in _ReadyQueueHead[ priority ]
+  Tcb*      rq_next;
+  Tcb*      rq_prev;
+  u8        timed;      // linked in _TimerQueueHead
+  Tcb*      tq_next;
+  Tcb*      tq_prev;
+  WaitQueue* wq;        // queue linked in while blocked, or NULL
+  Tcb*      wq_next;
+  Tcb*      wq_prev;
+  Tcb*      free_next;  // next in _FreeTcb while the slot is free
+  b8OsCpuCycles cpu_cycles; // cycles charged while this thread was current
+  u32       switches;       // times switched in
+  u32       syscalls;       // system calls made
 };
 
 struct _Semaphore {
-  b8OsSid sid;
-  int     semcount;
+  b8OsSid     sid;
+  int         semcount;
+  WaitQueue   waiters;    // threads in TWF_SEMAPHORE for this semaphore
+  Semaphore*  free_next;  // next in _FreeSemaphore while unused
 };
 
 typedef int (*b8IrqHandler)(int irq, void* arg);
@@ -164,6 +204,16 @@ typedef struct _b8OsIrqInfo {
   void* arg;              // The argument provided to the interrupt handler
 } b8OsIrqInfo;
 
+// Per irq event for B8_OS_SYSCALL_IRQ_WAIT. Waiters are woken from the interrupt path.
+typedef struct _IrqEvent {
+  u32   waiters;  // bit n: _TaskControlBlocks[ n ] waits for this irq
+  u32   observers;  // bit n: the wait of _TaskControlBlocks[ n ] is B8_OS_IRQ_WAIT_OBSERVE
+  u32   pending;  // events that came while no thread waited to take one
+  u32   count;    // events so far
+  u32   cyccnt;   // CYCCNT when the kernel took the last event
+  WaitQueue threads;  // the irq thread while TWF_IRQ
+} IrqEvent;
+
 #define REQ_SCHEDULE_NONE                               (0)
 #define REQ_SCHEDULE_REGULAR                            (1<<1)
 #define REQ_SCHEDULE_SEMAPHORE_WAIT                     (1<<2)
@@ -172,11 +222,16 @@ typedef struct _b8OsIrqInfo {
 #define REQ_SCHEDULE_YIELD                              (1<<5)
 #define REQ_SCHEDULE_YIELD_TIME                         (1<<6)
 #define REQ_SCHEDULE_EXIT_THREAD                        (1<<7)
+#define REQ_SCHEDULE_PREEMPT                            (1<<8)
+#define REQ_SCHEDULE_IRQ_WAIT                           (1<<9)
+#define REQ_SCHEDULE_FUTEX_WAIT                         (1<<10)
+#define REQ_SCHEDULE_JOIN_WAIT                          (1<<11)
 
 struct _ReqSchedule{
   u16       req; // REQ_SCHEDULE_*
   b8OsSid   sid;
   b8OsPid   pid;
+  u32       exit_value;
   u16       irq;
   b8OsUsec  sleep_time;
 };
@@ -193,39 +248,68 @@ static  Tcb*  _b8OsGetCurrentTcb(void);
 static  Tcb*  _b8OsGetTcb( b8OsPid pid );
 static  int   _b8OsIrqDispatch(int irq, void* arg);
 static  void  _b8OsProcessScheduler(ReqSchedule* rs);
+static  void  _b8OsPreemptIfNeeded(void);
 static  b8OsBridgeUsr2Svc*  TcbGetBridge( b8OsPid pid );
 static  int   _b8OsIrqAttach(int irq,b8IrqHandler isr,void* arg);
+static  int   _b8OsIrqUse(u32 irq);
+static  void  _b8OsAwakePid( b8OsPid pid );
+static  void  _b8OsThreadTerminate( Tcb* tcb , u32 value );
+static  void  _b8OsTestCancel(void);
+static  void  _b8OsWaitAbandon( Tcb* tcb );
 static  void  _b8OsGiveBridgeToUsr(void);
 
 static  b8OsIrqInfo _IrqInfo[ B8_IRQ_NUM_OF_INTERRUPTS ];
+static  IrqEvent    _IrqEvents[ B8_IRQ_NUM_OF_INTERRUPTS ];
 static  b8OsPid     _IdlePid;
 static  b8OsPid     _CurrentPid;
 static  uint32_t    _AccThread;
 static  uint32_t    _AccSemaphore;
 static  Tcb         _TaskControlBlocks[ N_MAX_THREAD ];
 static  Semaphore   _Semaphores[ N_MAX_SEMAPHORE ];
-static  u8          _MemoryPool[ CONFIG_BYTESIZE_OF_HEAP ];
-static  u32         _UpMemoryPool;
-static  List*       _ReadyTasksList;
-static  List*       _WaitingTasksList;
-static  List*       _ZombieTasksList;
+static  Tcb*        _FreeTcb;
+static  Semaphore*  _FreeSemaphore;
+static  Tcb*        _ReadyQueueHead[ N_PRIORITY ];
+static  Tcb*        _ReadyQueueTail[ N_PRIORITY ];
+static  u32         _ReadyBitmap;   // bit n is set while _ReadyQueueHead[ n ] is not empty
+static  Tcb*        _TimerQueueHead;  // sorted by wake_up_time, earliest first
+static  WaitQueue   _FutexQueues[ N_FUTEX_QUEUE ];
 static  b8OsConfig  _Config;
-static  size_t      _UpStackPool;
+static  StackPool   _StackPool;
 static  b8OsUsec    _AccumelatedTime;
 static  u64         _UsPerCpuCycleFixed8;
 static  u16         _IrqTimer;
 static  u16         _IrqDispatched;
 static  u64         _CycCnt;
+static  u32         _CycPrev;       // CYCCNT at the last kernel entry. CYCCNT is never cleared.
+static  b8OsCpuCycles _ProcessCycles; // cycles charged to threads other than the idle thread
+static  u64         _CycSec;        // _CycCnt / CpuCyclesPerSec
+static  u32         _CycInSec;      // _CycCnt % CpuCyclesPerSec
+static  volatile b8OsTimePage _TimePage;
 static  u64         _UnixEpochTimeMilliseconds;
 static  u64         _UnixEpochTimeCycles;
 static  b8OsUsec    _UnixEpochTimeMicroseconds;
 static  u32         _ClockResolutionNs;
 static  u8          _IsRunning = 0;
+static  volatile b8OsTickHook _TickHook;
 
 u32 b8OsUsrContext   [ REG_MAX ];
 u32 b8OsSysCallArgs  [ 1+6 ];
 
+static  void  _b8OsUpdateTimePage(void){
+  const Tcb* tcb_cur = _b8OsGetTcb( _CurrentPid );
+  _TimePage.seq++;
+  _TimePage.cyccnt          = _CycPrev;
+  _TimePage.sec             = _CycSec;
+  _TimePage.cyc_in_sec      = _CycInSec;
+  _TimePage.thread_cycles   = tcb_cur ? tcb_cur->cpu_cycles : 0;
+  _TimePage.process_cycles  = _ProcessCycles;
+  _TimePage.idle            = _CurrentPid == _IdlePid;
+  _TimePage.pid             = _CurrentPid;
+  _TimePage.seq++;
+}
+
 static  void  _b8OsSwitchBackToUsr(void){
+  _b8OsUpdateTimePage();
   switch( _b8OsGetCPSRMode() ){
     case  IRQ_MODE:{
       B8_PIC_EOIR = _IrqDispatched;
@@ -240,152 +324,135 @@ static  void  _b8OsSwitchBackToUsr(void){
   // It won't get here
 }
 
-static  void*   _b8OsKernelMalloc( size_t byte_ ){
-  byte_ += 3;
-  byte_ -= byte_ & 3;
-
-  u32 up = _UpMemoryPool;
-  _UpMemoryPool += byte_;
-  KPANIC( _UpMemoryPool <= CONFIG_BYTESIZE_OF_HEAP  , "out of memory" );
-  return &_MemoryPool[ up ];
+static  void  WaitQueuePushBack( WaitQueue* wq , Tcb* tcb ){
+  KPANIC( NULL == tcb->wq , "already waiting" );
+  tcb->wq_next = NULL;
+  tcb->wq_prev = wq->tail;
+  if( wq->tail ){
+    wq->tail->wq_next = tcb;
+  } else {
+    wq->head = tcb;
+  }
+  wq->tail = tcb;
+  tcb->wq = wq;
 }
 
-static  void*   _b8OsStackAlloc( size_t byte_ ){
-  byte_ += 7;
-  byte_ -= byte_ & 7;
-
-  if( _UpStackPool + byte_ > _Config.StackSize )  return NULL;
-
-  _UpStackPool += byte_;
-  return _Config.StackTop + _UpStackPool;
+static  void  WaitQueueErase( Tcb* tcb ){
+  WaitQueue* wq = tcb->wq;
+  if( NULL == wq ) return;
+  if( tcb->wq_prev ){
+    tcb->wq_prev->wq_next = tcb->wq_next;
+  } else {
+    wq->head = tcb->wq_next;
+  }
+  if( tcb->wq_next ){
+    tcb->wq_next->wq_prev = tcb->wq_prev;
+  } else {
+    wq->tail = tcb->wq_prev;
+  }
+  tcb->wq_next = tcb->wq_prev = NULL;
+  tcb->wq = NULL;
 }
 
-struct _Node {
-  Node*   _next;
-  Node*   _prev;
-  b8OsPid pid;
-};
-static  void  NodeClear(Node* node){
-  node->_next = node->_prev = NULL;
-  node->pid = B8_OS_INVALID_PID;
+static  WaitQueue*  FutexQueue( u32 addr ){
+  return  &_FutexQueues[ (addr >> 2) & (N_FUTEX_QUEUE-1) ];
 }
 
-struct _List {
-  u16   _size;
-  u16   _maxnum;
-  Node* _node_array;
-};
-
-static  Node*   ListHead(List* list);
-static  Node*   ListEnd(List* list);
-static  Node*   ListBegin(List* list);
-static  Node*   ListAllocNode(List* list);
-static  void    ListPushBack(List* list,uint32_t x_ );
-static  Node*   ListErase(List* list,uint32_t x_ );
-static  Node*   ListBack(List* list);
-static  size_t  ListSize(List* list);
-static  List*   NewList( size_t maxnum_ );
-static  Node*   ListAt(List* list,u32 nn);
-
 /*
-  [head]->[begin]->[]->...[]->[end]
+  Ready queues: one FIFO per priority plus _ReadyBitmap, so that picking the
+  next thread is O(1). The running thread stays at the head of its queue until
+  it blocks, yields or its RR time slice expires.
 */
-static  Node* ListHead(List* list){
-  return  &(list->_node_array[0]);
-}
-
-static  Node* ListEnd(List* list){
-  return  &(list->_node_array[ list->_maxnum+2-1 ]);
-}
-
-static  Node* ListBegin(List* list){
-  return  ListHead(list)->_next;
-}
-
-static  Node* ListAllocNode(List* list){
-  for( u16 nn=0 ; nn<= list->_maxnum ; ++nn ){
-    Node* node = &(list->_node_array[ nn+1 ]);
-    if( node->_next ) continue;
-    if( node->_prev ) continue;
-    return node;
+static  void  ReadyQueuePushBack( Tcb* tcb ){
+  KPANIC( !tcb->ready , "already ready" );
+  const u8 prio = tcb->priority;
+  tcb->rq_next = NULL;
+  tcb->rq_prev = _ReadyQueueTail[ prio ];
+  if( tcb->rq_prev ){
+    tcb->rq_prev->rq_next = tcb;
+  } else {
+    _ReadyQueueHead[ prio ] = tcb;
   }
-  return NULL;
+  _ReadyQueueTail[ prio ] = tcb;
+  _ReadyBitmap |= 1u << prio;
+  tcb->ready = 1;
 }
 
-Node*   ListAt(List* list,u32 nn){
-  if( nn >= ListSize(list) )  return NULL;
-  Node* node = ListBegin( list );
-  for( u32 ii=0 ; ii<nn ; ++ii ){
-    node = node->_next;
+static  void  ReadyQueueErase( Tcb* tcb ){
+  if( !tcb->ready ) return;
+  const u8 prio = tcb->priority;
+  if( tcb->rq_prev ){
+    tcb->rq_prev->rq_next = tcb->rq_next;
+  } else {
+    _ReadyQueueHead[ prio ] = tcb->rq_next;
   }
-  return node;
-}
-
-static  void  ListPushBack(List* list,uint32_t x_ ){
-  Node* node = ListAllocNode(list);
-  KPANIC(node,"failed alloc node");
-  KPANIC( ListSize(list) < list->_maxnum , "too many container" );
-  list->_size++;
-
-  Node* end  = ListEnd(list);
-  Node* back = ListBack(list);
-  back->_next = node;
-  end->_prev  = node;
-  node->_prev = back;
-  node->_next = end;
-
-  node->pid = x_;
-}
-
-static  Node* ListErase(List* list,uint32_t x_ ){
-  Node* it;
-  for(
-    it =  ListBegin( list ) ;
-    it != ListEnd( list ) ;
-    it = it->_next
-  ){
-    if(it->pid != x_ )  continue;
-
-    Node* prev = it->_prev;
-    Node* next = it->_next;
-    prev->_next = next;
-    next->_prev = prev;
-    list->_size--;
-
-    NodeClear( it );
-    return next;
+  if( tcb->rq_next ){
+    tcb->rq_next->rq_prev = tcb->rq_prev;
+  } else {
+    _ReadyQueueTail[ prio ] = tcb->rq_prev;
+  }
+  if( NULL == _ReadyQueueHead[ prio ] ){
+    _ReadyBitmap &= ~(1u << prio);
   }
-  return it; // = ListEnd()
+  tcb->rq_next = tcb->rq_prev = NULL;
+  tcb->ready = 0;
 }
 
-static  Node*  ListBack(List* list){
-  return  ListEnd(list)->_prev;
+static  void  ReadyQueueRotate( Tcb* tcb ){
+  if( !tcb->ready ) return;
+  ReadyQueueErase( tcb );
+  ReadyQueuePushBack( tcb );
 }
 
-static  size_t  ListSize(List* list){
-  return  (size_t)list->_size;
+static  Tcb*  ReadyQueueHighest(void){
+  if( 0 == _ReadyBitmap ) return NULL;
+  return  _ReadyQueueHead[ 31 - __builtin_clz( _ReadyBitmap ) ];
 }
 
-static  List* NewList( size_t maxnum_ ){
-  List* list = _b8OsKernelMalloc( sizeof( List ) );
-  list->_size = 0;
-  list->_maxnum = maxnum_;
-  const u16 array_num = list->_maxnum+2;
-  list->_node_array = _b8OsKernelMalloc( array_num * sizeof( Node ));
-  for( uint16_t ii=0 ; ii < array_num ; ++ii ){
-    NodeClear( &(list->_node_array[ ii ]) );
+/*
+  Timer queue: threads blocked with a deadline (sleep, sem_timedwait), sorted by
+  wake_up_time on the _AccumelatedTime base. Each tick only looks at the head.
+*/
+static  void  TimerQueueInsert( Tcb* tcb ){
+  KPANIC( !tcb->timed , "already timed" );
+  Tcb* prev = NULL;
+  Tcb* next = _TimerQueueHead;
+  while( next && next->wake_up_time <= tcb->wake_up_time ){
+    prev = next;
+    next = next->tq_next;
   }
+  tcb->tq_prev = prev;
+  tcb->tq_next = next;
+  if( prev ){
+    prev->tq_next = tcb;
+  } else {
+    _TimerQueueHead = tcb;
+  }
+  if( next ){
+    next->tq_prev = tcb;
+  }
+  tcb->timed = 1;
+}
 
-  Node* head = ListHead( list );
-  Node* end = ListEnd( list );
-
-  head->_next = end;
-  head->_prev = NULL;
-
-  end->_next = NULL;
-  end->_prev = head;
+static  void  TimerQueueErase( Tcb* tcb ){
+  if( !tcb->timed ) return;
+  if( tcb->tq_prev ){
+    tcb->tq_prev->tq_next = tcb->tq_next;
+  } else {
+    _TimerQueueHead = tcb->tq_next;
+  }
+  if( tcb->tq_next ){
+    tcb->tq_next->tq_prev = tcb->tq_prev;
+  }
+  tcb->tq_next = tcb->tq_prev = NULL;
+  tcb->timed = 0;
+}
 
-  return list;
+static  Tcb*  TimerQueuePopExpired( b8OsUsec now ){
+  Tcb* tcb = _TimerQueueHead;
+  if( NULL == tcb || now < tcb->wake_up_time ) return NULL;
+  TimerQueueErase( tcb );
+  return tcb;
 }
 
 extern  int usleep(useconds_t useconds);
@@ -399,9 +466,6 @@ static  void* _b8MainThread( void* arg ){
   b8SysPuts( "_b8MainThread:\n" );
 
   (void)arg;
-  int ret = sem_init(_Config.sem_heap, 0, 1);
-  KPANIC( ret >= 0 , "sem_init()" );
-
   FILE* fpo = fopen("stdout","w");
   KPANIC( fpo  , "failed open stdout" );
 
@@ -419,8 +483,8 @@ static  void* _b8MainThread( void* arg ){
 
 static  void* _b8OsCommonEntryPoint( void* arg ){
   Tcb* tcb_cur = _b8OsGetCurrentTcb();
-  tcb_cur->start_routine( arg );
-  b8OsSysCall( B8_OS_SYSCALL_EXIT, 0, 0, 0, 0, 0,0);
+  void* value = tcb_cur->start_routine( arg );
+  b8OsSysCall( B8_OS_SYSCALL_EXIT, _b8OsCastPtr( value ), 0, 0, 0, 0,0);
   KPANIC(0, "Unexpected return from b8OsSysCall");
   return NULL;
 }
@@ -471,8 +535,21 @@ static  void  TcbClear( Tcb* tcb ){
   tcb->sid_wait = B8_OS_INVALID_SID;
   tcb->mode_when_saved = 0x00;
   tcb->irq = B8_OS_NOT_USING_IRQ;
+  tcb->irq_wait = B8_OS_NOT_USING_IRQ;
   tcb->waiting_for = TWF_NOTHING;
   tcb->wake_up_time = 0;
+  tcb->priority = B8_OS_PRIORITY_DEFAULT;
+  tcb->ready = 0;
+  tcb->rq_next = tcb->rq_prev = NULL;
+  tcb->timed = 0;
+  tcb->tq_next = tcb->tq_prev = NULL;
+  tcb->wq = NULL;
+  tcb->wq_next = tcb->wq_prev = NULL;
+  tcb->free_next = NULL;
+  tcb->stack_base = NULL;
+  tcb->stack_block = 0;
+  tcb->joiner = B8_OS_INVALID_PID;
+  tcb->join_pid = B8_OS_INVALID_PID;
 }
 
 static  b8OsBridgeUsr2Svc*  TcbGetBridgeAddr( Tcb* tcb ){
@@ -536,15 +613,25 @@ static  void  Tcb2UsrContext( Tcb* tcb ){
 }
 
 static  b8OsPid _b8OsAllocTcb(void){
-  for( size_t nn=0 ; nn<N_MAX_THREAD ; ++nn ){
-    if( _TaskControlBlocks[ nn ].pid != B8_OS_INVALID_PID )  continue;
+  Tcb* tcb = _FreeTcb;
+  if( NULL == tcb ) return  B8_OS_INVALID_PID;
+  _FreeTcb = tcb->free_next;
+
+  TcbClear( tcb );
+  tcb->pid = (_AccThread<<16) | (u32)(tcb - _TaskControlBlocks);
+  // The upper half keeps a reused slot from matching a stale pid. It is never 0.
+  if( 0 == (++_AccThread & 0xffff) ) _AccThread = 1;
+  return  tcb->pid;
+}
 
-    TcbClear( &_TaskControlBlocks[ nn ] );
-    _TaskControlBlocks[ nn ].pid = (_AccThread<<16) | (u32)nn;
-    ++_AccThread;
-    return  _TaskControlBlocks[ nn ].pid;
+static  void  _b8OsFreeTcb( Tcb* tcb ){
+  if( tcb->stack_base ){
+    StackPoolFree( &_StackPool , tcb->stack_base , tcb->stack_block );
   }
-  return  B8_OS_INVALID_PID;
+  TcbClear( tcb );
+  tcb->pid = B8_OS_INVALID_PID;
+  tcb->free_next = _FreeTcb;
+  _FreeTcb = tcb;
 }
 
 static  void  SemaphoreClear( Semaphore* sem ){
@@ -552,6 +639,12 @@ static  void  SemaphoreClear( Semaphore* sem ){
   sem->sid = B8_OS_INVALID_SID;
 }
 
+static  void  _b8OsFreeSemaphore( Semaphore* sem ){
+  SemaphoreClear( sem );
+  sem->free_next = _FreeSemaphore;
+  _FreeSemaphore = sem;
+}
+
 static  Semaphore*  _b8OsGetSemaphore( b8OsSid sid ){
   if( sid == B8_OS_INVALID_SID ) return NULL;
   const u32 idx = sid & 0x3fff;
@@ -560,18 +653,32 @@ static  Semaphore*  _b8OsGetSemaphore( b8OsSid sid ){
 }
 
 static  b8OsSid _b8OsAllocSemaphore(int value){
-  for( size_t nn=0 ; nn<N_MAX_SEMAPHORE ; ++nn ){
-    if( _Semaphores[ nn ].sid != B8_OS_INVALID_SID )  continue;
+  Semaphore* sem = _FreeSemaphore;
+  if( NULL == sem ){
+    _b8OsSetError(-EINVAL);
+    return  B8_OS_INVALID_SID;
+  }
+  _FreeSemaphore = sem->free_next;
+
+  SemaphoreClear( sem );
+  sem->semcount = value;
+  sem->sid = (_AccSemaphore<<14) | (u32)(sem - _Semaphores);
+  // As with pids, the upper bits are never 0.
+  if( 0 == (++_AccSemaphore & 0x3ffff) ) _AccSemaphore = 1;
+  return sem->sid;
+}
 
-    Semaphore* sem = &_Semaphores[ nn ];
-    SemaphoreClear( sem );
-    sem->semcount = value;
-    sem->sid = (_AccSemaphore<<14) | (u32)nn;
-    ++_AccSemaphore;
-    return sem->sid;
+static  void  _b8OsSemaphoreDestroy( b8OsSid sid ){
+  Semaphore* sem = _b8OsGetSemaphore( sid );
+  if( NULL == sem ){
+    _b8OsSetError(-EINVAL);
+    return;
+  }
+  if( sem->waiters.head ){
+    _b8OsSetError(-EBUSY);
+    return;
   }
-  _b8OsSetError(-EINVAL);
-  return  B8_OS_INVALID_SID;
+  _b8OsFreeSemaphore( sem );
 }
 
 static  void  _b8OsSemaphoreGetValue( b8OsSid sid , int* value ){
@@ -602,6 +709,11 @@ static  void  _b8OsSemaphoreWait( b8OsSid sid , u8 wait_type , b8OsUsec wake_up_
       _b8OsSetError(-EAGAIN);
       return;
     }
+    // The deadline has passed already: do not block, nor queue on the timer.
+    if( wake_up_time <= _AccumelatedTime ){
+      _b8OsSetError(-ETIMEDOUT);
+      return;
+    }
 
     sem->semcount--;
     tcb_cur->sid_wait = sid;
@@ -655,37 +767,60 @@ static  int  _b8OsThreadCreate(
   void*     (*StartRoutine)(void*),
   void*     Arg,
   u32       SchedulingPolicy,
-  u32       IrqNo
+  u32       Priority,
+  u32       IrqNo,
+  u32       Detached
 ){
+  *ppid = B8_OS_INVALID_PID;
   if( IrqNo != B8_OS_NOT_USING_IRQ ){
-    int ret = _b8OsIrqAttach(IrqNo,_b8OsIrqDispatch,NULL);
-    if( ret < 0 ) return ret;
+    // One irq thread per irq. Waiters in B8_OS_SYSCALL_IRQ_WAIT may share the irq.
+    for( size_t nn=0 ; nn<N_MAX_THREAD ; ++nn ){
+      const Tcb* tcb = &_TaskControlBlocks[ nn ];
+      if( tcb->pid != B8_OS_INVALID_PID && tcb->irq == IrqNo ){
+        return  _b8OsSetError( -EINVAL );
+      }
+    }
   }
 
-  *ppid = _b8OsAllocTcb();
-  Tcb* tcb = _b8OsGetTcb( *ppid );
+  const b8OsPid pid = _b8OsAllocTcb();
+  Tcb* tcb = _b8OsGetTcb( pid );
   if( NULL == tcb ){
     return  _b8OsSetError(-EAGAIN);
   }
   tcb->start_routine = StartRoutine;
   tcb->arg = Arg;
   if( NULL == StackAddr){
-    StackAddr = _b8OsStackAlloc( StackSize );
-    if( NULL == StackAddr ){
+    tcb->stack_base = StackPoolAlloc( &_StackPool , StackSize , &tcb->stack_block );
+    if( NULL == tcb->stack_base ){
+      _b8OsFreeTcb( tcb );
       return  _b8OsSetError(-ENOMEM);
     }
+    StackSize = tcb->stack_block;
+    StackAddr = (u8*)tcb->stack_base + StackSize;
   }
+
+  // Claimed last, so a thread that cannot be created leaves the irq alone.
+  if( IrqNo != B8_OS_NOT_USING_IRQ ){
+    const int ret = _b8OsIrqUse( IrqNo );
+    if( ret < 0 ){
+      _b8OsFreeTcb( tcb );
+      return  ret;
+    }
+  }
+  *ppid = pid;
   StackAddr -= sizeof( b8OsBridgeUsr2Svc );
   tcb->stack_addr = StackAddr;
   tcb->stack_size = StackSize;
+  tcb->detached = Detached ? 1 : 0;
   tcb->scheduling_policy = SchedulingPolicy;
+  tcb->priority = Priority;
   tcb->irq = IrqNo;
 
-  ListPushBack( _ReadyTasksList , *ppid );
+  ReadyQueuePushBack( tcb );
 
   b8OsBridgeUsr2Svc* bridge = TcbGetBridgeAddr( tcb );
   bridge->signature = B8_OS_BRIDGE_USR2SVC_SIGNATURE;
-  bridge->pid = *ppid;
+  bridge->pid = pid;
   bridge->errcode = B8_OS_OK;
   bridge->ret_pid = B8_OS_INVALID_PID;
   bridge->ret_sid = B8_OS_INVALID_SID;
@@ -705,7 +840,6 @@ int  b8OsReset( b8OsConfig* cfg_ ){
     return -ENOMEM;
   }
 
-  if( NULL == cfg_->sem_heap )                    return -EINVAL;
   if( NULL == cfg_->ArchDriverGetTimerIrq )       return -EINVAL;
   if( NULL == cfg_->ArchDriverOnStartTimer)       return -EINVAL;
   if( NULL == cfg_->ArchDriverOnStartCycleCnt )   return -EINVAL;
@@ -715,6 +849,11 @@ int  b8OsReset( b8OsConfig* cfg_ ){
   if( NULL == cfg_->ArchDriverGetClockTime )      return -EINVAL;
 
   _CycCnt = 0;
+  _CycPrev = 0;
+  _ProcessCycles = 0;
+  _CycSec = 0;
+  _CycInSec = 0;
+  _TickHook = NULL;
 
   int ret = cfg_->ArchDriverGetTimerIrq( &_IrqTimer );
   if( ret < 0 ) return ret;
@@ -733,6 +872,7 @@ int  b8OsReset( b8OsConfig* cfg_ ){
     _IrqInfo[ nn ].handler = _b8OsIrqUnexpectedIsr;
     _IrqInfo[ nn ].arg = NULL;
   }
+  memset( _IrqEvents , 0 , sizeof(_IrqEvents) );
   _b8OsIrqEnable();
 
   memset( b8OsUsrContext , 0 , sizeof(b8OsUsrContext ) );
@@ -740,7 +880,14 @@ int  b8OsReset( b8OsConfig* cfg_ ){
 
   _Config.ArchDriverGetClockTime( &_UnixEpochTimeMilliseconds );
   _UnixEpochTimeMicroseconds = _UnixEpochTimeMilliseconds * 1000;
-  _UnixEpochTimeCycles = (_UnixEpochTimeMilliseconds/1000) * _Config.CpuCyclesPerSec;
+  _UnixEpochTimeCycles = (_UnixEpochTimeMilliseconds/1000) * _Config.CpuCyclesPerSec
+                       + (_UnixEpochTimeMilliseconds%1000) * _Config.CpuCyclesPerSec / 1000;
+
+  memset( (void*)&_TimePage , 0 , sizeof(_TimePage) );
+  _TimePage.cpu_hz        = (u32)_Config.CpuCyclesPerSec;
+  _TimePage.ns_mult       = ((u64)1000000000 << 32) / _Config.CpuCyclesPerSec;
+  _TimePage.realtime_sec  = _UnixEpochTimeMilliseconds/1000;
+  _TimePage.realtime_nsec = (u32)(_UnixEpochTimeMilliseconds%1000) * 1000000;
 
   Cast cast;
   cast.data._p32 = _Config.StackTop;
@@ -751,40 +898,47 @@ int  b8OsReset( b8OsConfig* cfg_ ){
   cast.data._u32 -= (cast.data._u32 & 7);
   _Config.StackTop = cast.data._p32;
 
-  _UpStackPool = 0;
+  StackPoolInit( &_StackPool , _Config.StackTop , _Config.StackSize );
 
+  // Free lists are LIFO; push in reverse so that the lowest slots are used first.
   _AccThread = 1;
-  _UpMemoryPool = 0;
-  for( size_t nn=0 ; nn<N_MAX_THREAD ; ++nn ){
-    _TaskControlBlocks[ nn ].pid = B8_OS_INVALID_PID;
+  _FreeTcb = NULL;
+  for( size_t nn=N_MAX_THREAD ; nn-- > 0 ; ){
+    Tcb* tcb = &_TaskControlBlocks[ nn ];
+    TcbClear( tcb );
+    tcb->pid = B8_OS_INVALID_PID;
+    tcb->free_next = _FreeTcb;
+    _FreeTcb = tcb;
   }
 
   _AccSemaphore = 1;
-  for( size_t nn=0 ; nn<N_MAX_SEMAPHORE ; ++nn ){
-    _Semaphores[ nn ].sid = B8_OS_INVALID_SID;
+  _FreeSemaphore = NULL;
+  for( size_t nn=N_MAX_SEMAPHORE ; nn-- > 0 ; ){
+    _b8OsFreeSemaphore( &_Semaphores[ nn ] );
   }
 
-  _ReadyTasksList = NewList( N_MAX_THREAD );
-  _WaitingTasksList = NewList( N_MAX_THREAD );
-  _ZombieTasksList = NewList( N_MAX_THREAD );
+  memset( _ReadyQueueHead , 0 , sizeof(_ReadyQueueHead) );
+  memset( _ReadyQueueTail , 0 , sizeof(_ReadyQueueTail) );
+  _ReadyBitmap = 0;
+  _TimerQueueHead = NULL;
+  memset( _FutexQueues , 0 , sizeof(_FutexQueues) );
 
   _AccumelatedTime = 0;
   ret = cfg_->ArchDriverOnStartCycleCnt();
   if( ret < 0 ) return ret;
 
-  ret = _b8OsThreadCreate( &_IdlePid,NULL,CONFIG_BYTESIZE_OF_STACK_IDLE_THREAD, _b8IdleThread , NULL, B8_OS_SCHED_RR , B8_OS_NOT_USING_IRQ );
+  ret = _b8OsThreadCreate( &_IdlePid,NULL,CONFIG_BYTESIZE_OF_STACK_IDLE_THREAD, _b8IdleThread , NULL, B8_OS_SCHED_RR , B8_OS_PRIORITY_MIN, B8_OS_NOT_USING_IRQ, 1 );
   if( ret < 0 ) return ret;
 
+  // The idle thread is not queued; it runs only while every ready queue is empty.
+  ReadyQueueErase( _b8OsGetTcb( _IdlePid ) );
+
   _CurrentPid = _IdlePid;
 
   b8OsPid main_th;
-  ret = _b8OsThreadCreate( &main_th,NULL,CONFIG_BYTESIZE_OF_STACK_MAIN_THREAD, _b8MainThread , NULL, B8_OS_SCHED_RR , B8_OS_NOT_USING_IRQ );
+  ret = _b8OsThreadCreate( &main_th,NULL,CONFIG_BYTESIZE_OF_STACK_MAIN_THREAD, _b8MainThread , NULL, B8_OS_SCHED_RR , B8_OS_PRIORITY_DEFAULT, B8_OS_NOT_USING_IRQ, 1 );
   if( ret < 0 ) return ret;
 
-  b8SysPuts( "b8os heap:" );
-  b8SysPutHex( _UpMemoryPool );
-  b8SysPutCR();
-
   ret = _b8OsIrqAttach(_IrqTimer,_b8OsIrqDispatch,NULL);
   if( ret < 0 ) return ret;
 
@@ -831,6 +985,7 @@ static  void _B8_OS_SYSCALL_SCHED_YIELD(void){
 }
 
 static  void  _B8_OS_SYSCALL_SCHED_SLEEP(void){
+  _b8OsTestCancel();
   ReqSchedule rs;
   ReqScheduleClear( &rs );
   rs.req = REQ_SCHEDULE_YIELD_TIME;
@@ -851,28 +1006,51 @@ static  void _B8_OS_SYSCALL_THREAD_CREATE(void){
     return;
   }
 
-  b8OsPid pid;
+  const u32 Priority = (b8OsSysCallArgs[5] >> 8) & 0xff;
+  if( Priority > B8_OS_PRIORITY_MAX ){
+    _b8OsSetError(-EINVAL);
+    _b8OsGiveBridgeToUsr();
+    return;
+  }
+
+  b8OsPid pid = B8_OS_INVALID_PID;
   _b8OsThreadCreate(
     &pid,
     _b8OsCastU32( b8OsSysCallArgs[1] ), // void*  StackAddr
     (size_t)b8OsSysCallArgs[2],         // size_t StackSize
     _b8OsCastU32( b8OsSysCallArgs[3] ), // void*  StartRoutine
     _b8OsCastU32( b8OsSysCallArgs[4] ), // void*  arg
-    b8OsSysCallArgs[5],                 // u32    SchedulingPolicy
-    b8OsSysCallArgs[6]                  // u32    IrqNo
+    b8OsSysCallArgs[5] & 0xff,          // u32    SchedulingPolicy
+    Priority,                           // u32    Priority
+    b8OsSysCallArgs[6],                 // u32    IrqNo
+    b8OsSysCallArgs[5] & B8_OS_THREAD_CREATE_DETACHED
   );
 
   b8OsBridgeUsr2Svc* bridge = TcbGetBridge( _CurrentPid );
   bridge->ret_pid = pid;
   _b8OsGiveBridgeToUsr();
+  _b8OsPreemptIfNeeded();
 }
 
-static  void _B8_OS_SYSCALL_EXIT(void){
+static  void _b8OsExitCurrentPid( u32 value ){
   ReqSchedule rs;
   ReqScheduleClear( &rs );
   rs.req = REQ_SCHEDULE_EXIT_THREAD;
   rs.pid = _CurrentPid;
+  rs.exit_value = value;
   _b8OsProcessScheduler( &rs );
+  // It won't get here
+}
+
+static  void _B8_OS_SYSCALL_EXIT(void){
+  _b8OsExitCurrentPid( b8OsSysCallArgs[1] );
+}
+
+// A cancellation point: exits the calling thread if it has been canceled.
+static  void  _b8OsTestCancel(void){
+  if( _b8OsGetCurrentTcb()->cancel_pending ){
+    _b8OsExitCurrentPid( B8_OS_THREAD_CANCELED );
+  }
 }
 
 static  void _B8_OS_SYSCALL_SET_ERRNO(void){
@@ -894,16 +1072,30 @@ static  void _B8_OS_SYSCALL_SEM_INIT(void){
   _b8OsGiveBridgeToUsr();
 }
 
+static  void _B8_OS_SYSCALL_SEM_DESTROY(void){
+  _b8OsSemaphoreDestroy( b8OsSysCallArgs[1] );
+  _b8OsGiveBridgeToUsr();
+}
+
 static  void _B8_OS_SYSCALL_SEM_POST(void){
   const b8OsSid sid = b8OsSysCallArgs[1];
   _b8OsSemaphorePost( sid );
   _b8OsGiveBridgeToUsr();
 }
 
+// The deadline is on CLOCK_REALTIME; convert it to the _AccumelatedTime base of the timer queue.
+static  b8OsUsec  _b8OsDeadlineToWakeUpTime( u32 sec , u32 nsec ){
+  const b8OsUsec wake_up_time = (u64)sec*1000000 + nsec/1000;
+  return  wake_up_time > _UnixEpochTimeMicroseconds ? wake_up_time - _UnixEpochTimeMicroseconds : 0;
+}
+
 static  void _B8_OS_SYSCALL_SEM_WAIT(void){
-  b8OsUsec wake_up_time = 0xffffffffffffffff;
+  b8OsUsec wake_up_time = B8_OS_USEC_INFINITE;
   const b8OsSid sid = b8OsSysCallArgs[1];
   const u32 wait_type = b8OsSysCallArgs[2];
+  if( wait_type != B8_OS_SEM_TRYWAIT ){
+    _b8OsTestCancel();
+  }
   if( wait_type == B8_OS_SEM_TIMEDWAIT ){
     const u32 nsec = b8OsSysCallArgs[4];
     if( nsec >= 1000000000 ){
@@ -911,9 +1103,7 @@ static  void _B8_OS_SYSCALL_SEM_WAIT(void){
       _b8OsGiveBridgeToUsr();
       _b8OsSwitchBackToUsr();
     }
-
-    const u64 sec = (u64)b8OsSysCallArgs[3];
-    wake_up_time = sec*1000000 + nsec/1000;
+    wake_up_time = _b8OsDeadlineToWakeUpTime( b8OsSysCallArgs[3] , nsec );
   }
   _b8OsSemaphoreWait( sid , wait_type , wake_up_time );
   _b8OsGiveBridgeToUsr();
@@ -929,20 +1119,69 @@ static  void _B8_OS_SYSCALL_SEM_GETVALUE(void){
   _b8OsGiveBridgeToUsr();
 }
 
-static  void  _b8OsChkClockId(void){
-  const u32 clkid = b8OsSysCallArgs[1];
-  if( clkid == B8_OS_CLOCKID_PROCESS_CPUTIME_ID ||
-      clkid == B8_OS_CLOCKID_THREAD_CPUTIME_ID
-  ){
-    _b8OsSetError(-EOPNOTSUPP); 
-    _b8OsGiveBridgeToUsr();
-    _b8OsSwitchBackToUsr();
+static  void _B8_OS_SYSCALL_THREAD_SETSCHEDPARAM(void){
+  const b8OsPid pid = b8OsSysCallArgs[1];
+  const u32 policy  = b8OsSysCallArgs[2];
+  const u32 priority= b8OsSysCallArgs[3];
+
+  Tcb* tcb = _b8OsGetTcb( pid );
+  if( NULL == tcb || pid == _IdlePid ){
+    _b8OsSetError(-ESRCH);
+    return;
+  }
+  if( priority > B8_OS_PRIORITY_MAX ){
+    _b8OsSetError(-EINVAL);
+    return;
+  }
+  switch( policy ){
+    case  B8_OS_SCHED_FIFO:
+    case  B8_OS_SCHED_RR:
+      break;
+    case  B8_OS_SCHED_IRQ:
+      if( tcb->irq != B8_OS_NOT_USING_IRQ ) break;
+      _b8OsSetError(-EINVAL);
+      return;
+    default:
+      _b8OsSetError(-EINVAL);
+      return;
+  }
+
+  const u8 was_ready = tcb->ready;
+  ReadyQueueErase( tcb );
+  tcb->scheduling_policy = policy;
+  tcb->priority = priority;
+  if( was_ready ){
+    ReadyQueuePushBack( tcb );
+  }
+
+  _b8OsGiveBridgeToUsr();
+  if( tcb == _b8OsGetCurrentTcb() ){
+    // The running thread went to the back of its new priority; the head runs,
+    // which may be a thread of the same priority.
+    ReqSchedule rs;
+    ReqScheduleClear( &rs );
+    rs.req = REQ_SCHEDULE_PREEMPT;
+    _b8OsProcessScheduler( &rs );
     // It won't get here
   }
+  _b8OsPreemptIfNeeded();
+}
+
+static  void _B8_OS_SYSCALL_THREAD_GETSCHEDPARAM(void){
+  const b8OsPid pid = b8OsSysCallArgs[1];
+  Tcb* tcb = _b8OsGetTcb( pid );
+  if( NULL == tcb ){
+    _b8OsSetError(-ESRCH);
+    return;
+  }
+
+  b8OsBridgeUsr2Svc* bridge = TcbGetBridge( _CurrentPid );
+  bridge->ret_policy = tcb->scheduling_policy;
+  bridge->ret_priority = tcb->priority;
+  _b8OsGiveBridgeToUsr();
 }
 
 static  void  _B8_OS_SYSCALL_CLOCK_GETRES(void){
-  _b8OsChkClockId();
   b8OsBridgeUsr2Svc* bridge = TcbGetBridge( _CurrentPid );
   bridge->tv_sec  = 0;
   bridge->tv_nsec = _ClockResolutionNs;
@@ -950,14 +1189,25 @@ static  void  _B8_OS_SYSCALL_CLOCK_GETRES(void){
 }
 
 static  void  _B8_OS_SYSCALL_CLOCK_GETTIME(void){
-  _b8OsChkClockId();
-
   const u32 clkid = b8OsSysCallArgs[1];
-  u32 cyccnt;
-  _Config.ArchDriverGetCycle( &cyccnt );
   static  const u64 ns = 1000000000UL;
-  const u64 BaseCycle = (clkid == B8_OS_CLOCKID_REALTIME) ? _UnixEpochTimeCycles : 0;
-  const u64 _CurCycCnt = BaseCycle + _CycCnt + (u64)cyccnt;
+
+  // The cycles up to this system call were charged on entry.
+  u64 _CurCycCnt;
+  switch( clkid ){
+    case  B8_OS_CLOCKID_PROCESS_CPUTIME_ID:
+      _CurCycCnt = _ProcessCycles;
+      break;
+    case  B8_OS_CLOCKID_THREAD_CPUTIME_ID:
+      _CurCycCnt = _b8OsGetCurrentTcb()->cpu_cycles;
+      break;
+    case  B8_OS_CLOCKID_REALTIME:
+      _CurCycCnt = _UnixEpochTimeCycles + _CycCnt;
+      break;
+    default:
+      _CurCycCnt = _CycCnt;
+      break;
+  }
   b8OsBridgeUsr2Svc* bridge = TcbGetBridge( _CurrentPid );
   bridge->tv_sec = _CurCycCnt / _Config.CpuCyclesPerSec;
   bridge->tv_nsec = (u32) (((_CurCycCnt % _Config.CpuCyclesPerSec) * ns) / _Config.CpuCyclesPerSec);
@@ -965,6 +1215,281 @@ static  void  _B8_OS_SYSCALL_CLOCK_GETTIME(void){
   _b8OsGiveBridgeToUsr();
 }
 
+static  void  _B8_OS_SYSCALL_IRQ_ATTACH(void){
+  const u32 irq = b8OsSysCallArgs[1];
+  if( irq == _IrqTimer ){
+    _b8OsSetError(-EINVAL);
+    return;
+  }
+  if( _b8OsIrqUse( irq ) < 0 ) return;
+  _b8OsSetError( 0 );
+}
+
+static  void  _B8_OS_SYSCALL_IRQ_WAIT(void){
+  const u32 irq   = b8OsSysCallArgs[1];
+  const u32 flags = b8OsSysCallArgs[2];
+  if( irq >= B8_IRQ_NUM_OF_INTERRUPTS || irq == _IrqTimer || _IrqInfo[ irq ].handler != _b8OsIrqDispatch ){
+    _b8OsSetError(-EINVAL);
+    return;
+  }
+  _b8OsTestCancel();
+
+  IrqEvent* ev = &_IrqEvents[ irq ];
+  b8OsBridgeUsr2Svc* bridge = TcbGetBridge( _CurrentPid );
+  _b8OsSetError( 0 );
+  if( flags & B8_OS_IRQ_WAIT_OBSERVE ){
+    // Neither takes nor clears the pending events: they are another thread's.
+    bridge->ret_count = 0;
+    ev->observers |= 1u << (_CurrentPid & 0xffff);
+  } else {
+    if( flags & B8_OS_IRQ_WAIT_CLEAR ){
+      ev->pending = 0;
+    }
+    bridge->ret_count = ev->pending;
+    if( ev->pending > 0 ){
+      ev->pending--;
+      return;
+    }
+  }
+
+  ReqSchedule rs;
+  ReqScheduleClear( &rs );
+  rs.req = REQ_SCHEDULE_IRQ_WAIT;
+  rs.irq = irq;
+  _b8OsProcessScheduler( &rs );
+  // It won't get here
+}
+
+static  void  _B8_OS_SYSCALL_FUTEX_WAIT(void){
+  const u32 addr  = b8OsSysCallArgs[1];
+  const u32 value = b8OsSysCallArgs[2];
+  const u32 flags = b8OsSysCallArgs[3];
+  if( 0 == addr || (addr & 3) ){
+    _b8OsSetError(-EINVAL);
+    return;
+  }
+  // User space has state to undo before it exits; see _B8_OS_SYSCALL_THREAD_CANCEL.
+  if( (flags & B8_OS_FUTEX_CANCEL) && _b8OsGetCurrentTcb()->cancel_pending ){
+    _b8OsSetError(-ECANCELED);
+    return;
+  }
+
+  b8OsUsec wake_up_time = B8_OS_USEC_INFINITE;
+  if( flags & B8_OS_FUTEX_TIMED ){
+    const u32 nsec = b8OsSysCallArgs[5];
+    if( nsec >= 1000000000 ){
+      _b8OsSetError(-EINVAL);
+      return;
+    }
+    wake_up_time = _b8OsDeadlineToWakeUpTime( b8OsSysCallArgs[4] , nsec );
+  }
+
+  // The word changed since user space read it: the wake up is not to be waited for.
+  if( *(volatile u32*)_b8OsCastU32( addr ) != value ){
+    _b8OsSetError(-EAGAIN);
+    return;
+  }
+  if( wake_up_time <= _AccumelatedTime ){
+    _b8OsSetError(-ETIMEDOUT);
+    return;
+  }
+
+  Tcb* tcb_cur = _b8OsGetCurrentTcb();
+  tcb_cur->futex = addr;
+  tcb_cur->futex_cancel = (flags & B8_OS_FUTEX_CANCEL) ? 1 : 0;
+  tcb_cur->wake_up_time = wake_up_time;
+  _b8OsSetError( 0 );
+
+  ReqSchedule rs;
+  ReqScheduleClear( &rs );
+  rs.req = REQ_SCHEDULE_FUTEX_WAIT;
+  _b8OsProcessScheduler( &rs );
+  // It won't get here
+}
+
+// Wakes up to num threads waiting for the word at addr, the most urgent first.
+static  u32   _b8OsFutexWake( u32 addr , u32 num ){
+  u32 woken = 0;
+  while( woken < num ){
+    Tcb* tcb_pick = NULL;
+    for( Tcb* tcb = FutexQueue( addr )->head ; tcb ; tcb = tcb->wq_next ){
+      if( tcb->futex != addr ) continue;
+      if( NULL == tcb_pick || tcb->priority > tcb_pick->priority ) tcb_pick = tcb;
+    }
+    if( NULL == tcb_pick )  break;
+
+    tcb_pick->futex = 0;
+    _b8OsAwakePid( tcb_pick->pid );
+    ++woken;
+  }
+  return  woken;
+}
+
+static  void  _B8_OS_SYSCALL_FUTEX_WAKE(void){
+  const u32 addr  = b8OsSysCallArgs[1];
+  const u32 num   = b8OsSysCallArgs[2];
+  const u32 flags = b8OsSysCallArgs[3];
+  if( 0 == addr || (addr & 3) ){
+    _b8OsSetError(-EINVAL);
+    return;
+  }
+
+  if( flags & B8_OS_FUTEX_INC ){
+    ++*(volatile u32*)_b8OsCastU32( addr );
+  }
+  b8OsBridgeUsr2Svc* bridge = TcbGetBridge( _CurrentPid );
+  bridge->ret_count = _b8OsFutexWake( addr , num );
+  _b8OsGiveBridgeToUsr();
+  _b8OsPreemptIfNeeded();
+}
+
+// A thread other than the idle thread, zombies included.
+static  Tcb*  _b8OsGetUserTcb( b8OsPid pid ){
+  if( pid == _IdlePid ) return NULL;
+  return  _b8OsGetTcb( pid );
+}
+
+static  void  _B8_OS_SYSCALL_THREAD_JOIN(void){
+  Tcb* tcb = _b8OsGetUserTcb( b8OsSysCallArgs[1] );
+  if( NULL == tcb ){
+    _b8OsSetError(-ESRCH);
+    return;
+  }
+  if( tcb->pid == _CurrentPid ){
+    _b8OsSetError(-EDEADLK);
+    return;
+  }
+  if( tcb->detached || tcb->joiner != B8_OS_INVALID_PID ){
+    _b8OsSetError(-EINVAL);
+    return;
+  }
+  _b8OsTestCancel();
+
+  b8OsBridgeUsr2Svc* bridge = TcbGetBridge( _CurrentPid );
+  _b8OsSetError( 0 );
+  if( tcb->exited ){
+    bridge->ret_value = tcb->exit_value;
+    _b8OsFreeTcb( tcb );
+    return;
+  }
+
+  // _b8OsThreadTerminate() hands the exit value over and wakes the caller.
+  Tcb* tcb_cur = _b8OsGetCurrentTcb();
+  tcb->joiner = _CurrentPid;
+  tcb_cur->join_pid = tcb->pid;
+
+  ReqSchedule rs;
+  ReqScheduleClear( &rs );
+  rs.req = REQ_SCHEDULE_JOIN_WAIT;
+  _b8OsProcessScheduler( &rs );
+  // It won't get here
+}
+
+static  void  _B8_OS_SYSCALL_THREAD_DETACH(void){
+  Tcb* tcb = _b8OsGetUserTcb( b8OsSysCallArgs[1] );
+  if( NULL == tcb ){
+    _b8OsSetError(-ESRCH);
+    return;
+  }
+  if( tcb->detached || tcb->joiner != B8_OS_INVALID_PID ){
+    _b8OsSetError(-EINVAL);
+    return;
+  }
+
+  tcb->detached = 1;
+  if( tcb->exited ){
+    _b8OsFreeTcb( tcb );
+  }
+  _b8OsSetError( 0 );
+}
+
+// True while the thread is blocked at a cancellation point.
+static  int   _b8OsIsCancelableWait( const Tcb* tcb ){
+  if( tcb->ready )  return 0;
+  switch( tcb->waiting_for ){
+    case  TWF_SEMAPHORE:
+    case  TWF_TIMER:
+    case  TWF_IRQ_EVENT:
+    case  TWF_JOIN:
+      return 1;
+    case  TWF_FUTEX:
+      return tcb->futex_cancel;
+    default:
+      return 0;
+  }
+}
+
+static  void  _B8_OS_SYSCALL_THREAD_CANCEL(void){
+  Tcb* tcb = _b8OsGetUserTcb( b8OsSysCallArgs[1] );
+  if( NULL == tcb ){
+    _b8OsSetError(-ESRCH);
+    return;
+  }
+  _b8OsSetError( 0 );
+  if( tcb->exited ) return;
+
+  tcb->cancel_pending = 1;
+  if( tcb->pid == _CurrentPid || !_b8OsIsCancelableWait( tcb ) ) return;
+
+  if( tcb->waiting_for == TWF_FUTEX ){
+    // The wait fails with ECANCELED, and the thread exits from user space.
+    _b8OsWaitAbandon( tcb );
+    _b8OsSetErrorInBridge( -ECANCELED , tcb->pid );
+    _b8OsAwakePid( tcb->pid );
+  } else {
+    _b8OsThreadTerminate( tcb , B8_OS_THREAD_CANCELED );
+  }
+  _b8OsPreemptIfNeeded();
+}
+
+static  void  _B8_OS_SYSCALL_THREAD_TESTCANCEL(void){
+  _b8OsTestCancel();
+  _b8OsSetError( 0 );
+}
+
+static  void  _B8_OS_SYSCALL_THREAD_GETINFO(void){
+  b8OsThreadInfo* info = (b8OsThreadInfo*)_b8OsCastU32( b8OsSysCallArgs[1] );
+  const u32 num = b8OsSysCallArgs[2];
+  u32 count = 0;
+  for( size_t nn=0 ; nn<N_MAX_THREAD ; ++nn ){
+    const Tcb* tcb = &_TaskControlBlocks[ nn ];
+    if( tcb->pid == B8_OS_INVALID_PID ) continue;
+    if( count < num && info ){
+      b8OsThreadInfo* ti = &info[ count ];
+      memset( ti , 0 , sizeof(*ti) );
+      ti->pid = tcb->pid;
+      if( tcb->pid == _CurrentPid ){
+        ti->state = B8_OS_THREAD_RUNNING;
+      } else if( tcb->ready ){
+        ti->state = B8_OS_THREAD_READY;
+      } else {
+        switch( tcb->waiting_for ){
+          case  TWF_SEMAPHORE:  ti->state = B8_OS_THREAD_WAIT_SEMAPHORE;  break;
+          case  TWF_TIMER:      ti->state = B8_OS_THREAD_WAIT_TIMER;      break;
+          case  TWF_IRQ:
+          case  TWF_IRQ_EVENT:  ti->state = B8_OS_THREAD_WAIT_IRQ;        break;
+          case  TWF_FUTEX:      ti->state = B8_OS_THREAD_WAIT_FUTEX;      break;
+          case  TWF_JOIN:       ti->state = B8_OS_THREAD_WAIT_JOIN;       break;
+          default:              ti->state = B8_OS_THREAD_EXITED;          break;
+        }
+      }
+      ti->policy     = tcb->scheduling_policy;
+      ti->priority   = tcb->priority;
+      ti->idle       = tcb->pid == _IdlePid;
+      ti->irq        = tcb->waiting_for == TWF_IRQ_EVENT ? tcb->irq_wait : tcb->irq;
+      ti->stack_size = tcb->stack_size;
+      ti->cpu_cycles = tcb->cpu_cycles;
+      ti->switches   = tcb->switches;
+      ti->syscalls   = tcb->syscalls;
+    }
+    ++count;
+  }
+
+  b8OsBridgeUsr2Svc* bridge = TcbGetBridge( _CurrentPid );
+  bridge->ret_count = count;
+  _b8OsGiveBridgeToUsr();
+}
+
 static  void  _B8_OS_SYSCALL_CLOCK_SETTIME(void){
   _b8OsSetError(-EPERM);
   _b8OsSwitchBackToUsr();
@@ -987,10 +1512,48 @@ static  const B8_OS_SYSCALL_FUNC  _b8OsSysCallTbl[ B8_OS_SYSCALL_MAX ] = {
   _B8_OS_SYSCALL_CLOCK_GETRES,
   _B8_OS_SYSCALL_CLOCK_GETTIME,
   _B8_OS_SYSCALL_CLOCK_SETTIME,
+  _B8_OS_SYSCALL_THREAD_SETSCHEDPARAM,
+  _B8_OS_SYSCALL_THREAD_GETSCHEDPARAM,
+  _B8_OS_SYSCALL_THREAD_GETINFO,
+  _B8_OS_SYSCALL_IRQ_ATTACH,
+  _B8_OS_SYSCALL_IRQ_WAIT,
+  _B8_OS_SYSCALL_FUTEX_WAIT,
+  _B8_OS_SYSCALL_FUTEX_WAKE,
+  _B8_OS_SYSCALL_THREAD_JOIN,
+  _B8_OS_SYSCALL_THREAD_DETACH,
+  _B8_OS_SYSCALL_THREAD_CANCEL,
+  _B8_OS_SYSCALL_THREAD_TESTCANCEL,
+  _B8_OS_SYSCALL_SEM_DESTROY,
 };
 
+// Charges the cycles since the last kernel entry to the current thread, and advances the clocks.
+static  void  _b8OsAccountCycles(void){
+  // CYCCNT runs free so that user code can measure cycles across kernel entries.
+  u32 cyccnt;
+  _Config.ArchDriverGetCycle( &cyccnt );
+  const u32 dcyc = cyccnt - _CycPrev;
+  _CycPrev = cyccnt;
+  _CycCnt += (u64)dcyc;
+  _AccumelatedTime = (_CycCnt * _UsPerCpuCycleFixed8) >> 8;
+
+  u64 in_sec = (u64)_CycInSec + dcyc;
+  if( in_sec >= _Config.CpuCyclesPerSec ){
+    _CycSec += in_sec / _Config.CpuCyclesPerSec;
+    in_sec  %= _Config.CpuCyclesPerSec;
+  }
+  _CycInSec = (u32)in_sec;
+
+  Tcb* tcb_cur = _b8OsGetTcb( _CurrentPid );
+  if( tcb_cur ){
+    tcb_cur->cpu_cycles += dcyc;
+    if( _CurrentPid != _IdlePid ) _ProcessCycles += dcyc;
+  }
+}
+
 // Called only from bootloader.s / __svc_dispatch:
 void  _b8OsSvcDispatch(void){
+  _b8OsAccountCycles();
+  _b8OsGetCurrentTcb()->syscalls++;
   _b8OsGiveBridgeToUsrByPid( _CurrentPid );
   const b8OsSysCallNum syscall = b8OsSysCallArgs[ 0 ];
   if( syscall >= B8_OS_SYSCALL_MAX ){
@@ -1003,15 +1566,43 @@ void  _b8OsSvcDispatch(void){
   // It won't get here
 }
 
+// Wakes every thread waiting for irq. The event is kept for the next waiter
+// unless one that takes it was woken; observers do not take it.
+static  void  _b8OsIrqSignal( int irq ){
+  IrqEvent* ev = &_IrqEvents[ irq ];
+  ev->count++;
+  ev->cyccnt = _CycPrev;
+  if( 0 == ( ev->waiters & ~ev->observers ) ){
+    if( ev->pending < SEM_VALUE_MAX ) ev->pending++;
+  }
+
+  u32 waiters = ev->waiters;
+  ev->waiters = 0;
+  ev->observers = 0;
+  for( u32 nn=0 ; waiters ; ++nn, waiters >>= 1 ){
+    if( 0 == (waiters & 1) ) continue;
+    Tcb* tcb = &_TaskControlBlocks[ nn ];
+    tcb->irq_wait = B8_OS_NOT_USING_IRQ;
+    _b8OsAwakePid( tcb->pid );
+  }
+}
+
 static  int   _b8OsIrqDispatch(int irq, void* arg){
+  _b8OsAccountCycles();
   _IrqDispatched = irq;
   (void)arg;
   ReqSchedule rs;
   ReqScheduleClear( &rs );
   if( irq == _IrqTimer ){
     rs.req |= REQ_SCHEDULE_REGULAR;
+    const b8OsTickHook hook = _TickHook;
+    if( hook ){
+      // lr_irq points one instruction past the interrupted one.
+      hook( b8OsUsrContext[ REG_15PC ] - 4 , _CurrentPid );
+    }
   } else {
     rs.req |= REQ_SCHEDULE_AWAKE_THREAD_WAITING_FOR_IRQ;
+    _b8OsIrqSignal( irq );
   }
 
   _b8OsProcessScheduler( &rs );
@@ -1020,100 +1611,39 @@ static  int   _b8OsIrqDispatch(int irq, void* arg){
   return B8_OS_OK;
 }
 
-static  b8OsPid _b8OsPickupThreadYield( void ){
-  Node* it;
-  for(
-    it =  ListBegin( _WaitingTasksList ) ;
-    it != ListEnd( _WaitingTasksList )   ;
-    it =  it->_next
-  ){
-    Tcb* tcb = _b8OsGetTcb( it->pid );
-    KPANIC(tcb,"not found");
-    if( tcb->waiting_for != TWF_YIELD ) continue;
-    return it->pid;
-  }
-  return  B8_OS_INVALID_PID;
-}
-
-static  b8OsPid _b8OsPickupThreadWaitingForTimer( void ){
-  Node* it;
-  for(
-    it =  ListBegin( _WaitingTasksList ) ;
-    it != ListEnd( _WaitingTasksList )   ;
-    it =  it->_next
-  ){
-    Tcb* tcb = _b8OsGetTcb( it->pid );
-    KPANIC(tcb,"not found");
-    if( tcb->waiting_for != TWF_TIMER ) continue;
-    if( _AccumelatedTime < tcb->wake_up_time ) continue;
-    return it->pid;
-  }
-  return  B8_OS_INVALID_PID;
-}
-
 static  b8OsPid _b8OsPickupThreadWaitingForSemaphore( b8OsSid sid ){
-  Node* it;
-  for(
-    it =  ListBegin( _WaitingTasksList ) ;
-    it != ListEnd( _WaitingTasksList )   ;
-    it =  it->_next
-  ){
-    Tcb* tcb = _b8OsGetTcb( it->pid );
-    KPANIC(tcb,"not found");
-    if( tcb->waiting_for != TWF_SEMAPHORE ) continue;
-    if( tcb->sid_wait != sid )  continue;
-    tcb->sid_wait = B8_OS_INVALID_SID;
-    return it->pid;
-  }
-  return  B8_OS_INVALID_PID;
-}
-
-static  b8OsPid _b8OsPickupThreadWaitingForSemaphoreTimeOut( void ){
-  Node* it;
-  for(
-    it =  ListBegin( _WaitingTasksList ) ;
-    it != ListEnd( _WaitingTasksList )   ;
-    it =  it->_next
-  ){
-    Tcb* tcb = _b8OsGetTcb( it->pid );
-    KPANIC(tcb,"not found");
-    if( tcb->waiting_for != TWF_SEMAPHORE ) continue;
-    if( _UnixEpochTimeMicroseconds + _AccumelatedTime < tcb->wake_up_time )  continue;
-    return it->pid;
-  }
-  return  B8_OS_INVALID_PID;
+  Semaphore* sem = _b8OsGetSemaphore( sid );
+  KPANIC( sem , "invalid sid" );
+  Tcb* tcb = sem->waiters.head;
+  if( NULL == tcb ) return  B8_OS_INVALID_PID;
+  tcb->sid_wait = B8_OS_INVALID_SID;
+  return  tcb->pid;
 }
 
 static  b8OsPid _b8OsPickThreadWaitingForIrq(void){
-  Node* it;
-  for(
-    it =  ListBegin( _WaitingTasksList ) ;
-    it != ListEnd( _WaitingTasksList )   ;
-    it =  it->_next
-  ){
-    Tcb* tcb = _b8OsGetTcb( it->pid );
-    KPANIC(tcb,"not found");
-    if( tcb->waiting_for != TWF_IRQ ) continue;
-    if(tcb->irq != _IrqDispatched)    continue;
-    return it->pid;
-  }
-  return  B8_OS_INVALID_PID;
-}
-
-static  Tcb*  _b8OsWaitCurrentPid( TcbWaitingFor waiting_for ){
-  ListErase( _ReadyTasksList , _CurrentPid );
-  ListPushBack( _WaitingTasksList , _CurrentPid );
+  Tcb* tcb = _IrqEvents[ _IrqDispatched ].threads.head;
+  return  tcb ? tcb->pid : B8_OS_INVALID_PID;
+}
+
+// wq is the queue the waker looks in, or NULL if it finds the thread another way.
+static  Tcb*  _b8OsWaitCurrentPid( TcbWaitingFor waiting_for , WaitQueue* wq ){
   Tcb* tcb = _b8OsGetTcb( _CurrentPid );
   KPANIC( tcb , "not found current tcb" );
+  ReadyQueueErase( tcb );
+  if( wq ){
+    WaitQueuePushBack( wq , tcb );
+  }
   tcb->waiting_for = waiting_for;
   return tcb;
 }
 
 static  void  _b8OsSwitchPidAndBackToUsr( b8OsPid pid_pickup ){
   KPANIC( pid_pickup != B8_OS_INVALID_PID , "no tcb" );
+  const b8OsPid pid_prev = _CurrentPid;
   _CurrentPid = pid_pickup;
   Tcb* tcb_cur = _b8OsGetTcb( _CurrentPid );
   KPANIC(tcb_cur,"invalid _CurrentPid" );
+  if( pid_prev != _CurrentPid ) tcb_cur->switches++;
   if( tcb_cur->status == TS_NOT_YET_INIT ){
     TcbInit( tcb_cur );
   }
@@ -1127,24 +1657,87 @@ static  void  _b8OsAwakePid( b8OsPid pid ){
   KPANIC( tcb_wakeup , "invalid tcb_wakeup" );
   tcb_wakeup->waiting_for = TWF_NOTHING;
 
-  ListErase( _WaitingTasksList , pid );
-  ListErase( _ReadyTasksList   , pid );
+  WaitQueueErase( tcb_wakeup );
+  TimerQueueErase( tcb_wakeup );
+  if( !tcb_wakeup->ready ){
+    ReadyQueuePushBack( tcb_wakeup );
+  }
+}
 
-  ListPushBack( _ReadyTasksList , pid );
+// Undoes the wait of a thread that will not be woken by what it waits for.
+static  void  _b8OsWaitAbandon( Tcb* tcb ){
+  switch( tcb->waiting_for ){
+    case  TWF_SEMAPHORE:{
+      Semaphore* sem = _b8OsGetSemaphore( tcb->sid_wait );
+      if( sem ) sem->semcount++;
+      tcb->sid_wait = B8_OS_INVALID_SID;
+    }break;
+    case  TWF_IRQ_EVENT:
+      _IrqEvents[ tcb->irq_wait ].waiters &= ~(1u << (tcb->pid & 0xffff));
+      _IrqEvents[ tcb->irq_wait ].observers &= ~(1u << (tcb->pid & 0xffff));
+      tcb->irq_wait = B8_OS_NOT_USING_IRQ;
+      break;
+    case  TWF_FUTEX:
+      tcb->futex = 0;
+      break;
+    case  TWF_JOIN:{
+      Tcb* tcb_join = _b8OsGetTcb( tcb->join_pid );
+      if( tcb_join ) tcb_join->joiner = B8_OS_INVALID_PID;
+      tcb->join_pid = B8_OS_INVALID_PID;
+    }break;
+    default:
+      break;
+  }
+}
 
-  _b8OsSwitchPidAndBackToUsr( pid );
-  // It won't get here.
+/*
+  Ends a thread, the current one or one blocked at a cancellation point.
+  The stack goes back to the pool at once, as the thread never runs again.
+  The TCB is kept, as a zombie with the exit value, until it is joined;
+  a detached thread, or one already being joined, is reclaimed at once.
+*/
+static  void  _b8OsThreadTerminate( Tcb* tcb , u32 value ){
+  _b8OsWaitAbandon( tcb );
+  ReadyQueueErase( tcb );
+  TimerQueueErase( tcb );
+  WaitQueueErase( tcb );
+  tcb->waiting_for = TWF_NOTHING;
+  tcb->irq = B8_OS_NOT_USING_IRQ;
+  if( tcb->stack_base ){
+    StackPoolFree( &_StackPool , tcb->stack_base , tcb->stack_block );
+    tcb->stack_base = NULL;
+  }
+  tcb->exited = 1;
+  tcb->exit_value = value;
+
+  if( tcb->joiner != B8_OS_INVALID_PID ){
+    Tcb* tcb_joiner = _b8OsGetTcb( tcb->joiner );
+    KPANIC( tcb_joiner , "invalid joiner" );
+    TcbGetBridge( tcb_joiner->pid )->ret_value = value;
+    tcb_joiner->join_pid = B8_OS_INVALID_PID;
+    _b8OsAwakePid( tcb_joiner->pid );
+    _b8OsFreeTcb( tcb );
+  } else if( tcb->detached ){
+    _b8OsFreeTcb( tcb );
+  }
+}
+
+static  void  _b8OsPreemptIfNeeded(void){
+  Tcb* tcb_cur = _b8OsGetCurrentTcb();
+  Tcb* tcb_top = ReadyQueueHighest();
+  if( NULL == tcb_top || tcb_top == tcb_cur ) return;
+  if( tcb_cur->ready && tcb_top->priority <= tcb_cur->priority ) return;
+
+  ReqSchedule rs;
+  ReqScheduleClear( &rs );
+  rs.req = REQ_SCHEDULE_PREEMPT;
+  _b8OsProcessScheduler( &rs );
+  // It won't get here
 }
 
 static  void  _b8OsProcessScheduler(ReqSchedule* rs){
   if( rs->req == REQ_SCHEDULE_NONE ) return;
 
-  u32 cyccnt;
-  _Config.ArchDriverGetCycleAndClear( &cyccnt );
-  _CycCnt += (u64)cyccnt;
-  const b8OsUsec  dt = ((u64)cyccnt * _UsPerCpuCycleFixed8 )>>8;
-  _AccumelatedTime += dt;
-
   Tcb* tcb_cur = _b8OsGetCurrentTcb();
   KPANIC(tcb_cur ,"invalid tcb_cur" );
   if(tcb_cur->status == TS_READY ){
@@ -1156,91 +1749,83 @@ static  void  _b8OsProcessScheduler(ReqSchedule* rs){
     b8OsPid pid_pickup = _b8OsPickThreadWaitingForIrq();
     if( pid_pickup != B8_OS_INVALID_PID ){
       _b8OsAwakePid( pid_pickup );
-      // It won't get here
     }
   }
 
   if( rs->req & REQ_SCHEDULE_REGULAR ){
-    // Check if there is any pid waiting for semaphore.
-    {
-      b8OsPid pid_pickup = _b8OsPickupThreadWaitingForSemaphoreTimeOut();
-      if( pid_pickup != B8_OS_INVALID_PID ){
-        Tcb* tcb = _b8OsGetTcb( pid_pickup );
-        KPANIC( tcb , "invalid tcb" );
-
+    // Wake up the threads whose sleep or semaphore timeout has expired.
+    Tcb* tcb;
+    while( NULL != (tcb = TimerQueuePopExpired( _AccumelatedTime )) ){
+      if( tcb->waiting_for == TWF_SEMAPHORE ){
         Semaphore* sem = _b8OsGetSemaphore( tcb->sid_wait );
         sem->semcount++;
         tcb->sid_wait = B8_OS_INVALID_SID;
-
-        _b8OsSetErrorInBridge( -ETIMEDOUT , pid_pickup );
-        _b8OsGiveBridgeToUsrByPid( pid_pickup );
-
-        _b8OsAwakePid( pid_pickup );
-        // It won't get here
+        _b8OsSetErrorInBridge( -ETIMEDOUT , tcb->pid );
+      } else if( tcb->waiting_for == TWF_FUTEX ){
+        tcb->futex = 0;
+        _b8OsSetErrorInBridge( -ETIMEDOUT , tcb->pid );
       }
+      _b8OsAwakePid( tcb->pid );
     }
 
-    // Check if there is any pid waiting for timer.
-    {
-      b8OsPid pid_pickup = _b8OsPickupThreadWaitingForTimer();
-      if( pid_pickup != B8_OS_INVALID_PID ){
-        _b8OsAwakePid( pid_pickup );
-        // It won't get here
-      }
+    // The time slice of a SCHED_RR thread is over.
+    if( tcb_cur->scheduling_policy == B8_OS_SCHED_RR ){
+      ReadyQueueRotate( tcb_cur );
     }
   }
 
   if( rs->req & REQ_SCHEDULE_SEMAPHORE_WAIT  ){
-    _b8OsWaitCurrentPid( TWF_SEMAPHORE );
+    Semaphore* sem = _b8OsGetSemaphore( tcb_cur->sid_wait );
+    KPANIC( sem , "invalid sid_wait" );
+    Tcb* tcb_wait = _b8OsWaitCurrentPid( TWF_SEMAPHORE , &sem->waiters );
+    if( tcb_wait->wake_up_time != B8_OS_USEC_INFINITE ){
+      TimerQueueInsert( tcb_wait );
+    }
+
+  // yield
+  } else if( rs->req & REQ_SCHEDULE_IRQ_WAIT ){
+    Tcb* tcb_wait = _b8OsWaitCurrentPid( TWF_IRQ_EVENT , NULL );
+    tcb_wait->irq_wait = rs->irq;
+    _IrqEvents[ rs->irq ].waiters |= 1u << (tcb_wait->pid & 0xffff);
+
+  } else if( rs->req & REQ_SCHEDULE_FUTEX_WAIT ){
+    Tcb* tcb_wait = _b8OsWaitCurrentPid( TWF_FUTEX , FutexQueue( tcb_cur->futex ) );
+    if( tcb_wait->wake_up_time != B8_OS_USEC_INFINITE ){
+      TimerQueueInsert( tcb_wait );
+    }
+
+  } else if( rs->req & REQ_SCHEDULE_JOIN_WAIT ){
+    _b8OsWaitCurrentPid( TWF_JOIN , NULL );
 
   // yield
   } else if( rs->req & REQ_SCHEDULE_YIELD ){
-    _b8OsWaitCurrentPid(
-      _b8OsGetTcb( _CurrentPid )->irq == B8_OS_NOT_USING_IRQ ?
-      TWF_YIELD : TWF_IRQ
-    );
+    if( tcb_cur->irq == B8_OS_NOT_USING_IRQ ){
+      ReadyQueueRotate( tcb_cur );
+    } else {
+      _b8OsWaitCurrentPid( TWF_IRQ , &_IrqEvents[ tcb_cur->irq ].threads );
+    }
 
   } else if( rs->req & REQ_SCHEDULE_YIELD_TIME ){
-    Tcb* tcb_yield = _b8OsWaitCurrentPid( TWF_TIMER );
-    tcb_yield->wake_up_time = _AccumelatedTime + rs->sleep_time;
+    Tcb* tcb_yield = _b8OsWaitCurrentPid( TWF_TIMER , NULL );
+    tcb_yield->wake_up_time =
+      rs->sleep_time < B8_OS_USEC_INFINITE - _AccumelatedTime ?
+      _AccumelatedTime + rs->sleep_time : B8_OS_USEC_INFINITE;
+    TimerQueueInsert( tcb_yield );
 
   // wake up a task that is waiting for semaphore.
   } else if( rs->req & REQ_SCHEDULE_AWAKE_THREAD_WAITING_FOR_SEMAPHORE ){
     _b8OsAwakePid( _b8OsPickupThreadWaitingForSemaphore( rs->sid ) );
-    // It won't get here
 
   // exit
   } else if( rs->req & REQ_SCHEDULE_EXIT_THREAD ){
-    ListErase( _ReadyTasksList , rs->pid );
-    ListErase( _WaitingTasksList , rs->pid );
-    ListPushBack( _ZombieTasksList , rs->pid );
-  }
-
-  // wake up TWF_YIELD
-  if( ListSize( _WaitingTasksList ) > 0 ){
-    b8OsPid pid = _b8OsPickupThreadYield();
-    if( pid != B8_OS_INVALID_PID ){
-      _b8OsAwakePid( pid );
-      // It won't get here.
-    }
-  }
-
-  static int _debug_sel = 0;
-  if( ListSize( _ReadyTasksList ) > 1 ){
-    const u32 sel = 1 + (_debug_sel % (ListSize( _ReadyTasksList )-1) );
-    Node* node_pick = ListAt( _ReadyTasksList , sel );
-    if( node_pick ){
-      _debug_sel++;
-      _b8OsSwitchPidAndBackToUsr( node_pick->pid );
-      // It won't get here
-    }
+    Tcb* tcb_exit = _b8OsGetTcb( rs->pid );
+    KPANIC( tcb_exit , "invalid tcb_exit" );
+    _b8OsThreadTerminate( tcb_exit , rs->exit_value );
   }
 
-  // pick up idle thread
-  Node* node_pick = ListAt( _ReadyTasksList , 0 );
-  KPANIC( node_pick , "not found idle pid" );
-  KPANIC( node_pick->pid == _IdlePid , "invalid idle pid" );
-  _b8OsSwitchPidAndBackToUsr( node_pick->pid );
+  // pick up the highest priority thread, or the idle thread if none is ready.
+  Tcb* tcb_pick = ReadyQueueHighest();
+  _b8OsSwitchPidAndBackToUsr( tcb_pick ? tcb_pick->pid : _IdlePid );
   // It won't get here
 }
 
@@ -1269,6 +1854,14 @@ static  int _b8OsIrqAttach(int irq,b8IrqHandler isr,void* arg){
   return B8_OS_OK;
 }
 
+// Routes irq to the scheduler, unless it already is.
+static  int _b8OsIrqUse(u32 irq){
+  if( irq < B8_IRQ_NUM_OF_INTERRUPTS && _IrqInfo[ irq ].handler == _b8OsIrqDispatch ){
+    return  B8_OS_OK;
+  }
+  return  _b8OsIrqAttach( irq, _b8OsIrqDispatch, NULL );
+}
+
 #define B8_MIF_ADDR             (0xffffd000)
 #define B8_MIF_DATAABORT_ADDR   _B8_REG(B8_MIF_ADDR + 0x00)
 
@@ -1303,6 +1896,28 @@ void  b8OsIrqDispatchEntry(void){
   isr( irq , _IrqInfo[ irq ].arg );
 }
 
+void b8OsSetTickHook( b8OsTickHook hook ){
+  _TickHook = hook;
+}
+
+void b8OsGetStackPoolInfo( b8OsStackPoolInfo* info ){
+  info->size   = _StackPool.size;
+  info->carved = _StackPool.carved;
+  info->free   = _StackPool.free_bytes;
+}
+
+u32 b8OsGetIrqCount( u32 irq ){
+  return  irq < B8_IRQ_NUM_OF_INTERRUPTS ? _IrqEvents[ irq ].count : 0;
+}
+
+u32 b8OsGetIrqCycle( u32 irq ){
+  return  irq < B8_IRQ_NUM_OF_INTERRUPTS ? _IrqEvents[ irq ].cyccnt : 0;
+}
+
+const volatile b8OsTimePage* b8OsGetTimePage(void){
+  return  &_TimePage;
+}
+
 int  b8OsIsRunning(void){
   return  _IsRunning;
 }
\ No newline at end of file
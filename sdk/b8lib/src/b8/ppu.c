@@ -1,7 +1,52 @@
 #include <beep8.h>
+#include <string.h>
 
 #define CHKOVL() _ASSERT( cmd_->sp < cmd_->tail , "ppu cmd overflow" )
 
+#if B8_PPU_STATS
+static  b8PpuStats  _stats_cur;
+static  b8PpuStats  _stats_last;
+#define STAT_PRIM( kind_ )  ( ++_stats_cur.prims[ (kind_) ] )
+#define STAT_JMP()          ( ++_stats_cur.jmp_words )
+#define STAT_OT( otz_ , words_ )  \
+  ( _stats_cur.ot_words[ (otz_) < B8_PPU_STATS_MAX_OTZ ? (otz_) : B8_PPU_STATS_MAX_OTZ-1 ] += (words_) )
+
+// Words of a primitive, from its code. Commands allocated after it and before
+// it is linked are not its own, so the distance to cmd_->sp would overcount.
+static  u32   _b8PpuPrimWords( const void* prim_ ){
+  switch( *(const u32*)prim_ >> 24 ){
+    case B8_PPU_CMD_RECT:       return sizeof(b8PpuRect)/sizeof(u32);
+    case B8_PPU_CMD_POLY:       return sizeof(b8PpuPoly)/sizeof(u32);
+    case B8_PPU_CMD_SPRITE:     return sizeof(b8PpuSprite)/sizeof(u32);
+    case B8_PPU_CMD_SETPAL:     return sizeof(b8PpuSetpal)/sizeof(u32);
+    case B8_PPU_CMD_BG:         return sizeof(b8PpuBg)/sizeof(u32);
+    case B8_PPU_CMD_SCISSOR:    return sizeof(b8PpuScissor)/sizeof(u32);
+    case B8_PPU_CMD_VIEWOFFSET: return sizeof(b8PpuViewoffset)/sizeof(u32);
+    case B8_PPU_CMD_LOADIMG:    return sizeof(b8PpuLoadimg)/sizeof(u32);
+    case B8_PPU_CMD_LINE:       return sizeof(b8PpuLine)/sizeof(u32);
+    case B8_PPU_CMD_FLUSH:      return sizeof(b8PpuFlush)/sizeof(u32);
+    case B8_PPU_CMD_ENABLE:     return sizeof(b8PpuEnable)/sizeof(u32);
+    case B8_PPU_CMD_HALT:       return sizeof(b8PpuHalt)/sizeof(u32);
+    case B8_PPU_CMD_NOP:        return sizeof(b8PpuNop)/sizeof(u32);
+    default:                    return 1;
+  }
+}
+#else
+#define STAT_PRIM( kind_ )        ((void)0)
+#define STAT_JMP()                ((void)0)
+#define STAT_OT( otz_ , words_ )  ((void)0)
+#endif
+
+// Counts b8PpuClearOT() calls, so that a segment can tell it is linked twice in one OT build.
+static  u32   _ot_builds;
+
+// OT build and fence of the last two lists started, so that a segment is not
+// relinked while a list that jumps through its tail is still in flight. With a
+// b8PpuCmdPair, older lists have retired before the last one was started.
+static  u32         _exec_builds[ 2 ];
+static  b8PpuFence  _exec_fences[ 2 ];
+static  u32         _exec_count;
+
 union	fc32 {
   u32 	aU32;
   u32* 	pU32;
@@ -22,6 +67,7 @@ b8PpuRect* b8PpuRectAlloc( b8PpuCmd* cmd_ ){
   b8PpuRect* pp = (b8PpuRect*)cmd_->sp;
   cmd_->sp = (u32*)(pp+1);
   CHKOVL();
+  STAT_PRIM( B8_PPU_STAT_RECT );
   pp->code = B8_PPU_CMD_RECT;
   return pp;
 }
@@ -42,6 +88,7 @@ b8PpuSprite* b8PpuSpriteAlloc( b8PpuCmd* cmd_ ){
   b8PpuSprite* pp = (b8PpuSprite*)cmd_->sp;
   cmd_->sp = (u32*)(pp+1);
   CHKOVL();
+  STAT_PRIM( B8_PPU_STAT_SPRITE );
   pp->code = B8_PPU_CMD_SPRITE;
   pp->vfp = pp->hfp = 0;
   return pp;
@@ -63,6 +110,7 @@ b8PpuSetpal* b8PpuSetpalAlloc( b8PpuCmd* cmd_ ){
   b8PpuSetpal* pp = (b8PpuSetpal*)cmd_->sp;
   cmd_->sp = (u32*)(pp+1);
   CHKOVL();
+  STAT_PRIM( B8_PPU_STAT_SETPAL );
   pp->code = B8_PPU_CMD_SETPAL;
   pp->palsel = 0;
   pp->wmask = 0xffff;
@@ -103,6 +151,23 @@ void  b8PpuExec( b8PpuCmd* cmd_ ){
   __asm("nop");
   B8_PPU_EXEC = (B8_PPU_EXEC_START<<24) | (u32) cmd_->buff;
   __asm("nop");
+
+  // Sampled after the kick: a V-blank serviced in between only makes the fence conservative.
+  const u32 slot = _exec_count++ & 1;
+  _exec_builds[ slot ] = _ot_builds;
+  _exec_fences[ slot ] = b8SysGetIrqCount( B8_IRQ_VBLK );
+
+#if B8_PPU_STATS
+  // A frame ends at every exec.
+  const u32 used = (u32)( cmd_->sp - cmd_->buff );
+  const u32 peak = _stats_last.peak_words > used ? _stats_last.peak_words : used;
+  const u32 frames = _stats_last.frames + 1;
+  _stats_last = _stats_cur;
+  _stats_last.used_words = used;
+  _stats_last.peak_words = peak;
+  _stats_last.frames = frames;
+  memset( &_stats_cur, 0, sizeof(_stats_cur) );
+#endif
 }
 
 void  b8PpuEnableVblankInterrupt( void ){
@@ -113,6 +178,7 @@ b8PpuScissor* b8PpuScissorAlloc( b8PpuCmd* cmd_ ){
   b8PpuScissor* pp = (b8PpuScissor*)cmd_->sp;
   cmd_->sp = (u32*)(pp+1);
   CHKOVL();
+  STAT_PRIM( B8_PPU_STAT_OTHER );
   pp->code = B8_PPU_CMD_SCISSOR;
   return pp;
 }
@@ -132,6 +198,7 @@ b8PpuScissor* b8PpuScissorAllocZPB( b8PpuCmd* cmd_ , u32 otz_ ){
 b8PpuBg* b8PpuBgAlloc( b8PpuCmd* cmd_ ){
   b8PpuBg* pp = (b8PpuBg*)cmd_->sp;
   cmd_->sp = (u32*)(pp+1);
+  STAT_PRIM( B8_PPU_STAT_BG );
   pp->code = B8_PPU_CMD_BG;
   pp->vwrap = pp->uwrap = B8_PPU_BG_WRAP_CLAMP;
   return pp;
@@ -153,6 +220,7 @@ b8PpuPoly* b8PpuPolyAlloc( b8PpuCmd* cmd_ ){
   b8PpuPoly* pp = (b8PpuPoly*)cmd_->sp;
   cmd_->sp = (u32*)(pp+1);
   CHKOVL();
+  STAT_PRIM( B8_PPU_STAT_POLY );
   pp->code = B8_PPU_CMD_POLY;
   return pp;
 }
@@ -173,6 +241,7 @@ b8PpuLine* b8PpuLineAlloc( b8PpuCmd* cmd_ ){
   b8PpuLine* pp = (b8PpuLine*)cmd_->sp;
   cmd_->sp = (u32*)(pp+1);
   CHKOVL();
+  STAT_PRIM( B8_PPU_STAT_LINE );
   pp->code = B8_PPU_CMD_LINE;
   return pp;
 }
@@ -193,6 +262,7 @@ b8PpuViewoffset* b8PpuViewoffsetAlloc( b8PpuCmd* cmd_ ){
   b8PpuViewoffset* pp = (b8PpuViewoffset*)cmd_->sp;
   cmd_->sp = (u32*)(pp+1);
   CHKOVL();
+  STAT_PRIM( B8_PPU_STAT_OTHER );
   pp->code = B8_PPU_CMD_VIEWOFFSET;
   return pp;
 }
@@ -213,6 +283,7 @@ b8PpuNop* b8PpuNopAlloc( b8PpuCmd* cmd_ ){
   b8PpuNop* pp = (b8PpuNop*)cmd_->sp;
   cmd_->sp = (u32*)(pp+1);
   CHKOVL();
+  STAT_PRIM( B8_PPU_STAT_OTHER );
   pp->code = B8_PPU_CMD_NOP;
   return pp;
 }
@@ -233,6 +304,7 @@ b8PpuFlush* b8PpuFlushAlloc( b8PpuCmd* cmd_ ){
   b8PpuFlush* pp = (b8PpuFlush*)cmd_->sp;
   cmd_->sp = (u32*)(pp+1);
   CHKOVL();
+  STAT_PRIM( B8_PPU_STAT_FLUSH );
   pp->code = B8_PPU_CMD_FLUSH;
   pp->img = pp->pal = 0;
   return pp;
@@ -254,6 +326,7 @@ b8PpuHalt* b8PpuHaltAlloc( b8PpuCmd* cmd_ ){
   b8PpuHalt* pp = (b8PpuHalt*)cmd_->sp;
   cmd_->sp = (u32*)(pp+1);
   CHKOVL();
+  STAT_PRIM( B8_PPU_STAT_OTHER );
   pp->code = B8_PPU_CMD_HALT;
   return pp;
 }
@@ -274,6 +347,7 @@ b8PpuEnable* b8PpuEnableAlloc( b8PpuCmd* cmd_ ){
   b8PpuEnable* pp = (b8PpuEnable*)cmd_->sp;
   cmd_->sp = (u32*)(pp+1);
   CHKOVL();
+  STAT_PRIM( B8_PPU_STAT_OTHER );
   pp->code = B8_PPU_CMD_ENABLE;
   pp->cul = 0;
   return pp;
@@ -295,6 +369,7 @@ b8PpuLoadimg* b8PpuLoadimgAlloc( b8PpuCmd* cmd_ ){
   b8PpuLoadimg* pp = (b8PpuLoadimg*)cmd_->sp;
   cmd_->sp = (u32*)(pp+1);
   CHKOVL();
+  STAT_PRIM( B8_PPU_STAT_LOADIMG );
   pp->code = B8_PPU_CMD_LOADIMG;
   return pp;
 }
@@ -315,6 +390,7 @@ b8PpuJmp* b8PpuJmpAlloc( b8PpuCmd* cmd_ , u32* cpuaddr_ ){
   b8PpuJmp* pp = (b8PpuJmp*)cmd_->sp;
   cmd_->sp = (u32*)(pp+1);
   CHKOVL();
+  STAT_JMP();
   pp->code = B8_PPU_CMD_JMP;
 
   union fc32 fc;
@@ -328,6 +404,7 @@ void  b8PpuClearOT( b8PpuCmd* cmd_ , u32* ot_ , u32* ot_prev_ , u32 num_ ){
   cmd_->ot = ot_;
   cmd_->ot_prev = ot_prev_;
   cmd_->otnum = num_;
+  ++_ot_builds;
   b8PpuJmpAlloc( cmd_ , &ot_[ num_ - 1 ] );
 
   cmd_->addr_halt = (u32*)b8PpuHaltAlloc( cmd_ );
@@ -355,6 +432,8 @@ void  b8PpuPushFrontOT( b8PpuCmd* cmd_ , u32 otz_ , void* prim_ ){
 
   *( cmd_->sp++ ) = *(cmd_->ot + otz_);
   CHKOVL();
+  STAT_JMP();
+  STAT_OT( otz_ , _b8PpuPrimWords( prim_ ) + 1 );   // and its JMP
 
   union fc32 fc_prim;
   fc_prim.pU32 = prim_;
@@ -374,6 +453,8 @@ void  b8PpuPushBackOT( b8PpuCmd* cmd_ , u32 otz_ , void* prim_ ){
   fc_jmp_back.pU32 = cmd_->sp;
   *( cmd_->sp++ ) = *fc_jmp.pU32;
   CHKOVL();
+  STAT_JMP();
+  STAT_OT( otz_ , _b8PpuPrimWords( prim_ ) + 1 );   // and its JMP
 
   union fc32 fc_prim;
   fc_prim.pU32 = prim_;
@@ -382,6 +463,65 @@ void  b8PpuPushBackOT( b8PpuCmd* cmd_ , u32 otz_ , void* prim_ ){
   cmd_->ot_prev[ otz_ ] = fc_jmp_back.aU32;
 }
 
+void  b8PpuSegmentBegin( b8PpuSegment* seg_ , u32* buff_ , u32 bytesize_ ){
+  b8PpuCmdSetBuff( &seg_->cmd , buff_ , bytesize_ );
+  seg_->cmd.ot = NULL;
+  seg_->cmd.ot_prev = NULL;
+  seg_->cmd.otnum = 0;
+  seg_->cmd.addr_halt = NULL;
+  seg_->head = buff_;
+  seg_->tail = NULL;
+  seg_->linked = _ot_builds - 1;
+}
+
+void  b8PpuSegmentEnd( b8PpuSegment* seg_ ){
+  // The target is patched when the segment is linked. Until then, it points to itself.
+  seg_->tail = b8PpuJmpAlloc( &seg_->cmd , seg_->cmd.sp );
+}
+
+// A second link would re-target the shared tail JMP, and may close the chain into a loop.
+// So would a link while the list of the previous one is still in flight.
+static  void  _b8PpuSegmentMarkLinked( b8PpuSegment* seg_ ){
+  _ASSERT( seg_->tail , "segment not ended" );
+  _ASSERT( seg_->linked != _ot_builds , "segment already linked in this OT build" );
+  for( u32 nn=0 ; nn < 2 && nn < _exec_count ; ++nn ){
+    _ASSERT( _exec_builds[ nn ] != seg_->linked || b8PpuFenceDone( _exec_fences[ nn ] ) ,
+             "segment relinked while its previous list is in flight" );
+  }
+  seg_->linked = _ot_builds;
+}
+
+void  b8PpuSegmentLinkFront( b8PpuCmd* cmd_ , u32 otz_ , b8PpuSegment* seg_ ){
+  _ASSERT( otz_ < cmd_->otnum , "invalid otz_" );
+  _b8PpuSegmentMarkLinked( seg_ );
+
+  b8PpuJmp* jmp = (b8PpuJmp*)(cmd_->ot + otz_);
+  *seg_->tail = *jmp;
+  STAT_OT( otz_ , (u32)( seg_->cmd.sp - seg_->head ) );
+
+  union fc32 fc_head;
+  fc_head.pU32 = seg_->head;
+  jmp->cpuaddr4 = fc_head.aU32>>2;
+}
+
+void  b8PpuSegmentLinkBack( b8PpuCmd* cmd_ , u32 otz_ , b8PpuSegment* seg_ ){
+  _ASSERT( otz_ < cmd_->otnum , "invalid otz_" );
+  _b8PpuSegmentMarkLinked( seg_ );
+
+  union fc32 fc_jmp;
+  fc_jmp.aU32 = cmd_->ot_prev[ otz_ ];
+  *seg_->tail = *fc_jmp.pJmp;
+  STAT_OT( otz_ , (u32)( seg_->cmd.sp - seg_->head ) );
+
+  union fc32 fc_head;
+  fc_head.pU32 = seg_->head;
+  fc_jmp.pJmp->cpuaddr4 = fc_head.aU32>>2;
+
+  union fc32 fc_tail;
+  fc_tail.pJmp = seg_->tail;
+  cmd_->ot_prev[ otz_ ] = fc_tail.aU32;
+}
+
 void  b8PpuReset( void ){
   b8SysSetupIrqWait( B8_IRQ_VBLK );
   b8PpuEnableVblankInterrupt();
@@ -391,6 +531,60 @@ void  b8PpuVsyncWait( void ){
   b8SysIrqClearAndWait( B8_IRQ_VBLK );
 }
 
+b8PpuFence  b8PpuExecFence( b8PpuCmd* cmd_ ){
+  b8PpuExec( cmd_ );
+  return  _exec_fences[ ( _exec_count - 1 ) & 1 ];
+}
+
+int   b8PpuFenceDone( b8PpuFence fence_ ){
+  return  b8SysGetIrqCount( B8_IRQ_VBLK ) != fence_;
+}
+
+void  b8PpuFenceWait( b8PpuFence fence_ ){
+  while( !b8PpuFenceDone( fence_ ) ){
+    const int res = b8SysIrqClearAndWait( B8_IRQ_VBLK );
+    _ASSERT( res >= 0 , "ppu fence: V-blank wait failed" );
+  }
+}
+
+void  b8PpuCmdPairInit( b8PpuCmdPair* pair_ , u32* buff0_ , u32* buff1_ , u32 bytesize_ ){
+  pair_->buff[0] = buff0_;
+  pair_->buff[1] = buff1_;
+  pair_->bytesize = bytesize_;
+  pair_->back = 0;
+
+  // Neither buffer is in flight yet, so start with already signaled fences.
+  pair_->fence[0] = pair_->fence[1] = b8SysGetIrqCount( B8_IRQ_VBLK ) - 1;
+}
+
+void  b8PpuCmdPairBegin( b8PpuCmdPair* pair_ , b8PpuCmd* cmd_ ){
+  b8PpuFenceWait( pair_->fence[ pair_->back ] );
+  b8PpuCmdSetBuff( cmd_ , pair_->buff[ pair_->back ] , pair_->bytesize );
+}
+
+void  b8PpuCmdPairSubmit( b8PpuCmdPair* pair_ , b8PpuCmd* cmd_ ){
+  _ASSERT( cmd_->buff == pair_->buff[ pair_->back ] , "not the back buffer" );
+
+  b8PpuFenceWait( pair_->fence[ pair_->back ^ 1 ] );
+  pair_->fence[ pair_->back ] = b8PpuExecFence( cmd_ );
+  pair_->back ^= 1;
+}
+
+void  b8PpuCmdPairSync( b8PpuCmdPair* pair_ ){
+  b8PpuFenceWait( pair_->fence[0] );
+  b8PpuFenceWait( pair_->fence[1] );
+}
+
+int   b8PpuGetStats( b8PpuStats* stats_ ){
+#if B8_PPU_STATS
+  *stats_ = _stats_last;
+  return 0;
+#else
+  (void)stats_;
+  return -1;
+#endif
+}
+
 void  b8PpuGetResolution( u32* ww, u32* hh ){
   const u32 res = B8_PPU_RESOLUTION;
   *ww = (res >> 16);
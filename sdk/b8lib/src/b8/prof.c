@@ -0,0 +1,293 @@
+#include <beep8.h>
+#include <b8/prof.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PROF_ZONE_NONE    (0xff)
+#define PROF_DUMP_VERSION (1)
+#define PROF_SAMPLE_PROBE (8)
+
+typedef struct {
+  const char* name;
+  u64 total;
+  u32 frames;
+  u32 calls;
+  u32 last;
+  u32 min;
+  u32 max;
+  u32 cur_cycles;
+  u32 cur_calls;
+} ProfZone;
+
+typedef struct {
+  u32 begin;
+  u8  zone;
+} ProfOpen;
+
+static  ProfZone    _zones[ B8_PROF_MAX_ZONES ];
+static  int         _num_zones;
+static  int         _enabled;
+static  ProfOpen    _stack[ B8_PROF_MAX_DEPTH ];
+static  u32         _depth;
+static  u32         _frame_begin;
+
+// events of the current frame, as a ring
+static  b8ProfEvent _ring[ B8_PROF_MAX_EVENTS ];
+static  u32         _num_events;
+
+// events of the last closed frame, oldest first
+static  b8ProfEvent _last[ B8_PROF_MAX_EVENTS ];
+static  u16         _last_num;
+static  u16         _last_dropped;
+static  u32         _last_cycles;
+
+// sampling histogram, open addressing keyed by pc and pid
+static  b8ProfSample  _samples[ B8_PROF_MAX_SAMPLE_PCS ];
+static  size_t        _num_samples;
+static  u32           _sample_total;
+static  u32           _sample_lost;
+static  int           _sampling;
+
+int b8ProfZone( const char* name ){
+  for( int nn=0 ; nn<_num_zones ; ++nn ){
+    if( _zones[ nn ].name == name || 0 == strcmp( _zones[ nn ].name, name ) ) return nn;
+  }
+  if( _num_zones >= B8_PROF_MAX_ZONES ) return -1;
+
+  ProfZone* zone = &_zones[ _num_zones ];
+  memset( zone, 0, sizeof(*zone) );
+  zone->name = name;
+  return  _num_zones++;
+}
+
+void  b8ProfEnable( int enable ){
+  _enabled = enable ? 1 : 0;
+  _depth = 0;
+}
+
+int   b8ProfIsEnabled( void ){
+  return  _enabled;
+}
+
+void  b8ProfBegin( int zone ){
+  if( !_enabled ) return;
+  if( _depth < B8_PROF_MAX_DEPTH ){
+    ProfOpen* op = &_stack[ _depth ];
+    op->zone  = ( zone >= 0 && zone < _num_zones ) ? (u8)zone : PROF_ZONE_NONE;
+    op->begin = B8_DWT_CYCCNT;
+  }
+  ++_depth;
+}
+
+void  b8ProfEnd( void ){
+  const u32 now = B8_DWT_CYCCNT;
+  if( !_enabled || 0 == _depth )  return;
+
+  --_depth;
+  if( _depth >= B8_PROF_MAX_DEPTH ) return;
+  const ProfOpen* op = &_stack[ _depth ];
+  if( op->zone == PROF_ZONE_NONE )  return;
+
+  const u32 cycles = now - op->begin;
+  ProfZone* zone = &_zones[ op->zone ];
+  zone->cur_cycles += cycles;
+  ++zone->cur_calls;
+
+  // A zone carried over from the previous frame begins at 0.
+  const s32 begin = (s32)( op->begin - _frame_begin );
+  b8ProfEvent* ev = &_ring[ _num_events % B8_PROF_MAX_EVENTS ];
+  ev->zone   = op->zone;
+  ev->depth  = (u8)_depth;
+  ev->reserved = 0;
+  ev->begin  = begin < 0 ? 0 : (u32)begin;
+  ev->cycles = cycles;
+  ++_num_events;
+}
+
+void  b8ProfFrame( void ){
+  const u32 now = B8_DWT_CYCCNT;
+
+  for( int nn=0 ; nn<_num_zones ; ++nn ){
+    ProfZone* zone = &_zones[ nn ];
+    zone->calls = zone->cur_calls;
+    zone->last  = zone->cur_cycles;
+    if( zone->cur_calls ){
+      if( 0 == zone->frames || zone->cur_cycles < zone->min ) zone->min = zone->cur_cycles;
+      if( zone->cur_cycles > zone->max ) zone->max = zone->cur_cycles;
+      zone->total += zone->cur_cycles;
+      ++zone->frames;
+    }
+    zone->cur_cycles = 0;
+    zone->cur_calls  = 0;
+  }
+
+  const u32 num = _num_events < B8_PROF_MAX_EVENTS ? _num_events : B8_PROF_MAX_EVENTS;
+  const u32 oldest = _num_events - num;
+  for( u32 nn=0 ; nn<num ; ++nn ){
+    _last[ nn ] = _ring[ (oldest + nn) % B8_PROF_MAX_EVENTS ];
+  }
+  _last_num     = (u16)num;
+  _last_dropped = (u16)( oldest > 0xffff ? 0xffff : oldest );
+  _last_cycles  = now - _frame_begin;
+
+  _num_events  = 0;
+  _frame_begin = now;
+}
+
+int   b8ProfGetZoneStats( int zone, b8ProfZoneStats* stats ){
+  if( zone < 0 || zone >= _num_zones || 0 == stats )  return -1;
+
+  const ProfZone* pz = &_zones[ zone ];
+  stats->name   = pz->name;
+  stats->frames = pz->frames;
+  stats->calls  = pz->calls;
+  stats->last   = pz->last;
+  stats->min    = pz->min;
+  stats->max    = pz->max;
+  stats->avg    = pz->frames ? (u32)( pz->total / pz->frames ) : 0;
+  return  0;
+}
+
+int   b8ProfGetNumZones( void ){
+  return  _num_zones;
+}
+
+size_t  b8ProfGetEvents( const b8ProfEvent** events, u32* cycles ){
+  if( events )  *events = _last;
+  if( cycles )  *cycles = _last_cycles;
+  return  _last_num;
+}
+
+static  u8* _put16( u8* pp, u32 vv ){
+  *pp++ = (u8)vv;
+  *pp++ = (u8)( vv >> 8 );
+  return  pp;
+}
+
+static  u8* _put32( u8* pp, u32 vv ){
+  pp = _put16( pp, vv );
+  return  _put16( pp, vv >> 16 );
+}
+
+static  int _write_all( int fd, const void* buff, size_t len ){
+  const u8* pp = (const u8*)buff;
+  size_t rest = len;
+  while( rest ){
+    const ssize_t ret = write( fd, pp, rest );
+    if( ret <= 0 ) return -1;
+    pp   += ret;
+    rest -= (size_t)ret;
+  }
+  return  (int)len;
+}
+
+int   b8ProfDump( int fd ){
+  u8  buff[ 24 ];
+  u8* pp = buff;
+  memcpy( pp, "B8PF", 4 );  pp += 4;
+  pp = _put16( pp, PROF_DUMP_VERSION );
+  pp = _put16( pp, (u32)_num_zones );
+  pp = _put32( pp, b8SysGetCpuClock() );
+  pp = _put32( pp, _last_cycles );
+  pp = _put16( pp, _last_num );
+  pp = _put16( pp, _last_dropped );
+
+  int total = 0;
+  if( _write_all( fd, buff, (size_t)(pp - buff) ) < 0 ) return -1;
+  total += pp - buff;
+
+  for( int nn=0 ; nn<_num_zones ; ++nn ){
+    size_t len = strlen( _zones[ nn ].name );
+    if( len > 0xff )  len = 0xff;
+    const u8 len8 = (u8)len;
+    if( _write_all( fd, &len8, 1 ) < 0 )  return -1;
+    if( _write_all( fd, _zones[ nn ].name, len ) < 0 )  return -1;
+    total += 1 + (int)len;
+  }
+
+  for( u32 nn=0 ; nn<_last_num ; ++nn ){
+    const b8ProfEvent* ev = &_last[ nn ];
+    pp = buff;
+    *pp++ = ev->zone;
+    *pp++ = ev->depth;
+    pp = _put16( pp, 0 );
+    pp = _put32( pp, ev->begin );
+    pp = _put32( pp, ev->cycles );
+    if( _write_all( fd, buff, (size_t)(pp - buff) ) < 0 ) return -1;
+    total += pp - buff;
+  }
+  return  total;
+}
+
+// Runs in the timer interrupt.
+static  void  _sample_tick( u32 pc, b8OsPid pid ){
+  ++_sample_total;
+  const u32 hash = ( (pc >> 2) ^ (pid << 16) ) * 2654435761u;
+  for( u32 nn=0 ; nn<PROF_SAMPLE_PROBE ; ++nn ){
+    b8ProfSample* ss = &_samples[ ( (hash >> 16) + nn ) % B8_PROF_MAX_SAMPLE_PCS ];
+    if( 0 == ss->count ){
+      ss->pc  = pc;
+      ss->pid = (u16)pid;
+      ss->count = 1;
+      ++_num_samples;
+      return;
+    }
+    if( ss->pc == pc && ss->pid == (u16)pid ){
+      ++ss->count;
+      return;
+    }
+  }
+  ++_sample_lost;
+}
+
+void  b8ProfSampleEnable( int enable ){
+  _sampling = enable ? 1 : 0;
+  b8OsSetTickHook( _sampling ? _sample_tick : NULL );
+}
+
+void  b8ProfSampleClear( void ){
+  b8OsSetTickHook( NULL );
+  memset( _samples, 0, sizeof(_samples) );
+  _num_samples  = 0;
+  _sample_total = 0;
+  _sample_lost  = 0;
+  b8OsSetTickHook( _sampling ? _sample_tick : NULL );
+}
+
+size_t  b8ProfGetSamples( const b8ProfSample** samples, u32* total, u32* lost ){
+  if( samples ) *samples = _samples;
+  if( total )   *total = _sample_total;
+  if( lost )    *lost  = _sample_lost;
+  return  _num_samples;
+}
+
+int   b8ProfSampleDump( int fd ){
+  b8OsSetTickHook( NULL );
+
+  u8  buff[ 24 ];
+  u8* pp = buff;
+  memcpy( pp, "B8PS", 4 );  pp += 4;
+  pp = _put16( pp, PROF_DUMP_VERSION );
+  pp = _put16( pp, 0 );
+  pp = _put32( pp, b8SysGetCpuClock() );
+  pp = _put32( pp, _sample_total );
+  pp = _put32( pp, _sample_lost );
+  pp = _put16( pp, (u32)_num_samples );
+  pp = _put16( pp, 0 );
+
+  int total = _write_all( fd, buff, (size_t)(pp - buff) );
+  for( u32 nn=0 ; total >= 0 && nn<B8_PROF_MAX_SAMPLE_PCS ; ++nn ){
+    const b8ProfSample* ss = &_samples[ nn ];
+    if( 0 == ss->count )  continue;
+    pp = buff;
+    pp = _put32( pp, ss->pc );
+    pp = _put16( pp, ss->pid );
+    pp = _put16( pp, 0 );
+    pp = _put32( pp, ss->count );
+    const int ret = _write_all( fd, buff, (size_t)(pp - buff) );
+    total = ret < 0 ? ret : total + ret;
+  }
+
+  b8OsSetTickHook( _sampling ? _sample_tick : NULL );
+  return  total;
+}
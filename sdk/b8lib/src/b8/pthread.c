@@ -46,13 +46,20 @@ int pthread_create(
       break;
   }
 
+  if( attr->priority < sched_get_priority_min( policy ) ||
+      attr->priority > sched_get_priority_max( policy )
+  ){
+    return  EINVAL;
+  }
+
   b8OsBridgeUsr2Svc* bridge = b8OsSysCall(
     B8_OS_SYSCALL_THREAD_CREATE,
     _CastPtr( attr->stackaddr ),
     attr->stacksize,
     _CastPtr( startroutine),
     _CastPtr( arg ),
-    policy,
+    policy | ((u32)attr->priority << 8) |
+      ( attr->detachstate == PTHREAD_CREATE_DETACHED ? B8_OS_THREAD_CREATE_DETACHED : 0 ),
     attr->irq_no
   );
   *thread = bridge->ret_pid;
@@ -67,7 +74,7 @@ int pthread_attr_init(pthread_attr_t* attr){
   attr->stacksize = 0x400;
   attr->policy = 0;
   attr->detachstate = 0;
-  attr->priority = SCHED_RR;
+  attr->priority = B8_OS_PRIORITY_DEFAULT;
   attr->irq_no = B8_OS_NOT_USING_IRQ;
   return  0;
 }
@@ -123,22 +130,52 @@ int pthread_attr_getstack(const pthread_attr_t *attr, void **stackaddr, long *st
 }
 
 int pthread_getschedparam(pthread_t thread, int* policy, struct sched_param* param){
-  (void)thread;  // Mark thread as unused
-  (void)policy;  // Mark policy as unused
-  (void)param;   // Mark param as unused
-  return  ENOSYS;
+  if( !policy || !param ){
+    return  EINVAL;
+  }
+
+  b8OsBridgeUsr2Svc* bridge = b8OsSysCall( B8_OS_SYSCALL_THREAD_GETSCHEDPARAM,thread,0,0,0,0,0);
+  if( bridge->errcode ){
+    return  - bridge->errcode;
+  }
+  *policy = (int)bridge->ret_policy;
+  param->sched_priority = (int)bridge->ret_priority;
+  return  0;
 }
 
 int pthread_setschedparam(pthread_t thread, int policy, const struct sched_param* param){
-  (void)thread;  // Mark thread as unused
-  (void)policy;  // Mark policy as unused
-  (void)param;   // Mark param as unused
-  return  ENOSYS;  
+  if( !param ){
+    return  EINVAL;
+  }
+
+  switch( policy ){
+    case  SCHED_FIFO:
+    case  SCHED_RR:
+    case  SCHED_IRQ:
+      break;
+    default:
+      return  EINVAL;
+  }
+
+  if( param->sched_priority < sched_get_priority_min( policy ) ||
+      param->sched_priority > sched_get_priority_max( policy )
+  ){
+    return  EINVAL;
+  }
+
+  b8OsBridgeUsr2Svc* bridge = b8OsSysCall(
+    B8_OS_SYSCALL_THREAD_SETSCHEDPARAM,
+    thread,
+    (u32)policy,
+    (u32)param->sched_priority,
+    0,0,0
+  );
+  return  - bridge->errcode;
 }
 
 int  pthread_detach(pthread_t thread){
-  (void)thread;
-  return  ENOSYS;
+  b8OsBridgeUsr2Svc* bridge = b8OsSysCall( B8_OS_SYSCALL_THREAD_DETACH,thread,0,0,0,0,0);
+  return  - bridge->errcode;
 }
 
 int pthread_attr_setschedpolicy(pthread_attr_t *attr, int policy){
@@ -206,19 +243,41 @@ int pthread_attr_getdetachstate(
 }
 
 void pthread_exit(pthread_addr_t value){
-  (void)value;
+  b8OsSysCall( B8_OS_SYSCALL_EXIT,_CastPtr( value ),0,0,0,0,0 );
+  // It won't get here
   while(1) b8OsSysCall( B8_OS_SYSCALL_SCHED_SLEEP,0,0xffffffff,0,0,0,0 );
 }
 
 int  pthread_cancel(pthread_t thread){
-  (void)thread;
-  return  ENOSYS;
+  b8OsBridgeUsr2Svc* bridge = b8OsSysCall( B8_OS_SYSCALL_THREAD_CANCEL,thread,0,0,0,0,0);
+  return  - bridge->errcode;
 }
 
 int  pthread_join(pthread_t thread, pthread_addr_t *value){
-  (void)thread;
-  (void)value;
-  return  ENOSYS;
+  b8OsBridgeUsr2Svc* bridge = b8OsSysCall( B8_OS_SYSCALL_THREAD_JOIN,thread,0,0,0,0,0);
+  if( bridge->errcode ){
+    return  - bridge->errcode;
+  }
+  if( value ){
+    Cast cast;
+    cast.data._u32 = bridge->ret_value;
+    *value = cast.data._p32;
+  }
+  return  0;
+}
+
+int  pthread_setcanceltype(int type, int *oldtype){
+  if( type != PTHREAD_CANCEL_DEFERRED ){
+    return  EINVAL;
+  }
+  if( oldtype ){
+    *oldtype = PTHREAD_CANCEL_DEFERRED;
+  }
+  return  0;
+}
+
+void pthread_testcancel(void){
+  b8OsSysCall( B8_OS_SYSCALL_THREAD_TESTCANCEL,0,0,0,0,0,0 );
 }
 
 int pthread_yield(void){
@@ -226,7 +285,7 @@ int pthread_yield(void){
   return  - bridge->errcode;
 }
 
+// The kernel publishes the running thread in the time page, so no system call is needed.
 pthread_t pthread_self(void){
-  b8OsBridgeUsr2Svc* bridge = b8OsSysCall( B8_OS_SYSCALL_GET_BRIDGE,0,0,0,0,0,0);
-  return bridge->pid;
+  return b8OsGetTimePage()->pid;
 }
@@ -0,0 +1,317 @@
+#include <beep8.h>
+#include <crt/crt.h>
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+
+/*
+  BP8R image layout (see tool/genb8rom)
+    +0   "BP8R"
+    +4   u16 number of files
+    +6   u16 offset of the FAT from the top of the image
+    +8   u8  bytesize of one FAT entry
+    +12  u32 offset of the name index from the top of the image (0: none)
+    FAT  { u32 offset; u32 len; char name[]; } x number of files
+         name is omitted when genb8rom -c is used (bytesize == 8)
+    data offsets are relative to the end of the FAT
+    index
+         u32 number of entries
+         { u32 hash; u16 fat_no; u16 name_len; u32 name; u32 orgsize; } sorted by hash
+           name    offset of the name from the top of the image
+           orgsize [23:0] size before compression, [31:24] method (0: stored)
+         string pool, only with a compact FAT. Otherwise names point into the FAT
+*/
+#define ROMFS_ADDR_OFFSET     (32)          // patched by relb8rom
+#define ROMFS_ROM_SIZE        (0x100000)
+#define ROMFS_NOT_RELOCATED   (0xe1a00000)  // nop of __beep8_signature
+#define ROMFS_FAT_NAME        (8)
+#define ROMFS_INDEX_ENTRY     (16)
+
+typedef struct {
+  const u8* top;
+  const u8* fat;
+  const u8* data;
+  const u8* index;
+  u32       num_index;
+  u16       num_files;
+  u8        fat_bytesize;
+} RomfsImage;
+
+typedef struct {
+  const u8* ptr;
+  u32       size;
+  u32       pos;
+  u8*       decoded;  // heap buffer of a compressed file
+  u8        used;
+} RomfsFile;
+
+static  RomfsImage  _image;
+static  RomfsFile   _rfiles[ B8_ROMFS_MAX_OPEN_FILES ];
+static  b8RomfsDecoder  _decoder;
+
+// The image is appended right after the linked ROM, so it may not be 4-byte aligned.
+static  u16 _rd16( const u8* pp ){
+  return  (u16)( pp[0] | (pp[1] << 8) );
+}
+
+static  u32 _rd32( const u8* pp ){
+  return  (u32)pp[0] | ((u32)pp[1] << 8) | ((u32)pp[2] << 16) | ((u32)pp[3] << 24);
+}
+
+// FNV-1a, same as tool/genb8rom
+static  u32 _b8RomfsHash( const char* name ){
+  u32 hash = 2166136261u;
+  while( *name ){
+    hash ^= (u8)*name++;
+    hash *= 16777619u;
+  }
+  return  hash;
+}
+
+static  int _b8RomfsFatEntry( const u8* ent, u32 orgsize, b8RomfsMap* map ){
+  map->ptr     = _image.data + _rd32( ent );
+  map->size    = _rd32( ent + 4 );
+  map->method  = (u8)( orgsize >> 24 );
+  map->orgsize = map->method == B8_ROMFS_METHOD_STORED ? map->size : ( orgsize & 0xffffff );
+  return  0;
+}
+
+static  int _b8RomfsLookupIndex( const char* name, size_t len, b8RomfsMap* map ){
+  const u32 hash = _b8RomfsHash( name );
+  const u8* entries = _image.index + 4;
+
+  // lower bound of hash
+  u32 lo = 0;
+  u32 hi = _image.num_index;
+  while( lo < hi ){
+    const u32 mid = (lo + hi) >> 1;
+    if( _rd32( entries + mid * ROMFS_INDEX_ENTRY ) < hash ){
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  for( ; lo<_image.num_index ; ++lo ){
+    const u8* ent = entries + lo * ROMFS_INDEX_ENTRY;
+    if( _rd32( ent ) != hash ) break;
+    if( _rd16( ent + 6 ) != len ) continue;
+    if( 0 != memcmp( _image.top + _rd32( ent + 8 ), name, len ) ) continue;
+
+    const u16 fat_no = _rd16( ent + 4 );
+    if( fat_no >= _image.num_files )  return -1;
+    return  _b8RomfsFatEntry( _image.fat + fat_no * _image.fat_bytesize, _rd32( ent + 12 ), map );
+  }
+  return  -1;
+}
+
+static  int _b8RomfsLookup( const char* name, b8RomfsMap* map ){
+  if( 0 == name ) return -1;
+
+  const size_t len = strlen( name );
+  if( len == 0 )  return -1;
+  if( _image.index )  return _b8RomfsLookupIndex( name, len, map );
+
+  const size_t max_len = _image.fat_bytesize - ROMFS_FAT_NAME;
+  if( len >= max_len )  return -1;
+
+  const u8* ent = _image.fat;
+  for( u16 nn=0 ; nn<_image.num_files ; ++nn, ent += _image.fat_bytesize ){
+    const char* ent_name = (const char*)( ent + ROMFS_FAT_NAME );
+    if( 0 != memcmp( ent_name, name, len ) ) continue;
+    if( ent_name[ len ] != '\0' ) continue;
+
+    return  _b8RomfsFatEntry( ent, 0, map );
+  }
+  return  -1;
+}
+
+static  int _b8RomfsDecode( RomfsFile* rf, const b8RomfsMap* map ){
+  if( 0 == _decoder ) return -ENOSYS;
+
+  u8* decoded = (u8*)malloc( map->orgsize );
+  if( 0 == decoded )  return -ENOMEM;
+
+  if( (*_decoder)( map->ptr, map->size, decoded, map->orgsize ) != (int)map->orgsize ){
+    free( decoded );
+    return -EIO;
+  }
+  rf->decoded = decoded;
+  rf->ptr     = decoded;
+  return  0;
+}
+
+static  int romfs_open( File* filep ){
+  b8RomfsMap map;
+  if( _b8RomfsLookup( filep->name, &map ) < 0 ) return -ENOENT;
+
+  RomfsFile* rf = _rfiles;
+  for( size_t nn=0 ; nn<B8_ROMFS_MAX_OPEN_FILES ; ++nn, ++rf ){
+    if( rf->used ) continue;
+    rf->ptr     = (const u8*)map.ptr;
+    rf->size    = map.orgsize;
+    rf->pos     = 0;
+    rf->decoded = 0;
+    if( map.method != B8_ROMFS_METHOD_STORED ){
+      const int ret = _b8RomfsDecode( rf, &map );
+      if( ret < 0 ) return ret;
+    }
+    rf->used = 1;
+    filep->f_priv = rf;
+    return 0;
+  }
+  return -ENFILE;
+}
+
+static  int romfs_close( File* filep ){
+  RomfsFile* rf = (RomfsFile*)filep->f_priv;
+  if( rf ){
+    free( rf->decoded );
+    rf->decoded = 0;
+    rf->used = 0;
+  }
+  return 0;
+}
+
+static  ssize_t romfs_read( File* filep, char* buffer, size_t buflen ){
+  RomfsFile* rf = (RomfsFile*)filep->f_priv;
+  if( rf->pos >= rf->size ) return 0;
+
+  const size_t rest = rf->size - rf->pos;
+  if( buflen > rest ) buflen = rest;
+  memcpy( buffer, rf->ptr + rf->pos, buflen );
+  rf->pos += buflen;
+  return  (ssize_t)buflen;
+}
+
+static  off_t romfs_seek( File* filep, int ptr, int dir ){
+  RomfsFile* rf = (RomfsFile*)filep->f_priv;
+  s32 base;
+  switch( dir ){
+    case SEEK_SET:  base = 0;             break;
+    case SEEK_CUR:  base = (s32)rf->pos;  break;
+    case SEEK_END:  base = (s32)rf->size; break;
+    default:
+      set_errno( EINVAL );
+      return -1;
+  }
+  if( base + ptr < 0 ){
+    set_errno( EINVAL );
+    return -1;
+  }
+  rf->pos = (u32)( base + ptr );
+  return  (off_t)rf->pos;
+}
+
+static  int romfs_ioctl( File* filep, unsigned int cmd, void* arg ){
+  RomfsFile* rf = (RomfsFile*)filep->f_priv;
+  switch( cmd ){
+    case FS_IOCTL_FSTAT:{
+      struct stat* st = (struct stat*)arg;
+      st->st_mode = S_IFREG | 0444;
+      st->st_size = (off_t)rf->size;
+    }break;
+    case B8_ROMFS_IOCTL_MAP:{
+      b8RomfsMap* map = (b8RomfsMap*)arg;
+      if( 0 == map ){
+        set_errno( EINVAL );
+        return -1;
+      }
+      map->ptr     = rf->ptr;
+      map->size    = rf->size;
+      map->orgsize = rf->size;
+      map->method  = B8_ROMFS_METHOD_STORED;
+    }break;
+    default:
+      set_errno( ENOTTY );
+      return -1;
+  }
+  return 0;
+}
+
+static const file_operations romfs_fops =
+{
+  romfs_open,     /* open  */
+  romfs_close,    /* close */
+  romfs_read,     /* read  */
+  NULL,           /* write */
+  romfs_seek,     /* seek  */
+  romfs_ioctl     /* ioctl */
+};
+
+size_t  b8RomfsGetNumFiles(void){
+  return  _image.num_files;
+}
+
+const void* b8RomfsFind( const char* name, size_t* size ){
+  b8RomfsMap map;
+  if( _b8RomfsLookup( name, &map ) < 0 ){
+    set_errno( ENOENT );
+    return 0;
+  }
+  if( size )  *size = map.size;
+  return  map.ptr;
+}
+
+int b8RomfsLookup( const char* name, b8RomfsMap* map ){
+  if( 0 == map ){
+    set_errno( EINVAL );
+    return -1;
+  }
+  if( _b8RomfsLookup( name, map ) < 0 ){
+    set_errno( ENOENT );
+    return -1;
+  }
+  return  0;
+}
+
+void  b8RomfsSetDecoder( b8RomfsDecoder decoder ){
+  _decoder = decoder;
+}
+
+// Mounts the image at top, with room bytes readable from there.
+static  int _b8RomfsMount( const u8* top, u32 room ){
+  memset( &_image, 0, sizeof(_image) );
+  memset( _rfiles, 0, sizeof(_rfiles) );
+
+  if( room < 16 || 0 != memcmp( top, "BP8R", 4 ) )  return -1;
+
+  const u16 num_files    = _rd16( top + 4 );
+  const u16 fat_start    = _rd16( top + 6 );
+  const u8  fat_bytesize = top[ 8 ];
+  const u32 index_offset = _rd32( top + 12 );
+  if( fat_bytesize < ROMFS_FAT_NAME )  return -1;
+  if( index_offset >= room )  return -1;
+
+  _image.top          = top;
+  _image.fat          = top + fat_start;
+  _image.data         = _image.fat + (u32)num_files * fat_bytesize;
+  _image.num_files    = num_files;
+  _image.fat_bytesize = fat_bytesize;
+  if( index_offset ){
+    _image.index      = top + index_offset;
+    _image.num_index  = _rd32( _image.index );
+  }
+
+  return  fs_register_driver( B8_ROMFS_MOUNT, &romfs_fops, 0444, &_image );
+}
+
+#if B8_ROMFS_HOST
+int b8RomfsHostMount( const void* image, size_t size ){
+  return  _b8RomfsMount( (const u8*)image, (u32)size );
+}
+#else
+/**
+ * b8RomfsReset is called only once from crt0_entry, before the OS starts.
+ */
+int b8RomfsReset(void){
+  memset( &_image, 0, sizeof(_image) );
+  memset( _rfiles, 0, sizeof(_rfiles) );
+
+  const u32 offset = *(const volatile u32*)ROMFS_ADDR_OFFSET;
+  if( offset == ROMFS_NOT_RELOCATED ) return 0;   // no romfs appended
+
+  if( offset >= ROMFS_ROM_SIZE )  return -1;
+  return  _b8RomfsMount( (const u8*)offset, ROMFS_ROM_SIZE - offset );
+}
+#endif
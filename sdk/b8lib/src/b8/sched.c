@@ -3,5 +3,18 @@
 
 int sched_get_priority_max(int policy ){
   (void)policy;
-  return 255;
+  return B8_OS_PRIORITY_MAX;
+}
+
+int sched_get_priority_min(int policy ){
+  (void)policy;
+  return B8_OS_PRIORITY_MIN;
+}
+
+int b8OsGetThreadInfo( b8OsThreadInfo* info, size_t num ){
+  b8OsBridgeUsr2Svc* bridge = b8OsSysCall( B8_OS_SYSCALL_THREAD_GETINFO,(u32)info,(u32)num,0,0,0,0);
+  if( bridge->errcode ){
+    return  bridge->errcode;
+  }
+  return  (int)bridge->ret_count;
 }
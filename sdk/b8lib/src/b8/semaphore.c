@@ -65,9 +65,11 @@ sem_t*  sem_open(const char* name, int __oflag, ...){
 }
 
 int sem_destroy(sem_t* sem){
-  (void)sem;
-  set_errno( ENOSYS );
-  return -1;
+  b8OsBridgeUsr2Svc* bridge = b8OsSysCall( B8_OS_SYSCALL_SEM_DESTROY, sem->sid, 0,0,0,0,0);
+  if( 0 == bridge->errcode ){
+    sem->sid = B8_OS_INVALID_SID;
+  }
+  return bridge->errcode;
 }
 
 int sem_close (sem_t* sem){
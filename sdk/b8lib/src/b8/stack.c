@@ -0,0 +1,77 @@
+#include <b8/os.h>
+#include "stack.h"
+
+void  StackPoolInit( StackPool* pool , void* top , size_t size ){
+  pool->top = top;
+  pool->size = size;
+  pool->carved = 0;
+  pool->free = NULL;
+  pool->free_bytes = 0;
+}
+
+/*
+  Stacks are blocks of a multiple of B8_OS_STACK_GRANULE bytes. A block is
+  taken first fit from the free list, else from the untouched part of the
+  pool. A freed block is merged with the free blocks next to it, and a free
+  block that ends at pool->carved goes back to the untouched part, so the
+  pool does not fragment into blocks of the sizes used earlier.
+  Returns the lowest address of the block.
+*/
+void*   StackPoolAlloc( StackPool* pool , size_t byte_ , size_t* size_ ){
+  const size_t size = ( byte_ + B8_OS_STACK_GRANULE - 1 ) & ~(size_t)( B8_OS_STACK_GRANULE - 1 );
+  *size_ = size;
+
+  for( StackBlock** link = &pool->free ; *link ; link = &(*link)->next ){
+    StackBlock* blk = *link;
+    if( blk->size < size )  continue;
+    pool->free_bytes -= size;
+    if( blk->size == size ){
+      *link = blk->next;
+      return  blk;
+    }
+    // Take the top of the block, so the rest stays where it is on the list.
+    blk->size -= size;
+    return  (u8*)blk + blk->size;
+  }
+
+  if( pool->carved + size <= pool->size ){
+    void* base = pool->top + pool->carved;
+    pool->carved += size;
+    return base;
+  }
+  return NULL;
+}
+
+void  StackPoolFree( StackPool* pool , void* base , size_t size ){
+  StackBlock* prev = NULL;
+  StackBlock** link = &pool->free;
+  while( *link && (u8*)*link < (u8*)base ){
+    prev = *link;
+    link = &prev->next;
+  }
+
+  StackBlock* blk = base;
+  blk->size = size;
+  blk->next = *link;
+  if( blk->next && (u8*)blk + blk->size == (u8*)blk->next ){
+    blk->size += blk->next->size;
+    blk->next = blk->next->next;
+  }
+  if( prev && (u8*)prev + prev->size == (u8*)blk ){
+    prev->size += blk->size;
+    prev->next = blk->next;
+    blk = prev;
+  } else {
+    *link = blk;
+  }
+  pool->free_bytes += size;
+
+  // A free block at the end of the carved part goes back to the untouched part.
+  if( NULL == blk->next && (u8*)blk + blk->size == pool->top + pool->carved ){
+    link = &pool->free;
+    while( *link != blk ) link = &(*link)->next;
+    *link = NULL;
+    pool->carved -= blk->size;
+    pool->free_bytes -= blk->size;
+  }
+}
@@ -0,0 +1,35 @@
+/*
+  Pool the kernel carves thread stacks from, see b8OsStackPoolInfo in b8/os.h.
+  Internal to the kernel: os.c keeps the one pool, and sdk/test runs this
+  code on the host.
+*/
+#pragma once
+#include <stddef.h>
+#include <b8/type.h>
+
+#ifdef  __cplusplus
+extern  "C" {
+#endif
+
+// Free block of the pool, kept in its own first bytes.
+typedef struct _StackBlock  StackBlock;
+struct _StackBlock {
+  StackBlock* next;
+  size_t      size;
+};
+
+typedef struct _StackPool {
+  u8*         top;        // lowest address of the pool
+  size_t      size;       // bytes of the pool
+  size_t      carved;     // bytes carved from the bottom of the pool
+  StackBlock* free;       // free blocks below carved, sorted by address, never adjacent
+  size_t      free_bytes; // bytes on the free list
+} StackPool;
+
+extern  void    StackPoolInit( StackPool* pool , void* top , size_t size );
+extern  void*   StackPoolAlloc( StackPool* pool , size_t byte_ , size_t* size_ );
+extern  void    StackPoolFree( StackPool* pool , void* base , size_t size );
+
+#ifdef  __cplusplus
+}
+#endif
@@ -64,60 +64,43 @@ u32   b8SysGetCpuClock(void){
 }
 
 static  u32       _irq_use_map = 0x00000000;
-static  sem_t     _sem_irq_sync[ B8_IRQ_NUM_OF_INTERRUPTS ] = {0};
-static  pthread_t _irq_thread  [ B8_IRQ_NUM_OF_INTERRUPTS ] = {0};
-
-static  void* _b8SysIrqThread( void* arg ){
-  sem_t* sem_irq = (sem_t*)arg;
-  while(1){
-    pthread_yield();
-    sem_post( sem_irq );
-  }
-  return NULL;
-}
-
-static  void* _b8SysIrqThreadUndefinedInstruction( void* arg ){
-  (void)arg;
-  while(1){
-    pthread_yield();
-    b8SysPuts( "Caught undefined instruction\n" ); 
-    b8SysHalt();
-  }
-  return NULL;
-}
+static  u32       _irq_latency[ B8_IRQ_NUM_OF_INTERRUPTS ] = {0};
 
-int b8SysIrqWait( u32 irq ){
-  if(!( _irq_use_map & (1<<irq)) ){
+// The kernel wakes the waiters from the interrupt path; no relay thread is involved.
+static  int _b8SysIrqWait( u32 irq, u32 flags ){
+  if( irq >= B8_IRQ_NUM_OF_INTERRUPTS || !( _irq_use_map & (1u<<irq)) ){
     set_errno( EINVAL );
     return -1;
   }
 
-  sem_t* sem = &(_sem_irq_sync[ irq ]);
-
-  int sval=0;
-  int ret = sem_getvalue(sem, &sval );
-  if( ret < 0 ){
-    set_errno( -ret );
+  b8OsBridgeUsr2Svc* bridge = b8OsSysCall( B8_OS_SYSCALL_IRQ_WAIT,irq,flags,0,0,0,0);
+  if( bridge->errcode ){
+    set_errno( -bridge->errcode );
     return -1;
   }
-  if( sval > 1 )  printf( "sval=%d\n" , sval );
+  // An event already pending is older than this call; only a wait that blocked
+  // was woken by the event b8OsGetIrqCycle() gives.
+  if( 0 == bridge->ret_count ){
+    _irq_latency[ irq ] = B8_DWT_CYCCNT - b8OsGetIrqCycle( irq );
+  }
+  return  0;
+}
 
-  return sem_wait( sem );
+int b8SysIrqWait( u32 irq ){
+  return  _b8SysIrqWait( irq, 0 );
 }
 
-int b8SysIrqClearAndWait(u32 irq){
-  if(!( _irq_use_map & (1u<<irq)) ){
-    set_errno(EINVAL);
-    return -1;
-  }
+u32 b8SysGetIrqCount( u32 irq ){
+  return  b8OsGetIrqCount( irq );
+}
 
-  sem_t *sem = &_sem_irq_sync[irq];
-  int sval;
-  while( sem_getvalue(sem, &sval)==0 && sval > 0 ){
-    sem_trywait(sem);
-  }
+u32 b8SysGetIrqLatency( u32 irq ){
+  if( irq >= B8_IRQ_NUM_OF_INTERRUPTS ) return 0;
+  return  _irq_latency[ irq ];
+}
 
-  return sem_wait(sem);
+int b8SysIrqClearAndWait(u32 irq){
+  return  _b8SysIrqWait( irq, B8_OS_IRQ_WAIT_CLEAR );
 }
 
 int   b8SysSetupIrqWait( u32 irq ){
@@ -126,32 +109,16 @@ int   b8SysSetupIrqWait( u32 irq ){
     return -1;
   }
 
-  if( _irq_use_map & (1<<irq) ){
+  if( _irq_use_map & (1u<<irq) ){
     return  B8_OS_OK;
   }
 
-  int ret = sem_init( &_sem_irq_sync[ irq ] , 0, 0);
-  if( ret < 0 ){
-    set_errno( -ret );
-    return -1;
-  }
-
-  pthread_attr_t attr;
-  pthread_attr_init(&attr);
-  pthread_attr_setschedpolicy(&attr,SCHED_IRQ);
-  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-  pthread_attr_setstacksize(&attr, 0x800);
-  attr.irq_no = irq;
-  if( irq == B8_IRQ_UNDF ){
-    ret = pthread_create( &_irq_thread[irq] , &attr, _b8SysIrqThreadUndefinedInstruction, &_sem_irq_sync[ irq ] );
-  } else { 
-    ret = pthread_create( &_irq_thread[irq] , &attr, _b8SysIrqThread, &_sem_irq_sync[ irq ] );
-  }
-  if( ret > 0 ){
-    set_errno( ret );
+  b8OsBridgeUsr2Svc* bridge = b8OsSysCall( B8_OS_SYSCALL_IRQ_ATTACH,irq,0,0,0,0,0);
+  if( bridge->errcode ){
+    set_errno( -bridge->errcode );
     return -1;
   }
 
-  _irq_use_map |= 1<<irq;
+  _irq_use_map |= 1u<<irq;
   return  0;
 }
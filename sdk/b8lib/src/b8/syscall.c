@@ -59,11 +59,67 @@ int clock_getres(clockid_t clk_id, struct timespec *res){
   return  bridge->errcode;
 }
 
+// Reads the clock from the kernel's time page, without a system call.
+// Returns -1 if the kernel does not run yet.
+static  int _clock_gettime_page( u32 os_clk_id , struct timespec* tp ){
+  const volatile b8OsTimePage* page = b8OsGetTimePage();
+  const u32 hz = page->cpu_hz;
+  if( 0 == hz ) return -1;
+
+  u32 seq, cyccnt, cyc_in_sec, idle;
+  u64 sec, cycles;
+  do {
+    seq = page->seq;
+    cyccnt      = page->cyccnt;
+    sec         = page->sec;
+    cyc_in_sec  = page->cyc_in_sec;
+    idle        = page->idle;
+    cycles = os_clk_id == B8_OS_CLOCKID_THREAD_CPUTIME_ID ? page->thread_cycles : page->process_cycles;
+  } while( seq != page->seq );
+  const u32 delta = B8_DWT_CYCCNT - cyccnt;
+
+  switch( os_clk_id ){
+    case  B8_OS_CLOCKID_PROCESS_CPUTIME_ID:
+      if( idle )  break;
+      // fall through
+    case  B8_OS_CLOCKID_THREAD_CPUTIME_ID:
+      cycles += delta;
+      sec = cycles / hz;
+      cyc_in_sec = (u32)( cycles - sec * hz );
+      break;
+
+    default:{
+      // The kernel is entered at least on every timer tick, so this loops once at most in practice.
+      u32 rest = delta;
+      while( rest >= hz - cyc_in_sec ){
+        rest -= hz - cyc_in_sec;
+        cyc_in_sec = 0;
+        ++sec;
+      }
+      cyc_in_sec += rest;
+    }break;
+  }
+  u32 nsec = (u32)( ( (u64)cyc_in_sec * page->ns_mult ) >> 32 );
+  if( os_clk_id == B8_OS_CLOCKID_REALTIME ){
+    sec  += page->realtime_sec;
+    nsec += page->realtime_nsec;
+    if( nsec >= 1000000000 ){
+      nsec -= 1000000000;
+      ++sec;
+    }
+  }
+  tp->tv_sec  = sec;
+  tp->tv_nsec = (long)nsec;
+  return  0;
+}
+
 int clock_gettime(clockid_t clk_id, struct timespec* tp){
   u32 os_clk_id = 0;
   int ret = _clock_id_conv( clk_id , &os_clk_id );
   if( ret < 0 ) return ret;
 
+  if( 0 == _clock_gettime_page( os_clk_id , tp ) ) return 0;
+
   b8OsBridgeUsr2Svc* bridge = b8OsSysCall(
     B8_OS_SYSCALL_CLOCK_GETTIME,
     os_clk_id,
@@ -14,8 +14,10 @@
 #include <b8/ppu.h>
 #include <b8/hif.h>
 #include <b8/pthread.h>
+#include <b8/romfs.h>
 #include <crt/crt.h>
 #include <sys/time.h>
+#include <b8/syscall.h>
 
 union	fc32 {
   u32 	aU32;
@@ -24,7 +26,7 @@ union	fc32 {
 
 extern  int set_errno(int errcode);
 extern  int get_errno(void);
-static sem_t    sem_heap;
+static pthread_mutex_t heap_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 
 static  void  fs_register_driver_init(void);
 static  FsDriver* fs_get_driver( int fd );
@@ -324,6 +326,7 @@ unsigned int crt0_entry(void){
   _stdout_register();
   _stdin_register();
   _stderr_register();
+  b8RomfsReset();
 
   static u8 OsStack[64*1024];
   b8OsConfig cfg;
@@ -332,7 +335,6 @@ unsigned int crt0_entry(void){
   cfg.StackSize = sizeof(OsStack);
   cfg.CpuCyclesPerSec = b8SysGetCpuClock();
   cfg.UsecPerTick  = 1000;
-  cfg.sem_heap = &sem_heap;
   cfg.ArchDriverGetTimerIrq       = ArchDriverGetTimerIrq;
   cfg.ArchDriverOnStartTimer      = ArchDriverOnStartTimer;
   cfg.ArchDriverOnStartCycleCnt   = ArchDriverOnStartCycleCnt;
@@ -366,7 +368,8 @@ size_t strlen(const char *s){
 #define N_MAX_FS_DRIVER (32)
 int _id_driver;
 
-#define N_MAX_FILES     (N_MAX_FS_DRIVER)
+#define N_MAX_MOUNT_FILES (16)
+#define N_MAX_FILES     (N_MAX_FS_DRIVER + N_MAX_MOUNT_FILES)
 File  _files[ N_MAX_FILES ];
 
 #define	STDIN   (0)
@@ -374,13 +377,26 @@ File  _files[ N_MAX_FILES ];
 #define	STDERR  (2)
 
 static  FsDriver _fs_driver[ N_MAX_FS_DRIVER ];
+
+// Descriptors from N_MAX_FS_DRIVER upwards are files opened below a mount point.
+static  FsDriver* _mount_driver[ N_MAX_MOUNT_FILES ];
+
 static  FsDriver* fs_get_driver( int fd ){
   if( fd < 0 )  return 0;
-  if( fd >= N_MAX_FS_DRIVER ) return 0;
+  if( fd >= N_MAX_FS_DRIVER ){
+    if( fd >= N_MAX_FILES ) return 0;
+    if( 0 == _files[ fd ].used ) return 0;
+    return  _mount_driver[ fd - N_MAX_FS_DRIVER ];
+  }
   if( 0 == strlen( _fs_driver[fd]._path ) ) return 0;
   return  &_fs_driver[ fd ];
 }
 
+static  int fs_is_mount_point( const FsDriver* driver ){
+  const size_t len = strlen( driver->_path );
+  return  len > 0 && '/' == driver->_path[ len-1 ];
+}
+
 static  File* file_get( int fd ){
   if( fd < 0 )  return 0;
   if( fd >= N_MAX_FILES ) return 0;
@@ -576,33 +592,15 @@ void* _sbrk_r(struct _reent *reent_ptr, ptrdiff_t incr) {
   return result;
 }
 
-extern  pthread_t pthread_self(void);
-
-pthread_t last_thread_id = 0;
-int lock_count = 0;
-
+// newlib locks the heap recursively. The mutex costs no system call unless another thread holds it.
 void  __malloc_lock(struct _reent* _r){
   (void)_r;
-  pthread_t current_thread_id = pthread_self();
-
-  if (last_thread_id != current_thread_id) {
-      sem_wait(&sem_heap);
-      last_thread_id = current_thread_id;
-  }
-
-  lock_count++;
+  pthread_mutex_lock(&heap_mutex);
 }
 
 void  __malloc_unlock(struct _reent* _r) {
   (void)_r;
-  if (last_thread_id == pthread_self()) {
-    lock_count--;
-
-    if (lock_count == 0) {
-        last_thread_id = 0;
-        sem_post(&sem_heap);
-    }
-  }
+  pthread_mutex_unlock(&heap_mutex);
 }
 
 int _kill(int pid, int sig){
@@ -612,8 +610,16 @@ int _kill(int pid, int sig){
 }
 
 int _gettimeofday(struct timeval * tv, struct timezone * tz){
-  (void)tv; (void)tz;
-  return -1;  // Always fails
+  (void)tz;
+  if( NULL == tv ) return 0;
+
+  // Served from the kernel's time page without a system call.
+  struct timespec ts;
+  const int ret = clock_gettime( CLOCK_REALTIME , &ts );
+  if( ret < 0 ) return ret;
+  tv->tv_sec  = ts.tv_sec;
+  tv->tv_usec = ts.tv_nsec / 1000;
+  return 0;
 }
 
 void _exit(int status){
@@ -636,17 +642,44 @@ int _fork(void){
   return -1;  // Always fails
 }
 
-int _open_r(struct _reent *r, const char *buf, int flags, int mode) {
-  (void)r;(void)flags;(void)mode;
-  for( int fd=0 ; fd < N_MAX_FS_DRIVER ; ++fd ){
-    if( fd >= N_MAX_FILES ){
-      set_errno( ENFILE );
+static  int _open_mount(FsDriver* driver, const char* name, int mode) {
+  for( int fd=N_MAX_FS_DRIVER ; fd < N_MAX_FILES ; ++fd ){
+    File* pfile = file_get( fd );
+    if( pfile->used ) continue;
+
+    pfile->f_priv = 0;
+    pfile->d_priv = driver->_priv;
+    pfile->used   = 1;
+    pfile->mode   = mode;
+    pfile->name   = name;
+    _mount_driver[ fd - N_MAX_FS_DRIVER ] = driver;
+
+    int ret = 0;
+    if( driver->_fops->open ) ret = (*driver->_fops->open)(pfile);
+    pfile->name = 0;
+    if( ret < 0 ){
+      pfile->used = 0;
+      set_errno( -ret );
       return -1;
     }
+    return fd;
+  }
+  set_errno( ENFILE );
+  return -1;
+}
 
+int _open_r(struct _reent *r, const char *buf, int flags, int mode) {
+  (void)r;(void)flags;(void)mode;
+  for( int fd=0 ; fd < N_MAX_FS_DRIVER ; ++fd ){
     FsDriver* driver = fs_get_driver( fd );
     if( 0 == driver ) continue;
 
+    if( fs_is_mount_point( driver ) ){
+      const size_t len = strlen( driver->_path );
+      if( 0 != strncmp( driver->_path , buf, len ) ) continue;
+      return  _open_mount( driver, buf + len, mode );
+    }
+
     if( 0 != strcmp( driver->_path , buf ) ) continue;
 
     File* pfile = file_get( fd );
@@ -669,6 +702,7 @@ int _open_r(struct _reent *r, const char *buf, int flags, int mode) {
     }
     return fd;
   }
+  set_errno( ENOENT );
   return -1;
 }
 
@@ -755,10 +789,22 @@ int _fstat(int file, struct stat* st) {
   if( (STDOUT == file) || (STDERR == file) ){
     st->st_mode = S_IFCHR;
     return  0;
-  } else {
+  }
+
+  FsDriver* fs = fs_get_driver( file );
+  File* pfile = file_get( file );
+  if( 0 == fs || 0 == pfile || 0 == pfile->used || 0 == fs->_fops->ioctl ){
+    set_errno(EBADF);
+    return  -1;
+  }
+
+  MEMCLR( st, sizeof(*st) );
+  if( (*fs->_fops->ioctl)(pfile,FS_IOCTL_FSTAT,st) < 0 ) return -1;
+  if( 0 == st->st_mode ){
     set_errno(EBADF);
     return  -1;
   }
+  return  0;
 }
 
 int _isatty(int file) {
@@ -0,0 +1,137 @@
+// CHuffmanDecoder, which decodes through lookup tables, against the tree walk
+// it replaced, which popped the stream one bit at a time. Both decode the same
+// streams from CHuffmanEncoder, and their outputs are compared.
+#include <beep8.h>
+#include <huffman.h>
+#include "host/bench.h"
+#include "host/corpus.h"
+#include "host/test.h"
+
+// The decoder before the lookup tables, kept for comparison.
+namespace TreeWalk {
+
+constexpr u16 NIL = 0xffff;
+
+class BitReader {
+  Pipe::CPipe&  _pipe;
+  u32   _cnt = 0;
+  u8    _reg = 0;
+public:
+  explicit BitReader( Pipe::CPipe& pipe_ ) : _pipe( pipe_ ) {}
+  bool  Pop(){
+    if( ( _cnt & 7 ) == 0 ) _pipe.Pop( _reg );
+    ++_cnt;
+    const bool bit = _reg & 0x80;
+    _reg <<= 1;
+    return  bit;
+  }
+  u32   Pop( u8 bits_ ){
+    u32 result = 0;
+    for( u8 nn=0 ; nn < bits_ ; ++nn ) result = ( result << 1 ) | Pop();
+    return  result;
+  }
+};
+
+bool  Decode( Pipe::CPipe& pipe_in_ , Pipe::CPipe& pipe_out_ ){
+  BitReader br( pipe_in_ );
+  if( br.Pop( 8 ) != 0x77 || br.Pop() ) return false;
+
+  static  u16 left[ 512 ] , right[ 512 ];
+  static  u8  data[ 512 ];
+  u16 used = 0;
+  auto branch = [&]{
+    left[ used ] = right[ used ] = NIL;
+    data[ used ] = 0;
+    return  used++;
+  };
+  const u16 root = branch();
+  const u32 num = br.Pop( 9 );
+  for( u32 nn=0 ; nn < num ; ++nn ){
+    const u8  len  = br.Pop( 5 );
+    const u32 code = br.Pop( len );
+    u16 cur = root;
+    for( int nc=len-1 ; nc >= 0 ; --nc ){
+      u16& next = ( ( code >> nc ) & 1 ) ? right[ cur ] : left[ cur ];
+      if( next == NIL ) next = branch();
+      cur = next;
+    }
+    data[ cur ] = br.Pop( 8 );
+  }
+
+  const u32 size = br.Pop( 20 );
+  u16 cur = root;
+  for( u32 decoded = 0 ; decoded < size ; ){
+    if( left[ cur ] == NIL && right[ cur ] == NIL ){
+      pipe_out_.Push( data[ cur ] );
+      ++decoded;
+      cur = root;
+    } else {
+      cur = br.Pop() ? right[ cur ] : left[ cur ];
+    }
+  }
+  return  true;
+}
+
+} // namespace TreeWalk
+
+// Frequencies halving from one symbol to the next, so codes get longer than
+// both lookup tables and the decoder walks the tree past them.
+static  std::vector<u8> _long_codes( size_t size_ ){
+  Corpus::CRandom rnd( 5 );
+  std::vector<u8> out( size_ );
+  for( u8& cc : out ){
+    const u32 rr = rnd.Next() | 0x80000000u;
+    cc = (u8)__builtin_ctz( rr );
+  }
+  return  out;
+}
+
+static  std::vector<u8> _encode( const std::vector<u8>& data_ ){
+  auto pipe_in  = std::make_shared< Pipe::CMemReaderPipe >( data_.data() , data_.size() );
+  auto pipe_out = std::make_shared< Pipe::CMemBufferPipe >();
+  Huffman::CHuffmanEncoder encoder;
+  encoder.SetIn ( pipe_in );
+  encoder.SetOut( pipe_out );
+  encoder.Encode();
+  return  pipe_out->_buff;
+}
+
+int main(){
+  std::vector<Corpus::Entry> corpus = Corpus::All( 64 * 1024 );
+  corpus.push_back( { "longcode" , _long_codes( 64 * 1024 ) } );
+
+  printf( "bench_huffman: corpus org_bytes packed_bytes tree_MB/s lut_MB/s speedup (host)\n" );
+  for( const Corpus::Entry& ent : corpus ){
+    const std::vector<u8> packed = _encode( ent.data );
+    // Data that does not compress is stored flat, with no tree to walk.
+    if( packed[ 1 ] & 0x80 ){
+      printf( "bench_huffman: %-8s stored flat, skipped\n" , ent.name.c_str() );
+      continue;
+    }
+    std::vector<u8> out_tree , out_lut;
+
+    const double sec_tree = Bench::Seconds( [&]{
+      Pipe::CMemReaderPipe pipe_in( packed.data() , packed.size() );
+      Pipe::CMemBufferPipe pipe_out;
+      CHECK( TreeWalk::Decode( pipe_in , pipe_out ) );
+      out_tree.swap( pipe_out._buff );
+    } );
+    const double sec_lut = Bench::Seconds( [&]{
+      auto pipe_in  = std::make_shared< Pipe::CMemReaderPipe >( packed.data() , packed.size() );
+      auto pipe_out = std::make_shared< Pipe::CMemBufferPipe >();
+      Huffman::CHuffmanDecoder decoder;
+      decoder.SetIn ( pipe_in );
+      decoder.SetOut( pipe_out );
+      CHECK_EQ( decoder.Decode() , Huffman::CHuffmanDecoder::DECODE_OK );
+      out_lut.swap( pipe_out->_buff );
+    } );
+    CHECK( out_tree == ent.data );
+    CHECK( out_lut == ent.data );
+
+    const double mb = (double)ent.data.size() / 1e6;
+    printf( "bench_huffman: %-8s %6zu %6zu %8.1f %8.1f %5.2fx\n" ,
+      ent.name.c_str() , ent.data.size() , packed.size() ,
+      mb / sec_tree , mb / sec_lut , sec_tree / sec_lut );
+  }
+  return  0;
+}
@@ -0,0 +1,101 @@
+// The codecs through pipes with block Read/Write/Peek, against the same codecs
+// through pipes that only Pop and Push one byte at a time, as they ran before
+// the block transfers. Outputs of both are compared.
+#include <beep8.h>
+#include <huffman.h>
+#include <rle.h>
+#include <zpack.h>
+#include "host/bench.h"
+#include "host/corpus.h"
+#include "host/test.h"
+
+using namespace Pipe;
+
+// Reads a buffer one byte at a time: no Peek(), and Read() falls back to Pop().
+class CByteReaderPipe : public CPipe {
+  const std::vector<u8>& _src;
+  bool vOnPop( u8& x_ ) override {
+    if( _poped_in_bytes >= _src.size() ) return false;
+    x_ = _src[ _poped_in_bytes ];
+    return  true;
+  }
+public:
+  explicit CByteReaderPipe( const std::vector<u8>& src_ ) : _src( src_ ) {}
+};
+
+// Collects bytes one at a time: Write() falls back to Push().
+class CByteWriterPipe : public CPipe {
+  bool vOnPush( u8 x_ ) override {
+    _buff.push_back( x_ );
+    return  true;
+  }
+public:
+  std::vector<u8> _buff;
+};
+
+// Runs codec_ from src_ to a new buffer, through block or byte-only pipes.
+template< class Codec >
+static  std::vector<u8> _run( const std::vector<u8>& src_ , bool blocks_ ){
+  Codec codec;
+  if( blocks_ ){
+    auto pipe_out = std::make_shared< CMemBufferPipe >();
+    codec.SetIn ( std::make_shared< CMemReaderPipe >( std::span<const u8>( src_ ) ) );
+    codec.SetOut( pipe_out );
+    codec.Run();
+    return  std::move( pipe_out->_buff );
+  } else {
+    auto pipe_out = std::make_shared< CByteWriterPipe >();
+    codec.SetIn ( std::make_shared< CByteReaderPipe >( src_ ) );
+    codec.SetOut( pipe_out );
+    codec.Run();
+    return  std::move( pipe_out->_buff );
+  }
+}
+
+struct HuffmanEncode : Huffman::CHuffmanEncoder {
+  void  Run(){ Encode(); }
+};
+struct HuffmanDecode : Huffman::CHuffmanDecoder {
+  void  Run(){ CHECK( Decode() == DECODE_OK ); }
+};
+struct RleEncode : Rle::CRleEncoder {
+  void  Run(){ CHECK( Encode() == ENCODE_OK ); }
+};
+struct RleDecode : Rle::CRleDecoder {
+  void  Run(){ CHECK( Decode() == DECODE_OK ); }
+};
+struct ZPackEncode : ZPack::CZPackEncoder {
+  void  Run(){ Encode(); }
+};
+struct ZPackDecode : ZPack::CZPackDecoder {
+  void  Run(){ CHECK( Decode() == DECODE_OK ); }
+};
+
+// Times the encoder on the corpus data and the decoder on what it encoded.
+template< class Encode , class Decode >
+static  void  _bench( const char* codec_ , const Corpus::Entry& ent_ ){
+  const std::vector<u8> packed = _run< Encode >( ent_.data , true );
+  CHECK( _run< Encode >( ent_.data , false ) == packed );
+  CHECK( _run< Decode >( packed , true  ) == ent_.data );
+  CHECK( _run< Decode >( packed , false ) == ent_.data );
+
+  const double mb = (double)ent_.data.size() / 1e6;
+  const double enc_byte  = Bench::Seconds( [&]{ _run< Encode >( ent_.data , false ); } );
+  const double enc_block = Bench::Seconds( [&]{ _run< Encode >( ent_.data , true  ); } );
+  const double dec_byte  = Bench::Seconds( [&]{ _run< Decode >( packed , false ); } );
+  const double dec_block = Bench::Seconds( [&]{ _run< Decode >( packed , true  ); } );
+  printf( "bench_pipe: %-7s %-8s %8.1f %8.1f %+5.0f%% %8.1f %8.1f %+5.0f%%\n" ,
+    codec_ , ent_.name.c_str() ,
+    mb / enc_byte , mb / enc_block , ( enc_byte / enc_block - 1.0 ) * 100.0 ,
+    mb / dec_byte , mb / dec_block , ( dec_byte / dec_block - 1.0 ) * 100.0 );
+}
+
+int main(){
+  printf( "bench_pipe: codec   corpus   enc_MB/s: byte block gain  dec_MB/s: byte block gain (host)\n" );
+  for( const Corpus::Entry& ent : Corpus::All( 64 * 1024 ) ){
+    _bench< HuffmanEncode , HuffmanDecode >( "huffman" , ent );
+    _bench< RleEncode     , RleDecode     >( "rle"     , ent );
+    _bench< ZPackEncode   , ZPackDecode   >( "zpack"   , ent );
+  }
+  return  0;
+}
@@ -0,0 +1,29 @@
+// Decode throughput of the b8helper ZPack decoder on streams encoded by
+// genb8rom, the way compressed romfs files are opened.
+#include <beep8.h>
+#include <zpack.h>
+#include "../../tool/genb8rom/zpack.h"
+#include "host/bench.h"
+#include "host/corpus.h"
+#include "host/test.h"
+
+static  const char* const _methods[] = { "huffman->rle" , "huffman" , "flat" , "flat+size" };
+
+int main(){
+  printf( "bench_zpack: corpus method org_bytes packed_bytes ratio decode_MB/s(host)\n" );
+  for( const Corpus::Entry& ent : Corpus::All( 64 * 1024 ) ){
+    zpack::Method method;
+    const std::vector<u8> packed = zpack::encode( ent.data , method );
+    std::vector<u8> decoded( ent.data.size() );
+
+    const double sec = Bench::Seconds( [&]{
+      CHECK_EQ( ZPack::Decode( packed.data() , packed.size() , decoded.data() , decoded.size() ) , ent.data.size() );
+    } );
+    CHECK( decoded == ent.data );
+
+    printf( "bench_zpack: %-8s %-12s %6zu %6zu %.3f %8.1f\n" ,
+      ent.name.c_str() , _methods[ method ] , ent.data.size() , packed.size() ,
+      (double)packed.size() / (double)ent.data.size() , (double)ent.data.size() / sec / 1e6 );
+  }
+  return  0;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file assert.h
+ * @brief Host replacement of <b8/assert.h> for the host tests.
+ *
+ * A failed `_ASSERT` calls `b8HostAssertFailed`, which aborts, or returns to
+ * the test through `B8_HOST_EXPECT_ASSERT` when the test expects it to fail.
+ */
+#pragma once
+#include <stdio.h>
+#include <setjmp.h>
+#ifdef  __cplusplus
+extern  "C" {
+#endif
+
+extern  jmp_buf*  b8HostAssertJmp;
+extern  void  b8HostAssertFailed( const char* file_ , int line_ , const char* comment_ );
+
+#define _ASSERT(expr_, comment_) \
+  do { \
+    if (!(expr_)) { \
+      b8HostAssertFailed( __FILE__ , __LINE__ , comment_ ); \
+    } \
+  } while(0)
+
+#define _NOTIMPL()  b8HostAssertFailed( __FILE__ , __LINE__ , "not implemented" )
+
+/**
+ * @brief Evaluates `stmt_`, and yields 1 if an `_ASSERT` failed in it, 0 otherwise.
+ */
+#define B8_HOST_EXPECT_ASSERT(result_, stmt_) \
+  do { \
+    jmp_buf jb_; \
+    b8HostAssertJmp = &jb_; \
+    if( setjmp( jb_ ) == 0 ){ \
+      stmt_; \
+      (result_) = 0; \
+    } else { \
+      (result_) = 1; \
+    } \
+    b8HostAssertJmp = NULL; \
+  } while(0)
+
+#ifdef  __cplusplus
+}
+#endif
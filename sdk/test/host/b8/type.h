@@ -0,0 +1,28 @@
+/**
+ * @file type.h
+ * @brief Host replacement of <b8/type.h> for the host tests.
+ *
+ * The target's u32 is `unsigned long`, which is 64 bits wide on a 64-bit host
+ * and would change the layout of the command words. The fixed-width types keep
+ * every structure as it is on the target.
+ */
+#pragma once
+#include <stdint.h>
+#include <sys/types.h>
+#ifdef  __cplusplus
+extern  "C" {
+#endif
+typedef uint32_t            u32;
+typedef uint64_t            u64;
+typedef int64_t             s64;
+typedef uint16_t            u16;
+typedef uint8_t             u8;
+typedef uint8_t             u1;
+typedef int32_t             s32;
+typedef int16_t             s16;
+typedef int8_t              s8;
+typedef float               f32;
+typedef double              f64;
+#ifdef  __cplusplus
+}
+#endif
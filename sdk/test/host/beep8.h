@@ -0,0 +1,52 @@
+/**
+ * @file beep8.h
+ * @brief Host replacement of <beep8.h> for the host tests.
+ *
+ * Brings in the parts of b8lib that build on the host: the PPU and APU command
+ * recorders and ROMFS. The system calls they use are stubbed in host/stub.c,
+ * and threads are the host's.
+ */
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <b8/type.h>
+#include <b8/register.h>
+#include <b8/assert.h>
+#include <b8/sys.h>
+#include <b8/irq.h>
+#include <b8/tmr.h>
+#include <b8/ppu.h>
+#include <b8/apu.h>
+#include <b8/romfs.h>
+
+#ifdef  __cplusplus
+extern  "C" {
+#endif
+
+static  inline  int set_errno( int errcode ){
+  errno = errcode;
+  return  -1;
+}
+
+#define B8_OS_PRIORITY_DEFAULT  (16)
+
+extern  int   b8SysIrqClearAndWait( u32 irq );
+extern  u32   b8SysGetIrqCount( u32 irq );
+extern  int   b8SysSetupIrqWait( u32 irq );
+
+/**
+ * @brief Advances the V-blank count of the stubs, as if the interrupt had been serviced.
+ */
+extern  void  b8HostVblank( void );
+
+/**
+ * @brief Makes the stubbed `b8SysIrqClearAndWait` fail from now on, or succeed again.
+ */
+extern  void  b8HostIrqWaitFails( int fail_ );
+
+#ifdef  __cplusplus
+}
+#endif
@@ -0,0 +1,41 @@
+/**
+ * @file bench.h
+ * @brief Timing for the host benchmarks.
+ *
+ * Host timings only compare implementations with each other; the target's
+ * cycle counts differ.
+ */
+#pragma once
+#include <time.h>
+
+namespace Bench {
+
+inline double Now(){
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC , &ts );
+  return  (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Runs fn_ repeatedly for at least min_sec_ seconds.
+ *
+ * @return Seconds per run, the best of three rounds.
+ */
+template< class Fn >
+double  Seconds( Fn fn_ , double min_sec_ = 0.2 ){
+  double best = 1e30;
+  for( int round=0 ; round < 3 ; ++round ){
+    const double t0 = Now();
+    double elapsed = 0.0;
+    long runs = 0;
+    do {
+      fn_();
+      ++runs;
+      elapsed = Now() - t0;
+    } while( elapsed < min_sec_ / 3 );
+    if( elapsed / runs < best ) best = elapsed / runs;
+  }
+  return  best;
+}
+
+} // namespace Bench
@@ -0,0 +1,88 @@
+/**
+ * @file corpus.h
+ * @brief Test data for the codec tests and benchmarks, generated from a fixed seed.
+ */
+#pragma once
+#include <cstring>
+#include <string>
+#include <vector>
+#include <b8/type.h>
+
+namespace Corpus {
+
+struct Entry {
+  std::string     name;
+  std::vector<u8> data;
+};
+
+// xorshift32, so the data is the same on every host.
+class CRandom {
+  u32 _state;
+public:
+  explicit CRandom( u32 seed_ ) : _state( seed_ ) {}
+  u32 Next(){
+    _state ^= _state << 13;
+    _state ^= _state >> 17;
+    _state ^= _state << 5;
+    return _state;
+  }
+};
+
+// Words picked at random, like a script or a dialogue file.
+inline std::vector<u8> Text( size_t size_ ){
+  static const char* const words[] = {
+    "the", "a", "player", "enemy", "jumps", "over", "castle", "sword", "gold",
+    "door", "opens", "key", "and", "to", "of", "level", "boss", "hp", "\n",
+  };
+  CRandom rnd( 1 );
+  std::vector<u8> out;
+  while( out.size() < size_ ){
+    const char* word = words[ rnd.Next() % std::size(words) ];
+    out.insert( out.end(), word, word + strlen( word ) );
+    out.push_back( ' ' );
+  }
+  out.resize( size_ );
+  return out;
+}
+
+// Runs of tile numbers, like a BG map.
+inline std::vector<u8> Tilemap( size_t size_ ){
+  CRandom rnd( 2 );
+  std::vector<u8> out;
+  while( out.size() < size_ ){
+    const u8 tile = (u8)( rnd.Next() % 12 );
+    out.insert( out.end(), 1 + rnd.Next() % 40, tile );
+  }
+  out.resize( size_ );
+  return out;
+}
+
+// A few symbols much more frequent than the rest, like 4bpp pixels packed in bytes.
+inline std::vector<u8> Skewed( size_t size_ ){
+  CRandom rnd( 3 );
+  std::vector<u8> out( size_ );
+  for( u8& cc : out ){
+    const u32 rr = rnd.Next();
+    cc = (u8)( ( rr & 0xf00 ) ? ( rr & 3 ) : ( rr >> 24 ) );
+  }
+  return out;
+}
+
+// Incompressible.
+inline std::vector<u8> Random( size_t size_ ){
+  CRandom rnd( 4 );
+  std::vector<u8> out( size_ );
+  for( u8& cc : out ) cc = (u8)rnd.Next();
+  return out;
+}
+
+inline std::vector<Entry> All( size_t size_ ){
+  return {
+    { "text"    , Text( size_ ) },
+    { "tilemap" , Tilemap( size_ ) },
+    { "skewed"  , Skewed( size_ ) },
+    { "random"  , Random( size_ ) },
+  };
+}
+
+} // namespace Corpus
@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "genb8rom.h"
+#include "test.h"
+
+#ifndef GENB8ROM
+#error "GENB8ROM: path of the host genb8rom, given by the Makefile"
+#endif
+
+static  char  _dir[ 64 ];
+
+void  b8HostGenb8romBegin( void ){
+  char path[ 128 ];
+  strcpy( _dir , "/tmp/b8test.XXXXXX" );
+  CHECK( mkdtemp( _dir ) );
+  snprintf( path , sizeof(path) , "%s/in" , _dir );
+  CHECK( mkdir( path , 0700 ) == 0 );
+}
+
+void  b8HostGenb8romAdd( const char* name_ , const void* data_ , size_t size_ ){
+  char path[ 384 ];
+  snprintf( path , sizeof(path) , "%s/in/%s" , _dir , name_ );
+  FILE* fp = fopen( path , "wb" );
+  CHECK( fp );
+  CHECK( fwrite( data_ , 1 , size_ , fp ) == size_ );
+  fclose( fp );
+}
+
+u8*   b8HostGenb8rom( const char* options_ , size_t* size_ ){
+  char cmd[ 384 ];
+  snprintf( cmd , sizeof(cmd) , GENB8ROM " -i '%s/in/*' -o %s/romfs.bin %s > /dev/null" ,
+            _dir , _dir , options_ );
+  CHECK( system( cmd ) == 0 );
+
+  snprintf( cmd , sizeof(cmd) , "%s/romfs.bin" , _dir );
+  FILE* fp = fopen( cmd , "rb" );
+  CHECK( fp );
+  fseek( fp , 0 , SEEK_END );
+  *size_ = (size_t)ftell( fp );
+  fseek( fp , 0 , SEEK_SET );
+  u8* image = (u8*)malloc( *size_ );
+  CHECK( fread( image , 1 , *size_ , fp ) == *size_ );
+  fclose( fp );
+  return  image;
+}
+
+void  b8HostGenb8romEnd( void ){
+  char cmd[ 128 ];
+  snprintf( cmd , sizeof(cmd) , "rm -rf %s" , _dir );
+  CHECK( system( cmd ) == 0 );
+}
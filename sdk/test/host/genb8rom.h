@@ -0,0 +1,45 @@
+/**
+ * @file genb8rom.h
+ * @brief Builds BP8R images with the host build of tool/genb8rom, for the host tests.
+ *
+ * The files added are written to a temporary directory, which genb8rom packs.
+ */
+#pragma once
+#include <stddef.h>
+#include <b8/type.h>
+
+#ifdef  __cplusplus
+extern  "C" {
+#endif
+
+/**
+ * @brief Creates an empty input directory.
+ */
+extern  void  b8HostGenb8romBegin( void );
+
+/**
+ * @brief Adds a file to the input directory.
+ *
+ * @param name_ File name.
+ * @param data_ Contents.
+ * @param size_ Size of the contents in bytes.
+ */
+extern  void  b8HostGenb8romAdd( const char* name_ , const void* data_ , size_t size_ );
+
+/**
+ * @brief Runs genb8rom over the files added so far.
+ *
+ * @param options_ Options added to "-i <dir>/(every file) -o <image>", e.g. "-c 1".
+ * @param size_ Receives the size of the image in bytes.
+ * @return The image in a heap buffer, which the caller frees.
+ */
+extern  u8*   b8HostGenb8rom( const char* options_ , size_t* size_ );
+
+/**
+ * @brief Removes the input directory and the image.
+ */
+extern  void  b8HostGenb8romEnd( void );
+
+#ifdef  __cplusplus
+}
+#endif
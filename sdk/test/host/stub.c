@@ -0,0 +1,70 @@
+#include <beep8.h>
+#include <stdlib.h>
+#include <crt/crt.h>
+
+jmp_buf*  b8HostAssertJmp;
+
+static  u32   _vblank_count;
+static  int   _irq_wait_fails;
+
+void  b8HostAssertFailed( const char* file_ , int line_ , const char* comment_ ){
+  if( b8HostAssertJmp ){
+    longjmp( *b8HostAssertJmp , 1 );
+  }
+  fprintf( stderr , "\n=== Assertion failed === %s(%d) %s\n" , file_ , line_ , comment_ );
+  abort();
+}
+
+void  b8HostVblank( void ){
+  ++_vblank_count;
+}
+
+void  b8HostIrqWaitFails( int fail_ ){
+  _irq_wait_fails = fail_;
+}
+
+int   b8SysSetupIrqWait( u32 irq ){
+  (void)irq;
+  return  0;
+}
+
+int   b8SysIrqClearAndWait( u32 irq ){
+  if( _irq_wait_fails ){
+    errno = EINVAL;
+    return  -1;
+  }
+  if( irq == B8_IRQ_VBLK ) b8HostVblank();
+  return  0;
+}
+
+u32   b8SysGetIrqCount( u32 irq ){
+  return  irq == B8_IRQ_VBLK ? _vblank_count : 0;
+}
+
+u32   b8SysGetCpuClock( void ){
+  return  1000000;
+}
+
+// Channels past the last one fail, as on the target.
+int   b8TmrSetup( u32 tmr_ch , u32 cycval ){
+  (void)cycval;
+  if( tmr_ch >= B8_TMR_NUM ) return set_errno( EINVAL );
+  return  0;
+}
+
+int   b8TmrWait( u32 tmr_ch ){
+  (void)tmr_ch;
+  return  0;
+}
+
+// The last driver registered; the tests call its operations directly.
+const char*             b8HostDriverPath;
+const file_operations*  b8HostDriverFops;
+
+int   fs_register_driver( const char* path , const file_operations* fops , mode_t mode , void* priv ){
+  (void)mode;
+  (void)priv;
+  b8HostDriverPath = path;
+  b8HostDriverFops = fops;
+  return  0;
+}
@@ -0,0 +1,26 @@
+/**
+ * @file test.h
+ * @brief Checks shared by the host tests.
+ */
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(expr_) \
+  do { \
+    if( !(expr_) ){ \
+      fprintf( stderr , "%s(%d): CHECK( %s ) failed\n" , __FILE__ , __LINE__ , #expr_ ); \
+      exit( 1 ); \
+    } \
+  } while(0)
+
+#define CHECK_EQ(a_, b_) \
+  do { \
+    const unsigned long long a__ = (unsigned long long)(a_); \
+    const unsigned long long b__ = (unsigned long long)(b_); \
+    if( a__ != b__ ){ \
+      fprintf( stderr , "%s(%d): CHECK_EQ( %s , %s ) failed: 0x%llx != 0x%llx\n" , \
+        __FILE__ , __LINE__ , #a_ , #b_ , a__ , b__ ); \
+      exit( 1 ); \
+    } \
+  } while(0)
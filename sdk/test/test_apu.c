@@ -0,0 +1,112 @@
+// Checks the APU command words against the layouts of the data sheet's APU
+// command tables (docs/beep8_data_sheet.numbers), through the B8_APU_MOCK capture.
+// The expected words are written out by hand from those tables.
+#include <beep8.h>
+#include "host/test.h"
+
+static  u32   _buff[2][ 64 ];
+
+static  void  _check_capture( const u32* expect_ , u32 num_ ){
+  const u32* words;
+  CHECK_EQ( b8ApuMockGetCapture( &words ) , num_ );
+  for( u32 nn=0 ; nn < num_ ; ++nn ){
+    CHECK_EQ( words[ nn ] , expect_[ nn ] );
+  }
+}
+
+static  void  _test_layouts( void ){
+  b8ApuCmd cmd = {0};
+  b8ApuMockClear();
+  b8ApuCmdSetBuff( &cmd , _buff[0] , sizeof(_buff[0]) );
+
+  b8ApuNopAlloc( &cmd );
+  b8ApuAttackAlloc( &cmd )->ch = 5;
+  { b8ApuTime* pp = b8ApuAttacktimeAlloc( &cmd ); pp->ch = 1; pp->time = 0xfffff; }
+  { b8ApuAmp* pp = b8ApuSustainampAlloc( &cmd ); pp->ch = 7; pp->amp = 0x1234; }
+  { b8ApuSetfreq* pp = b8ApuSetfreqAlloc( &cmd ); pp->ch = 2; pp->freq = (16383 << 6) | 63; }
+  { b8ApuSetwavtype* pp = b8ApuSetwavtypeAlloc( &cmd ); pp->ch = 4; pp->wavtype = B8_APU_WAVE_NOISE; }
+  { b8ApuTrackvol* pp = b8ApuTrackvolAlloc( &cmd ); pp->ch = 6; pp->vol = 0xffff; }
+  b8ApuHaltAlloc( &cmd );
+  b8ApuExec( &cmd );
+
+  static  const u32 expect[] = {
+    0x00000000,   // NOP
+    0x01500000,   // ATTACK        TRACK 5
+    0x021fffff,   // ATTACKTIME    TRACK 1, SAMPLES 0xfffff
+    0x06701234,   // SUSTAINAMP    TRACK 7, AMPLITUDE 0x1234
+    0x102fffff,   // SETFREQ       TRACK 2, IntegerPart 16383, FractionalPart 63
+    0x11400007,   // SETWAVTYPE    TRACK 4, TYPE noise
+    0x1360ffff,   // TRACKVOL      TRACK 6, VOLUME 1.0
+    0xff000000,   // HALT
+  };
+  _check_capture( expect , sizeof(expect)/sizeof(expect[0]) );
+  CHECK_EQ( b8ApuMockGetExecCount() , 1 );
+  CHECK_EQ( B8_APU_EXEC , ( B8_APU_EXEC_START << 24 ) | ( (u32)(uintptr_t)_buff[0] & 0xffffff ) );
+  CHECK_EQ( sizeof(b8ApuSetfreq) , 4 );
+  CHECK_EQ( sizeof(b8ApuTime) , 4 );
+}
+
+// Two frames through a pair, with shadow registers: the second frame only
+// records what changed.
+static  void  _test_register_sequence( void ){
+  static  b8ApuShadow shadow;
+  b8ApuCmdPair pair;
+  b8ApuCmd cmd = {0};
+
+  b8ApuMockClear();
+  b8ApuShadowReset( &shadow );
+  cmd.shadow = &shadow;
+  b8ApuCmdPairInit( &pair , _buff[0] , _buff[1] , sizeof(_buff[0]) );
+
+  for( int frame=0 ; frame < 2 ; ++frame ){
+    b8ApuCmdPairBegin( &pair , &cmd );
+    b8ApuSetWavtype( &cmd , 3 , B8_APU_WAVE_SQUARE );
+    b8ApuSetFreq( &cmd , 3 , frame == 0 ? B8_APU_HZ( 440 ) : B8_APU_HZ( 440 ) + 32 );
+    b8ApuSetAttacktime( &cmd , 3 , B8_APU_MS_TO_SAMPLES( 10 ) );
+    b8ApuSetAttackamp( &cmd , 3 , B8_APU_AMP_MAX );
+    b8ApuSetTrackvol( &cmd , 3 , 0x8000 );
+    b8ApuAttackAlloc( &cmd )->ch = 3;
+    b8ApuHaltAlloc( &cmd );
+    b8ApuCmdPairSubmit( &pair , &cmd );
+  }
+
+  static  const u32 expect[] = {
+    0x11300001,   // SETWAVTYPE    TRACK 3, square
+    0x10306e00,   // SETFREQ       TRACK 3, 440 Hz
+    0x023001b9,   // ATTACKTIME    TRACK 3, 441 samples
+    0x0330ffff,   // ATTACKAMP     TRACK 3, 1.0
+    0x13308000,   // TRACKVOL      TRACK 3, 0.5
+    0x01300000,   // ATTACK        TRACK 3
+    0xff000000,   // HALT
+    0x10306e20,   // SETFREQ       TRACK 3, 440.5 Hz
+    0x01300000,   // ATTACK        TRACK 3
+    0xff000000,   // HALT
+  };
+  _check_capture( expect , sizeof(expect)/sizeof(expect[0]) );
+  CHECK_EQ( b8ApuMockGetExecCount() , 2 );
+  CHECK_EQ( shadow.written , 6 );
+  CHECK_EQ( shadow.dropped , 4 );
+}
+
+static  void  _test_range( void ){
+  b8ApuCmd cmd = {0};
+  int failed;
+  b8ApuCmdSetBuff( &cmd , _buff[0] , sizeof(_buff[0]) );
+
+  B8_HOST_EXPECT_ASSERT( failed , b8ApuSetFreq( &cmd , 0 , B8_APU_FREQ_MAX + 1 ) );
+  CHECK( failed );
+  B8_HOST_EXPECT_ASSERT( failed , b8ApuSetTrackvol( &cmd , 0 , 0x10000 ) );
+  CHECK( failed );
+  B8_HOST_EXPECT_ASSERT( failed , b8ApuSetWavtype( &cmd , B8_APU_MAX_CH , 0 ) );
+  CHECK( failed );
+  B8_HOST_EXPECT_ASSERT( failed , b8ApuSetDecaytime( &cmd , 0 , B8_APU_TIME_MAX ) );
+  CHECK( !failed );
+}
+
+int main( void ){
+  _test_layouts();
+  _test_register_sequence();
+  _test_range();
+  printf( "test_apu: ok\n" );
+  return  0;
+}
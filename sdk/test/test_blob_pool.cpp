@@ -0,0 +1,74 @@
+// Deduplication of file contents in genb8rom: BlobPool with a hash where every
+// blob collides, then identical files in an image built by genb8rom.
+#include <beep8.h>
+#include "../../tool/genb8rom/blob_pool.h"
+#include "host/genb8rom.h"
+#include "host/test.h"
+
+static  uint64_t  _same_hash( const std::vector<uint8_t>& blob_ ){
+  (void)blob_;
+  return  0;
+}
+
+static  void  _test_collisions(){
+  std::vector<uint8_t> packdata;
+  BlobPool pool( packdata , _same_hash );
+
+  const std::vector<uint8_t> abc    = { 'a' , 'b' , 'c' };
+  const std::vector<uint8_t> abcdef = { 'a' , 'b' , 'c' , 'd' , 'e' , 'f' };
+  const std::vector<uint8_t> abd    = { 'a' , 'b' , 'd' };
+  const std::vector<uint8_t> empty;
+
+  // A longer blob with the same hash and prefix is stored apart, without
+  // comparing past the end of the pool.
+  CHECK_EQ( pool.add( abc ) , 0 );
+  CHECK_EQ( pool.add( abcdef ) , 4 );
+  CHECK_EQ( pool.add( abd ) , 12 );
+  CHECK_EQ( pool.add( empty ) , 16 );
+  CHECK_EQ( packdata.size() , 16 );
+  CHECK_EQ( pool.shared_files , 0 );
+
+  CHECK_EQ( pool.add( abcdef ) , 4 );
+  CHECK_EQ( pool.add( abc ) , 0 );
+  CHECK_EQ( pool.add( abd ) , 12 );
+  CHECK_EQ( pool.add( empty ) , 16 );
+  CHECK_EQ( packdata.size() , 16 );
+  CHECK_EQ( pool.shared_files , 4 );
+  CHECK_EQ( pool.saved_bytes , 8 + 4 + 4 + 0 );
+}
+
+static  void  _test_image(){
+  std::vector<u8> data( 300 );
+  for( size_t nn=0 ; nn < data.size() ; ++nn ) data[ nn ] = (u8)( nn * 13 );
+  std::vector<u8> longer = data;
+  longer.push_back( 0 );
+
+  b8HostGenb8romBegin();
+  b8HostGenb8romAdd( "a.bin" , data.data() , data.size() );
+  b8HostGenb8romAdd( "b.bin" , data.data() , data.size() );
+  b8HostGenb8romAdd( "c.bin" , longer.data() , longer.size() );
+  size_t size;
+  u8* image = b8HostGenb8rom( "" , &size );
+  b8HostGenb8romEnd();
+  CHECK_EQ( b8RomfsHostMount( image , size ) , 0 );
+
+  size_t size_a , size_b , size_c;
+  const u8* aa = (const u8*)b8RomfsFind( "a.bin" , &size_a );
+  const u8* bb = (const u8*)b8RomfsFind( "b.bin" , &size_b );
+  const u8* cc = (const u8*)b8RomfsFind( "c.bin" , &size_c );
+  CHECK( aa && bb && cc );
+  CHECK( aa == bb );
+  CHECK( cc != aa );
+  CHECK_EQ( size_a , data.size() );
+  CHECK_EQ( size_c , longer.size() );
+  CHECK( 0 == memcmp( aa , data.data() , data.size() ) );
+  CHECK( 0 == memcmp( cc , longer.data() , longer.size() ) );
+  free( image );
+}
+
+int main(){
+  _test_collisions();
+  _test_image();
+  printf( "test_blob_pool: ok\n" );
+  return  0;
+}
@@ -0,0 +1,231 @@
+// Builds OTs with retained segments and walks the JMP chain the way the PPU
+// does, checking the order the primitives are reached in.
+#include <beep8.h>
+#include <sys/mman.h>
+#include "host/test.h"
+
+#define MAX_OTZ     (4)
+#define CMD_WORDS   (256)
+#define SEG_WORDS   (32)
+#define MAX_VISITS  (64)
+
+// JMP keeps a 24-bit word address, so the buffers have to sit in the low 64 MB.
+#define LOW_ADDR    ((void*)0x1000000)
+
+// b8PpuExec() writes B8_PPU_EXEC, so the page of the PPU registers is mapped too.
+#define PPU_REGS    ((void*)(uintptr_t)B8_PPU_ADDR)
+
+typedef struct {
+  u32*  cmd;
+  u32*  ot;
+  u32*  ot_prev;
+  u32*  seg[2];
+} Buffers;
+
+static  Buffers _bufs;
+
+static  void  _alloc_buffers( void ){
+  const size_t words = CMD_WORDS + MAX_OTZ * 2 + SEG_WORDS * 2;
+  u32* pp = mmap( LOW_ADDR , words * sizeof(u32) , PROT_READ | PROT_WRITE ,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE , -1 , 0 );
+  CHECK( pp == LOW_ADDR );
+  _bufs.cmd     = pp;  pp += CMD_WORDS;
+  _bufs.ot      = pp;  pp += MAX_OTZ;
+  _bufs.ot_prev = pp;  pp += MAX_OTZ;
+  _bufs.seg[0]  = pp;  pp += SEG_WORDS;
+  _bufs.seg[1]  = pp;
+
+  void* regs = mmap( PPU_REGS , 0x1000 , PROT_READ | PROT_WRITE ,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE , -1 , 0 );
+  CHECK( regs == PPU_REGS );
+}
+
+// Follows the list from its first word to HALT, and returns the x of each RECT
+// on the way. Fails if the list does not reach HALT within MAX_VISITS commands.
+static  u32   _walk( const u32* start_ , s16* xs_ ){
+  const u32* pc = start_;
+  u32 num = 0;
+  for( u32 steps=0 ; steps < MAX_VISITS ; ++steps ){
+    const u32 code = *pc >> 24;
+    switch( code ){
+      case  B8_PPU_CMD_HALT:
+        return  num;
+      case  B8_PPU_CMD_JMP:
+        pc = (const u32*)(uintptr_t)( ( *pc & 0xffffff ) << 2 );
+        break;
+      case  B8_PPU_CMD_RECT:
+        xs_[ num++ ] = ((const b8PpuRect*)pc)->x;
+        pc += sizeof(b8PpuRect) / sizeof(u32);
+        break;
+      default:
+        CHECK( !"unexpected command" );
+    }
+  }
+  CHECK( !"the list does not reach HALT" );
+  return  0;
+}
+
+static  void  _rect( b8PpuRect* rc_ , s16 x_ ){
+  rc_->x = x_;
+  rc_->y = 0;
+  rc_->w = rc_->h = 1;
+}
+
+static  void  _record_segment( b8PpuSegment* seg_ , u32* buff_ , s16 x0_ , u32 num_ ){
+  b8PpuSegmentBegin( seg_ , buff_ , SEG_WORDS * sizeof(u32) );
+  for( u32 nn=0 ; nn < num_ ; ++nn ){
+    _rect( b8PpuRectAlloc( &seg_->cmd ) , x0_ + nn );
+  }
+  b8PpuSegmentEnd( seg_ );
+}
+
+static  void  _check_order( const s16* expect_ , u32 num_ ){
+  s16 xs[ MAX_VISITS ];
+  CHECK_EQ( _walk( _bufs.cmd , xs ) , num_ );
+  for( u32 nn=0 ; nn < num_ ; ++nn ){
+    CHECK_EQ( xs[ nn ] , expect_[ nn ] );
+  }
+}
+
+// OT entries are drawn from the deepest. Segments behave like their primitives
+// pushed one by one at the same Z.
+static  void  _test_chain( void ){
+  static  b8PpuSegment seg_a , seg_b;
+  b8PpuCmd cmd;
+  _record_segment( &seg_a , _bufs.seg[0] , 10 , 2 );
+  _record_segment( &seg_b , _bufs.seg[1] , 20 , 3 );
+
+  for( u32 frame=0 ; frame < 2 ; ++frame ){
+    b8PpuCmdSetBuff( &cmd , _bufs.cmd , CMD_WORDS * sizeof(u32) );
+    b8PpuClearOT( &cmd , _bufs.ot , _bufs.ot_prev , MAX_OTZ );
+
+    _rect( b8PpuRectAllocZPB( &cmd , 1 ) , 1 );
+    b8PpuSegmentLinkBack( &cmd , 1 , &seg_a );
+    _rect( b8PpuRectAllocZPB( &cmd , 1 ) , 2 );
+    _rect( b8PpuRectAllocZ( &cmd , 3 ) , 3 );
+    b8PpuSegmentLinkFront( &cmd , 3 , &seg_b );
+    b8PpuHaltAlloc( &cmd );
+
+    // The same segments link again the next frame, after b8PpuClearOT().
+    static  const s16 expect[] = { 20 , 21 , 22 , 3 , 1 , 10 , 11 , 2 };
+    _check_order( expect , sizeof(expect)/sizeof(expect[0]) );
+  }
+}
+
+static  void  _test_link_twice( void ){
+  static  b8PpuSegment seg;
+  b8PpuCmd cmd;
+  int failed;
+  _record_segment( &seg , _bufs.seg[0] , 10 , 1 );
+
+  b8PpuCmdSetBuff( &cmd , _bufs.cmd , CMD_WORDS * sizeof(u32) );
+  b8PpuClearOT( &cmd , _bufs.ot , _bufs.ot_prev , MAX_OTZ );
+  b8PpuSegmentLinkBack( &cmd , 2 , &seg );
+
+  // Either a second link in the same OT build would tie the tail JMP back into the list.
+  B8_HOST_EXPECT_ASSERT( failed , b8PpuSegmentLinkBack( &cmd , 0 , &seg ) );
+  CHECK( failed );
+  B8_HOST_EXPECT_ASSERT( failed , b8PpuSegmentLinkFront( &cmd , 2 , &seg ) );
+  CHECK( failed );
+
+  // The list is left as it was before the rejected links.
+  b8PpuHaltAlloc( &cmd );
+  static  const s16 expect[] = { 10 };
+  _check_order( expect , 1 );
+
+  // A segment that has not been ended cannot be linked.
+  b8PpuSegmentBegin( &seg , _bufs.seg[0] , SEG_WORDS * sizeof(u32) );
+  b8PpuClearOT( &cmd , _bufs.ot , _bufs.ot_prev , MAX_OTZ );
+  B8_HOST_EXPECT_ASSERT( failed , b8PpuSegmentLinkFront( &cmd , 0 , &seg ) );
+  CHECK( failed );
+}
+
+// A segment linked into a list that was started is not linked again until the
+// list has retired, since its tail JMP is still on the way of the PPU.
+static  void  _test_relink_in_flight( void ){
+  static  b8PpuSegment seg;
+  b8PpuCmd cmd;
+  int failed;
+  _record_segment( &seg , _bufs.seg[0] , 10 , 1 );
+
+  b8PpuCmdSetBuff( &cmd , _bufs.cmd , CMD_WORDS * sizeof(u32) );
+  b8PpuClearOT( &cmd , _bufs.ot , _bufs.ot_prev , MAX_OTZ );
+  b8PpuSegmentLinkBack( &cmd , 1 , &seg );
+  b8PpuHaltAlloc( &cmd );
+  const b8PpuFence fence = b8PpuExecFence( &cmd );
+  CHECK_EQ( B8_PPU_EXEC , ( B8_PPU_EXEC_START << 24 ) | (u32)(uintptr_t)_bufs.cmd );
+
+  // The next frame, before the V-blank.
+  b8PpuCmdSetBuff( &cmd , _bufs.cmd , CMD_WORDS * sizeof(u32) );
+  b8PpuClearOT( &cmd , _bufs.ot , _bufs.ot_prev , MAX_OTZ );
+  B8_HOST_EXPECT_ASSERT( failed , b8PpuSegmentLinkBack( &cmd , 1 , &seg ) );
+  CHECK( failed );
+
+  b8PpuFenceWait( fence );
+  B8_HOST_EXPECT_ASSERT( failed , b8PpuSegmentLinkBack( &cmd , 1 , &seg ) );
+  CHECK( !failed );
+  b8PpuHaltAlloc( &cmd );
+  static  const s16 expect[] = { 10 };
+  _check_order( expect , 1 );
+}
+
+// The words counted at an OT depth are those of the primitive linked there and
+// its JMP, even when more commands were allocated before it was linked.
+static  void  _test_stats_ot_words( void ){
+  const u32 rect_words = sizeof(b8PpuRect)/sizeof(u32);
+  const u32 sprite_words = sizeof(b8PpuSprite)/sizeof(u32);
+  b8PpuCmd cmd;
+  b8PpuStats stats;
+
+  // Statistics run from one b8PpuExec() to the next: start with an empty list.
+  b8PpuCmdSetBuff( &cmd , _bufs.cmd , CMD_WORDS * sizeof(u32) );
+  b8PpuHaltAlloc( &cmd );
+  b8PpuFenceWait( b8PpuExecFence( &cmd ) );
+
+  b8PpuCmdSetBuff( &cmd , _bufs.cmd , CMD_WORDS * sizeof(u32) );
+  b8PpuClearOT( &cmd , _bufs.ot , _bufs.ot_prev , MAX_OTZ );
+  _rect( b8PpuRectAllocZPB( &cmd , 1 ) , 1 );
+  b8PpuSpriteAllocZ( &cmd , 2 );
+  b8PpuRect* first  = b8PpuRectAlloc( &cmd );
+  b8PpuRect* second = b8PpuRectAlloc( &cmd );
+  _rect( first , 2 );
+  _rect( second , 3 );
+  b8PpuPushBackOT( &cmd , 3 , first );
+  b8PpuPushFrontOT( &cmd , 3 , second );
+  b8PpuHaltAlloc( &cmd );
+  const b8PpuFence fence = b8PpuExecFence( &cmd );
+
+  CHECK_EQ( b8PpuGetStats( &stats ) , 0 );
+  CHECK_EQ( stats.ot_words[ 0 ] , 0 );
+  CHECK_EQ( stats.ot_words[ 1 ] , rect_words + 1 );
+  CHECK_EQ( stats.ot_words[ 2 ] , sprite_words + 1 );
+  CHECK_EQ( stats.ot_words[ 3 ] , 2 * ( rect_words + 1 ) );
+  b8PpuFenceWait( fence );
+}
+
+// A fence is signaled by the next V-blank. A failing V-blank wait halts
+// instead of spinning on the fence.
+static  void  _test_fence_wait( void ){
+  int failed;
+  b8PpuFence fence = b8SysGetIrqCount( B8_IRQ_VBLK );
+  CHECK( !b8PpuFenceDone( fence ) );
+  b8PpuFenceWait( fence );
+  CHECK( b8PpuFenceDone( fence ) );
+
+  fence = b8SysGetIrqCount( B8_IRQ_VBLK );
+  b8HostIrqWaitFails( 1 );
+  B8_HOST_EXPECT_ASSERT( failed , b8PpuFenceWait( fence ) );
+  b8HostIrqWaitFails( 0 );
+  CHECK( failed );
+}
+
+int   main( void ){
+  _alloc_buffers();
+  _test_chain();
+  _test_link_twice();
+  _test_relink_in_flight();
+  _test_stats_ot_words();
+  _test_fence_wait();
+  printf( "test_ppu: ok\n" );
+  return  0;
+}
@@ -0,0 +1,150 @@
+// Packs files with a host build of tool/genb8rom, mounts the image with
+// b8RomfsHostMount(), and reads it back through the driver's file operations.
+#include <beep8.h>
+#include <stdlib.h>
+#include <crt/crt.h>
+#include "host/genb8rom.h"
+#include "host/test.h"
+
+extern  const char*             b8HostDriverPath;
+extern  const file_operations*  b8HostDriverFops;
+
+static  void  _open( File* file_ , const char* name_ ){
+  memset( file_ , 0 , sizeof(*file_) );
+  file_->name = name_;
+  CHECK_EQ( b8HostDriverFops->open( file_ ) , 0 );
+}
+
+static  const char  _hello[] = "hello, romfs";
+static  u8          _pattern[ 1000 ];
+
+static  void  _test_files( const char* options_ ){
+  size_t size;
+  u8* image = b8HostGenb8rom( options_ , &size );
+  CHECK_EQ( b8RomfsHostMount( image , size ) , 0 );
+  CHECK( 0 == strcmp( b8HostDriverPath , B8_ROMFS_MOUNT ) );
+  CHECK_EQ( b8RomfsGetNumFiles() , 2 );
+
+  File file;
+  char buff[ 1024 ];
+  _open( &file , "hello.txt" );
+  CHECK_EQ( b8HostDriverFops->read( &file , buff , sizeof(buff) ) , sizeof(_hello) );
+  CHECK( 0 == memcmp( buff , _hello , sizeof(_hello) ) );
+  CHECK_EQ( b8HostDriverFops->read( &file , buff , sizeof(buff) ) , 0 );
+
+  CHECK_EQ( b8HostDriverFops->seek( &file , -5 , SEEK_END ) , sizeof(_hello) - 5 );
+  CHECK_EQ( b8HostDriverFops->read( &file , buff , 2 ) , 2 );
+  CHECK( 0 == memcmp( buff , _hello + sizeof(_hello) - 5 , 2 ) );
+  CHECK_EQ( b8HostDriverFops->seek( &file , -100 , SEEK_CUR ) , -1 );
+  CHECK_EQ( errno , EINVAL );
+
+  struct stat st;
+  CHECK_EQ( b8HostDriverFops->ioctl( &file , FS_IOCTL_FSTAT , &st ) , 0 );
+  CHECK_EQ( st.st_size , sizeof(_hello) );
+
+  b8RomfsMap map;
+  CHECK_EQ( b8HostDriverFops->ioctl( &file , B8_ROMFS_IOCTL_MAP , &map ) , 0 );
+  CHECK_EQ( map.size , sizeof(_hello) );
+  CHECK( (const u8*)map.ptr >= image && (const u8*)map.ptr < image + size );
+
+  // Requests the driver does not know fail, instead of reporting success.
+  errno = 0;
+  CHECK_EQ( b8HostDriverFops->ioctl( &file , 0x12345678 , &map ) , -1 );
+  CHECK_EQ( errno , ENOTTY );
+  CHECK_EQ( b8HostDriverFops->close( &file ) , 0 );
+
+  _open( &file , "pattern.bin" );
+  CHECK_EQ( b8HostDriverFops->read( &file , buff , sizeof(buff) ) , sizeof(_pattern) );
+  CHECK( 0 == memcmp( buff , _pattern , sizeof(_pattern) ) );
+  CHECK_EQ( b8HostDriverFops->close( &file ) , 0 );
+
+  size_t found_size;
+  const u8* found = b8RomfsFind( "pattern.bin" , &found_size );
+  CHECK( found );
+  CHECK_EQ( found_size , sizeof(_pattern) );
+  CHECK( 0 == memcmp( found , _pattern , sizeof(_pattern) ) );
+
+  memset( &file , 0 , sizeof(file) );
+  file.name = "missing.bin";
+  CHECK_EQ( b8HostDriverFops->open( &file ) , -ENOENT );
+  CHECK( 0 == b8RomfsFind( "missing.bin" , NULL ) );
+  CHECK_EQ( errno , ENOENT );
+
+  free( image );
+}
+
+// Every one of thousands of files is found through the name index, with the
+// names in the FAT or, with -c, in the index itself.
+#define MANY_FILES  (3000)
+
+static  void  _many_name( char* name_ , u32 nn_ ){
+  sprintf( name_ , "f%u_%x.dat" , nn_ , nn_ * 2654435761u );
+}
+
+static  void  _test_many_files( const char* options_ , int names_in_fat_ ){
+  size_t size;
+  u8* image = b8HostGenb8rom( options_ , &size );
+  CHECK_EQ( b8RomfsHostMount( image , size ) , 0 );
+  CHECK_EQ( b8RomfsGetNumFiles() , MANY_FILES );
+
+  const u32 fat_end = 16 + MANY_FILES * image[ 8 ];
+  const u32 index_offset = image[12] | (image[13] << 8) | (image[14] << 16) | ((u32)image[15] << 24);
+  for( u32 nn=0 ; nn < MANY_FILES ; ++nn ){
+    char name[ 32 ];
+    _many_name( name , nn );
+    size_t found_size;
+    const u8* found = b8RomfsFind( name , &found_size );
+    CHECK( found );
+    CHECK_EQ( found_size , sizeof(u32) );
+    u32 contents;
+    memcpy( &contents , found , sizeof(u32) );
+    CHECK_EQ( contents , nn );
+
+    // A name differing only in its last character is not found.
+    name[ strlen( name ) - 1 ] = 'x';
+    CHECK( 0 == b8RomfsFind( name , NULL ) );
+
+    // Index entries give name offsets from the top of the image.
+    const u8* ent = image + index_offset + 4 + nn * 16;
+    const u32 name_offset = ent[8] | (ent[9] << 8) | (ent[10] << 16) | ((u32)ent[11] << 24);
+    if( names_in_fat_ ){
+      CHECK( name_offset >= 16 && name_offset < fat_end );
+    } else {
+      CHECK( name_offset > index_offset && name_offset < size );
+    }
+  }
+  CHECK( 0 == b8RomfsFind( "f3000_0.dat" , NULL ) );
+  free( image );
+}
+
+static  void  _test_broken_header( void ){
+  static  const u8 image[ 16 ] = { 'B' , 'P' , '8' , 'X' };
+  CHECK_EQ( b8RomfsHostMount( image , sizeof(image) ) , -1 );
+}
+
+int   main( void ){
+  b8HostGenb8romBegin();
+  for( size_t nn=0 ; nn < sizeof(_pattern) ; ++nn ){
+    _pattern[ nn ] = (u8)( nn * 7 + ( nn >> 3 ) );
+  }
+  b8HostGenb8romAdd( "hello.txt" , _hello , sizeof(_hello) );
+  b8HostGenb8romAdd( "pattern.bin" , _pattern , sizeof(_pattern) );
+
+  _test_files( "" );
+  _test_files( "-c 1" );
+  _test_broken_header();
+  b8HostGenb8romEnd();
+
+  b8HostGenb8romBegin();
+  for( u32 nn=0 ; nn < MANY_FILES ; ++nn ){
+    char name[ 32 ];
+    _many_name( name , nn );
+    b8HostGenb8romAdd( name , &nn , sizeof(nn) );
+  }
+  _test_many_files( "" , 1 );
+  _test_many_files( "-c 1" , 0 );
+  b8HostGenb8romEnd();
+
+  printf( "test_romfs: ok\n" );
+  return  0;
+}
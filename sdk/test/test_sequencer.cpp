@@ -0,0 +1,121 @@
+// Renders a small bank with CSequencer::Render() and checks the APU commands
+// captured by B8_APU_MOCK: the first note word by word, and that the whole
+// trace depends only on the bank and the requests.
+#include <vector>
+#include <beep8.h>
+#include <sequencer.h>
+#include "host/test.h"
+
+// Two music frames that loop, playing sfx 0 on track 0, and sfx 1 for the sfx.
+static  const u8  _bank[] = {
+  'S' , 'Q' , 2 , 2 ,
+  18 , 0 ,                          // sfx 0
+  26 , 0 ,                          // sfx 1
+  CSequencer::FRAME_LOOP_START , 0 , 0xff , 0xff , 0xff ,
+  CSequencer::FRAME_LOOP_BACK  , 0 , 0xff , 0xff , 0xff ,
+  // sfx 0: 2 ticks per row; square, loudest; A 440 Hz, A# one row, rest 2 rows.
+  2 , 0x83 , 0x8f , 0x90 , 33 , 0x41 , 0x01 , 0xff ,
+  // sfx 1: 1 tick per row; noise at volume 3; C, then silence.
+  1 , 0x86 , 0x8b , 0x90 , 12 , 0x92 , 0xff ,
+};
+
+static  std::vector<u32>  _render(){
+  static  CSequencer* seq;
+  delete seq;
+  seq = new CSequencer;
+  b8ApuMockClear();
+
+  CHECK( seq->SetBank( { _bank , sizeof(_bank) } ) );
+  seq->PlayMusic( 0 );
+  seq->Render( 4 );
+  seq->PlaySfx( 1 );
+  seq->Render( 40 );
+
+  const u32* words;
+  const u32 num = b8ApuMockGetCapture( &words );
+  CHECK( num < B8_APU_MOCK_CAPTURE_WORDS );
+  return  std::vector<u32>( words , words + num );
+}
+
+static  void  _test_first_note(){
+  const std::vector<u32> trace = _render();
+
+  // Voice 0 gets the music's first note, with the envelope of instrument 3:
+  // attack 2 ms, sustain for the rest of the 2-tick row, release 20 ms.
+  static  const u32 expect[] = {
+    0x11000001,   // SETWAVTYPE    square
+    0x02000058,   // ATTACKTIME    88 samples, 2 ms
+    0x0300ffff,   // ATTACKAMP     1.0
+    0x04000000,   // DECAYTIME     0
+    0x05000269,   // SUSTAINTIME   617 samples, 14 ms
+    0x0600ffff,   // SUSTAINAMP    1.0
+    0x07000372,   // RELEASETIME   882 samples, 20 ms
+    0x10006e00,   // SETFREQ       440 Hz
+    0x1300ffff,   // TRACKVOL      7 of 7
+    0x01000000,   // ATTACK
+    0xff000000,   // HALT
+  };
+  CHECK( trace.size() > std::size(expect) );
+  for( size_t nn=0 ; nn < std::size(expect) ; ++nn ){
+    CHECK_EQ( trace[ nn ] , expect[ nn ] );
+  }
+
+  // Two ticks later, A# on the same voice: only the frequency changes.
+  static  const u32 expect2[] = {
+    0x1000748a,   // SETFREQ       466.16 Hz
+    0x01000000,   // ATTACK
+    0xff000000,   // HALT
+  };
+  for( size_t nn=0 ; nn < std::size(expect2) ; ++nn ){
+    CHECK_EQ( trace[ std::size(expect) + nn ] , expect2[ nn ] );
+  }
+
+  // At tick 4 the sfx takes the free voice 1: instrument 6, 1-tick rows.
+  // The next tick silences it.
+  static  const u32 expect3[] = {
+    0x11100007,   // SETWAVTYPE    noise
+    0x0210002c,   // ATTACKTIME    44 samples, 1 ms
+    0x0310ffff,   // ATTACKAMP     1.0
+    0x04100000,   // DECAYTIME     0
+    0x05100134,   // SUSTAINTIME   308 samples, 7 ms
+    0x0610ffff,   // SUSTAINAMP    1.0
+    0x071001b9,   // RELEASETIME   441 samples, 10 ms
+    0x101020b4,   // SETFREQ       130.8 Hz
+    0x13106db6,   // TRACKVOL      3 of 7
+    0x01100000,   // ATTACK
+    0xff000000,   // HALT
+    0x13100000,   // TRACKVOL      0
+    0xff000000,   // HALT
+  };
+  const size_t at = std::size(expect) + std::size(expect2);
+  for( size_t nn=0 ; nn < std::size(expect3) ; ++nn ){
+    CHECK_EQ( trace[ at + nn ] , expect3[ nn ] );
+  }
+}
+
+static  void  _test_deterministic(){
+  const std::vector<u32> a = _render();
+  const std::vector<u32> b = _render();
+  CHECK_EQ( a.size() , b.size() );
+  for( size_t nn=0 ; nn < a.size() ; ++nn ){
+    CHECK_EQ( a[ nn ] , b[ nn ] );
+  }
+}
+
+static  void  _test_start_fails(){
+  static  CSequencer seq;
+  CHECK( seq.Start( B8_TMR_NUM ) != 0 );
+
+  // Not running, so Render() may still be used.
+  int failed;
+  B8_HOST_EXPECT_ASSERT( failed , seq.Render( 1 ) );
+  CHECK( !failed );
+}
+
+int main(){
+  _test_first_note();
+  _test_deterministic();
+  _test_start_fails();
+  printf( "test_sequencer: ok\n" );
+  return  0;
+}
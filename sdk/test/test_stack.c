@@ -0,0 +1,152 @@
+// Carves, frees and merges stacks in a pool the way the kernel does for
+// threads, checking the free list after every step.
+#include <stdlib.h>
+#include <b8/os.h>
+#include "../b8lib/src/b8/stack.h"
+#include "host/test.h"
+
+#define G           B8_OS_STACK_GRANULE
+#define POOL_BYTES  (16 * G)
+
+static  u8* _top;
+
+// The free list is sorted, never has two blocks next to each other, ends below
+// the carved part, and adds up to free_bytes.
+static  void  _check_pool( const StackPool* pool_ ){
+  size_t bytes = 0;
+  const u8* end = NULL;
+  for( const StackBlock* blk = pool_->free ; blk ; blk = blk->next ){
+    CHECK( (const u8*)blk > end );
+    CHECK( blk->size > 0 && 0 == blk->size % G );
+    end = (const u8*)blk + blk->size;
+    bytes += blk->size;
+  }
+  CHECK( end < pool_->top + pool_->carved );
+  CHECK_EQ( bytes , pool_->free_bytes );
+  CHECK( pool_->carved <= pool_->size );
+}
+
+static  u8*   _alloc( StackPool* pool_ , size_t bytes_ , size_t expect_ ){
+  size_t size = 0;
+  u8* base = StackPoolAlloc( pool_ , bytes_ , &size );
+  CHECK_EQ( size , expect_ );
+  if( base ){
+    CHECK( base >= _top && base + size <= _top + POOL_BYTES );
+    CHECK_EQ( ( base - _top ) % G , 0 );
+  }
+  _check_pool( pool_ );
+  return  base;
+}
+
+static  void  _free( StackPool* pool_ , u8* base_ , size_t size_ ){
+  StackPoolFree( pool_ , base_ , size_ );
+  _check_pool( pool_ );
+}
+
+// Sizes round up to the granule, and blocks are carved from the bottom.
+static  void  _test_carve( void ){
+  StackPool pool;
+  StackPoolInit( &pool , _top , POOL_BYTES );
+  CHECK( _alloc( &pool , 1 , G ) == _top );
+  CHECK( _alloc( &pool , G + 1 , 2*G ) == _top + G );
+  CHECK( _alloc( &pool , 13*G , 13*G ) == _top + 3*G );
+  CHECK( _alloc( &pool , 1 , G ) == NULL );
+  CHECK_EQ( pool.carved , POOL_BYTES );
+}
+
+// A freed stack is reused, first fit, from its top; what is left of it stays free.
+static  void  _test_reuse( void ){
+  StackPool pool;
+  StackPoolInit( &pool , _top , POOL_BYTES );
+  u8* a = _alloc( &pool , G , G );
+  u8* b = _alloc( &pool , 4*G , 4*G );
+  u8* c = _alloc( &pool , G , G );
+  (void)a; (void)c;
+  _free( &pool , b , 4*G );
+  CHECK_EQ( pool.free_bytes , 4*G );
+
+  u8* d = _alloc( &pool , G , G );
+  CHECK( d == b + 3*G );
+  CHECK_EQ( pool.free_bytes , 3*G );
+  CHECK_EQ( pool.carved , 6*G );
+
+  // Freeing it merges it back with the rest.
+  _free( &pool , d , G );
+  CHECK( pool.free == (StackBlock*)b );
+  CHECK_EQ( pool.free->size , 4*G );
+  CHECK( pool.free->next == NULL );
+}
+
+// Free neighbours merge on both sides, and a free block at the end of the
+// carved part goes back to the untouched part.
+static  void  _test_merge( void ){
+  StackPool pool;
+  StackPoolInit( &pool , _top , POOL_BYTES );
+  u8* s[5];
+  for( int nn=0 ; nn<5 ; ++nn ) s[ nn ] = _alloc( &pool , 2*G , 2*G );
+
+  _free( &pool , s[1] , 2*G );
+  _free( &pool , s[3] , 2*G );
+  CHECK( pool.free->next != NULL );
+  _free( &pool , s[2] , 2*G );    // joins s[1] and s[3]
+  CHECK( pool.free == (StackBlock*)s[1] );
+  CHECK_EQ( pool.free->size , 6*G );
+  CHECK( pool.free->next == NULL );
+
+  _free( &pool , s[4] , 2*G );    // at the end: all but s[0] is untouched again
+  CHECK( pool.free == NULL );
+  CHECK_EQ( pool.carved , 2*G );
+  CHECK_EQ( pool.free_bytes , 0 );
+
+  _free( &pool , s[0] , 2*G );
+  CHECK_EQ( pool.carved , 0 );
+
+  // A stack too large for any free block is carved past them.
+  s[0] = _alloc( &pool , G , G );
+  s[1] = _alloc( &pool , G , G );
+  s[2] = _alloc( &pool , G , G );
+  _free( &pool , s[1] , G );
+  CHECK( _alloc( &pool , 2*G , 2*G ) == _top + 3*G );
+}
+
+// Random stacks, freed in random order, never overlap, and the pool is
+// whole again once they are all freed.
+static  void  _test_random( void ){
+  StackPool pool;
+  StackPoolInit( &pool , _top , POOL_BYTES );
+  u8*     base[ 16 ] = { 0 };
+  size_t  size[ 16 ] = { 0 };
+  srand( 8 );
+  for( int step=0 ; step<20000 ; ++step ){
+    const int nn = rand() % 16;
+    if( base[ nn ] ){
+      _free( &pool , base[ nn ] , size[ nn ] );
+      base[ nn ] = NULL;
+      continue;
+    }
+    base[ nn ] = StackPoolAlloc( &pool , 1 + rand() % ( 3*G ) , &size[ nn ] );
+    _check_pool( &pool );
+    if( !base[ nn ] ) continue;
+    for( int mm=0 ; mm<16 ; ++mm ){
+      if( mm == nn || !base[ mm ] ) continue;
+      CHECK( base[ nn ] + size[ nn ] <= base[ mm ] || base[ mm ] + size[ mm ] <= base[ nn ] );
+    }
+  }
+  for( int nn=0 ; nn<16 ; ++nn ){
+    if( base[ nn ] ) _free( &pool , base[ nn ] , size[ nn ] );
+  }
+  CHECK_EQ( pool.carved , 0 );
+  CHECK( pool.free == NULL );
+}
+
+int   main( void ){
+  _top = aligned_alloc( G , POOL_BYTES );
+  CHECK( _top != NULL );
+  _test_carve();
+  _test_reuse();
+  _test_merge();
+  _test_random();
+  free( _top );
+  printf( "test_stack: ok\n" );
+  return  0;
+}
@@ -0,0 +1,151 @@
+// tool/genb8rom carries its own ZPack encoder and decoder (tool/genb8rom/zpack.h),
+// since it builds without the BEEP-8 runtime. This test keeps it in step with
+// the b8helper codecs the target decodes with: the format constants, streams
+// encoded on one side and decoded on the other, and compressed romfs files
+// opened through the romfs driver.
+#include <beep8.h>
+#include <crt/crt.h>
+#include <zpack.h>
+#include <huffman.h>
+#include "../../tool/genb8rom/zpack.h"
+#include "host/corpus.h"
+#include "host/genb8rom.h"
+#include "host/test.h"
+
+extern "C" const file_operations*  b8HostDriverFops;
+
+static_assert( zpack::signature == ZPack::Signature );
+static_assert( zpack::HuffmanToRle == (int)ZPack::HuffmanToRle );
+static_assert( zpack::Huffman      == (int)ZPack::Huffman );
+static_assert( zpack::Flat         == (int)ZPack::Flat );
+static_assert( zpack::FlatWithSize == (int)ZPack::FlatWithSize );
+
+static  std::vector<Corpus::Entry>  _corpus(){
+  std::vector<Corpus::Entry> all = Corpus::All( 48 * 1024 );
+  std::vector<u8> every_symbol( 256 );
+  for( size_t nn=0 ; nn < every_symbol.size() ; ++nn ) every_symbol[ nn ] = (u8)nn;
+  all.push_back( { "one byte"     , { 0x41 } } );
+  all.push_back( { "one run"      , std::vector<u8>( 1000 , 0x00 ) } );
+  all.push_back( { "every symbol" , every_symbol } );
+  all.push_back( { "small text"   , Corpus::Text( 37 ) } );
+  return  all;
+}
+
+// genb8rom's encoder, b8helper's decoder.
+static  void  _test_genb8rom_to_b8helper(){
+  for( const Corpus::Entry& ent : _corpus() ){
+    zpack::Method method;
+    const std::vector<u8> packed = zpack::encode( ent.data , method );
+
+    std::vector<u8> decoded( ent.data.size() + 1 );
+    const int size = ZPack::Decode( packed.data() , packed.size() , decoded.data() , decoded.size() );
+    if( size != (int)ent.data.size() || 0 != memcmp( decoded.data() , ent.data.data() , ent.data.size() ) ){
+      fprintf( stderr , "genb8rom -> b8helper: %s, method %d\n" , ent.name.c_str() , (int)method );
+      CHECK( false );
+    }
+  }
+}
+
+// b8helper's encoder, genb8rom's decoder: every method but FlatWithSize, which
+// genb8rom does not read.
+static  void  _test_b8helper_to_genb8rom(){
+  for( const Corpus::Entry& ent : _corpus() ){
+    auto pipe_in  = std::make_shared< Pipe::CMemReaderPipe >( ent.data.data() , ent.data.size() );
+    auto pipe_out = std::make_shared< Pipe::CMemBufferPipe >();
+    ZPack::CZPackEncoder encoder;
+    encoder.SetIn ( pipe_in );
+    encoder.SetOut( pipe_out );
+    encoder.Encode();
+    if( ( pipe_out->_buff[ 1 ] & 3 ) == ZPack::FlatWithSize ) continue;
+
+    std::vector<u8> decoded;
+    if( !zpack::decode( pipe_out->_buff , decoded ) || decoded != ent.data ){
+      fprintf( stderr , "b8helper -> genb8rom: %s\n" , ent.name.c_str() );
+      CHECK( false );
+    }
+  }
+}
+
+// Huffman streams back to back in a file: the decoder may only take the bytes
+// of its own stream from a pipe it cannot peek into, or rewind.
+static  void  _test_huffman_file_pipe(){
+  const std::vector<Corpus::Entry> corpus = _corpus();
+  FILE* fp = tmpfile();
+  CHECK( fp != nullptr );
+  for( const Corpus::Entry& ent : corpus ){
+    auto pipe_in  = std::make_shared< Pipe::CMemReaderPipe >( ent.data.data() , ent.data.size() );
+    auto pipe_out = std::make_shared< Pipe::CMemBufferPipe >();
+    Huffman::CHuffmanEncoder encoder;
+    encoder.SetIn ( pipe_in );
+    encoder.SetOut( pipe_out );
+    encoder.Encode();
+    fwrite( pipe_out->_buff.data() , 1 , pipe_out->_buff.size() , fp );
+  }
+  fputc( 0xa5 , fp );
+  rewind( fp );
+
+  auto pipe_file = std::make_shared< Pipe::CFilePipe >( fp );
+  for( const Corpus::Entry& ent : corpus ){
+    auto pipe_out = std::make_shared< Pipe::CMemBufferPipe >();
+    Huffman::CHuffmanDecoder decoder;
+    decoder.SetIn ( pipe_file );
+    decoder.SetOut( pipe_out );
+    if( decoder.Decode() != Huffman::CHuffmanDecoder::DECODE_OK || pipe_out->_buff != ent.data ){
+      fprintf( stderr , "huffman file pipe: %s\n" , ent.name.c_str() );
+      CHECK( false );
+    }
+  }
+  u8 tail = 0;
+  CHECK( pipe_file->Pop( tail ) );
+  CHECK_EQ( tail , 0xa5 );
+  fclose( fp );
+}
+
+// genb8rom -z, then open() decodes with the decoder installed from b8helper.
+static  void  _test_romfs(){
+  const std::vector<u8> text = Corpus::Text( 20000 );
+  const std::vector<u8> tiles = Corpus::Tilemap( 20000 );
+  b8HostGenb8romBegin();
+  b8HostGenb8romAdd( "script.txt" , text.data() , text.size() );
+  b8HostGenb8romAdd( "map.bin" , tiles.data() , tiles.size() );
+  size_t size;
+  u8* image = b8HostGenb8rom( "-z *.txt,*.bin" , &size );
+  b8HostGenb8romEnd();
+  CHECK_EQ( b8RomfsHostMount( image , size ) , 0 );
+  ZPack::InstallRomfsDecoder();
+
+  for( const auto& [ name , data ] : { std::pair{ "script.txt" , &text } , std::pair{ "map.bin" , &tiles } } ){
+    b8RomfsMap stored;
+    CHECK_EQ( b8RomfsLookup( name , &stored ) , 0 );
+    CHECK( stored.method != B8_ROMFS_METHOD_STORED );
+    CHECK_EQ( stored.orgsize , data->size() );
+    CHECK( stored.size < data->size() );
+
+    File file = {};
+    file.name = name;
+    CHECK_EQ( b8HostDriverFops->open( &file ) , 0 );
+    std::vector<u8> read( data->size() + 1 );
+    CHECK_EQ( b8HostDriverFops->read( &file , (char*)read.data() , read.size() ) , data->size() );
+    CHECK( 0 == memcmp( read.data() , data->data() , data->size() ) );
+
+    // The map of an open compressed file is the decoded copy, out of the image.
+    b8RomfsMap map;
+    CHECK_EQ( b8HostDriverFops->ioctl( &file , B8_ROMFS_IOCTL_MAP , &map ) , 0 );
+    CHECK_EQ( map.method , B8_ROMFS_METHOD_STORED );
+    CHECK_EQ( map.size , data->size() );
+    CHECK( (const u8*)map.ptr < image || (const u8*)map.ptr >= image + size );
+    CHECK( 0 == memcmp( map.ptr , data->data() , data->size() ) );
+    CHECK_EQ( b8HostDriverFops->close( &file ) , 0 );
+  }
+  b8RomfsSetDecoder( nullptr );
+  free( image );
+}
+
+int main(){
+  _test_genb8rom_to_b8helper();
+  _test_b8helper_to_genb8rom();
+  _test_huffman_file_pipe();
+  _test_romfs();
+  printf( "test_zpack: ok\n" );
+  return  0;
+}
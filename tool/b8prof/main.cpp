@@ -0,0 +1,365 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <regex>
+#include <sstream>
+#include <iomanip>
+#include <cxxabi.h>
+#include "argparse.h"
+
+// Layouts written by b8ProfDump() and b8ProfSampleDump() in sdk/b8lib/src/b8/prof.c
+const char signature[] = "B8PF";
+const char sample_signature[] = "B8PS";
+const uint16_t dump_version = 1;
+const size_t header_size = 24;
+const size_t event_size = 12;
+const size_t sample_size = 12;
+
+struct Event {
+    uint8_t zone;
+    uint8_t depth;
+    uint32_t begin;
+    uint32_t cycles;
+};
+
+struct Dump {
+    uint32_t cpuclk = 0;
+    uint32_t frame_cycles = 0;
+    uint16_t dropped = 0;
+    std::vector<std::string> zones;
+    std::vector<Event> events;
+};
+
+uint16_t read_u16(const std::vector<uint8_t>& buf, size_t pos) {
+    return static_cast<uint16_t>(buf[pos] | (buf[pos + 1] << 8));
+}
+
+uint32_t read_u32(const std::vector<uint8_t>& buf, size_t pos) {
+    return read_u16(buf, pos) | (static_cast<uint32_t>(read_u16(buf, pos + 2)) << 16);
+}
+
+struct Sample {
+    uint32_t pc;
+    uint16_t pid;
+    uint32_t count;
+};
+
+struct SampleDump {
+    uint32_t cpuclk = 0;
+    uint32_t total = 0;
+    uint32_t lost = 0;
+    std::vector<Sample> samples;
+};
+
+struct Symbol {
+    uint32_t addr;
+    uint32_t size;  // 0 if unknown
+    std::string name;
+};
+
+std::string demangle(const std::string& name) {
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+    if (status != 0 || demangled == nullptr) return name;
+    std::string result(demangled);
+    std::free(demangled);
+    return result;
+}
+
+// Reads the function symbols of a 32-bit little endian ELF file.
+std::vector<Symbol> load_elf_symbols(const std::vector<uint8_t>& elf) {
+    if (elf.size() < 52 || elf[4] != 1 || elf[5] != 1) {
+        throw std::runtime_error("Only 32-bit little endian ELF files are supported");
+    }
+    auto u16 = [&](size_t pos) { return static_cast<uint16_t>(elf[pos] | (elf[pos + 1] << 8)); };
+    auto u32 = [&](size_t pos) { return static_cast<uint32_t>(u16(pos) | (u16(pos + 2) << 16)); };
+
+    const uint32_t shoff = u32(32);
+    const uint16_t shentsize = u16(46);
+    const uint16_t shnum = u16(48);
+    if (shoff + static_cast<size_t>(shentsize) * shnum > elf.size()) {
+        throw std::runtime_error("Broken ELF section headers");
+    }
+
+    std::vector<Symbol> symbols;
+    for (uint16_t nn = 0; nn < shnum; ++nn) {
+        const size_t sh = shoff + static_cast<size_t>(nn) * shentsize;
+        if (u32(sh + 4) != 2) continue;  // SHT_SYMTAB
+        const uint32_t off = u32(sh + 16);
+        const uint32_t size = u32(sh + 20);
+        const uint32_t link = u32(sh + 24);
+        const uint32_t entsize = u32(sh + 36);
+        if (link >= shnum || entsize < 16 || off + static_cast<size_t>(size) > elf.size()) continue;
+        const size_t strsh = shoff + static_cast<size_t>(link) * shentsize;
+        const uint32_t stroff = u32(strsh + 16);
+        const uint32_t strsize = u32(strsh + 20);
+        if (stroff + static_cast<size_t>(strsize) > elf.size()) continue;
+
+        for (uint32_t pos = off; pos + entsize <= off + size; pos += entsize) {
+            const uint32_t name = u32(pos);
+            const uint32_t value = u32(pos + 4);
+            const uint32_t symsize = u32(pos + 8);
+            if ((elf[pos + 12] & 0xf) != 2 || name >= strsize) continue;  // STT_FUNC
+            const char* str = reinterpret_cast<const char*>(&elf[stroff + name]);
+            symbols.push_back({value, symsize, demangle(std::string(str, strnlen(str, strsize - name)))});
+        }
+    }
+    return symbols;
+}
+
+// Reads the symbols listed in the memory map of a GNU ld map file.
+std::vector<Symbol> load_map_symbols(const std::string& text) {
+    // Symbol lines hold an address and a name, demangled by ld; assignments hold '='.
+    static const std::regex line_symbol(R"(^\s+0x([0-9a-fA-F]+)\s+([A-Za-z_][^=]*?)\s*$)");
+    std::vector<Symbol> symbols;
+    std::istringstream in(text);
+    std::string line;
+    bool in_map = false;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.rfind("Linker script and memory map", 0) == 0) in_map = true;
+        std::smatch m;
+        if (!in_map || !std::regex_match(line, m, line_symbol)) continue;
+        if (m[2].str().rfind("PROVIDE", 0) == 0) continue;
+        symbols.push_back({static_cast<uint32_t>(std::stoul(m[1].str(), nullptr, 16)), 0, demangle(m[2].str())});
+    }
+    return symbols;
+}
+
+std::vector<Symbol> load_symbols(const std::string& path) {
+    std::ifstream fin(path, std::ios::binary);
+    if (!fin) {
+        throw std::runtime_error("Cannot open symbol file: " + path);
+    }
+    std::vector<uint8_t> buf((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    std::vector<Symbol> symbols;
+    if (buf.size() >= 4 && std::memcmp(buf.data(), "\x7f" "ELF", 4) == 0) {
+        symbols = load_elf_symbols(buf);
+    } else {
+        symbols = load_map_symbols(std::string(buf.begin(), buf.end()));
+    }
+    if (symbols.empty()) {
+        throw std::runtime_error(path + " contains no symbols");
+    }
+    std::sort(symbols.begin(), symbols.end(), [](const Symbol& a, const Symbol& b) { return a.addr < b.addr; });
+    return symbols;
+}
+
+// Returns the function that contains pc, or the pc in hex if none does.
+std::string symbolize(const std::vector<Symbol>& symbols, uint32_t pc) {
+    auto it = std::upper_bound(symbols.begin(), symbols.end(), pc,
+                               [](uint32_t value, const Symbol& sym) { return value < sym.addr; });
+    if (it != symbols.begin()) {
+        --it;
+        if (it->size == 0 || pc < it->addr + it->size) return it->name;
+    }
+    std::ostringstream hex;
+    hex << "0x" << std::hex << std::setw(8) << std::setfill('0') << pc;
+    return hex.str();
+}
+
+// Parses one sampling dump at pos. Returns the position after it, or 0 if it is truncated or broken.
+size_t parse_sample_dump(const std::vector<uint8_t>& buf, size_t pos, SampleDump& dump) {
+    if (pos + header_size > buf.size()) return 0;
+    if (read_u16(buf, pos + 4) != dump_version) return 0;
+    dump.cpuclk = read_u32(buf, pos + 8);
+    dump.total = read_u32(buf, pos + 12);
+    dump.lost = read_u32(buf, pos + 16);
+    const uint16_t nsamples = read_u16(buf, pos + 20);
+    pos += header_size;
+
+    if (pos + nsamples * sample_size > buf.size()) return 0;
+    for (uint16_t nn = 0; nn < nsamples; ++nn) {
+        dump.samples.push_back({read_u32(buf, pos), read_u16(buf, pos + 4), read_u32(buf, pos + 8)});
+        pos += sample_size;
+    }
+    return pos;
+}
+
+// Adds the samples of each thread and function to folded, and to flat per function.
+void fold_samples(const SampleDump& dump, const std::vector<Symbol>& symbols,
+                  std::map<std::string, uint64_t>& folded, std::map<std::string, uint64_t>& flat) {
+    for (const Sample& ss : dump.samples) {
+        const std::string func = symbolize(symbols, ss.pc);
+        folded["thread " + std::to_string(ss.pid) + ";" + func] += ss.count;
+        flat[func] += ss.count;
+    }
+}
+
+// Parses one dump at pos. Returns the position after it, or 0 if it is truncated or broken.
+size_t parse_dump(const std::vector<uint8_t>& buf, size_t pos, Dump& dump) {
+    if (pos + header_size > buf.size()) return 0;
+    if (read_u16(buf, pos + 4) != dump_version) return 0;
+    const uint16_t nzones = read_u16(buf, pos + 6);
+    dump.cpuclk = read_u32(buf, pos + 8);
+    dump.frame_cycles = read_u32(buf, pos + 12);
+    const uint16_t nevents = read_u16(buf, pos + 16);
+    dump.dropped = read_u16(buf, pos + 18);
+    pos += header_size;
+
+    for (uint16_t nn = 0; nn < nzones; ++nn) {
+        if (pos >= buf.size()) return 0;
+        const size_t len = buf[pos++];
+        if (pos + len > buf.size()) return 0;
+        dump.zones.emplace_back(reinterpret_cast<const char*>(&buf[pos]), len);
+        pos += len;
+    }
+
+    if (pos + nevents * event_size > buf.size()) return 0;
+    for (uint16_t nn = 0; nn < nevents; ++nn) {
+        Event ev;
+        ev.zone = buf[pos];
+        ev.depth = buf[pos + 1];
+        ev.begin = read_u32(buf, pos + 4);
+        ev.cycles = read_u32(buf, pos + 8);
+        if (ev.zone >= nzones) return 0;
+        dump.events.push_back(ev);
+        pos += event_size;
+    }
+    return pos;
+}
+
+// Rebuilds the nesting from depth and begin, and adds the self cycles of each stack to folded.
+void fold_dump(const Dump& dump, std::map<std::string, uint64_t>& folded) {
+    std::vector<Event> events = dump.events;
+    std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        return a.begin != b.begin ? a.begin < b.begin : a.depth < b.depth;
+    });
+
+    struct Open {
+        const Event* ev;
+        std::string path;
+        uint64_t self;
+    };
+    std::vector<Open> stack;
+    auto close = [&]() {
+        folded[stack.back().path] += stack.back().self;
+        stack.pop_back();
+    };
+
+    for (const Event& ev : events) {
+        const uint64_t end = static_cast<uint64_t>(ev.begin) + ev.cycles;
+        while (!stack.empty()) {
+            const Event* top = stack.back().ev;
+            if (top->depth < ev.depth && end <= static_cast<uint64_t>(top->begin) + top->cycles) break;
+            close();
+        }
+        std::string path = dump.zones[ev.zone];
+        if (!stack.empty()) {
+            Open& parent = stack.back();
+            parent.self -= std::min<uint64_t>(parent.self, ev.cycles);
+            path = parent.path + ";" + path;
+        }
+        stack.push_back({&ev, path, ev.cycles});
+    }
+    while (!stack.empty()) close();
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        ArgumentParser parser("b8prof");
+        parser.add_argument("-i", "specify the SCI capture that contains the profiler dumps", true);
+        parser.add_argument("-o", "folded stacks to be written (default: stdout)", false);
+        parser.add_argument("-n", "use only the n-th dump, counted from 0 (default: sum of all dumps)", false);
+        parser.add_argument("-m", "specify the .elf or .map file of the program to symbolize the samples", false);
+        parser.parse_args(argc, argv);
+        std::string input = parser.get("-i");
+        std::string output = parser.get("-o");
+        int only = parser.get("-n").empty() ? -1 : std::stoi(parser.get("-n"));
+        std::vector<Symbol> symbols;
+        if (!parser.get("-m").empty()) {
+            symbols = load_symbols(parser.get("-m"));
+        }
+
+        std::ifstream fin(input, std::ios::binary);
+        if (!fin) {
+            throw std::runtime_error("Cannot open input file: " + input);
+        }
+        std::vector<uint8_t> buf((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+        fin.close();
+
+        // The capture may mix the dumps with any other output of the program.
+        std::map<std::string, uint64_t> folded;
+        std::map<std::string, uint64_t> flat;
+        uint64_t flat_total = 0;
+        int found = 0;
+        for (size_t pos = 0; pos + sizeof(signature) - 1 <= buf.size();) {
+            if (std::memcmp(&buf[pos], sample_signature, sizeof(sample_signature) - 1) == 0) {
+                SampleDump dump;
+                size_t next = parse_sample_dump(buf, pos, dump);
+                if (next == 0) {
+                    ++pos;
+                    continue;
+                }
+                if (only < 0 || only == found) {
+                    fold_samples(dump, symbols, folded, flat);
+                    flat_total += dump.total - dump.lost;
+                    std::cerr << "dump " << found << ": " << dump.samples.size() << " pcs, "
+                              << dump.total << " samples, " << dump.lost << " lost" << std::endl;
+                }
+                ++found;
+                pos = next;
+                continue;
+            }
+            if (std::memcmp(&buf[pos], signature, sizeof(signature) - 1) != 0) {
+                ++pos;
+                continue;
+            }
+            Dump dump;
+            size_t next = parse_dump(buf, pos, dump);
+            if (next == 0) {
+                ++pos;
+                continue;
+            }
+            if (only < 0 || only == found) {
+                fold_dump(dump, folded);
+                std::cerr << "dump " << found << ": " << dump.events.size() << " events, "
+                          << dump.dropped << " dropped, " << dump.frame_cycles << " cycles";
+                if (dump.cpuclk) {
+                    std::cerr << " (" << (static_cast<uint64_t>(dump.frame_cycles) * 1000000 / dump.cpuclk) << " us)";
+                }
+                std::cerr << std::endl;
+            }
+            ++found;
+            pos = next;
+        }
+        if (found == 0) {
+            throw std::runtime_error(input + " contains no profiler dump");
+        }
+        if (only >= found) {
+            throw std::runtime_error("The given parameter value " + std::to_string(only) + " for -n is invalid.");
+        }
+
+        // Flat profile of the samples, busiest function first.
+        std::vector<std::pair<std::string, uint64_t>> funcs(flat.begin(), flat.end());
+        std::stable_sort(funcs.begin(), funcs.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+        for (size_t nn = 0; nn < funcs.size() && nn < 20; ++nn) {
+            std::cerr << std::setw(8) << funcs[nn].second << " " << std::fixed << std::setprecision(1)
+                      << std::setw(5) << (100.0 * funcs[nn].second / flat_total) << "% " << funcs[nn].first << std::endl;
+        }
+
+        std::ofstream fout;
+        if (!output.empty()) {
+            fout.open(output);
+            if (!fout) {
+                throw std::runtime_error("Cannot open output file: " + output);
+            }
+        }
+        std::ostream& out = output.empty() ? std::cout : fout;
+        for (const auto& [path, cycles] : folded) {
+            if (cycles) out << path << " " << cycles << "\n";
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "\033[1;31mb8prof Exception: " << e.what() << "\033[0m" << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
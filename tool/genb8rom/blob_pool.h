@@ -0,0 +1,65 @@
+#pragma once
+// Appends blobs to the packed data of genb8rom, sharing one copy between files
+// with identical contents.
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+
+class BlobPool {
+public:
+    using HashFn = uint64_t (*)(const std::vector<uint8_t>&);
+
+    // FNV-1a over the whole blob
+    static uint64_t content_hash(const std::vector<uint8_t>& blob) {
+        uint64_t hash = 14695981039346656037ull;
+        for (uint8_t cc : blob) {
+            hash ^= cc;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+private:
+    struct Blob {
+        uint32_t offset;    // in _packdata
+        uint32_t size;
+    };
+
+    std::vector<uint8_t>& _packdata;
+    HashFn _hash;
+    std::unordered_multimap<uint64_t, Blob> _blobs;     // content hash -> blobs with that hash
+
+public:
+    size_t shared_files = 0;
+    uint64_t saved_bytes = 0;
+
+    explicit BlobPool(std::vector<uint8_t>& packdata, HashFn hash = content_hash)
+        : _packdata(packdata), _hash(hash) {}
+
+    // Returns the offset of the blob in the packed data.
+    uint32_t add(const std::vector<uint8_t>& blob) {
+        const uint64_t hash = _hash(blob);
+        const auto range = _blobs.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            // Blobs with the same hash may differ in size, and a longer one would read past the pool.
+            const Blob& stored = it->second;
+            if (stored.size != blob.size()) continue;
+            if (std::equal(blob.begin(), blob.end(), _packdata.begin() + stored.offset)) {
+                ++shared_files;
+                saved_bytes += (blob.size() + 3) & ~size_t(3);
+                return stored.offset;
+            }
+        }
+
+        const uint32_t offset = static_cast<uint32_t>(_packdata.size());
+        _packdata.insert(_packdata.end(), blob.begin(), blob.end());
+        size_t npad = (_packdata.size() + 4) - (_packdata.size() & 3) - _packdata.size();
+        if (npad < 4) {
+            _packdata.insert(_packdata.end(), npad, 0);
+        }
+        _blobs.emplace(hash, Blob{offset, static_cast<uint32_t>(blob.size())});
+        return offset;
+    }
+};
@@ -7,36 +7,202 @@
 #include <cstring>
 #include <cstdint>
 #include <regex>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <sstream>
 #include "argparse.h"
+#include "blob_pool.h"
+#include "zpack.h"
 
 using namespace std;
 namespace fs = std::filesystem;
 
 const uint16_t fat_section_start = 16;
 const uint8_t one_fat_bytesize = 48;
+const uint8_t compact_fat_bytesize = 2 * 4;
 const uint32_t max_len_of_fname = one_fat_bytesize - 2 * 4;
+const uint32_t max_len_of_index_name = 255;
+const uint32_t index_offset_pos = 12;
 
 class OneFile {
 public:
     string fname;
     uint32_t len;
     uint32_t offset;
+    uint32_t orgsize = 0;   // size before compression, 0 when stored as-is
+    uint8_t method = 0;     // 0: stored, 1 + zpack::Method
 
     OneFile(const string& filename, uint32_t length, uint32_t offset)
         : fname(fs::path(filename).filename().string()), len(length), offset(offset) {}
 };
 
+// Per file type totals reported with -v
+struct PackStats {
+    size_t files = 0;
+    size_t packed_files = 0;
+    uint64_t org_bytes = 0;
+    uint64_t stored_bytes = 0;
+    double decode_sec = 0.0;
+    uint64_t decoded_bytes = 0;
+};
+
+/*
+  Name index, placed after the packed data. Its offset from the top of the
+  image is stored at header offset 12 (0 if absent).
+    u32 number of entries
+    entries sorted by (hash, name):
+      u32 hash      FNV-1a of the name
+      u16 fat_no    index into the FAT
+      u16 name_len
+      u32 name      offset of the name from the top of the image
+      u32 orgsize   [23:0] size before compression, [31:24] 0: stored, 1 + ZPack method
+    string pool     '\0' terminated names, only with a compact FAT (-c). Otherwise
+                    the names are those of the FAT entries.
+*/
+struct IndexEntry {
+    uint32_t hash;
+    uint16_t fat_no;
+    uint16_t name_len;
+    uint32_t name;
+    uint32_t orgsize;
+};
+
+uint32_t name_hash(const string& name) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+vector<uint8_t> build_index(const vector<OneFile>& file_list, uint32_t index_offset, uint8_t fat_bytesize,
+                            bool compact, bool verbose) {
+    vector<size_t> order(file_list.size());
+    vector<uint32_t> hashes(file_list.size());
+    for (size_t nn = 0; nn < file_list.size(); ++nn) {
+        order[nn] = nn;
+        hashes[nn] = name_hash(file_list[nn].fname);
+    }
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (hashes[a] != hashes[b]) return hashes[a] < hashes[b];
+        return file_list[a].fname < file_list[b].fname;
+    });
+
+    const uint32_t entries_bytesize = 4 + static_cast<uint32_t>(order.size() * sizeof(IndexEntry));
+    vector<IndexEntry> entries;
+    string pool;
+    size_t collisions = 0;
+    size_t longest_run = order.empty() ? 0 : 1;
+    size_t run = 0;
+    for (size_t nn = 0; nn < order.size(); ++nn) {
+        const OneFile& of = file_list[order[nn]];
+        if (nn > 0 && hashes[order[nn]] == hashes[order[nn - 1]]) {
+            ++collisions;
+            longest_run = max(longest_run, ++run);
+        } else {
+            run = 1;
+        }
+        const uint32_t name = compact
+            ? index_offset + entries_bytesize + static_cast<uint32_t>(pool.size())
+            : fat_section_start + static_cast<uint32_t>(order[nn]) * fat_bytesize + 2 * 4;
+        entries.push_back({hashes[order[nn]], static_cast<uint16_t>(order[nn]),
+                           static_cast<uint16_t>(of.fname.size()), name,
+                           of.orgsize | (static_cast<uint32_t>(of.method) << 24)});
+        if (compact) {
+            pool += of.fname;
+            pool += '\0';
+        }
+    }
+    while (pool.size() & 3) pool += '\0';
+
+    vector<uint8_t> index(entries_bytesize + pool.size());
+    const uint32_t num_entries = static_cast<uint32_t>(entries.size());
+    memcpy(index.data(), &num_entries, 4);
+    uint8_t* pp = index.data() + 4;
+    for (const auto& ent : entries) {
+        memcpy(pp + 0, &ent.hash, 4);
+        memcpy(pp + 4, &ent.fat_no, 2);
+        memcpy(pp + 6, &ent.name_len, 2);
+        memcpy(pp + 8, &ent.name, 4);
+        memcpy(pp + 12, &ent.orgsize, 4);
+        pp += sizeof(IndexEntry);
+    }
+    memcpy(pp, pool.data(), pool.size());
+
+    if (verbose) {
+        cout << "index: " << entries.size() << " entries, "
+             << index.size() << " bytes (string pool " << pool.size() << " bytes), "
+             << collisions << " hash collisions, longest run " << longest_run << endl;
+    }
+    return index;
+}
+
 bool match_pattern(const string& pattern, const string& str) {
     string regex_pattern = std::regex_replace(pattern, std::regex("\\*"), ".*");
     return std::regex_match(str, std::regex(regex_pattern));
 }
 
+bool match_any_pattern(const vector<string>& patterns, const string& str) {
+    for (const auto& pattern : patterns) {
+        if (match_pattern(pattern, str)) return true;
+    }
+    return false;
+}
+
+// Compresses fdata in place when ZPack makes it smaller. The packed stream is
+// decoded again and compared, so a broken stream never reaches the image.
+void pack_file(OneFile& onefile, vector<uint8_t>& fdata, PackStats& stats) {
+    ++stats.files;
+    stats.org_bytes += fdata.size();
+    if (fdata.empty() || fdata.size() > 0xffffff) {
+        stats.stored_bytes += fdata.size();
+        return;
+    }
+
+    zpack::Method method;
+    vector<uint8_t> packed = zpack::encode(fdata, method);
+    if (method == zpack::Flat || packed.size() >= fdata.size()) {
+        stats.stored_bytes += fdata.size();
+        return;
+    }
+
+    vector<uint8_t> decoded;
+    const auto t0 = chrono::steady_clock::now();
+    const bool ok = zpack::decode(packed, decoded);
+    stats.decode_sec += chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    stats.decoded_bytes += decoded.size();
+    if (!ok || decoded != fdata) {
+        throw runtime_error("ZPack round trip failed: " + onefile.fname);
+    }
+
+    ++stats.packed_files;
+    stats.stored_bytes += packed.size();
+    onefile.orgsize = static_cast<uint32_t>(fdata.size());
+    onefile.method = static_cast<uint8_t>(1 + method);
+    onefile.len = static_cast<uint32_t>(packed.size());
+    fdata.swap(packed);
+}
+
+void print_pack_stats(const map<string, PackStats>& stats_by_ext) {
+    cout << "zpack: type files packed org_bytes stored_bytes ratio decode_MB/s(host)" << endl;
+    for (const auto& [ext, st] : stats_by_ext) {
+        const double ratio = st.org_bytes ? double(st.stored_bytes) / double(st.org_bytes) : 1.0;
+        const double mbps = st.decode_sec > 0.0 ? double(st.decoded_bytes) / st.decode_sec / 1e6 : 0.0;
+        cout << "zpack: " << (ext.empty() ? "(none)" : ext) << " " << st.files << " " << st.packed_files << " "
+             << st.org_bytes << " " << st.stored_bytes << " " << ratio << " " << mbps << endl;
+    }
+}
+
 int main(int argc, char* argv[]) {
     ArgumentParser program("genromfs");
 
     program.add_argument("-i", "input path or pattern", true);
     program.add_argument("-o", "output bin file", true);
     program.add_argument("-v", "increase output verbosity", false);
+    program.add_argument("-c", "compact FAT: keep file names only in the name index", false);
+    program.add_argument("-z", "compress files matching these comma separated patterns with ZPack", false);
 
     try {
         program.parse_args(argc, argv);
@@ -47,9 +213,20 @@ int main(int argc, char* argv[]) {
     }
 
     bool verbose = !program.get("-v").empty();
+    bool compact = !program.get("-c").empty();
     string input_pattern = program.get("-i");
     string out_bin = program.get("-o");
 
+    vector<string> zpack_patterns;
+    {
+        stringstream ss(program.get("-z"));
+        string pattern;
+        while (getline(ss, pattern, ',')) {
+            if (!pattern.empty()) zpack_patterns.push_back(pattern);
+        }
+    }
+    map<string, PackStats> stats_by_ext;
+
     if (verbose) {
         cout << "input_pattern: " << input_pattern << endl;
         cout << "out_bin: " << out_bin << endl;
@@ -65,13 +242,15 @@ int main(int argc, char* argv[]) {
 
     vector<OneFile> file_list;
     vector<uint8_t> packdata;
+    BlobPool blobs(packdata);
 
     for (const auto& entry : fs::directory_iterator(input_path)) {
         if (entry.is_regular_file() && match_pattern(file_pattern, entry.path().filename().string())) {
             string file = entry.path().string();
 
-            if (fs::path(file).filename().string().length() >= max_len_of_fname) {
-                throw runtime_error("file name " + file + " exceeds " + to_string(max_len_of_fname) + " bytes in length");
+            const uint32_t max_len = compact ? max_len_of_index_name : max_len_of_fname;
+            if (fs::path(file).filename().string().length() >= max_len) {
+                throw runtime_error("file name " + file + " exceeds " + to_string(max_len) + " bytes in length");
             }
 
             ifstream fr(file, ios::binary);
@@ -82,16 +261,32 @@ int main(int argc, char* argv[]) {
             vector<uint8_t> fdata((istreambuf_iterator<char>(fr)), istreambuf_iterator<char>());
             fr.close();
 
-            OneFile onefile(file, fdata.size(), packdata.size());
+            OneFile onefile(file, fdata.size(), 0);
+            if (match_any_pattern(zpack_patterns, onefile.fname)) {
+                pack_file(onefile, fdata, stats_by_ext[fs::path(file).extension().string()]);
+            }
+            onefile.offset = blobs.add(fdata);
             file_list.push_back(onefile);
+        }
+    }
 
-            packdata.insert(packdata.end(), fdata.begin(), fdata.end());
+    if (file_list.size() > 0xffff) {
+        throw runtime_error("too many files: " + to_string(file_list.size()));
+    }
 
-            size_t npad = (packdata.size() + 4) - (packdata.size() & 3) - packdata.size();
-            if (npad < 4) {
-                packdata.insert(packdata.end(), npad, 0);
-            }
-        }
+    const uint8_t fat_bytesize = compact ? compact_fat_bytesize : one_fat_bytesize;
+    const uint32_t index_offset = fat_section_start + file_list.size() * fat_bytesize + packdata.size();
+    vector<uint8_t> index = build_index(file_list, index_offset, fat_bytesize, compact, verbose);
+
+    if (verbose && !stats_by_ext.empty()) {
+        print_pack_stats(stats_by_ext);
+    }
+
+    if (verbose) {
+        cout << "dedup: " << blobs.shared_files << " files share data with another file, "
+             << blobs.saved_bytes << " bytes saved" << endl;
+        cout << "fat: " << file_list.size() << " entries, " << file_list.size() * fat_bytesize << " bytes"
+             << (compact ? " (compact)" : "") << endl;
     }
 
     ofstream fat(out_bin, ios::binary);
@@ -103,13 +298,15 @@ int main(int argc, char* argv[]) {
     uint16_t num_files = file_list.size();
     fat.write(reinterpret_cast<char*>(&num_files), 2);
     fat.write(reinterpret_cast<const char*>(&fat_section_start), 2);
-    fat.write(reinterpret_cast<const char*>(&one_fat_bytesize), 1);
-    vector<uint8_t> header_padding(fat_section_start - (4 + 2 + 2 + 1), 0);
+    fat.write(reinterpret_cast<const char*>(&fat_bytesize), 1);
+    vector<uint8_t> header_padding(index_offset_pos - (4 + 2 + 2 + 1), 0);
     fat.write(reinterpret_cast<char*>(header_padding.data()), header_padding.size());
+    fat.write(reinterpret_cast<const char*>(&index_offset), 4);
 
     for (const auto& of : file_list) {
       fat.write(reinterpret_cast<const char*>(&of.offset), 4);
       fat.write(reinterpret_cast<const char*>(&of.len), 4);
+      if (compact) continue;
       vector<uint8_t> fname_bytes(of.fname.begin(), of.fname.end());
       vector<uint8_t> fname_padding(one_fat_bytesize - 2 * 4 - fname_bytes.size(), 0);
       fat.write(reinterpret_cast<char*>(fname_bytes.data()), fname_bytes.size());
@@ -117,6 +314,7 @@ int main(int argc, char* argv[]) {
     }
 
     fat.write(reinterpret_cast<char*>(packdata.data()), packdata.size());
+    fat.write(reinterpret_cast<char*>(index.data()), index.size());
     fat.close();
 
     return 0;
@@ -0,0 +1,292 @@
+#pragma once
+// Host side of the ZPack stream format used by sdk/b8helper (zpack.cpp, huffman.cpp, rle.cpp).
+// The target's codecs depend on the BEEP-8 runtime, so genb8rom carries its own
+// encoder, plus a decoder to verify every packed file before it is written.
+// sdk/test/test_zpack.cpp decodes this encoder's streams with the b8helper
+// decoder and the reverse, so run it (make -C sdk/test) after changing either side.
+//
+//  ZPack   u8 0x99, u8 method (0:huffman->rle 1:huffman 2:flat 3:flat with size), payload
+//  Huffman bits, MSB first
+//          8 signature 0x77, 1 flat(=0), 9 number of codes,
+//          { 5 len, len code, 8 data } x number of codes,
+//          20 original size, codes...
+//  RLE     n>0: repeat the next byte n times, n<0: copy -n bytes, 0: end
+
+#include <vector>
+#include <queue>
+#include <cstdint>
+#include <algorithm>
+
+namespace zpack {
+
+enum Method : uint8_t {
+    HuffmanToRle,
+    Huffman,
+    Flat,
+    FlatWithSize,
+};
+
+const uint8_t signature = 0x99;
+const uint8_t huffman_signature = 0x77;
+const uint32_t huffman_max_size_pow2 = 20;
+const uint32_t huffman_max_code_len = 31;
+
+class BitWriter {
+    std::vector<uint8_t>& _out;
+    uint8_t _byte = 0;
+    int _bits = 0;
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : _out(out) {}
+    void push(bool b) {
+        _byte = static_cast<uint8_t>((_byte << 1) | (b ? 1 : 0));
+        if (++_bits == 8) {
+            _out.push_back(_byte);
+            _byte = 0;
+            _bits = 0;
+        }
+    }
+    void push(uint32_t bits, uint32_t value) {
+        for (int sft = static_cast<int>(bits) - 1; sft >= 0; --sft) push((value >> sft) & 1);
+    }
+    void flush() {
+        while (_bits) push(false);
+    }
+};
+
+class BitReader {
+    const uint8_t* _pp;
+    const uint8_t* _end;
+    uint8_t _byte = 0;
+    int _bits = 0;
+public:
+    BitReader(const uint8_t* pp, const uint8_t* end) : _pp(pp), _end(end) {}
+    bool ok = true;
+    bool pop() {
+        if (_bits == 0) {
+            if (_pp >= _end) {
+                ok = false;
+                return false;
+            }
+            _byte = *_pp++;
+            _bits = 8;
+        }
+        --_bits;
+        return (_byte >> _bits) & 1;
+    }
+    uint32_t pop(uint32_t bits) {
+        uint32_t value = 0;
+        for (uint32_t nn = 0; nn < bits; ++nn) value = (value << 1) | (pop() ? 1 : 0);
+        return value;
+    }
+};
+
+// Returns an empty vector when the data cannot be Huffman coded.
+inline std::vector<uint8_t> huffman_encode(const std::vector<uint8_t>& in) {
+    std::vector<uint8_t> out;
+    if (in.empty() || in.size() >= (1u << huffman_max_size_pow2)) return out;
+
+    uint32_t freq[0x100] = {};
+    for (uint8_t cc : in) ++freq[cc];
+
+    // code lengths from the tree depth of every leaf
+    struct Node { uint64_t freq; int left, right, sym; };
+    std::vector<Node> nodes;
+    using Item = std::pair<uint64_t, int>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+    for (int sym = 0; sym < 0x100; ++sym) {
+        if (freq[sym] == 0) continue;
+        nodes.push_back({freq[sym], -1, -1, sym});
+        heap.push({freq[sym], static_cast<int>(nodes.size() - 1)});
+    }
+    while (heap.size() > 1) {
+        const Item a = heap.top(); heap.pop();
+        const Item b = heap.top(); heap.pop();
+        nodes.push_back({a.first + b.first, a.second, b.second, -1});
+        heap.push({a.first + b.first, static_cast<int>(nodes.size() - 1)});
+    }
+
+    uint32_t len[0x100] = {};
+    std::vector<std::pair<int, uint32_t>> stack = {{heap.top().second, 0}};
+    while (!stack.empty()) {
+        const auto [idx, depth] = stack.back();
+        stack.pop_back();
+        const Node& node = nodes[idx];
+        if (node.sym >= 0) {
+            len[node.sym] = depth;
+        } else {
+            stack.push_back({node.left, depth + 1});
+            stack.push_back({node.right, depth + 1});
+        }
+    }
+
+    // canonical codes
+    std::vector<int> syms;
+    for (int sym = 0; sym < 0x100; ++sym) {
+        if (freq[sym] == 0) continue;
+        if (len[sym] > huffman_max_code_len) return out;
+        syms.push_back(sym);
+    }
+    std::sort(syms.begin(), syms.end(), [&](int a, int b) {
+        return len[a] != len[b] ? len[a] < len[b] : a < b;
+    });
+    uint32_t code[0x100] = {};
+    uint32_t next = 0;
+    uint32_t prev_len = len[syms.front()];
+    for (size_t nn = 0; nn < syms.size(); ++nn) {
+        if (nn > 0) {
+            next = (next + 1) << (len[syms[nn]] - prev_len);
+            prev_len = len[syms[nn]];
+        }
+        code[syms[nn]] = next;
+    }
+
+    BitWriter bw(out);
+    bw.push(8, huffman_signature);
+    bw.push(false);
+    bw.push(9, static_cast<uint32_t>(syms.size()));
+    for (int sym : syms) {
+        bw.push(5, len[sym]);
+        bw.push(len[sym], code[sym]);
+        bw.push(8, sym);
+    }
+    bw.push(huffman_max_size_pow2, static_cast<uint32_t>(in.size()));
+    for (uint8_t cc : in) bw.push(len[cc], code[cc]);
+    bw.flush();
+    return out;
+}
+
+inline std::vector<uint8_t> rle_encode(const std::vector<uint8_t>& in) {
+    std::vector<uint8_t> out;
+    size_t ii = 0;
+    while (ii < in.size()) {
+        size_t run = 1;
+        while (ii + run < in.size() && in[ii + run] == in[ii] && run < 0x7f) ++run;
+        if (run >= 3) {
+            out.push_back(static_cast<uint8_t>(run));
+            out.push_back(in[ii]);
+            ii += run;
+            continue;
+        }
+
+        size_t lit = 0;
+        while (ii + lit < in.size() && lit < 0x7f) {
+            const size_t pos = ii + lit;
+            if (pos + 2 < in.size() && in[pos] == in[pos + 1] && in[pos] == in[pos + 2]) break;
+            ++lit;
+        }
+        out.push_back(static_cast<uint8_t>(-static_cast<int>(lit)));
+        out.insert(out.end(), in.begin() + ii, in.begin() + ii + lit);
+        ii += lit;
+    }
+    out.push_back(0x00);
+    return out;
+}
+
+inline bool huffman_decode(BitReader& br, std::vector<uint8_t>& out) {
+    if (br.pop(8) != huffman_signature) return false;
+    if (br.pop()) return false;   // flat huffman is never emitted by this encoder
+
+    const uint16_t nil = 0xffff;
+    std::vector<uint16_t> left(1, nil), right(1, nil);
+    std::vector<uint8_t> data(1, 0);
+    const uint32_t num = br.pop(9);
+    for (uint32_t nn = 0; nn < num; ++nn) {
+        const uint32_t len = br.pop(5);
+        const uint32_t code = br.pop(len);
+        const uint8_t sym = static_cast<uint8_t>(br.pop(8));
+        uint16_t cur = 0;
+        for (int bit = static_cast<int>(len) - 1; bit >= 0; --bit) {
+            std::vector<uint16_t>& next = ((code >> bit) & 1) ? right : left;
+            if (next[cur] == nil) {
+                next[cur] = static_cast<uint16_t>(left.size());
+                left.push_back(nil);
+                right.push_back(nil);
+                data.push_back(0);
+            }
+            cur = next[cur];
+        }
+        data[cur] = sym;
+    }
+
+    const uint32_t size = br.pop(huffman_max_size_pow2);
+    uint16_t cur = 0;
+    while (br.ok && out.size() < size) {
+        if (left[cur] == nil && right[cur] == nil) {
+            out.push_back(data[cur]);
+            cur = 0;
+        } else {
+            cur = br.pop() ? right[cur] : left[cur];
+            if (cur == nil) return false;
+        }
+    }
+    return br.ok;
+}
+
+inline bool rle_decode(const uint8_t* pp, const uint8_t* end, std::vector<uint8_t>& out) {
+    while (pp < end) {
+        const int8_t n = static_cast<int8_t>(*pp++);
+        if (n == 0) return true;
+        if (n > 0) {
+            if (pp >= end) return false;
+            out.insert(out.end(), n, *pp++);
+        } else {
+            if (end - pp < -n) return false;
+            out.insert(out.end(), pp, pp - n);
+            pp -= n;
+        }
+    }
+    return false;
+}
+
+// Picks the smallest ZPack method. The caller stores the file as-is when the
+// result is not smaller than the input.
+inline std::vector<uint8_t> encode(const std::vector<uint8_t>& in, Method& method) {
+    std::vector<uint8_t> best;
+    const std::vector<uint8_t> huf = huffman_encode(in);
+    method = Flat;
+    best = in;
+    if (!huf.empty()) {
+        const std::vector<uint8_t> huf_rle = rle_encode(huf);
+        if (huf.size() < best.size()) {
+            method = Huffman;
+            best = huf;
+        }
+        if (huf_rle.size() < best.size()) {
+            method = HuffmanToRle;
+            best = huf_rle;
+        }
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(2 + best.size());
+    out.push_back(signature);
+    out.push_back(static_cast<uint8_t>(method));
+    out.insert(out.end(), best.begin(), best.end());
+    return out;
+}
+
+inline bool decode(const std::vector<uint8_t>& in, std::vector<uint8_t>& out) {
+    out.clear();
+    if (in.size() < 2 || in[0] != signature) return false;
+    const uint8_t* pp = in.data() + 2;
+    const uint8_t* end = in.data() + in.size();
+    switch (in[1] & 3) {
+        case HuffmanToRle: {
+            std::vector<uint8_t> huf;
+            if (!rle_decode(pp, end, huf)) return false;
+            BitReader br(huf.data(), huf.data() + huf.size());
+            return huffman_decode(br, out);
+        }
+        case Huffman: {
+            BitReader br(pp, end);
+            return huffman_decode(br, out);
+        }
+        case Flat:
+            out.assign(pp, end);
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace zpack